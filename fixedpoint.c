@@ -4,6 +4,27 @@
 #include <ctype.h>
 #include <assert.h>
 #include "fixedpoint.h"
+#include "fixedpoint_wide.h"
+
+// All ones if val is a valid value, 0 otherwise. VALID_NONNEGATIVE and
+// VALID_NEGATIVE are the two smallest tags, so no branch is needed.
+static inline uint64_t valid_mask(Fixedpoint val)
+{
+    return -(uint64_t)((unsigned)val.tag <= VALID_NEGATIVE);
+}
+
+// Build a value from a magnitude and a sign (0 or 1), or an error value if
+// error_mask is all ones, without branching. A zero magnitude is always
+// non-negative.
+static inline Fixedpoint make_value(u128 mag, uint64_t sign, uint64_t error_mask)
+{
+    Fixedpoint fixedpoint;
+    fixedpoint.whole = (uint64_t)(mag >> 64);
+    fixedpoint.frac = (uint64_t)mag;
+    sign &= (mag != 0);
+    fixedpoint.tag = (Tag)((sign & ~error_mask) | (ERROR & error_mask));
+    return fixedpoint;
+}
 
 Fixedpoint fixedpoint_create(uint64_t whole)
 {
@@ -332,7 +353,280 @@ Fixedpoint fixedpoint_halve(Fixedpoint val)
 
 Fixedpoint fixedpoint_double(Fixedpoint val)
 {
-    return fixedpoint_add(val, val);
+    return fixedpoint_shl(val, 1);
+}
+
+Fixedpoint fixedpoint_mul(Fixedpoint left, Fixedpoint right)
+{
+    return fixedpoint_mul_round(left, right, FIXEDPOINT_ROUND_EXACT);
+}
+
+Fixedpoint fixedpoint_mul_round(Fixedpoint left, Fixedpoint right, FixedpointRound mode)
+{
+    // The 256 bit product of the magnitudes, in units of 2^-128, as four
+    // 64 bit limbs (least significant first)
+    u128 lo = (u128)left.frac * right.frac;
+    u128 mid1 = (u128)left.whole * right.frac;
+    u128 mid2 = (u128)left.frac * right.whole;
+    u128 hi = (u128)left.whole * right.whole;
+    u128 mid = (lo >> 64) + (uint64_t)mid1 + (uint64_t)mid2;
+    u128 upper = hi + (mid1 >> 64) + (mid2 >> 64) + (mid >> 64);
+    uint64_t rem = (uint64_t)lo;
+    u128 quotient = (u128)(uint64_t)upper << 64 | (uint64_t)mid;
+    int negative = (left.tag ^ right.tag) & 1;
+
+    int round_up = 0;
+    if (rem != 0)
+    {
+        switch (mode)
+        {
+        case FIXEDPOINT_ROUND_NEAREST_EVEN:
+            round_up = rem > (1UL << 63) || (rem == (1UL << 63) && (quotient & 1));
+            break;
+        case FIXEDPOINT_ROUND_CEILING:
+            round_up = !negative;
+            break;
+        case FIXEDPOINT_ROUND_FLOOR:
+            round_up = negative;
+            break;
+        default:
+            break;
+        }
+    }
+    u128 rounded = quotient + round_up;
+
+    Fixedpoint product;
+    product.whole = (uint64_t)(rounded >> 64);
+    product.frac = (uint64_t)rounded;
+    if (!fixedpoint_is_valid(left) || !fixedpoint_is_valid(right))
+    {
+        product.tag = ERROR;
+    }
+    else if ((upper >> 64) != 0 || rounded < quotient)
+    {
+        product.tag = negative ? OVERFLOW_NEGATIVE : OVERFLOW_POSITIVE;
+    }
+    else if (mode == FIXEDPOINT_ROUND_EXACT && rem != 0)
+    {
+        product.tag = negative ? UNDERFLOW_NEGATIVE : UNDERFLOW_POSITIVE;
+    }
+    else
+    {
+        product.tag = negative && rounded != 0 ? VALID_NEGATIVE : VALID_NONNEGATIVE;
+    }
+    return product;
+}
+
+Fixedpoint fixedpoint_shl(Fixedpoint val, unsigned n)
+{
+    u128 mag = magnitude(val);
+    u128 shifted = n > 127 ? 0 : mag << n;
+
+    Fixedpoint result;
+    result.whole = (uint64_t)(shifted >> 64);
+    result.frac = (uint64_t)shifted;
+    result.tag = val.tag;
+
+    // Check whether any set bits were shifted out of the top
+    if (fixedpoint_is_valid(val) && (n > 127 ? mag != 0 : (shifted >> n) != mag))
+    {
+        result.tag = val.tag == VALID_NONNEGATIVE ? OVERFLOW_POSITIVE : OVERFLOW_NEGATIVE;
+    }
+    return result;
+}
+
+Fixedpoint fixedpoint_shr(Fixedpoint val, unsigned n, FixedpointRound mode, Fixedpoint *remainder)
+{
+    u128 mag = magnitude(val);
+    int negative = val.tag == VALID_NEGATIVE;
+
+    // Split the magnitude into the quotient and the shifted-out bits
+    u128 quotient;
+    u128 rem;
+    if (n == 0)
+    {
+        quotient = mag;
+        rem = 0;
+    }
+    else if (n > 127)
+    {
+        quotient = 0;
+        rem = mag;
+    }
+    else
+    {
+        quotient = mag >> n;
+        rem = mag & (((u128)1 << n) - 1);
+    }
+
+    if (remainder != NULL)
+    {
+        *remainder = make_value(rem, negative, 0);
+        // A value that is not valid passes its tag on, as to the quotient
+        if (!fixedpoint_is_valid(val))
+        {
+            remainder->tag = val.tag;
+        }
+    }
+
+    // Decide whether to round the magnitude up (away from zero). The
+    // quotient is below 2^127 whenever rem is nonzero, so this cannot carry out.
+    int round_up = 0;
+    if (rem != 0)
+    {
+        switch (mode)
+        {
+        case FIXEDPOINT_ROUND_NEAREST_EVEN:
+            if (n <= 128)
+            {
+                // Compare the shifted-out bits against one half of 2^n
+                u128 half = (u128)1 << (n - 1);
+                round_up = rem > half || (rem == half && (quotient & 1));
+            }
+            break;
+        case FIXEDPOINT_ROUND_CEILING:
+            round_up = !negative;
+            break;
+        case FIXEDPOINT_ROUND_FLOOR:
+            round_up = negative;
+            break;
+        default:
+            break;
+        }
+    }
+    quotient += round_up;
+
+    Fixedpoint result;
+    result.whole = (uint64_t)(quotient >> 64);
+    result.frac = (uint64_t)quotient;
+    if (!fixedpoint_is_valid(val))
+    {
+        result.tag = val.tag;
+    }
+    else if (mode == FIXEDPOINT_ROUND_EXACT && rem != 0)
+    {
+        result.tag = negative ? UNDERFLOW_NEGATIVE : UNDERFLOW_POSITIVE;
+    }
+    else
+    {
+        result.tag = negative && quotient != 0 ? VALID_NEGATIVE : VALID_NONNEGATIVE;
+    }
+    return result;
+}
+
+void fixedpoint_shl_batch(const Fixedpoint *vals, unsigned n, Fixedpoint *out, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        out[i] = fixedpoint_shl(vals[i], n);
+    }
+}
+
+void fixedpoint_shr_batch(const Fixedpoint *vals, unsigned n, FixedpointRound mode, Fixedpoint *out, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        out[i] = fixedpoint_shr(vals[i], n, mode, NULL);
+    }
+}
+
+int fixedpoint_clz(Fixedpoint val)
+{
+    if (val.whole != 0)
+    {
+        return __builtin_clzll(val.whole);
+    }
+    if (val.frac != 0)
+    {
+        return 64 + __builtin_clzll(val.frac);
+    }
+    return 128;
+}
+
+int fixedpoint_ilog2(Fixedpoint val)
+{
+    int clz = fixedpoint_clz(val);
+    return clz == 128 ? FIXEDPOINT_ILOG2_ZERO : 63 - clz;
+}
+
+// Saturating left + right, or left - right if negate_right is 1
+static inline Fixedpoint add_sat(Fixedpoint left, Fixedpoint right, uint64_t negate_right)
+{
+    u128 a = magnitude(left);
+    u128 b = magnitude(right);
+    uint64_t sign_a = left.tag & 1;
+    uint64_t sign_b = (right.tag & 1) ^ negate_right;
+    uint64_t error_mask = ~(valid_mask(left) & valid_mask(right));
+
+    // Same signs: add the magnitudes, clamping to all ones on carry out
+    u128 sum = a + b;
+    u128 sum_mag = sum | -(u128)(sum < a);
+
+    // Different signs: subtract the magnitudes, negating on borrow
+    uint64_t borrow = a < b;
+    u128 borrow_mask = -(u128)borrow;
+    u128 diff_mag = ((a - b) ^ borrow_mask) - borrow_mask;
+
+    u128 same_mask = -(u128)(sign_a == sign_b);
+    u128 mag = (sum_mag & same_mask) | (diff_mag & ~same_mask);
+    uint64_t sign = sign_a ^ (borrow & (sign_a != sign_b));
+    return make_value(mag, sign, error_mask);
+}
+
+Fixedpoint fixedpoint_add_sat(Fixedpoint left, Fixedpoint right)
+{
+    return add_sat(left, right, 0);
+}
+
+Fixedpoint fixedpoint_sub_sat(Fixedpoint left, Fixedpoint right)
+{
+    return add_sat(left, right, 1);
+}
+
+Fixedpoint fixedpoint_double_sat(Fixedpoint val)
+{
+    return fixedpoint_shl_sat(val, 1);
+}
+
+Fixedpoint fixedpoint_shl_sat(Fixedpoint val, unsigned n)
+{
+    u128 mag = magnitude(val);
+    unsigned shift = n > 127 ? 127 : n;
+
+    // Bits shifted out of the top; (mag >> 1) >> (127 - shift) avoids an
+    // undefined shift by 128 when shift is 0
+    uint64_t lost = (((mag >> 1) >> (127 - shift)) != 0) | ((n > 127) & (mag != 0));
+    mag = (mag << shift) | -(u128)lost;
+    return make_value(mag, val.tag & 1, ~valid_mask(val));
+}
+
+void fixedpoint_add_sat_batch(const Fixedpoint *left, const Fixedpoint *right, Fixedpoint *out, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        out[i] = add_sat(left[i], right[i], 0);
+    }
+}
+
+void fixedpoint_sub_sat_batch(const Fixedpoint *left, const Fixedpoint *right, Fixedpoint *out, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        out[i] = add_sat(left[i], right[i], 1);
+    }
+}
+
+void fixedpoint_double_sat_batch(const Fixedpoint *vals, Fixedpoint *out, size_t count)
+{
+    fixedpoint_shl_sat_batch(vals, 1, out, count);
+}
+
+void fixedpoint_shl_sat_batch(const Fixedpoint *vals, unsigned n, Fixedpoint *out, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        out[i] = fixedpoint_shl_sat(vals[i], n);
+    }
 }
 
 int fixedpoint_compare(Fixedpoint left, Fixedpoint right)
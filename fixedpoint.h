@@ -1,6 +1,7 @@
 #ifndef FIXEDPREC_H
 #define FIXEDPREC_H
 
+#include <stddef.h>
 #include <stdint.h>
 
 // An enum that holds the possible tags that a Fixedpoint can have
@@ -36,6 +37,27 @@ typedef struct
     Tag tag;
 } Fixedpoint;
 
+// An enum that holds the ways an operation can round a result that cannot
+// be represented exactly
+// FIXEDPOINT_ROUND_EXACT: Truncate toward zero, and tag the result
+//                         UNDERFLOW_POSITIVE or UNDERFLOW_NEGATIVE if any
+//                         bits were lost (as fixedpoint_halve does)
+// FIXEDPOINT_ROUND_TRUNCATE: Round toward zero
+// FIXEDPOINT_ROUND_NEAREST_EVEN: Round to nearest, ties to even
+// FIXEDPOINT_ROUND_CEILING: Round toward positive infinity
+// FIXEDPOINT_ROUND_FLOOR: Round toward negative infinity
+typedef enum
+{
+    FIXEDPOINT_ROUND_EXACT,
+    FIXEDPOINT_ROUND_TRUNCATE,
+    FIXEDPOINT_ROUND_NEAREST_EVEN,
+    FIXEDPOINT_ROUND_CEILING,
+    FIXEDPOINT_ROUND_FLOOR
+} FixedpointRound;
+
+// The value fixedpoint_ilog2 returns for zero
+#define FIXEDPOINT_ILOG2_ZERO (-128)
+
 // Create a Fixedpoint value representing an integer.
 //
 // Parameters:
@@ -180,6 +202,167 @@ Fixedpoint fixedpoint_halve(Fixedpoint val);
 //   computed value would have been positive or negative)
 Fixedpoint fixedpoint_double(Fixedpoint val);
 
+// Compute the product of two Fixedpoint values.
+//
+// Parameters:
+//   left - the left Fixedpoint value
+//   right - the right Fixedpoint value
+//
+// Returns:
+//   the exact product, if it can be represented;
+//   if the magnitude is too large, a value for which fixedpoint_is_overflow_pos
+//   or fixedpoint_is_overflow_neg returns true (with the magnitude wrapped);
+//   if bits below 2^-64 were lost, the truncated product, for which
+//   fixedpoint_is_underflow_pos or fixedpoint_is_underflow_neg returns true;
+//   an error value if either value is not valid
+Fixedpoint fixedpoint_mul(Fixedpoint left, Fixedpoint right);
+
+// Compute the product of two Fixedpoint values, rounding the bits below
+// 2^-64 according to a rounding mode. See fixedpoint_mul, which is the same
+// as this function with FIXEDPOINT_ROUND_EXACT.
+//
+// Parameters:
+//   left - the left Fixedpoint value
+//   right - the right Fixedpoint value
+//   mode - how to round the product
+//
+// Returns:
+//   the rounded product, or an overflow or error value as for fixedpoint_mul
+Fixedpoint fixedpoint_mul_round(Fixedpoint left, Fixedpoint right, FixedpointRound mode);
+
+// Multiply a valid Fixedpoint value by 2^n, in constant time.
+//
+// Parameters:
+//   val - a valid Fixedpoint value
+//   n - the number of bits to shift left (0 to 127; larger values shift
+//       every bit out)
+//
+// Returns:
+//   val * 2^n, if it can be represented exactly;
+//   otherwise, a value (holding the low 128 bits of the shifted magnitude)
+//   for which either fixedpoint_is_overflow_pos or fixedpoint_is_overflow_neg
+//   returns true, depending on the sign of val
+Fixedpoint fixedpoint_shl(Fixedpoint val, unsigned n);
+
+// Divide a valid Fixedpoint value by 2^n, in constant time, rounding the
+// result as specified. fixedpoint_shr(val, 1, FIXEDPOINT_ROUND_EXACT, NULL)
+// is equivalent to fixedpoint_halve(val).
+//
+// Parameters:
+//   val - a valid Fixedpoint value
+//   n - the number of bits to shift right (0 to 127; larger values shift
+//       every bit out)
+//   mode - how to round the result
+//   remainder - if not NULL, receives the bits shifted out: the value
+//               val - trunc(val / 2^n) * 2^n, which has the sign of val
+//               (or is 0) and a magnitude less than 2^n * 2^-64; if val
+//               is not valid, the bits shifted out with val's tag
+//
+// Returns:
+//   val / 2^n, rounded according to mode; with FIXEDPOINT_ROUND_EXACT, a
+//   value for which fixedpoint_is_underflow_pos or fixedpoint_is_underflow_neg
+//   returns true if any bits were shifted out; if val is not valid, a value
+//   with val's tag
+Fixedpoint fixedpoint_shr(Fixedpoint val, unsigned n, FixedpointRound mode, Fixedpoint *remainder);
+
+// Batch versions of fixedpoint_shl and fixedpoint_shr. out[i] is the result
+// of the shift of vals[i]. out may alias vals.
+//
+// Parameters:
+//   vals - the input array
+//   n - the shift distance
+//   mode - how to round (fixedpoint_shr_batch only)
+//   out - the output array
+//   count - the number of elements
+void fixedpoint_shl_batch(const Fixedpoint *vals, unsigned n, Fixedpoint *out, size_t count);
+void fixedpoint_shr_batch(const Fixedpoint *vals, unsigned n, FixedpointRound mode, Fixedpoint *out, size_t count);
+
+// Count the leading zero bits of the 128 bit magnitude of a Fixedpoint value
+// (whole part followed by fractional part).
+//
+// Parameters:
+//   val - the Fixedpoint value
+//
+// Returns:
+//   the number of leading zero bits, from 0 to 128 (128 for zero)
+int fixedpoint_clz(Fixedpoint val);
+
+// Compute the integer base 2 logarithm of the magnitude of a Fixedpoint
+// value, i.e. the exponent k such that 2^k <= |val| < 2^(k+1). Shifting val
+// right by k (or left by -k) normalizes it into [1, 2).
+//
+// Parameters:
+//   val - the Fixedpoint value
+//
+// Returns:
+//   floor(log2(|val|)), from -64 to 63;
+//   FIXEDPOINT_ILOG2_ZERO if val is zero
+int fixedpoint_ilog2(Fixedpoint val);
+
+// Compute the saturating sum of two valid Fixedpoint values.
+// Unlike fixedpoint_add, a sum whose magnitude is too large to represent is
+// clamped to the largest representable magnitude (whole and frac parts all
+// ones) with the sign of the exact sum. The computation has no branches.
+//
+// Parameters:
+//   left - the left Fixedpoint value
+//   right - the right Fixedpoint value
+//
+// Returns:
+//   the sum left + right, clamped to the representable range;
+//   if either argument is not valid, a value for which fixedpoint_is_err
+//   returns true
+Fixedpoint fixedpoint_add_sat(Fixedpoint left, Fixedpoint right);
+
+// Compute the saturating difference of two valid Fixedpoint values.
+// See fixedpoint_add_sat.
+//
+// Parameters:
+//   left - the left Fixedpoint value
+//   right - the right Fixedpoint value
+//
+// Returns:
+//   the difference left - right, clamped to the representable range;
+//   if either argument is not valid, a value for which fixedpoint_is_err
+//   returns true
+Fixedpoint fixedpoint_sub_sat(Fixedpoint left, Fixedpoint right);
+
+// Return twice a valid Fixedpoint value, clamped to the representable range.
+// See fixedpoint_add_sat.
+//
+// Parameters:
+//   val - a valid Fixedpoint value
+//
+// Returns:
+//   2 * val, clamped to the representable range;
+//   if val is not valid, a value for which fixedpoint_is_err returns true
+Fixedpoint fixedpoint_double_sat(Fixedpoint val);
+
+// Multiply a valid Fixedpoint value by 2^n, clamped to the representable
+// range. See fixedpoint_add_sat.
+//
+// Parameters:
+//   val - a valid Fixedpoint value
+//   n - the number of bits to shift left; any value is allowed
+//
+// Returns:
+//   val * 2^n, clamped to the representable range;
+//   if val is not valid, a value for which fixedpoint_is_err returns true
+Fixedpoint fixedpoint_shl_sat(Fixedpoint val, unsigned n);
+
+// Batch versions of the saturating operations. out[i] is the result of the
+// operation on element i of the inputs. out may alias an input.
+//
+// Parameters:
+//   left, right, vals - the input arrays
+//   n - the shift distance (fixedpoint_shl_sat_batch only)
+//   out - the output array
+//   count - the number of elements
+void fixedpoint_add_sat_batch(const Fixedpoint *left, const Fixedpoint *right, Fixedpoint *out, size_t count);
+void fixedpoint_sub_sat_batch(const Fixedpoint *left, const Fixedpoint *right, Fixedpoint *out, size_t count);
+void fixedpoint_double_sat_batch(const Fixedpoint *vals, Fixedpoint *out, size_t count);
+void fixedpoint_shl_sat_batch(const Fixedpoint *vals, unsigned n, Fixedpoint *out, size_t count);
+
 // Compare two valid Fixedpoint values.
 //
 // Parameters:
@@ -0,0 +1,374 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "fixedpoint256.h"
+
+__extension__ typedef unsigned __int128 u128;
+
+// The value of a hex digit (which must be valid)
+static uint64_t hex_digit_value(char c)
+{
+    if (c >= 'a' && c <= 'f')
+    {
+        return (uint64_t)(c - 'a' + 10);
+    }
+    if (c >= 'A' && c <= 'F')
+    {
+        return (uint64_t)(c - 'A' + 10);
+    }
+    return (uint64_t)(c - '0');
+}
+
+static int is_valid_tag(Tag tag)
+{
+    return tag == VALID_NONNEGATIVE || tag == VALID_NEGATIVE;
+}
+
+// The number of limbs up to and including the most significant nonzero one
+static int used_limbs(const uint64_t *limbs, int n)
+{
+    while (n > 0 && limbs[n - 1] == 0)
+    {
+        --n;
+    }
+    return n;
+}
+
+// Compare two magnitudes of n limbs
+static int compare_limbs(const uint64_t *left, const uint64_t *right, int n)
+{
+    for (int i = n - 1; i >= 0; --i)
+    {
+        if (left[i] != right[i])
+        {
+            return left[i] > right[i] ? 1 : -1;
+        }
+    }
+    return 0;
+}
+
+// Add src (src_len limbs) into dst (dst_len limbs) starting at limb offset,
+// propagating the carry through dst. Returns the carry out of dst.
+static uint64_t add_limbs(uint64_t *dst, int dst_len, const uint64_t *src, int src_len, int offset)
+{
+    uint64_t carry = 0;
+    for (int i = offset; i < dst_len; ++i)
+    {
+        if (i - offset >= src_len && carry == 0)
+        {
+            break;
+        }
+        u128 sum = (u128)dst[i] + carry + (i - offset < src_len ? src[i - offset] : 0);
+        dst[i] = (uint64_t)sum;
+        carry = (uint64_t)(sum >> 64);
+    }
+    return carry;
+}
+
+// Subtract src (src_len limbs) from dst (dst_len limbs), propagating the
+// borrow through dst. Returns the borrow out of dst.
+static uint64_t sub_limbs(uint64_t *dst, int dst_len, const uint64_t *src, int src_len)
+{
+    uint64_t borrow = 0;
+    for (int i = 0; i < dst_len; ++i)
+    {
+        if (i >= src_len && borrow == 0)
+        {
+            break;
+        }
+        uint64_t s = i < src_len ? src[i] : 0;
+        uint64_t d = dst[i];
+        dst[i] = d - s - borrow;
+        borrow = d < s || (d == s && borrow);
+    }
+    return borrow;
+}
+
+// Multiply two 4 limb magnitudes into an 8 limb product, one limb of left
+// at a time, skipping zero limbs. With a fast 64 x 64 -> 128 bit multiply
+// (as on x86-64) this is faster than Karatsuba's method even for full four
+// limb operands, which are too short for its fewer multiplications to pay
+// for its extra additions.
+static void mul_schoolbook(const uint64_t *left, const uint64_t *right, uint64_t product[8])
+{
+    int left_len = used_limbs(left, 4);
+    int right_len = used_limbs(right, 4);
+    memset(product, 0, 8 * sizeof(uint64_t));
+    for (int i = 0; i < left_len; ++i)
+    {
+        if (left[i] == 0)
+        {
+            continue;
+        }
+        uint64_t carry = 0;
+        for (int j = 0; j < right_len; ++j)
+        {
+            u128 t = (u128)left[i] * right[j] + product[i + j] + carry;
+            product[i + j] = (uint64_t)t;
+            carry = (uint64_t)(t >> 64);
+        }
+        product[i + right_len] = carry;
+    }
+}
+
+// Decide whether to round a truncated magnitude up (away from zero), given
+// the rem_len limbs that were shifted out and the lowest bit of the result
+static int round_up(const uint64_t *rem, int rem_len, uint64_t lowest, int negative, FixedpointRound mode)
+{
+    if (used_limbs(rem, rem_len) == 0)
+    {
+        return 0;
+    }
+    switch (mode)
+    {
+    case FIXEDPOINT_ROUND_NEAREST_EVEN:
+    {
+        uint64_t top = rem[rem_len - 1];
+        int below_half_zero = used_limbs(rem, rem_len - 1) == 0 && (top & ~(1UL << 63)) == 0;
+        if (!(top >> 63))
+        {
+            return 0;
+        }
+        return !below_half_zero || (lowest & 1);
+    }
+    case FIXEDPOINT_ROUND_CEILING:
+        return !negative;
+    case FIXEDPOINT_ROUND_FLOOR:
+        return negative;
+    default:
+        return 0;
+    }
+}
+
+// Choose the tag of a rounded result
+static Tag result_tag(int valid, int overflow, int inexact, int negative, int nonzero, FixedpointRound mode)
+{
+    if (!valid)
+    {
+        return ERROR;
+    }
+    if (overflow)
+    {
+        return negative ? OVERFLOW_NEGATIVE : OVERFLOW_POSITIVE;
+    }
+    if (mode == FIXEDPOINT_ROUND_EXACT && inexact)
+    {
+        return negative ? UNDERFLOW_NEGATIVE : UNDERFLOW_POSITIVE;
+    }
+    return negative && nonzero ? VALID_NEGATIVE : VALID_NONNEGATIVE;
+}
+
+Fixedpoint256 fixedpoint256_create(uint64_t whole)
+{
+    Fixedpoint256 val = {{0, 0, whole, 0}, VALID_NONNEGATIVE};
+    return val;
+}
+
+Fixedpoint256 fixedpoint256_from_fixedpoint(Fixedpoint val)
+{
+    Fixedpoint256 wide = {{0, val.frac, val.whole, 0}, val.tag};
+    return wide;
+}
+
+Fixedpoint fixedpoint256_to_fixedpoint(Fixedpoint256 val, FixedpointRound mode)
+{
+    int negative = val.tag == VALID_NEGATIVE;
+    uint64_t quotient[2] = {val.limb[1], val.limb[2]};
+    int up = round_up(val.limb, 1, quotient[0], negative, mode);
+    uint64_t carry = up ? add_limbs(quotient, 2, (const uint64_t[]){1}, 1, 0) : 0;
+
+    Fixedpoint result;
+    result.whole = quotient[1];
+    result.frac = quotient[0];
+    if (!is_valid_tag(val.tag))
+    {
+        result.tag = val.tag;
+    }
+    else
+    {
+        result.tag = result_tag(1, val.limb[3] != 0 || carry, val.limb[0] != 0, negative,
+                                (quotient[0] | quotient[1]) != 0, mode);
+    }
+    return result;
+}
+
+Fixedpoint256 fixedpoint256_create_from_hex(const char *hex)
+{
+    Fixedpoint256 val = {{0, 0, 0, 0}, ERROR};
+    const char *digits = hex[0] == '-' ? hex + 1 : hex;
+    const char *point = strchr(digits, '.');
+    size_t whole_len = point != NULL ? (size_t)(point - digits) : strlen(digits);
+    const char *frac = point != NULL ? point + 1 : digits + whole_len;
+    size_t frac_len = strlen(frac);
+
+    if (whole_len > 32 || frac_len > 32)
+    {
+        return val;
+    }
+    for (size_t i = 0; i < whole_len; ++i)
+    {
+        if (!is_valid_char(digits[i]))
+        {
+            return val;
+        }
+    }
+    for (size_t i = 0; i < frac_len; ++i)
+    {
+        if (!is_valid_char(frac[i]))
+        {
+            return val;
+        }
+    }
+
+    // Whole digits fill limbs 2 and 3 from the top down; fraction digits
+    // fill limbs 1 and 0 from the binary point down
+    for (size_t i = 0; i < whole_len; ++i)
+    {
+        unsigned pos = 128 + 4 * (unsigned)(whole_len - 1 - i);
+        val.limb[pos / 64] |= hex_digit_value(digits[i]) << (pos % 64);
+    }
+    for (size_t i = 0; i < frac_len; ++i)
+    {
+        unsigned pos = 124 - 4 * (unsigned)i;
+        val.limb[pos / 64] |= hex_digit_value(frac[i]) << (pos % 64);
+    }
+
+    val.tag = hex[0] == '-' && used_limbs(val.limb, 4) != 0 ? VALID_NEGATIVE : VALID_NONNEGATIVE;
+    return val;
+}
+
+char *fixedpoint256_format_as_hex(Fixedpoint256 val)
+{
+    // Sign, 32 whole digits, point, 32 fraction digits and terminator
+    char *s = calloc(67, sizeof(char));
+    if (!fixedpoint256_is_valid(val))
+    {
+        strcpy(s, "<invalid>");
+        return s;
+    }
+
+    size_t next_index = 0;
+    if (val.tag == VALID_NEGATIVE)
+    {
+        s[next_index++] = '-';
+    }
+    if (val.limb[3] != 0)
+    {
+        next_index += sprintf(s + next_index, "%lx%016lx", val.limb[3], val.limb[2]);
+    }
+    else
+    {
+        next_index += sprintf(s + next_index, "%lx", val.limb[2]);
+    }
+
+    if (val.limb[1] != 0 || val.limb[0] != 0)
+    {
+        s[next_index++] = '.';
+        sprintf(s + next_index, "%016lx%016lx", val.limb[1], val.limb[0]);
+        // Remove trailing zeroes
+        size_t end = strlen(s);
+        while (s[end - 1] == '0')
+        {
+            s[--end] = '\0';
+        }
+    }
+    return s;
+}
+
+Fixedpoint256 fixedpoint256_add(Fixedpoint256 left, Fixedpoint256 right)
+{
+    Fixedpoint256 result;
+    if (!is_valid_tag(left.tag) || !is_valid_tag(right.tag))
+    {
+        memset(result.limb, 0, sizeof(result.limb));
+        result.tag = ERROR;
+        return result;
+    }
+
+    int negative = left.tag == VALID_NEGATIVE;
+    if (left.tag == right.tag)
+    {
+        // Same signs: add the magnitudes
+        result = left;
+        uint64_t carry = add_limbs(result.limb, 4, right.limb, 4, 0);
+        result.tag = carry ? (negative ? OVERFLOW_NEGATIVE : OVERFLOW_POSITIVE) : left.tag;
+        return result;
+    }
+
+    // Different signs: subtract the smaller magnitude from the larger
+    if (compare_limbs(left.limb, right.limb, 4) >= 0)
+    {
+        result = left;
+        sub_limbs(result.limb, 4, right.limb, 4);
+    }
+    else
+    {
+        result = right;
+        sub_limbs(result.limb, 4, left.limb, 4);
+        negative = !negative;
+    }
+    result.tag = negative && used_limbs(result.limb, 4) != 0 ? VALID_NEGATIVE : VALID_NONNEGATIVE;
+    return result;
+}
+
+Fixedpoint256 fixedpoint256_sub(Fixedpoint256 left, Fixedpoint256 right)
+{
+    if (is_valid_tag(right.tag))
+    {
+        right.tag = right.tag == VALID_NEGATIVE ? VALID_NONNEGATIVE : VALID_NEGATIVE;
+    }
+    return fixedpoint256_add(left, right);
+}
+
+Fixedpoint256 fixedpoint256_negate(Fixedpoint256 val)
+{
+    if (is_valid_tag(val.tag))
+    {
+        val.tag = val.tag == VALID_NONNEGATIVE && used_limbs(val.limb, 4) != 0 ? VALID_NEGATIVE : VALID_NONNEGATIVE;
+    }
+    return val;
+}
+
+Fixedpoint256 fixedpoint256_mul(Fixedpoint256 left, Fixedpoint256 right, FixedpointRound mode)
+{
+    uint64_t product[8];
+    mul_schoolbook(left.limb, right.limb, product);
+
+    // The product is in units of 2^-256; keep limbs 2 to 5
+    int negative = (left.tag ^ right.tag) & 1;
+    Fixedpoint256 result;
+    memcpy(result.limb, product + 2, sizeof(result.limb));
+    uint64_t carry = 0;
+    if (round_up(product, 2, result.limb[0], negative, mode))
+    {
+        carry = add_limbs(result.limb, 4, (const uint64_t[]){1}, 1, 0);
+    }
+    result.tag = result_tag(is_valid_tag(left.tag) && is_valid_tag(right.tag), (product[6] | product[7] | carry) != 0,
+                            (product[0] | product[1]) != 0, negative, used_limbs(result.limb, 4) != 0, mode);
+    return result;
+}
+
+int fixedpoint256_compare(Fixedpoint256 left, Fixedpoint256 right)
+{
+    if (left.tag != right.tag)
+    {
+        return left.tag == VALID_NONNEGATIVE ? 1 : -1;
+    }
+    int result = compare_limbs(left.limb, right.limb, 4);
+    return left.tag == VALID_NONNEGATIVE ? result : -result;
+}
+
+int fixedpoint256_is_zero(Fixedpoint256 val)
+{
+    return is_valid_tag(val.tag) && used_limbs(val.limb, 4) == 0;
+}
+
+int fixedpoint256_is_neg(Fixedpoint256 val)
+{
+    return val.tag == VALID_NEGATIVE;
+}
+
+int fixedpoint256_is_valid(Fixedpoint256 val)
+{
+    return is_valid_tag(val.tag);
+}
@@ -0,0 +1,166 @@
+#ifndef FIXEDPOINT256_H
+#define FIXEDPOINT256_H
+
+#include <stdint.h>
+#include "fixedpoint.h"
+
+// A 256 bit fixed point type with 128 integer bits and 128 fraction bits,
+// for intermediate results that would overflow or lose precision as
+// Fixedpoint values. Every Fixedpoint value converts to it exactly, and
+// the product of two Fixedpoint values is always exact in it.
+
+// The number of 64 bit limbs of a Fixedpoint256 magnitude
+#define FIXEDPOINT256_LIMBS 4
+
+// A struct that holds a Fixedpoint256 number
+//
+// Fields:
+//  limb - the magnitude in units of 2^-128, least significant limb first:
+//         limb[0] and limb[1] are the fractional part, limb[2] and limb[3]
+//         the whole part
+//  tag - a tag that keeps track of the value. See the Tag enum for possible tags.
+typedef struct
+{
+    uint64_t limb[FIXEDPOINT256_LIMBS];
+    Tag tag;
+} Fixedpoint256;
+
+// Create a Fixedpoint256 value representing an integer.
+//
+// Parameters:
+//   whole - the value
+//
+// Returns:
+//   the Fixedpoint256 value
+Fixedpoint256 fixedpoint256_create(uint64_t whole);
+
+// Convert a Fixedpoint value to a Fixedpoint256 value. The conversion is
+// exact, and the tag is kept.
+//
+// Parameters:
+//   val - the Fixedpoint value
+//
+// Returns:
+//   the same value as a Fixedpoint256
+Fixedpoint256 fixedpoint256_from_fixedpoint(Fixedpoint val);
+
+// Convert a Fixedpoint256 value to a Fixedpoint value.
+//
+// Parameters:
+//   val - the Fixedpoint256 value
+//   mode - how to round bits below 2^-64
+//
+// Returns:
+//   val rounded according to mode (with FIXEDPOINT_ROUND_EXACT, a value for
+//   which fixedpoint_is_underflow_pos or fixedpoint_is_underflow_neg returns
+//   true if bits were lost);
+//   if val is 2^64 or more in magnitude, a value for which
+//   fixedpoint_is_overflow_pos or fixedpoint_is_overflow_neg returns true
+//   (with the magnitude wrapped);
+//   if val is not valid, a value with the same tag
+Fixedpoint fixedpoint256_to_fixedpoint(Fixedpoint256 val, FixedpointRound mode);
+
+// Create a Fixedpoint256 value from a string of hex digits. See
+// fixedpoint_create_from_hex; the whole and fractional parts may each have
+// up to 32 hex digits.
+//
+// Parameters:
+//   hex - the string of hex digits
+//
+// Returns:
+//   the Fixedpoint256 value, or a value for which fixedpoint256_is_valid
+//   returns false (tagged ERROR) if hex is not valid
+Fixedpoint256 fixedpoint256_create_from_hex(const char *hex);
+
+// Format a Fixedpoint256 value as a string of hex digits. See
+// fixedpoint_format_as_hex.
+//
+// Parameters:
+//   val - the Fixedpoint256 value
+//
+// Returns:
+//   dynamically allocated character string containing the representation
+//   of the value, or "<invalid>" if the value is not valid
+char *fixedpoint256_format_as_hex(Fixedpoint256 val);
+
+// Compute the sum of two Fixedpoint256 values.
+//
+// Parameters:
+//   left - the left value
+//   right - the right value
+//
+// Returns:
+//   the exact sum, if it can be represented;
+//   otherwise, a value tagged OVERFLOW_POSITIVE or OVERFLOW_NEGATIVE (with
+//   the magnitude wrapped);
+//   an error value if either value is not valid
+Fixedpoint256 fixedpoint256_add(Fixedpoint256 left, Fixedpoint256 right);
+
+// Compute the difference of two Fixedpoint256 values. See fixedpoint256_add.
+Fixedpoint256 fixedpoint256_sub(Fixedpoint256 left, Fixedpoint256 right);
+
+// Negate a Fixedpoint256 value. Zero stays non-negative, and non-valid
+// values are returned unchanged.
+//
+// Parameters:
+//   val - the value
+//
+// Returns:
+//   the negated value
+Fixedpoint256 fixedpoint256_negate(Fixedpoint256 val);
+
+// Compute the product of two Fixedpoint256 values.
+//
+// Parameters:
+//   left - the left value
+//   right - the right value
+//   mode - how to round bits below 2^-128
+//
+// Returns:
+//   the product rounded according to mode (with FIXEDPOINT_ROUND_EXACT, a
+//   value tagged UNDERFLOW_POSITIVE or UNDERFLOW_NEGATIVE if bits were lost);
+//   if the magnitude is 2^128 or more, a value tagged OVERFLOW_POSITIVE or
+//   OVERFLOW_NEGATIVE (with the magnitude wrapped);
+//   an error value if either value is not valid
+Fixedpoint256 fixedpoint256_mul(Fixedpoint256 left, Fixedpoint256 right, FixedpointRound mode);
+
+// Compare two valid Fixedpoint256 values.
+//
+// Parameters:
+//   left - the left value
+//   right - the right value
+//
+// Returns:
+//   -1 if left < right;
+//   0 if left == right;
+//   1 if left > right
+int fixedpoint256_compare(Fixedpoint256 left, Fixedpoint256 right);
+
+// Check whether a Fixedpoint256 value is a valid zero.
+//
+// Parameters:
+//   val - the value
+//
+// Returns:
+//   1 if val is valid and zero; 0 otherwise
+int fixedpoint256_is_zero(Fixedpoint256 val);
+
+// Check whether a Fixedpoint256 value is valid and negative.
+//
+// Parameters:
+//   val - the value
+//
+// Returns:
+//   1 if val is tagged VALID_NEGATIVE; 0 otherwise
+int fixedpoint256_is_neg(Fixedpoint256 val);
+
+// Check whether a Fixedpoint256 value is valid.
+//
+// Parameters:
+//   val - the value
+//
+// Returns:
+//   1 if val is tagged VALID_NONNEGATIVE or VALID_NEGATIVE; 0 otherwise
+int fixedpoint256_is_valid(Fixedpoint256 val);
+
+#endif // FIXEDPOINT256_H
@@ -0,0 +1,202 @@
+#include "fixedpoint_accum.h"
+#include "fixedpoint256.h"
+
+__extension__ typedef unsigned __int128 u128;
+
+// Add the 192 bit two's complement number (high, whole, frac) to acc
+static void add192(FixedpointAccum *acc, uint64_t high, uint64_t whole, uint64_t frac, uint64_t carry_in)
+{
+    u128 lo = (u128)acc->frac + frac + carry_in;
+    acc->frac = (uint64_t)lo;
+    u128 mid = (u128)acc->whole + whole + (uint64_t)(lo >> 64);
+    acc->whole = (uint64_t)mid;
+    acc->high += high + (uint64_t)(mid >> 64);
+}
+
+// Add val to acc if negate is 0, or subtract it if negate is 1
+static void accumulate(FixedpointAccum *acc, Fixedpoint val, uint64_t negate)
+{
+    if (!fixedpoint_is_valid(val))
+    {
+        if (acc->tag == VALID_NONNEGATIVE)
+        {
+            acc->tag = val.tag;
+        }
+        return;
+    }
+
+    // All ones if the value is to be subtracted, so that (x ^ mask) + (mask & 1)
+    // is the two's complement negation of x when needed, without a branch
+    uint64_t mask = -((uint64_t)(val.tag == VALID_NEGATIVE) ^ negate);
+    add192(acc, mask, val.whole ^ mask, val.frac ^ mask, mask & 1);
+}
+
+void fixedpoint_accum_init(FixedpointAccum *acc)
+{
+    acc->frac = 0;
+    acc->whole = 0;
+    acc->high = 0;
+    acc->tag = VALID_NONNEGATIVE;
+}
+
+void fixedpoint_accum_add(FixedpointAccum *acc, Fixedpoint val)
+{
+    accumulate(acc, val, 0);
+}
+
+void fixedpoint_accum_sub(FixedpointAccum *acc, Fixedpoint val)
+{
+    accumulate(acc, val, 1);
+}
+
+void fixedpoint_accum_merge(FixedpointAccum *acc, const FixedpointAccum *other)
+{
+    if (acc->tag == VALID_NONNEGATIVE)
+    {
+        acc->tag = other->tag;
+    }
+    add192(acc, other->high, other->whole, other->frac, 0);
+}
+
+int fixedpoint_accum_compare(const FixedpointAccum *left, const FixedpointAccum *right)
+{
+    // The high words are signed, the lower words are unsigned
+    if (left->high != right->high)
+    {
+        return (int64_t)left->high < (int64_t)right->high ? -1 : 1;
+    }
+    if (left->whole != right->whole)
+    {
+        return left->whole < right->whole ? -1 : 1;
+    }
+    if (left->frac != right->frac)
+    {
+        return left->frac < right->frac ? -1 : 1;
+    }
+    return 0;
+}
+
+Fixedpoint fixedpoint_accum_result(const FixedpointAccum *acc)
+{
+    Fixedpoint result;
+
+    if (acc->tag != VALID_NONNEGATIVE)
+    {
+        result.whole = 0;
+        result.frac = 0;
+        result.tag = acc->tag;
+        return result;
+    }
+
+    uint64_t high = acc->high;
+    uint64_t whole = acc->whole;
+    uint64_t frac = acc->frac;
+    int negative = (int64_t)high < 0;
+    if (negative)
+    {
+        // Negate to get the magnitude
+        frac = ~frac + 1;
+        whole = ~whole + (frac == 0);
+        high = ~high + (frac == 0 && whole == 0);
+    }
+
+    result.whole = whole;
+    result.frac = frac;
+    if (high != 0)
+    {
+        result.tag = negative ? OVERFLOW_NEGATIVE : OVERFLOW_POSITIVE;
+    }
+    else if (negative)
+    {
+        result.tag = VALID_NEGATIVE;
+    }
+    else
+    {
+        result.tag = VALID_NONNEGATIVE;
+    }
+    return result;
+}
+
+Fixedpoint fixedpoint_accum_div(const FixedpointAccum *acc, uint64_t divisor, FixedpointRound mode)
+{
+    Fixedpoint result = {0, 0, acc->tag};
+    if (acc->tag != VALID_NONNEGATIVE)
+    {
+        return result;
+    }
+    if (divisor == 0)
+    {
+        result.tag = ERROR;
+        return result;
+    }
+
+    // Divide the magnitude a word at a time, high word first
+    int negative = (int64_t)acc->high < 0;
+    uint64_t mask = negative ? ~0UL : 0;
+    u128 low = ((u128)(acc->whole ^ mask) << 64 | (acc->frac ^ mask)) + (mask & 1);
+    uint64_t high = (acc->high ^ mask) + (negative && low == 0);
+    uint64_t q_high = high / divisor;
+    u128 rem = high % divisor;
+    u128 q_whole = (rem << 64 | (uint64_t)(low >> 64)) / divisor;
+    rem = (rem << 64 | (uint64_t)(low >> 64)) % divisor;
+    u128 q_frac = (rem << 64 | (uint64_t)low) / divisor;
+    rem = (rem << 64 | (uint64_t)low) % divisor;
+    u128 quotient = q_whole << 64 | (uint64_t)q_frac;
+
+    int round_up = 0;
+    if (rem != 0)
+    {
+        switch (mode)
+        {
+        case FIXEDPOINT_ROUND_NEAREST_EVEN:
+            round_up = rem > divisor - rem || (rem == divisor - rem && (quotient & 1));
+            break;
+        case FIXEDPOINT_ROUND_CEILING:
+            round_up = !negative;
+            break;
+        case FIXEDPOINT_ROUND_FLOOR:
+            round_up = negative;
+            break;
+        default:
+            break;
+        }
+    }
+    quotient += round_up;
+    q_high += round_up && quotient == 0;
+
+    result.whole = (uint64_t)(quotient >> 64);
+    result.frac = (uint64_t)quotient;
+    if (q_high != 0)
+    {
+        result.tag = negative ? OVERFLOW_NEGATIVE : OVERFLOW_POSITIVE;
+    }
+    else if (mode == FIXEDPOINT_ROUND_EXACT && rem != 0)
+    {
+        result.tag = negative ? UNDERFLOW_NEGATIVE : UNDERFLOW_POSITIVE;
+    }
+    else
+    {
+        result.tag = negative && quotient != 0 ? VALID_NEGATIVE : VALID_NONNEGATIVE;
+    }
+    return result;
+}
+
+Fixedpoint fixedpoint_product_accum_result(const FixedpointProductAccum *acc, FixedpointRound mode)
+{
+    uint64_t sign = acc->limb[FIXEDPOINT_PRODUCT_ACCUM_LIMBS - 1] >> 63 ? ~0UL : 0;
+    uint64_t mag[FIXEDPOINT_PRODUCT_ACCUM_LIMBS];
+    uint64_t carry = sign & 1;
+    for (int i = 0; i < FIXEDPOINT_PRODUCT_ACCUM_LIMBS; ++i)
+    {
+        u128 limb = (u128)(acc->limb[i] ^ sign) + carry;
+        mag[i] = (uint64_t)limb;
+        carry = (uint64_t)(limb >> 64);
+    }
+    if (mag[FIXEDPOINT_PRODUCT_ACCUM_LIMBS - 1] != 0)
+    {
+        Fixedpoint val = {mag[2], mag[1], sign ? OVERFLOW_NEGATIVE : OVERFLOW_POSITIVE};
+        return val;
+    }
+    Fixedpoint256 wide = {{mag[0], mag[1], mag[2], mag[3]}, sign ? VALID_NEGATIVE : VALID_NONNEGATIVE};
+    return fixedpoint256_to_fixedpoint(wide, mode);
+}
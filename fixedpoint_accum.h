@@ -0,0 +1,234 @@
+#ifndef FIXEDPOINT_ACCUM_H
+#define FIXEDPOINT_ACCUM_H
+
+#include <stdint.h>
+#include "fixedpoint.h"
+
+// An exact accumulator for sums of Fixedpoint values.
+// The running sum is kept as a 192 bit two's complement number in units of
+// 2^-64 (frac is the low word, whole the middle word, and high the top word),
+// so up to 2^63 values of any magnitude can be added without the accumulator
+// itself overflowing. Only the final result is checked against the range of
+// a Fixedpoint. The sum does not depend on the order of the additions.
+//
+// Fields:
+//  frac - the low 64 bits of the sum
+//  whole - the middle 64 bits of the sum
+//  high - the high 64 bits of the sum (sign extension and carries)
+//  tag - VALID_NONNEGATIVE while every accumulated value was valid;
+//        otherwise the tag of the first non-valid value accumulated
+typedef struct
+{
+    uint64_t frac;
+    uint64_t whole;
+    uint64_t high;
+    Tag tag;
+} FixedpointAccum;
+
+// Initialize an accumulator to 0.
+//
+// Parameters:
+//   acc - pointer to the accumulator
+void fixedpoint_accum_init(FixedpointAccum *acc);
+
+// Add a Fixedpoint value to an accumulator.
+// A value that is not valid does not change the sum, but is remembered in
+// the accumulator's tag (if it is the first non-valid value).
+//
+// Parameters:
+//   acc - pointer to the accumulator
+//   val - the Fixedpoint value to add
+void fixedpoint_accum_add(FixedpointAccum *acc, Fixedpoint val);
+
+// Subtract a Fixedpoint value from an accumulator.
+// Non-valid values are handled as in fixedpoint_accum_add.
+//
+// Parameters:
+//   acc - pointer to the accumulator
+//   val - the Fixedpoint value to subtract
+void fixedpoint_accum_sub(FixedpointAccum *acc, Fixedpoint val);
+
+// Add the sum held in one accumulator to another.
+//
+// Parameters:
+//   acc - pointer to the accumulator to add to
+//   other - pointer to the accumulator to add
+void fixedpoint_accum_merge(FixedpointAccum *acc, const FixedpointAccum *other);
+
+// Compare the sums held in two accumulators.
+//
+// Parameters:
+//   left - pointer to the left accumulator
+//   right - pointer to the right accumulator
+//
+// Returns:
+//   -1 if left < right;
+//    0 if left == right;
+//    1 if left > right
+int fixedpoint_accum_compare(const FixedpointAccum *left, const FixedpointAccum *right);
+
+// Get the sum held in an accumulator as a Fixedpoint value.
+//
+// Parameters:
+//   acc - pointer to the accumulator
+//
+// Returns:
+//   the sum, if every accumulated value was valid and the sum can be
+//   represented;
+//   if the sum cannot be represented, a value for which either
+//   fixedpoint_is_overflow_pos or fixedpoint_is_overflow_neg returns true,
+//   holding the low 128 bits of the magnitude (as fixedpoint_add does);
+//   if a non-valid value was accumulated, a value with that value's tag
+Fixedpoint fixedpoint_accum_result(const FixedpointAccum *acc);
+
+// Divide the sum held in an accumulator by an integer, such as the number
+// of values accumulated, rounding once.
+//
+// Parameters:
+//   acc - pointer to the accumulator
+//   divisor - the divisor
+//   mode - how to round the quotient to a multiple of 2^-64
+//
+// Returns:
+//   the quotient rounded according to mode (with FIXEDPOINT_ROUND_EXACT, a
+//   value for which fixedpoint_is_underflow_pos or
+//   fixedpoint_is_underflow_neg returns true if it is inexact);
+//   if the quotient cannot be represented, a value for which either
+//   fixedpoint_is_overflow_pos or fixedpoint_is_overflow_neg returns true,
+//   holding the low 128 bits of the magnitude;
+//   if a non-valid value was accumulated, a value with that value's tag;
+//   an error value if divisor is 0
+Fixedpoint fixedpoint_accum_div(const FixedpointAccum *acc, uint64_t divisor, FixedpointRound mode);
+
+// The number of 64 bit limbs of a FixedpointProductAccum
+#define FIXEDPOINT_PRODUCT_ACCUM_LIMBS 5
+
+// A valid Fixedpoint value in the sign-magnitude form that
+// fixedpoint_product_accum_add reads, so that a value used in many products
+// is converted once.
+//
+// Fields:
+//  frac - the fractional part of the magnitude
+//  whole - the whole part of the magnitude
+//  sign - all ones if the value is negative, 0 otherwise
+typedef struct
+{
+    uint64_t frac;
+    uint64_t whole;
+    uint64_t sign;
+} FixedpointProductTerm;
+
+// An exact accumulator for sums of products of Fixedpoint values, such as
+// dot products and convolutions.
+// The running sum is kept as a 320 bit two's complement number in units of
+// 2^-128, least significant limb first, so up to 2^63 products of any
+// magnitude can be added without the accumulator itself overflowing. An
+// accumulator whose limbs are all 0 holds 0.
+//
+// Fields:
+//  limb - the limbs of the sum
+typedef struct
+{
+    uint64_t limb[FIXEDPOINT_PRODUCT_ACCUM_LIMBS];
+} FixedpointProductAccum;
+
+// Convert a valid Fixedpoint value to a product term.
+//
+// Parameters:
+//   val - the Fixedpoint value
+//
+// Returns:
+//   the term
+static inline FixedpointProductTerm fixedpoint_product_term(Fixedpoint val)
+{
+    FixedpointProductTerm term = {val.frac, val.whole, val.tag == VALID_NEGATIVE ? ~0UL : 0};
+    return term;
+}
+
+// Convert a Fixedpoint value to a product term, noting whether it is valid.
+// The term of a value that is not valid is meaningless, so the result of a
+// sum that uses it should be read with fixedpoint_product_accum_checked_result.
+//
+// Parameters:
+//   val - the Fixedpoint value
+//   invalid - pointer to a flag that is set to 1 if val is not valid (and
+//             left unchanged otherwise)
+//
+// Returns:
+//   the term
+static inline FixedpointProductTerm fixedpoint_product_term_checked(Fixedpoint val, unsigned char *invalid)
+{
+    *invalid |= !fixedpoint_is_valid(val);
+    return fixedpoint_product_term(val);
+}
+
+// Add the exact product of two terms to a product accumulator. It is
+// defined here so that it is inlined into the loops that call it.
+//
+// Parameters:
+//   acc - pointer to the accumulator
+//   x - the left term
+//   y - the right term
+static inline void fixedpoint_product_accum_add(FixedpointProductAccum *acc, FixedpointProductTerm x,
+                                                FixedpointProductTerm y)
+{
+    __extension__ typedef unsigned __int128 u128;
+    u128 lo = (u128)x.frac * y.frac;
+    u128 mid1 = (u128)x.whole * y.frac;
+    u128 mid2 = (u128)x.frac * y.whole;
+    u128 mid = (lo >> 64) + (uint64_t)mid1 + (uint64_t)mid2;
+    u128 hi = (u128)x.whole * y.whole + (mid1 >> 64) + (mid2 >> 64) + (mid >> 64);
+
+    // A negative product is added as its two's complement: the complement of
+    // each limb, plus one
+    uint64_t sign = x.sign ^ y.sign;
+    u128 sum = (u128)acc->limb[0] + ((uint64_t)lo ^ sign) + (sign & 1);
+    acc->limb[0] = (uint64_t)sum;
+    sum = (u128)acc->limb[1] + ((uint64_t)mid ^ sign) + (uint64_t)(sum >> 64);
+    acc->limb[1] = (uint64_t)sum;
+    sum = (u128)acc->limb[2] + ((uint64_t)hi ^ sign) + (uint64_t)(sum >> 64);
+    acc->limb[2] = (uint64_t)sum;
+    sum = (u128)acc->limb[3] + ((uint64_t)(hi >> 64) ^ sign) + (uint64_t)(sum >> 64);
+    acc->limb[3] = (uint64_t)sum;
+    acc->limb[4] += sign + (uint64_t)(sum >> 64);
+}
+
+// Get the sum held in a product accumulator as a Fixedpoint value, rounding
+// once.
+//
+// Parameters:
+//   acc - pointer to the accumulator
+//   mode - how to round the sum to a multiple of 2^-64
+//
+// Returns:
+//   the sum rounded according to mode (with FIXEDPOINT_ROUND_EXACT, a value
+//   for which fixedpoint_is_underflow_pos or fixedpoint_is_underflow_neg
+//   returns true if it is inexact);
+//   if the sum cannot be represented, a value for which either
+//   fixedpoint_is_overflow_pos or fixedpoint_is_overflow_neg returns true,
+//   holding the low 128 bits of the magnitude (as fixedpoint_add does)
+Fixedpoint fixedpoint_product_accum_result(const FixedpointProductAccum *acc, FixedpointRound mode);
+
+// Get the sum held in a product accumulator as fixedpoint_product_accum_result
+// does, or an error value if any of the terms summed was not valid.
+//
+// Parameters:
+//   acc - pointer to the accumulator
+//   invalid - nonzero if a term of the sum was not valid
+//   mode - how to round the sum to a multiple of 2^-64
+//
+// Returns:
+//   an error value if invalid is nonzero; otherwise, the sum as
+//   fixedpoint_product_accum_result returns it
+static inline Fixedpoint fixedpoint_product_accum_checked_result(const FixedpointProductAccum *acc, int invalid,
+                                                                 FixedpointRound mode)
+{
+    if (invalid)
+    {
+        Fixedpoint error = {0, 0, ERROR};
+        return error;
+    }
+    return fixedpoint_product_accum_result(acc, mode);
+}
+
+#endif // FIXEDPOINT_ACCUM_H
@@ -0,0 +1,177 @@
+#include <stdlib.h>
+#include "fixedpoint_atomic.h"
+#include "fixedpoint_accum.h"
+
+__extension__ typedef unsigned __int128 u128;
+typedef u128 __attribute__((may_alias)) u128_alias;
+
+// Counter used to hand out shards of striped accumulators to threads
+static unsigned next_shard_hint;
+
+// The shard hint of the calling thread, or UINT32_MAX if not yet assigned
+static _Thread_local unsigned thread_shard_hint = UINT32_MAX;
+
+// Add delta to the low 128 bits of acc, returning the value before the update
+static u128 add_low(FixedpointAtomic *acc, u128 delta)
+{
+    volatile u128_alias *cell = (volatile u128_alias *)acc->value;
+#if defined(__GCC_HAVE_SYNC_COMPARE_AND_SWAP_16)
+    // A torn read here just makes the first compare-and-swap fail
+    u128 old = *cell;
+    for (;;)
+    {
+        u128 seen = __sync_val_compare_and_swap(cell, old, old + delta);
+        if (seen == old)
+        {
+            return old;
+        }
+        old = seen;
+    }
+#else
+    while (__atomic_test_and_set(&acc->lock, __ATOMIC_ACQUIRE))
+    {
+    }
+    u128 old = *cell;
+    *cell = old + delta;
+    __atomic_clear(&acc->lock, __ATOMIC_RELEASE);
+    return old;
+#endif
+}
+
+// Add val to acc if negate is 0, or subtract it if negate is 1
+static void accumulate(FixedpointAtomic *acc, Fixedpoint val, uint64_t negate)
+{
+    if (!fixedpoint_is_valid(val))
+    {
+        __sync_bool_compare_and_swap(&acc->tag, VALID_NONNEGATIVE, val.tag);
+        return;
+    }
+
+    // Sign-extend the two's complement delta to 192 bits: (mask, delta)
+    uint64_t mask = -((uint64_t)(val.tag == VALID_NEGATIVE) ^ negate);
+    u128 magnitude = (u128)val.whole << 64 | val.frac;
+    u128 delta = (magnitude ^ ((u128)mask << 64 | mask)) + (mask & 1);
+    if (delta == 0)
+    {
+        return;
+    }
+
+    u128 old = add_low(acc, delta);
+    u128 new = old + delta;
+    // The low 128 bits are read as a signed number, so the carry word only
+    // changes when that number overflows: the delta's sign extension plus
+    // the carry out of the low 128 bits, corrected for the change of the low
+    // bits' sign. Crossing zero leaves the carry word alone.
+    int64_t carry = (int64_t)mask + (new < old) - (int64_t)(old >> 127) + (int64_t)(new >> 127);
+    if (carry != 0)
+    {
+        __atomic_fetch_add(&acc->carry, carry, __ATOMIC_RELAXED);
+    }
+}
+
+// Add the sum held in acc to an exact accumulator
+static void merge_into(FixedpointAccum *sum, FixedpointAtomic *acc)
+{
+    FixedpointAccum part;
+    volatile u128_alias *cell = (volatile u128_alias *)acc->value;
+#if defined(__GCC_HAVE_SYNC_COMPARE_AND_SWAP_16)
+    // A compare-and-swap that never changes the value is an atomic 128 bit load
+    u128 low = __sync_val_compare_and_swap(cell, 0, 0);
+#else
+    while (__atomic_test_and_set(&acc->lock, __ATOMIC_ACQUIRE))
+    {
+    }
+    u128 low = *cell;
+    __atomic_clear(&acc->lock, __ATOMIC_RELEASE);
+#endif
+    part.frac = (uint64_t)low;
+    part.whole = (uint64_t)(low >> 64);
+    // Sign-extend the low bits and add the number of signed overflows
+    part.high = (uint64_t)__atomic_load_n(&acc->carry, __ATOMIC_RELAXED) - (uint64_t)(low >> 127);
+    part.tag = (Tag)__atomic_load_n(&acc->tag, __ATOMIC_RELAXED);
+    fixedpoint_accum_merge(sum, &part);
+}
+
+void fixedpoint_atomic_init(FixedpointAtomic *acc)
+{
+    acc->value[0] = 0;
+    acc->value[1] = 0;
+    acc->carry = 0;
+    acc->tag = VALID_NONNEGATIVE;
+    acc->lock = 0;
+}
+
+void fixedpoint_atomic_add(FixedpointAtomic *acc, Fixedpoint val)
+{
+    accumulate(acc, val, 0);
+}
+
+void fixedpoint_atomic_sub(FixedpointAtomic *acc, Fixedpoint val)
+{
+    accumulate(acc, val, 1);
+}
+
+Fixedpoint fixedpoint_atomic_load(FixedpointAtomic *acc)
+{
+    FixedpointAccum sum;
+    fixedpoint_accum_init(&sum);
+    merge_into(&sum, acc);
+    return fixedpoint_accum_result(&sum);
+}
+
+int fixedpoint_atomic_striped_init(FixedpointAtomicStriped *acc, unsigned num_shards)
+{
+    if (num_shards == 0)
+    {
+        num_shards = 1;
+    }
+    acc->shards = aligned_alloc(_Alignof(FixedpointAtomic), num_shards * sizeof(FixedpointAtomic));
+    if (acc->shards == NULL)
+    {
+        return 0;
+    }
+    acc->num_shards = num_shards;
+    for (unsigned i = 0; i < num_shards; ++i)
+    {
+        fixedpoint_atomic_init(&acc->shards[i]);
+    }
+    return 1;
+}
+
+void fixedpoint_atomic_striped_destroy(FixedpointAtomicStriped *acc)
+{
+    free(acc->shards);
+    acc->shards = NULL;
+    acc->num_shards = 0;
+}
+
+// Get the shard of acc that the calling thread should update
+static FixedpointAtomic *thread_shard(FixedpointAtomicStriped *acc)
+{
+    if (thread_shard_hint == UINT32_MAX)
+    {
+        thread_shard_hint = __atomic_fetch_add(&next_shard_hint, 1, __ATOMIC_RELAXED) & (UINT32_MAX >> 1);
+    }
+    return &acc->shards[thread_shard_hint % acc->num_shards];
+}
+
+void fixedpoint_atomic_striped_add(FixedpointAtomicStriped *acc, Fixedpoint val)
+{
+    accumulate(thread_shard(acc), val, 0);
+}
+
+void fixedpoint_atomic_striped_sub(FixedpointAtomicStriped *acc, Fixedpoint val)
+{
+    accumulate(thread_shard(acc), val, 1);
+}
+
+Fixedpoint fixedpoint_atomic_striped_load(FixedpointAtomicStriped *acc)
+{
+    FixedpointAccum sum;
+    fixedpoint_accum_init(&sum);
+    for (unsigned i = 0; i < acc->num_shards; ++i)
+    {
+        merge_into(&sum, &acc->shards[i]);
+    }
+    return fixedpoint_accum_result(&sum);
+}
@@ -0,0 +1,135 @@
+#ifndef FIXEDPOINT_ATOMIC_H
+#define FIXEDPOINT_ATOMIC_H
+
+#include <stdint.h>
+#include "fixedpoint.h"
+
+// An accumulator that many threads can add Fixedpoint values to without a
+// mutex. The sum is kept as a 128 bit two's complement number in units of
+// 2^-64, which is updated with a single 128 bit compare-and-swap
+// (cmpxchg16b on x86-64). Each update that takes those 128 bits past
+// 2^127 or -2^127 (in units of 2^-64, so a sum of about 2^63 or more) also
+// adds +1 or -1 to a separate carry word. Together these hold the exact
+// sum, so the sum can leave the range of a Fixedpoint and come back without
+// losing information, while a sum that crosses zero only changes the
+// 128 bits.
+// Each accumulator occupies its own 64 byte cache line.
+//
+// Fields:
+//  value - the low 128 bits of the sum (low word first)
+//  carry - the number of times the low 128 bits, as a signed number,
+//          overflowed upwards minus the number of times they overflowed
+//          downwards
+//  tag - VALID_NONNEGATIVE while every value added was valid; otherwise
+//        the tag of the first non-valid value added
+//  lock - used instead of compare-and-swap on platforms without a
+//         128 bit compare-and-swap instruction
+typedef struct
+{
+    _Alignas(64) uint64_t value[2];
+    int64_t carry;
+    int tag;
+    unsigned char lock;
+} FixedpointAtomic;
+
+// A striped accumulator: several FixedpointAtomic accumulators (shards),
+// with each thread adding to its own shard. This avoids contention on a
+// single cache line when many threads update the same total. Reading the
+// total merges the shards.
+//
+// Fields:
+//  shards - the shards
+//  num_shards - the number of shards
+typedef struct
+{
+    FixedpointAtomic *shards;
+    unsigned num_shards;
+} FixedpointAtomicStriped;
+
+// Initialize an atomic accumulator to 0. This must not race with any
+// other operation on the accumulator.
+//
+// Parameters:
+//   acc - pointer to the accumulator
+void fixedpoint_atomic_init(FixedpointAtomic *acc);
+
+// Atomically add a Fixedpoint value to an accumulator.
+// A value that is not valid does not change the sum, but is remembered in
+// the accumulator's tag (if it is the first non-valid value).
+//
+// Parameters:
+//   acc - pointer to the accumulator
+//   val - the Fixedpoint value to add
+void fixedpoint_atomic_add(FixedpointAtomic *acc, Fixedpoint val);
+
+// Atomically subtract a Fixedpoint value from an accumulator.
+// Non-valid values are handled as in fixedpoint_atomic_add.
+//
+// Parameters:
+//   acc - pointer to the accumulator
+//   val - the Fixedpoint value to subtract
+void fixedpoint_atomic_sub(FixedpointAtomic *acc, Fixedpoint val);
+
+// Get the sum held in an accumulator. The result is exact when no other
+// thread is updating the accumulator. While other threads are updating
+// it, the low 128 bits and the carry word are read separately, so an
+// update that takes the sum past 2^127 or -2^127 (in units of 2^-64) may be
+// half-observed; updates while the sum stays between those bounds, such as
+// ones that make it cross zero, are always seen whole.
+//
+// Parameters:
+//   acc - pointer to the accumulator
+//
+// Returns:
+//   the sum, if every value added was valid and the sum can be represented;
+//   if the sum cannot be represented, a value for which either
+//   fixedpoint_is_overflow_pos or fixedpoint_is_overflow_neg returns true;
+//   if a non-valid value was added, a value with that value's tag
+Fixedpoint fixedpoint_atomic_load(FixedpointAtomic *acc);
+
+// Initialize a striped accumulator to 0.
+//
+// Parameters:
+//   acc - pointer to the striped accumulator
+//   num_shards - the number of shards (typically the number of threads)
+//
+// Returns:
+//   1 if successful;
+//   0 if memory could not be allocated
+int fixedpoint_atomic_striped_init(FixedpointAtomicStriped *acc, unsigned num_shards);
+
+// Free the memory owned by a striped accumulator.
+//
+// Parameters:
+//   acc - pointer to the striped accumulator
+void fixedpoint_atomic_striped_destroy(FixedpointAtomicStriped *acc);
+
+// Atomically add a Fixedpoint value to the calling thread's shard of a
+// striped accumulator. Threads are assigned shards round-robin the first
+// time they use any striped accumulator.
+//
+// Parameters:
+//   acc - pointer to the striped accumulator
+//   val - the Fixedpoint value to add
+void fixedpoint_atomic_striped_add(FixedpointAtomicStriped *acc, Fixedpoint val);
+
+// Atomically subtract a Fixedpoint value from the calling thread's shard of
+// a striped accumulator.
+//
+// Parameters:
+//   acc - pointer to the striped accumulator
+//   val - the Fixedpoint value to subtract
+void fixedpoint_atomic_striped_sub(FixedpointAtomicStriped *acc, Fixedpoint val);
+
+// Merge the shards of a striped accumulator into a single sum. As with
+// fixedpoint_atomic_load, the result is exact when no thread is updating
+// the accumulator.
+//
+// Parameters:
+//   acc - pointer to the striped accumulator
+//
+// Returns:
+//   the sum, tagged as described for fixedpoint_atomic_load
+Fixedpoint fixedpoint_atomic_striped_load(FixedpointAtomicStriped *acc);
+
+#endif // FIXEDPOINT_ATOMIC_H
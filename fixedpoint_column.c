@@ -0,0 +1,295 @@
+#include <stdlib.h>
+#include <string.h>
+#include "fixedpoint_column.h"
+
+// The number of values fixedpoint_add_batch analyzes and packs at a time
+#define BATCH_BLOCK 256
+
+// The operations a column supports
+typedef enum
+{
+    COLUMN_ADD,
+    COLUMN_SUB
+} ColumnOp;
+
+void fixedpoint_range_analyze(const Fixedpoint *vals, size_t count, FixedpointRange *range)
+{
+    uint64_t wholes = 0;
+    uint64_t fracs = 0;
+    size_t invalid = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        wholes |= vals[i].whole;
+        fracs |= vals[i].frac;
+        invalid += vals[i].tag != VALID_NONNEGATIVE && vals[i].tag != VALID_NEGATIVE;
+    }
+
+    range->whole_bits = wholes == 0 ? 0 : 64 - __builtin_clzl(wholes);
+    range->frac_bits = fracs == 0 ? 0 : 64 - __builtin_ctzl(fracs);
+    range->invalid = invalid;
+}
+
+int fixedpoint_range_fits_packed(const FixedpointRange *range)
+{
+    return range->invalid == 0 && range->whole_bits + range->frac_bits <= FIXEDPOINT_PACKED_BITS;
+}
+
+void fixedpoint_pack(const Fixedpoint *vals, size_t count, unsigned frac_bits, int64_t *out)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        uint64_t mag = vals[i].whole << frac_bits | (frac_bits == 0 ? 0 : vals[i].frac >> (64 - frac_bits));
+        out[i] = vals[i].tag == VALID_NEGATIVE ? -(int64_t)mag : (int64_t)mag;
+    }
+}
+
+// Convert one packed value to a Fixedpoint value
+static Fixedpoint unpack_one(int64_t x, unsigned frac_bits)
+{
+    Fixedpoint val;
+    // Negate as unsigned so that INT64_MIN is handled
+    uint64_t mag = x < 0 ? -(uint64_t)x : (uint64_t)x;
+    val.whole = mag >> frac_bits;
+    val.frac = frac_bits == 0 ? 0 : mag << (64 - frac_bits);
+    val.tag = x < 0 ? VALID_NEGATIVE : VALID_NONNEGATIVE;
+    return val;
+}
+
+void fixedpoint_unpack(const int64_t *packed, size_t count, unsigned frac_bits, Fixedpoint *out)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        out[i] = unpack_one(packed[i], frac_bits);
+    }
+}
+
+// Apply op to arrays of Fixedpoint values, packing each block of values
+// whose operands leave room for one carry bit
+static void batch_op(const Fixedpoint *left, const Fixedpoint *right, Fixedpoint *out, size_t count, ColumnOp op)
+{
+    int64_t a[BATCH_BLOCK], b[BATCH_BLOCK];
+
+    for (size_t start = 0; start < count; start += BATCH_BLOCK)
+    {
+        size_t n = count - start < BATCH_BLOCK ? count - start : BATCH_BLOCK;
+        FixedpointRange left_range, right_range;
+        fixedpoint_range_analyze(left + start, n, &left_range);
+        fixedpoint_range_analyze(right + start, n, &right_range);
+        unsigned whole_bits = left_range.whole_bits > right_range.whole_bits ? left_range.whole_bits
+                                                                              : right_range.whole_bits;
+        unsigned frac_bits = left_range.frac_bits > right_range.frac_bits ? left_range.frac_bits
+                                                                           : right_range.frac_bits;
+
+        if (left_range.invalid + right_range.invalid != 0 || whole_bits + frac_bits > FIXEDPOINT_PACKED_BITS - 1)
+        {
+            for (size_t i = start; i < start + n; ++i)
+            {
+                out[i] = op == COLUMN_ADD ? fixedpoint_add(left[i], right[i]) : fixedpoint_sub(left[i], right[i]);
+            }
+            continue;
+        }
+
+        fixedpoint_pack(left + start, n, frac_bits, a);
+        fixedpoint_pack(right + start, n, frac_bits, b);
+        if (op == COLUMN_ADD)
+        {
+            for (size_t i = 0; i < n; ++i)
+            {
+                a[i] += b[i];
+            }
+        }
+        else
+        {
+            for (size_t i = 0; i < n; ++i)
+            {
+                a[i] -= b[i];
+            }
+        }
+        fixedpoint_unpack(a, n, frac_bits, out + start);
+    }
+}
+
+void fixedpoint_add_batch(const Fixedpoint *left, const Fixedpoint *right, Fixedpoint *out, size_t count)
+{
+    batch_op(left, right, out, count, COLUMN_ADD);
+}
+
+void fixedpoint_sub_batch(const Fixedpoint *left, const Fixedpoint *right, Fixedpoint *out, size_t count)
+{
+    batch_op(left, right, out, count, COLUMN_SUB);
+}
+
+int fixedpoint_column_init(FixedpointColumn *col, const Fixedpoint *vals, size_t count)
+{
+    col->packed = NULL;
+    col->count = count;
+    col->frac_bits = 0;
+    // Allocate at least one element so that a wide column never has a NULL array
+    col->wide = malloc((count == 0 ? 1 : count) * sizeof(Fixedpoint));
+    if (col->wide == NULL)
+    {
+        return 0;
+    }
+    memcpy(col->wide, vals, count * sizeof(Fixedpoint));
+    fixedpoint_column_narrow(col);
+    return 1;
+}
+
+void fixedpoint_column_destroy(FixedpointColumn *col)
+{
+    free(col->packed);
+    free(col->wide);
+    col->packed = NULL;
+    col->wide = NULL;
+    col->count = 0;
+}
+
+int fixedpoint_column_is_packed(const FixedpointColumn *col)
+{
+    return col->packed != NULL;
+}
+
+Fixedpoint fixedpoint_column_get(const FixedpointColumn *col, size_t index)
+{
+    if (col->packed != NULL)
+    {
+        return unpack_one(col->packed[index], col->frac_bits);
+    }
+    return col->wide[index];
+}
+
+void fixedpoint_column_read(const FixedpointColumn *col, Fixedpoint *out)
+{
+    if (col->packed != NULL)
+    {
+        fixedpoint_unpack(col->packed, col->count, col->frac_bits, out);
+    }
+    else
+    {
+        memcpy(out, col->wide, col->count * sizeof(Fixedpoint));
+    }
+}
+
+int fixedpoint_column_widen(FixedpointColumn *col)
+{
+    if (col->packed == NULL)
+    {
+        return 1;
+    }
+    Fixedpoint *wide = malloc((col->count == 0 ? 1 : col->count) * sizeof(Fixedpoint));
+    if (wide == NULL)
+    {
+        return 0;
+    }
+    fixedpoint_unpack(col->packed, col->count, col->frac_bits, wide);
+    free(col->packed);
+    col->packed = NULL;
+    col->wide = wide;
+    return 1;
+}
+
+int fixedpoint_column_narrow(FixedpointColumn *col)
+{
+    if (col->packed != NULL)
+    {
+        return 1;
+    }
+    FixedpointRange range;
+    fixedpoint_range_analyze(col->wide, col->count, &range);
+    if (!fixedpoint_range_fits_packed(&range))
+    {
+        return 0;
+    }
+    int64_t *packed = malloc((col->count == 0 ? 1 : col->count) * sizeof(int64_t));
+    if (packed == NULL)
+    {
+        return 0;
+    }
+    fixedpoint_pack(col->wide, col->count, range.frac_bits, packed);
+    free(col->wide);
+    col->wide = NULL;
+    col->packed = packed;
+    col->frac_bits = range.frac_bits;
+    return 1;
+}
+
+// The number of significant bits of the largest magnitude in a packed array
+static unsigned packed_magnitude_bits(const int64_t *packed, size_t count)
+{
+    uint64_t mags = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        mags |= packed[i] < 0 ? -(uint64_t)packed[i] : (uint64_t)packed[i];
+    }
+    return mags == 0 ? 0 : 64 - __builtin_clzl(mags);
+}
+
+// Apply op to a column of Fixedpoint values, from the given index on
+static int column_op_wide(FixedpointColumn *left, const FixedpointColumn *right, size_t start, ColumnOp op)
+{
+    if (!fixedpoint_column_widen(left))
+    {
+        return 0;
+    }
+    for (size_t i = start; i < left->count; ++i)
+    {
+        Fixedpoint r = fixedpoint_column_get(right, i);
+        left->wide[i] = op == COLUMN_ADD ? fixedpoint_add(left->wide[i], r) : fixedpoint_sub(left->wide[i], r);
+    }
+    return 1;
+}
+
+// Apply op to two columns. Packed columns are brought to a common scale
+// and combined with overflow-checked integer arithmetic; at the first
+// overflow the left column is widened and the rest is done exactly.
+static int column_op(FixedpointColumn *left, const FixedpointColumn *right, ColumnOp op)
+{
+    if (left->packed == NULL || right->packed == NULL)
+    {
+        return column_op_wide(left, right, 0, op);
+    }
+
+    unsigned frac_bits = left->frac_bits > right->frac_bits ? left->frac_bits : right->frac_bits;
+    unsigned left_shift = frac_bits - left->frac_bits;
+    unsigned right_shift = frac_bits - right->frac_bits;
+    if ((left_shift != 0 && packed_magnitude_bits(left->packed, left->count) + left_shift > FIXEDPOINT_PACKED_BITS) ||
+        (right_shift != 0 && packed_magnitude_bits(right->packed, right->count) + right_shift > FIXEDPOINT_PACKED_BITS))
+    {
+        return column_op_wide(left, right, 0, op);
+    }
+
+    int64_t *a = left->packed;
+    const int64_t *b = right->packed;
+    if (left_shift != 0)
+    {
+        for (size_t i = 0; i < left->count; ++i)
+        {
+            a[i] *= (int64_t)1 << left_shift;
+        }
+        left->frac_bits = frac_bits;
+    }
+
+    int64_t right_scale = (int64_t)1 << right_shift;
+    for (size_t i = 0; i < left->count; ++i)
+    {
+        int64_t result;
+        int overflow = op == COLUMN_ADD ? __builtin_add_overflow(a[i], b[i] * right_scale, &result)
+                                        : __builtin_sub_overflow(a[i], b[i] * right_scale, &result);
+        if (overflow)
+        {
+            return column_op_wide(left, right, i, op);
+        }
+        a[i] = result;
+    }
+    return 1;
+}
+
+int fixedpoint_column_add(FixedpointColumn *left, const FixedpointColumn *right)
+{
+    return column_op(left, right, COLUMN_ADD);
+}
+
+int fixedpoint_column_sub(FixedpointColumn *left, const FixedpointColumn *right)
+{
+    return column_op(left, right, COLUMN_SUB);
+}
@@ -0,0 +1,188 @@
+#ifndef FIXEDPOINT_COLUMN_H
+#define FIXEDPOINT_COLUMN_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "fixedpoint.h"
+
+// Arrays of Fixedpoint values with a narrow-range fast path.
+//
+// Most values are far smaller than the full 64.64 range. When every value
+// of an array has a small whole part and few fraction bits, the whole array
+// can be stored as 64 bit two's complement integers in units of 2^-frac_bits
+// for some shared frac_bits, and added or subtracted with single-word
+// integer arithmetic. A FixedpointColumn chooses its representation from a
+// range analysis of its values and widens back to Fixedpoint values,
+// exactly, as soon as a result would leave the packed range.
+
+// The result of a range analysis of an array of Fixedpoint values
+//
+// Fields:
+//  whole_bits - the number of bits needed for the largest whole part (0 to 64)
+//  frac_bits - the number of fraction bits needed for the finest fractional
+//              part, i.e. 64 minus the lowest set bit position (0 to 64)
+//  invalid - the number of values that are not valid
+typedef struct
+{
+    unsigned whole_bits;
+    unsigned frac_bits;
+    size_t invalid;
+} FixedpointRange;
+
+// The largest number of significant bits (whole_bits + frac_bits) a packed
+// value can have: the magnitude must fit a signed 64 bit integer
+#define FIXEDPOINT_PACKED_BITS 63
+
+// A column of Fixedpoint values, stored either packed or as Fixedpoint values
+//
+// Fields:
+//  packed - if not NULL, the values, in units of 2^-frac_bits
+//  wide - if not NULL, the values as Fixedpoint values
+//  count - the number of values
+//  frac_bits - the scale of the packed values
+typedef struct
+{
+    int64_t *packed;
+    Fixedpoint *wide;
+    size_t count;
+    unsigned frac_bits;
+} FixedpointColumn;
+
+// Find the range of an array of Fixedpoint values.
+//
+// Parameters:
+//   vals - the values
+//   count - the number of values
+//   range - receives the range of the values
+void fixedpoint_range_analyze(const Fixedpoint *vals, size_t count, FixedpointRange *range);
+
+// Check whether values with a given range can be packed.
+//
+// Parameters:
+//   range - the range of the values
+//
+// Returns:
+//   1 if all the values are valid and have at most FIXEDPOINT_PACKED_BITS
+//   significant bits; 0 otherwise
+int fixedpoint_range_fits_packed(const FixedpointRange *range);
+
+// Convert Fixedpoint values to packed values.
+//
+// Parameters:
+//   vals - the values, which must be valid and fit in packed form with the
+//          given scale
+//   count - the number of values
+//   frac_bits - the scale of the packed values (at most FIXEDPOINT_PACKED_BITS)
+//   out - receives the packed values
+void fixedpoint_pack(const Fixedpoint *vals, size_t count, unsigned frac_bits, int64_t *out);
+
+// Convert packed values to Fixedpoint values.
+//
+// Parameters:
+//   packed - the packed values
+//   count - the number of values
+//   frac_bits - the scale of the packed values (at most FIXEDPOINT_PACKED_BITS)
+//   out - receives the Fixedpoint values
+void fixedpoint_unpack(const int64_t *packed, size_t count, unsigned frac_bits, Fixedpoint *out);
+
+// Add arrays of Fixedpoint values elementwise, with the same results as
+// fixedpoint_add (except that a negative zero operand is treated as zero).
+// Blocks of values that fit in packed form are added with single-word
+// arithmetic.
+//
+// Parameters:
+//   left - the left operands
+//   right - the right operands
+//   out - receives the sums (may be the same array as left or right)
+//   count - the number of values
+void fixedpoint_add_batch(const Fixedpoint *left, const Fixedpoint *right, Fixedpoint *out, size_t count);
+
+// Subtract arrays of Fixedpoint values elementwise, with the same results as
+// fixedpoint_sub. See fixedpoint_add_batch.
+void fixedpoint_sub_batch(const Fixedpoint *left, const Fixedpoint *right, Fixedpoint *out, size_t count);
+
+// Initialize a column with a copy of an array of values. The column is
+// packed if the range of the values allows it.
+//
+// Parameters:
+//   col - pointer to the column to initialize
+//   vals - the values
+//   count - the number of values
+//
+// Returns:
+//   1 if successful;
+//   0 if memory could not be allocated
+int fixedpoint_column_init(FixedpointColumn *col, const Fixedpoint *vals, size_t count);
+
+// Free the memory owned by a column.
+//
+// Parameters:
+//   col - pointer to the column
+void fixedpoint_column_destroy(FixedpointColumn *col);
+
+// Check whether a column is packed.
+//
+// Parameters:
+//   col - pointer to the column
+//
+// Returns:
+//   1 if the column is stored packed; 0 otherwise
+int fixedpoint_column_is_packed(const FixedpointColumn *col);
+
+// Get a value of a column.
+//
+// Parameters:
+//   col - pointer to the column
+//   index - the index of the value (less than col->count)
+//
+// Returns:
+//   the value
+Fixedpoint fixedpoint_column_get(const FixedpointColumn *col, size_t index);
+
+// Copy all the values of a column into an array.
+//
+// Parameters:
+//   col - pointer to the column
+//   out - receives col->count values
+void fixedpoint_column_read(const FixedpointColumn *col, Fixedpoint *out);
+
+// Convert a packed column to Fixedpoint values. Does nothing if the column
+// is not packed.
+//
+// Parameters:
+//   col - pointer to the column
+//
+// Returns:
+//   1 if successful;
+//   0 if memory could not be allocated (the column is unchanged)
+int fixedpoint_column_widen(FixedpointColumn *col);
+
+// Pack a column if the range of its values allows it. Does nothing if the
+// column is already packed or its values do not fit.
+//
+// Parameters:
+//   col - pointer to the column
+//
+// Returns:
+//   1 if the column is packed on return; 0 otherwise
+int fixedpoint_column_narrow(FixedpointColumn *col);
+
+// Add a column to another, elementwise and in place. If both columns are
+// packed the sums are computed with single-word arithmetic; if a sum would
+// leave the packed range, the left column is widened and the results are
+// still exact (the same as fixedpoint_add).
+//
+// Parameters:
+//   left - pointer to the column to add to
+//   right - pointer to the column to add (with the same count as left)
+//
+// Returns:
+//   1 if successful;
+//   0 if memory could not be allocated (left may hold partial results)
+int fixedpoint_column_add(FixedpointColumn *left, const FixedpointColumn *right);
+
+// Subtract a column from another, elementwise and in place.
+// See fixedpoint_column_add.
+int fixedpoint_column_sub(FixedpointColumn *left, const FixedpointColumn *right);
+
+#endif // FIXEDPOINT_COLUMN_H
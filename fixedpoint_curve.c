@@ -0,0 +1,333 @@
+#include <stdlib.h>
+#include "fixedpoint_curve.h"
+#include "fixedpoint_wide.h"
+
+// Coordinates are signed 128 bit numbers in units of 2^-64. Knots are below
+// 2^120 in magnitude, so differences of knots are below 2^121 and the cubic
+// coefficients below 2^124.
+
+// The data of the segment that starts at a knot. For a linear curve, scale
+// is the slope; for a cubic one it is 1/h, where h is the width of the
+// segment, so that the position in the segment is t = (x - knot x) / h.
+// Either way it is stored times 2^shift, with shift chosen to keep about
+// 125 significant bits. The last knot has no segment, only x and y.
+//
+// Fields:
+//  x - the x coordinate of the knot
+//  y - the y coordinate of the knot
+//  scale - the slope or the reciprocal of the width, times 2^shift
+//  b, c, d - the cubic y + b t + c t^2 + d t^3 (cubic curves only)
+//  shift - the scale of the scale field
+struct FixedpointCurveSegment
+{
+    i128 x;
+    i128 y;
+    i128 scale;
+    i128 b;
+    i128 c;
+    i128 d;
+    unsigned shift;
+};
+
+// Convert a knot coordinate, failing if it is out of range
+static int to_coordinate(Fixedpoint val, i128 *out)
+{
+    if (!fixedpoint_is_valid(val) || val.whole >= FIXEDPOINT_CURVE_MAX_WHOLE)
+    {
+        return 0;
+    }
+    *out = val.tag == VALID_NEGATIVE ? -(i128)magnitude(val) : (i128)magnitude(val);
+    return 1;
+}
+
+// Convert an argument, clamping it to a range beyond every knot
+static i128 to_argument(Fixedpoint val)
+{
+    u128 mag = val.whole >= (1UL << 62) ? (u128)1 << 126 : magnitude(val);
+    return val.tag == VALID_NEGATIVE ? -(i128)mag : (i128)mag;
+}
+
+static Fixedpoint from_coordinate(i128 v)
+{
+    u128 mag = abs_wide(v);
+    Fixedpoint val;
+    val.whole = (uint64_t)(mag >> 64);
+    val.frac = (uint64_t)mag;
+    val.tag = v < 0 ? VALID_NEGATIVE : VALID_NONNEGATIVE;
+    return val;
+}
+
+// Compute round(v * u / 2^shift), rounding halves away from zero. The
+// result must fit in 127 bits.
+static i128 mul_shift(i128 v, u128 u, unsigned shift)
+{
+    u128 upper, lower;
+    mul_128(abs_wide(v), u, &upper, &lower);
+    u128 result;
+    if (shift == 0)
+    {
+        result = lower;
+    }
+    else
+    {
+        // Add half of the last unit kept, then shift
+        if (shift <= 128)
+        {
+            u128 half = (u128)1 << (shift - 1);
+            lower += half;
+            upper += lower < half;
+        }
+        else
+        {
+            upper += (u128)1 << (shift - 129);
+        }
+        result = shift < 128 ? upper << (128 - shift) | lower >> shift : upper >> (shift - 128);
+    }
+    return v < 0 ? -(i128)result : (i128)result;
+}
+
+// Divide the 256 bit number upper:lower by d, one bit at a time, rounding
+// to nearest. The quotient must fit in 128 bits and d in 127. This is only
+// used while building curves.
+static u128 div_256(u128 upper, u128 lower, u128 d)
+{
+    u128 quotient = 0, rem = 0;
+    for (int i = 255; i >= 0; --i)
+    {
+        uint64_t bit = i >= 128 ? (uint64_t)(upper >> (i - 128)) & 1 : (uint64_t)(lower >> i) & 1;
+        rem = rem << 1 | bit;
+        quotient <<= 1;
+        if (rem >= d)
+        {
+            rem -= d;
+            quotient |= 1;
+        }
+    }
+    return quotient + (rem >= d - rem);
+}
+
+// Compute num / den (den > 0) as a scale and shift for mul_shift
+static void make_scale(i128 num, u128 den, i128 *scale, unsigned *shift)
+{
+    u128 mag = abs_wide(num);
+    if (mag == 0)
+    {
+        *scale = 0;
+        *shift = 0;
+        return;
+    }
+    // mag * 2^s / den is below 2^(s + bits(mag) - bits(den) + 1); aim for 2^125
+    int s = 124 + (int)bit_length(den) - (int)bit_length(mag);
+    u128 upper = 0, lower = mag;
+    if (s >= 128)
+    {
+        upper = mag << (s - 128);
+        lower = 0;
+    }
+    else if (s > 0)
+    {
+        upper = mag >> (128 - s);
+        lower = mag << s;
+    }
+    u128 q = div_256(upper, lower, den);
+    *scale = num < 0 ? -(i128)q : (i128)q;
+    *shift = (unsigned)s;
+}
+
+// Compare |a| / ha with |b| / hb
+static int compare_slopes(i128 a, u128 ha, i128 b, u128 hb)
+{
+    u128 upper1, lower1, upper2, lower2;
+    mul_128(abs_wide(a), hb, &upper1, &lower1);
+    mul_128(abs_wide(b), ha, &upper2, &lower2);
+    if (upper1 != upper2)
+    {
+        return upper1 < upper2 ? -1 : 1;
+    }
+    return lower1 < lower2 ? -1 : lower1 > lower2;
+}
+
+// The tangent at knot k times the width of segment i, in units of y.
+// Inside the curve, the tangent is zero at a local extremum, and otherwise
+// the smaller of the two neighbouring slopes (which keeps the curve
+// monotone); at the ends it is the slope of the end segment.
+static i128 scaled_tangent(const FixedpointCurveSegment *segs, size_t count, size_t k, size_t i)
+{
+    size_t from;
+    if (k == 0 || k == count - 1)
+    {
+        from = k == 0 ? 0 : k - 1;
+    }
+    else
+    {
+        i128 left = segs[k].y - segs[k - 1].y, right = segs[k + 1].y - segs[k].y;
+        if ((left < 0) != (right < 0) || left == 0 || right == 0)
+        {
+            return 0;
+        }
+        u128 left_h = (u128)(segs[k].x - segs[k - 1].x), right_h = (u128)(segs[k + 1].x - segs[k].x);
+        from = compare_slopes(left, left_h, right, right_h) <= 0 ? k - 1 : k;
+    }
+    i128 dy = segs[from + 1].y - segs[from].y;
+    if (from == i)
+    {
+        return dy;
+    }
+    u128 h = (u128)(segs[i + 1].x - segs[i].x), from_h = (u128)(segs[from + 1].x - segs[from].x);
+    u128 upper, lower;
+    mul_128(abs_wide(dy), h, &upper, &lower);
+    u128 q = div_256(upper, lower, from_h);
+    return dy < 0 ? -(i128)q : (i128)q;
+}
+
+// Compute the segment data once the knots are in place
+static void build_segments(FixedpointCurve *curve)
+{
+    FixedpointCurveSegment *segs = curve->segments;
+    for (size_t i = 0; i + 1 < curve->count; ++i)
+    {
+        i128 dy = segs[i + 1].y - segs[i].y;
+        u128 h = (u128)(segs[i + 1].x - segs[i].x);
+        if (curve->kind == FIXEDPOINT_CURVE_LINEAR)
+        {
+            make_scale(dy, h, &segs[i].scale, &segs[i].shift);
+            continue;
+        }
+        make_scale((i128)1 << 64, h, &segs[i].scale, &segs[i].shift);
+        i128 left = scaled_tangent(segs, curve->count, i, i);
+        i128 right = scaled_tangent(segs, curve->count, i + 1, i);
+        segs[i].b = left;
+        segs[i].c = 3 * dy - 2 * left - right;
+        segs[i].d = left + right - 2 * dy;
+    }
+}
+
+static int alloc_segments(FixedpointCurve *curve, size_t count, FixedpointCurveKind kind)
+{
+    curve->segments = count > 0 ? calloc(count, sizeof(FixedpointCurveSegment)) : NULL;
+    curve->count = count;
+    curve->kind = kind;
+    curve->uniform = 0;
+    curve->step_shift = 0;
+    return curve->segments != NULL;
+}
+
+int fixedpoint_curve_init(FixedpointCurve *curve, const Fixedpoint *xs, const Fixedpoint *ys, size_t count,
+                          FixedpointCurveKind kind)
+{
+    if (!alloc_segments(curve, count, kind))
+    {
+        return 0;
+    }
+    for (size_t i = 0; i < count; ++i)
+    {
+        FixedpointCurveSegment *seg = &curve->segments[i];
+        if (!to_coordinate(xs[i], &seg->x) || !to_coordinate(ys[i], &seg->y) || (i > 0 && seg->x <= seg[-1].x))
+        {
+            fixedpoint_curve_destroy(curve);
+            return 0;
+        }
+    }
+    build_segments(curve);
+    return 1;
+}
+
+int fixedpoint_curve_init_uniform(FixedpointCurve *curve, Fixedpoint x0, int step_exp, const Fixedpoint *ys,
+                                  size_t count, FixedpointCurveKind kind)
+{
+    i128 start;
+    if (step_exp < -64 || step_exp > 55 || !to_coordinate(x0, &start))
+    {
+        return 0;
+    }
+    unsigned step_shift = (unsigned)(step_exp + 64);
+    i128 limit = (i128)FIXEDPOINT_CURVE_MAX_WHOLE << 64;
+    if (count > 0 && (count - 1) > (size_t)((limit - 1 - start) >> step_shift))
+    {
+        return 0;
+    }
+    if (!alloc_segments(curve, count, kind))
+    {
+        return 0;
+    }
+    for (size_t i = 0; i < count; ++i)
+    {
+        curve->segments[i].x = start + ((i128)i << step_shift);
+        if (!to_coordinate(ys[i], &curve->segments[i].y))
+        {
+            fixedpoint_curve_destroy(curve);
+            return 0;
+        }
+    }
+    curve->uniform = 1;
+    curve->step_shift = step_shift;
+    build_segments(curve);
+    return 1;
+}
+
+void fixedpoint_curve_destroy(FixedpointCurve *curve)
+{
+    free(curve->segments);
+    curve->segments = NULL;
+    curve->count = 0;
+}
+
+// Find the segment containing x, which is strictly inside the knots
+static const FixedpointCurveSegment *find_segment(const FixedpointCurve *curve, i128 x)
+{
+    const FixedpointCurveSegment *base = curve->segments;
+    if (curve->uniform)
+    {
+        return base + (size_t)((u128)(x - base->x) >> curve->step_shift);
+    }
+    // Branch-free binary search for the last knot at or below x
+    size_t len = curve->count - 1;
+    while (len > 1)
+    {
+        size_t half = len / 2;
+        base = base[half].x <= x ? base + half : base;
+        len -= half;
+    }
+    return base;
+}
+
+Fixedpoint fixedpoint_curve_eval(const FixedpointCurve *curve, Fixedpoint x)
+{
+    if (!fixedpoint_is_valid(x))
+    {
+        Fixedpoint err = {0, 0, ERROR};
+        return err;
+    }
+    const FixedpointCurveSegment *first = curve->segments;
+    const FixedpointCurveSegment *last = curve->segments + curve->count - 1;
+    i128 arg = to_argument(x);
+    if (arg <= first->x)
+    {
+        return from_coordinate(first->y);
+    }
+    if (arg >= last->x)
+    {
+        return from_coordinate(last->y);
+    }
+
+    const FixedpointCurveSegment *seg = find_segment(curve, arg);
+    u128 offset = (u128)(arg - seg->x);
+    if (curve->kind == FIXEDPOINT_CURVE_LINEAR)
+    {
+        return from_coordinate(seg->y + mul_shift(seg->scale, offset, seg->shift));
+    }
+    // t in [0, 1] in units of 2^-64, then Horner's rule
+    u128 t = (u128)mul_shift(seg->scale, offset, seg->shift);
+    i128 acc = seg->d;
+    acc = seg->c + mul_shift(acc, t, 64);
+    acc = seg->b + mul_shift(acc, t, 64);
+    return from_coordinate(seg->y + mul_shift(acc, t, 64));
+}
+
+void fixedpoint_curve_eval_batch(const FixedpointCurve *curve, const Fixedpoint *xs, Fixedpoint *out, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        out[i] = fixedpoint_curve_eval(curve, xs[i]);
+    }
+}
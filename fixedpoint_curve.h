@@ -0,0 +1,119 @@
+#ifndef FIXEDPOINT_CURVE_H
+#define FIXEDPOINT_CURVE_H
+
+#include <stddef.h>
+#include "fixedpoint.h"
+
+// Curves interpolated between knot points, such as yield curves and fee
+// schedules. Everything that does not depend on the argument (slopes,
+// reciprocals of the knot spacing, cubic coefficients) is computed once
+// when the curve is built, so evaluating a curve takes one search and a
+// few multiplications. Curves with evenly spaced knots at a power of two
+// spacing find the segment with a shift instead of a search.
+//
+// Outside the knots a curve is flat: it takes the value of the first knot
+// before it and the value of the last knot after it.
+
+// The bound on the magnitude of knot coordinates (2^56), which keeps the
+// interpolation arithmetic within 128 bits
+#define FIXEDPOINT_CURVE_MAX_WHOLE (1UL << 56)
+
+// An enum that holds the ways a curve can interpolate between knots
+// FIXEDPOINT_CURVE_LINEAR: Straight lines between knots. The result is
+//                          within 1 ulp (2^-64) of the exact value.
+// FIXEDPOINT_CURVE_CUBIC: Cubic Hermite interpolation, with tangents chosen
+//                         so that the curve is monotone wherever the knots
+//                         are and never overshoots them. The position
+//                         within a segment is rounded to a multiple of
+//                         2^-64, so the result is within
+//                         4 ulp + 2^-62 * |dy| of the exact value, where dy
+//                         is the change in y over the segment.
+typedef enum
+{
+    FIXEDPOINT_CURVE_LINEAR,
+    FIXEDPOINT_CURVE_CUBIC
+} FixedpointCurveKind;
+
+// The precomputed data of one segment (defined in fixedpoint_curve.c)
+typedef struct FixedpointCurveSegment FixedpointCurveSegment;
+
+// A struct that holds an interpolated curve
+//
+// Fields:
+//  segments - the knots and the data of the segment that starts at each
+//  count - the number of knots
+//  kind - how the curve interpolates
+//  uniform - 1 if the knots are evenly spaced and segments are found by
+//            shifting; 0 if they are found by binary search
+//  step_shift - for a uniform curve, log2 of the knot spacing in units of 2^-64
+typedef struct
+{
+    FixedpointCurveSegment *segments;
+    size_t count;
+    FixedpointCurveKind kind;
+    int uniform;
+    unsigned step_shift;
+} FixedpointCurve;
+
+// Build a curve through a set of knots.
+//
+// Parameters:
+//   curve - pointer to the curve to initialize
+//   xs - the x coordinates of the knots, strictly increasing
+//   ys - the y coordinates of the knots
+//   count - the number of knots, at least 1
+//   kind - how to interpolate between knots
+//
+// Returns:
+//   1 if successful;
+//   0 if memory could not be allocated, or if the knots are not valid: a
+//   coordinate that is not valid or not below FIXEDPOINT_CURVE_MAX_WHOLE
+//   in magnitude, x coordinates out of order, or no knots
+int fixedpoint_curve_init(FixedpointCurve *curve, const Fixedpoint *xs, const Fixedpoint *ys, size_t count,
+                          FixedpointCurveKind kind);
+
+// Build a curve through knots spaced 2^step_exp apart, starting at x0.
+// Evaluating it finds the segment with a shift instead of a search.
+//
+// Parameters:
+//   curve - pointer to the curve to initialize
+//   x0 - the x coordinate of the first knot
+//   step_exp - log2 of the knot spacing, from -64 to 55
+//   ys - the y coordinates of the knots
+//   count - the number of knots, at least 1
+//   kind - how to interpolate between knots
+//
+// Returns:
+//   1 if successful;
+//   0 if memory could not be allocated or the knots are not valid (see
+//   fixedpoint_curve_init)
+int fixedpoint_curve_init_uniform(FixedpointCurve *curve, Fixedpoint x0, int step_exp, const Fixedpoint *ys,
+                                  size_t count, FixedpointCurveKind kind);
+
+// Free the memory owned by a curve.
+//
+// Parameters:
+//   curve - pointer to the curve
+void fixedpoint_curve_destroy(FixedpointCurve *curve);
+
+// Evaluate a curve.
+//
+// Parameters:
+//   curve - pointer to the curve
+//   x - the argument
+//
+// Returns:
+//   the value of the curve at x, rounded to the nearest multiple of 2^-64;
+//   an error value if x is not valid
+Fixedpoint fixedpoint_curve_eval(const FixedpointCurve *curve, Fixedpoint x);
+
+// Evaluate a curve at each element of an array. out may alias xs.
+//
+// Parameters:
+//   curve - pointer to the curve
+//   xs - the arguments
+//   out - the output array
+//   count - the number of elements
+void fixedpoint_curve_eval_batch(const FixedpointCurve *curve, const Fixedpoint *xs, Fixedpoint *out, size_t count);
+
+#endif // FIXEDPOINT_CURVE_H
@@ -0,0 +1,382 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "fixedpoint_decimal.h"
+
+__extension__ typedef unsigned __int128 u128;
+
+// A power of ten as a divisor, with the data for dividing by it with a
+// multiplication (Moller and Granlund, "Improved division by invariant
+// integers", 2011)
+//
+// Fields:
+//  divisor - the power of ten
+//  shift - the shift that normalizes the divisor (sets its top bit)
+//  reciprocal - floor((2^128 - 1) / (divisor << shift)) - 2^64
+typedef struct
+{
+    uint64_t divisor;
+    unsigned shift;
+    uint64_t reciprocal;
+} Pow10Divisor;
+
+// 10^1 to 10^19
+static const Pow10Divisor pow10_divisors[FIXEDPOINT_DECIMAL_MAX_SCALE] = {
+    {10UL, 60, 0x9999999999999999UL},
+    {100UL, 57, 0x47ae147ae147ae14UL},
+    {1000UL, 54, 0x0624dd2f1a9fbe76UL},
+    {10000UL, 50, 0xa36e2eb1c432ca57UL},
+    {100000UL, 47, 0x4f8b588e368f0846UL},
+    {1000000UL, 44, 0x0c6f7a0b5ed8d36bUL},
+    {10000000UL, 40, 0xad7f29abcaf48578UL},
+    {100000000UL, 37, 0x5798ee2308c39df9UL},
+    {1000000000UL, 34, 0x12e0be826d694b2eUL},
+    {10000000000UL, 30, 0xb7cdfd9d7bdbab7dUL},
+    {100000000000UL, 27, 0x5fd7fe17964955fdUL},
+    {1000000000000UL, 24, 0x19799812dea11197UL},
+    {10000000000000UL, 20, 0xc25c268497681c26UL},
+    {100000000000000UL, 17, 0x6849b86a12b9b01eUL},
+    {1000000000000000UL, 14, 0x203af9ee756159b2UL},
+    {10000000000000000UL, 10, 0xcd2b297d889bc2b6UL},
+    {100000000000000000UL, 7, 0x70ef54646d496892UL},
+    {1000000000000000000UL, 4, 0x2725dd1d243aba0eUL},
+    {10000000000000000000UL, 0, 0xd83c94fb6d2ac34aUL},
+};
+
+static int is_valid_tag(Tag tag)
+{
+    return tag == VALID_NONNEGATIVE || tag == VALID_NEGATIVE;
+}
+
+static u128 magnitude(FixedpointDecimal val)
+{
+    return (u128)val.hi << 64 | val.lo;
+}
+
+// Build a decimal value from a magnitude; a zero magnitude is non-negative
+static FixedpointDecimal make_value(u128 mag, int negative, unsigned scale)
+{
+    FixedpointDecimal val;
+    val.hi = (uint64_t)(mag >> 64);
+    val.lo = (uint64_t)mag;
+    val.scale = scale;
+    val.tag = negative && mag != 0 ? VALID_NEGATIVE : VALID_NONNEGATIVE;
+    return val;
+}
+
+// 10^n for n up to FIXEDPOINT_DECIMAL_MAX_POW10
+static u128 pow10_u128(unsigned n)
+{
+    u128 p = 1;
+    for (unsigned i = 0; i < n; ++i)
+    {
+        p *= 10;
+    }
+    return p;
+}
+
+// Divide the two limb number u1:u0 by a normalized divisor d with
+// reciprocal v, where u1 < d. Returns the quotient and stores the remainder.
+static uint64_t div_2by1(uint64_t u1, uint64_t u0, uint64_t d, uint64_t v, uint64_t *rem)
+{
+    u128 q = (u128)v * u1 + ((u128)u1 << 64) + u0 + ((u128)1 << 64);
+    uint64_t q1 = (uint64_t)(q >> 64);
+    uint64_t q0 = (uint64_t)q;
+    uint64_t r = u0 - q1 * d;
+    if (r > q0)
+    {
+        q1--;
+        r += d;
+    }
+    if (r >= d)
+    {
+        q1++;
+        r -= d;
+    }
+    *rem = r;
+    return q1;
+}
+
+// Divide a 128 bit number by 10^n (1 <= n <= 19). Returns the quotient and
+// stores the remainder.
+static u128 div_pow10_small(u128 x, unsigned n, uint64_t *rem)
+{
+    const Pow10Divisor *p = &pow10_divisors[n - 1];
+    unsigned s = p->shift;
+    uint64_t d = p->divisor << s;
+    uint64_t hi = (uint64_t)(x >> 64);
+    uint64_t lo = (uint64_t)x;
+
+    // Normalize the dividend into three limbs n2:n1:n0
+    uint64_t n2 = s == 0 ? 0 : hi >> (64 - s);
+    uint64_t n1 = s == 0 ? hi : hi << s | lo >> (64 - s);
+    uint64_t n0 = lo << s;
+
+    uint64_t r;
+    uint64_t q1 = div_2by1(n2, n1, d, p->reciprocal, &r);
+    uint64_t q0 = div_2by1(r, n0, d, p->reciprocal, &r);
+    *rem = r >> s;
+    return (u128)q1 << 64 | q0;
+}
+
+// Divide a 128 bit number by 10^n (n <= FIXEDPOINT_DECIMAL_MAX_POW10).
+// Returns the quotient and stores the remainder.
+static u128 div_pow10(u128 x, unsigned n, u128 *rem)
+{
+    if (n == 0)
+    {
+        *rem = 0;
+        return x;
+    }
+    uint64_t r;
+    if (n <= FIXEDPOINT_DECIMAL_MAX_SCALE)
+    {
+        u128 q = div_pow10_small(x, n, &r);
+        *rem = r;
+        return q;
+    }
+
+    // Two steps: by 10^19, then by the rest
+    uint64_t r2;
+    u128 q = div_pow10_small(div_pow10_small(x, FIXEDPOINT_DECIMAL_MAX_SCALE, &r), n - FIXEDPOINT_DECIMAL_MAX_SCALE,
+                             &r2);
+    *rem = (u128)r2 * pow10_divisors[FIXEDPOINT_DECIMAL_MAX_SCALE - 1].divisor + r;
+    return q;
+}
+
+FixedpointDecimal fixedpoint_decimal_create(uint64_t whole, unsigned scale)
+{
+    return make_value((u128)whole * pow10_u128(scale), 0, scale);
+}
+
+FixedpointDecimal fixedpoint_decimal_create_from_string(const char *s, unsigned scale)
+{
+    FixedpointDecimal error = {0, 0, scale, ERROR};
+    int negative = s[0] == '-';
+    const char *digits = negative ? s + 1 : s;
+    u128 whole = 0;
+    u128 frac = 0;
+    size_t frac_len = 0;
+    int seen_point = 0;
+
+    for (const char *c = digits; *c != '\0'; ++c)
+    {
+        if (*c == '.' && !seen_point)
+        {
+            seen_point = 1;
+        }
+        else if (*c < '0' || *c > '9')
+        {
+            return error;
+        }
+        else if (seen_point)
+        {
+            if (++frac_len > scale)
+            {
+                return error;
+            }
+            frac = frac * 10 + (unsigned)(*c - '0');
+        }
+        else
+        {
+            // Stop before whole * 10^scale could exceed 128 bits
+            unsigned digit = (unsigned)(*c - '0');
+            if (whole > (~(u128)0 / pow10_u128(scale) - digit) / 10)
+            {
+                return error;
+            }
+            whole = whole * 10 + digit;
+        }
+    }
+
+    u128 mag = whole * pow10_u128(scale);
+    u128 frac_mag = frac * pow10_u128(scale - (unsigned)frac_len);
+    if (mag + frac_mag < mag)
+    {
+        return error;
+    }
+    return make_value(mag + frac_mag, negative, scale);
+}
+
+char *fixedpoint_decimal_format_as_string(FixedpointDecimal val)
+{
+    // Sign, 39 whole digits, point, 19 fraction digits and terminator
+    char *s = calloc(64, sizeof(char));
+    if (!is_valid_tag(val.tag))
+    {
+        strcpy(s, "<invalid>");
+        return s;
+    }
+
+    size_t next_index = 0;
+    if (val.tag == VALID_NEGATIVE)
+    {
+        s[next_index++] = '-';
+    }
+
+    u128 frac;
+    u128 whole = div_pow10(magnitude(val), val.scale, &frac);
+
+    // Print the whole part in groups of 19 digits, most significant first
+    uint64_t groups[3];
+    int num_groups = 0;
+    do
+    {
+        uint64_t group;
+        whole = div_pow10_small(whole, FIXEDPOINT_DECIMAL_MAX_SCALE, &group);
+        groups[num_groups++] = group;
+    } while (whole != 0);
+    next_index += sprintf(s + next_index, "%lu", groups[num_groups - 1]);
+    for (int i = num_groups - 2; i >= 0; --i)
+    {
+        next_index += sprintf(s + next_index, "%019lu", groups[i]);
+    }
+
+    if (frac != 0)
+    {
+        next_index += sprintf(s + next_index, ".%0*lu", (int)val.scale, (uint64_t)frac);
+        // Remove trailing zeroes
+        while (s[next_index - 1] == '0')
+        {
+            s[--next_index] = '\0';
+        }
+    }
+    return s;
+}
+
+FixedpointDecimal fixedpoint_decimal_add(FixedpointDecimal left, FixedpointDecimal right)
+{
+    if (!is_valid_tag(left.tag) || !is_valid_tag(right.tag) || left.scale != right.scale)
+    {
+        FixedpointDecimal error = {0, 0, left.scale, ERROR};
+        return error;
+    }
+
+    u128 a = magnitude(left);
+    u128 b = magnitude(right);
+    int negative = left.tag == VALID_NEGATIVE;
+    if (left.tag == right.tag)
+    {
+        FixedpointDecimal sum = make_value(a + b, negative, left.scale);
+        if (a + b < a)
+        {
+            sum.tag = negative ? OVERFLOW_NEGATIVE : OVERFLOW_POSITIVE;
+        }
+        return sum;
+    }
+    if (a >= b)
+    {
+        return make_value(a - b, negative, left.scale);
+    }
+    return make_value(b - a, !negative, left.scale);
+}
+
+FixedpointDecimal fixedpoint_decimal_sub(FixedpointDecimal left, FixedpointDecimal right)
+{
+    if (is_valid_tag(right.tag))
+    {
+        right.tag = right.tag == VALID_NEGATIVE ? VALID_NONNEGATIVE : VALID_NEGATIVE;
+    }
+    return fixedpoint_decimal_add(left, right);
+}
+
+FixedpointDecimal fixedpoint_decimal_negate(FixedpointDecimal val)
+{
+    if (!is_valid_tag(val.tag))
+    {
+        return val;
+    }
+    return make_value(magnitude(val), val.tag == VALID_NONNEGATIVE, val.scale);
+}
+
+int fixedpoint_decimal_compare(FixedpointDecimal left, FixedpointDecimal right)
+{
+    if (left.tag != right.tag)
+    {
+        return left.tag == VALID_NONNEGATIVE ? 1 : -1;
+    }
+    u128 a = magnitude(left);
+    u128 b = magnitude(right);
+    int result = (a > b) - (a < b);
+    return left.tag == VALID_NONNEGATIVE ? result : -result;
+}
+
+FixedpointDecimal fixedpoint_decimal_mul_pow10(FixedpointDecimal val, unsigned n)
+{
+    if (!is_valid_tag(val.tag))
+    {
+        return val;
+    }
+    u128 mag = magnitude(val);
+    u128 p = pow10_u128(n);
+    int negative = val.tag == VALID_NEGATIVE;
+    FixedpointDecimal product = make_value(mag * p, negative, val.scale);
+    if (mag != 0 && mag > ~(u128)0 / p)
+    {
+        product.tag = negative ? OVERFLOW_NEGATIVE : OVERFLOW_POSITIVE;
+    }
+    return product;
+}
+
+FixedpointDecimal fixedpoint_decimal_div_pow10(FixedpointDecimal val, unsigned n, FixedpointRound mode)
+{
+    if (!is_valid_tag(val.tag))
+    {
+        return val;
+    }
+    u128 rem;
+    u128 quotient = div_pow10(magnitude(val), n, &rem);
+    int negative = val.tag == VALID_NEGATIVE;
+
+    int round_up = 0;
+    if (rem != 0)
+    {
+        switch (mode)
+        {
+        case FIXEDPOINT_ROUND_NEAREST_EVEN:
+        {
+            // Compare the remainder against half of 10^n
+            u128 divisor = pow10_u128(n);
+            round_up = 2 * rem > divisor || (2 * rem == divisor && (quotient & 1));
+            break;
+        }
+        case FIXEDPOINT_ROUND_CEILING:
+            round_up = !negative;
+            break;
+        case FIXEDPOINT_ROUND_FLOOR:
+            round_up = negative;
+            break;
+        default:
+            break;
+        }
+    }
+
+    FixedpointDecimal result = make_value(quotient + round_up, negative, val.scale);
+    if (mode == FIXEDPOINT_ROUND_EXACT && rem != 0)
+    {
+        result.tag = negative ? UNDERFLOW_NEGATIVE : UNDERFLOW_POSITIVE;
+    }
+    return result;
+}
+
+FixedpointDecimal fixedpoint_decimal_rescale(FixedpointDecimal val, unsigned scale, FixedpointRound mode)
+{
+    unsigned from = val.scale;
+    if (scale == from)
+    {
+        return val;
+    }
+    if (scale > from)
+    {
+        val = fixedpoint_decimal_mul_pow10(val, scale - from);
+    }
+    else
+    {
+        val = fixedpoint_decimal_div_pow10(val, from - scale, mode);
+    }
+    val.scale = scale;
+    return val;
+}
+
+FIXEDPOINT_DECIMAL_DEFINE(FixedpointDec2, fixedpoint_dec2, 2)
+FIXEDPOINT_DECIMAL_DEFINE(FixedpointDec6, fixedpoint_dec6, 6)
@@ -0,0 +1,317 @@
+#ifndef FIXEDPOINT_DECIMAL_H
+#define FIXEDPOINT_DECIMAL_H
+
+#include <stdint.h>
+#include "fixedpoint.h"
+
+// Decimal fixed point values, for quantities such as currency amounts that
+// must represent decimal fractions like 0.01 exactly.
+//
+// A decimal value with scale k is a sign-magnitude integer multiple of
+// 10^-k: its 128 bit magnitude counts units of 10^-k, and it has the same
+// tags as Fixedpoint. FixedpointDecimal is the general form, which carries
+// its scale; FIXEDPOINT_DECIMAL_DECLARE and FIXEDPOINT_DECIMAL_DEFINE
+// generate types whose scale is fixed by the type.
+
+// The largest supported scale (so that one whole unit fits in 64 bits)
+#define FIXEDPOINT_DECIMAL_MAX_SCALE 19
+
+// The largest power of ten that fixedpoint_decimal_mul_pow10 and
+// fixedpoint_decimal_div_pow10 accept (the largest below 2^128)
+#define FIXEDPOINT_DECIMAL_MAX_POW10 38
+
+// A struct that holds a decimal value with any scale
+//
+// Fields:
+//  hi - the upper 64 bits of the magnitude
+//  lo - the lower 64 bits of the magnitude
+//  scale - the number of decimal places; the magnitude is in units of 10^-scale
+//  tag - a tag that keeps track of the value. See the Tag enum for possible tags.
+typedef struct
+{
+    uint64_t hi;
+    uint64_t lo;
+    unsigned scale;
+    Tag tag;
+} FixedpointDecimal;
+
+// Create a decimal value representing an integer.
+//
+// Parameters:
+//   whole - the value
+//   scale - the scale (at most FIXEDPOINT_DECIMAL_MAX_SCALE)
+//
+// Returns:
+//   the decimal value
+FixedpointDecimal fixedpoint_decimal_create(uint64_t whole, unsigned scale);
+
+// Create a decimal value from a string of decimal digits, of the form
+// -X.Y like the strings accepted by fixedpoint_create_from_hex.
+//
+// Parameters:
+//   s - the string
+//   scale - the scale (at most FIXEDPOINT_DECIMAL_MAX_SCALE)
+//
+// Returns:
+//   the decimal value, or a value tagged ERROR if s is not a valid string,
+//   has more than scale digits after the point, or is too large
+FixedpointDecimal fixedpoint_decimal_create_from_string(const char *s, unsigned scale);
+
+// Format a decimal value as a string of decimal digits. Like
+// fixedpoint_format_as_hex, trailing zeroes after the point are removed.
+//
+// Parameters:
+//   val - the decimal value
+//
+// Returns:
+//   dynamically allocated character string containing the representation
+//   of the value, or "<invalid>" if the value is not valid
+char *fixedpoint_decimal_format_as_string(FixedpointDecimal val);
+
+// Compute the sum of two decimal values with the same scale.
+//
+// Parameters:
+//   left - the left value
+//   right - the right value
+//
+// Returns:
+//   the exact sum, if it can be represented;
+//   otherwise, a value tagged OVERFLOW_POSITIVE or OVERFLOW_NEGATIVE (with
+//   the magnitude wrapped);
+//   an error value if either value is not valid or the scales differ
+FixedpointDecimal fixedpoint_decimal_add(FixedpointDecimal left, FixedpointDecimal right);
+
+// Compute the difference of two decimal values. See fixedpoint_decimal_add.
+FixedpointDecimal fixedpoint_decimal_sub(FixedpointDecimal left, FixedpointDecimal right);
+
+// Negate a decimal value. Zero stays non-negative, and non-valid values
+// are returned unchanged.
+//
+// Parameters:
+//   val - the value
+//
+// Returns:
+//   the negated value
+FixedpointDecimal fixedpoint_decimal_negate(FixedpointDecimal val);
+
+// Compare two valid decimal values with the same scale.
+//
+// Parameters:
+//   left - the left value
+//   right - the right value
+//
+// Returns:
+//   -1 if left < right;
+//   0 if left == right;
+//   1 if left > right
+int fixedpoint_decimal_compare(FixedpointDecimal left, FixedpointDecimal right);
+
+// Multiply a decimal value by a power of ten, keeping its scale.
+//
+// Parameters:
+//   val - the value
+//   n - the exponent (at most FIXEDPOINT_DECIMAL_MAX_POW10)
+//
+// Returns:
+//   val * 10^n, if it can be represented;
+//   otherwise, a value tagged OVERFLOW_POSITIVE or OVERFLOW_NEGATIVE;
+//   val unchanged if it is not valid
+FixedpointDecimal fixedpoint_decimal_mul_pow10(FixedpointDecimal val, unsigned n);
+
+// Divide a decimal value by a power of ten, keeping its scale. The
+// division multiplies by precomputed reciprocals instead of dividing.
+//
+// Parameters:
+//   val - the value
+//   n - the exponent (at most FIXEDPOINT_DECIMAL_MAX_POW10)
+//   mode - how to round the quotient
+//
+// Returns:
+//   val / 10^n, rounded according to mode (with FIXEDPOINT_ROUND_EXACT, a
+//   value tagged UNDERFLOW_POSITIVE or UNDERFLOW_NEGATIVE if the division
+//   was inexact);
+//   val unchanged if it is not valid
+FixedpointDecimal fixedpoint_decimal_div_pow10(FixedpointDecimal val, unsigned n, FixedpointRound mode);
+
+// Convert a decimal value to another scale.
+//
+// Parameters:
+//   val - the value
+//   scale - the new scale (at most FIXEDPOINT_DECIMAL_MAX_SCALE)
+//   mode - how to round if the new scale is smaller
+//
+// Returns:
+//   the value with the new scale: exact if the new scale is larger (or an
+//   overflow value if it does not fit), otherwise rounded as by
+//   fixedpoint_decimal_div_pow10
+FixedpointDecimal fixedpoint_decimal_rescale(FixedpointDecimal val, unsigned scale, FixedpointRound mode);
+
+// Decimal types with a scale fixed by the type.
+//
+// FIXEDPOINT_DECIMAL_DECLARE(Name, prefix, SCALE) declares the struct type
+// Name and the following functions (it goes in a header), and
+// FIXEDPOINT_DECIMAL_DEFINE(Name, prefix, SCALE) defines them (it goes in
+// exactly one source file). Each function behaves like the
+// fixedpoint_decimal function of the same name, or like the Fixedpoint
+// function of the same name for the tag predicates.
+//
+//   Name prefix_create(uint64_t whole)
+//   Name prefix_create_from_string(const char *s)
+//   char *prefix_format_as_string(Name val)
+//   Name prefix_add(Name left, Name right)
+//   Name prefix_sub(Name left, Name right)
+//   Name prefix_negate(Name val)
+//   int prefix_compare(Name left, Name right)
+//   Name prefix_mul_pow10(Name val, unsigned n)
+//   Name prefix_div_pow10(Name val, unsigned n, FixedpointRound mode)
+//   int prefix_is_zero(Name val)
+//   int prefix_is_err(Name val)
+//   int prefix_is_neg(Name val)
+//   int prefix_is_overflow_neg(Name val)
+//   int prefix_is_overflow_pos(Name val)
+//   int prefix_is_underflow_neg(Name val)
+//   int prefix_is_underflow_pos(Name val)
+//   int prefix_is_valid(Name val)
+//   FixedpointDecimal prefix_to_decimal(Name val)
+//     exact
+//   Name prefix_from_decimal(FixedpointDecimal val, FixedpointRound mode)
+//     converts from any scale, as by fixedpoint_decimal_rescale
+
+#define FIXEDPOINT_DECIMAL_DECLARE(Name, prefix, SCALE)                                               \
+    _Static_assert((SCALE) >= 0 && (SCALE) <= FIXEDPOINT_DECIMAL_MAX_SCALE, "invalid decimal scale"); \
+    typedef struct                                                                                    \
+    {                                                                                                 \
+        uint64_t hi;                                                                                  \
+        uint64_t lo;                                                                                  \
+        Tag tag;                                                                                      \
+    } Name;                                                                                           \
+    Name prefix##_create(uint64_t whole);                                                             \
+    Name prefix##_create_from_string(const char *s);                                                  \
+    char *prefix##_format_as_string(Name val);                                                        \
+    Name prefix##_add(Name left, Name right);                                                         \
+    Name prefix##_sub(Name left, Name right);                                                         \
+    Name prefix##_negate(Name val);                                                                   \
+    int prefix##_compare(Name left, Name right);                                                      \
+    Name prefix##_mul_pow10(Name val, unsigned n);                                                    \
+    Name prefix##_div_pow10(Name val, unsigned n, FixedpointRound mode);                              \
+    int prefix##_is_zero(Name val);                                                                   \
+    int prefix##_is_err(Name val);                                                                    \
+    int prefix##_is_neg(Name val);                                                                    \
+    int prefix##_is_overflow_neg(Name val);                                                           \
+    int prefix##_is_overflow_pos(Name val);                                                           \
+    int prefix##_is_underflow_neg(Name val);                                                          \
+    int prefix##_is_underflow_pos(Name val);                                                          \
+    int prefix##_is_valid(Name val);                                                                  \
+    FixedpointDecimal prefix##_to_decimal(Name val);                                                  \
+    Name prefix##_from_decimal(FixedpointDecimal val, FixedpointRound mode)
+
+#define FIXEDPOINT_DECIMAL_DEFINE(Name, prefix, SCALE)                                                             \
+    FixedpointDecimal prefix##_to_decimal(Name val)                                                                \
+    {                                                                                                              \
+        FixedpointDecimal general = {val.hi, val.lo, SCALE, val.tag};                                              \
+        return general;                                                                                            \
+    }                                                                                                              \
+                                                                                                                   \
+    Name prefix##_from_decimal(FixedpointDecimal val, FixedpointRound mode)                                        \
+    {                                                                                                              \
+        val = fixedpoint_decimal_rescale(val, SCALE, mode);                                                        \
+        Name result = {val.hi, val.lo, val.tag};                                                                   \
+        return result;                                                                                             \
+    }                                                                                                              \
+                                                                                                                   \
+    Name prefix##_create(uint64_t whole)                                                                           \
+    {                                                                                                              \
+        return prefix##_from_decimal(fixedpoint_decimal_create(whole, SCALE), FIXEDPOINT_ROUND_EXACT);             \
+    }                                                                                                              \
+                                                                                                                   \
+    Name prefix##_create_from_string(const char *s)                                                                \
+    {                                                                                                              \
+        FixedpointDecimal val = fixedpoint_decimal_create_from_string(s, SCALE);                                   \
+        return prefix##_from_decimal(val, FIXEDPOINT_ROUND_EXACT);                                                 \
+    }                                                                                                              \
+                                                                                                                   \
+    char *prefix##_format_as_string(Name val)                                                                      \
+    {                                                                                                              \
+        return fixedpoint_decimal_format_as_string(prefix##_to_decimal(val));                                      \
+    }                                                                                                              \
+                                                                                                                   \
+    Name prefix##_add(Name left, Name right)                                                                       \
+    {                                                                                                              \
+        FixedpointDecimal sum = fixedpoint_decimal_add(prefix##_to_decimal(left), prefix##_to_decimal(right));     \
+        return prefix##_from_decimal(sum, FIXEDPOINT_ROUND_EXACT);                                                 \
+    }                                                                                                              \
+                                                                                                                   \
+    Name prefix##_sub(Name left, Name right)                                                                       \
+    {                                                                                                              \
+        FixedpointDecimal difference =                                                                             \
+            fixedpoint_decimal_sub(prefix##_to_decimal(left), prefix##_to_decimal(right));                         \
+        return prefix##_from_decimal(difference, FIXEDPOINT_ROUND_EXACT);                                          \
+    }                                                                                                              \
+                                                                                                                   \
+    Name prefix##_negate(Name val)                                                                                 \
+    {                                                                                                              \
+        return prefix##_from_decimal(fixedpoint_decimal_negate(prefix##_to_decimal(val)), FIXEDPOINT_ROUND_EXACT); \
+    }                                                                                                              \
+                                                                                                                   \
+    int prefix##_compare(Name left, Name right)                                                                    \
+    {                                                                                                              \
+        return fixedpoint_decimal_compare(prefix##_to_decimal(left), prefix##_to_decimal(right));                  \
+    }                                                                                                              \
+                                                                                                                   \
+    Name prefix##_mul_pow10(Name val, unsigned n)                                                                  \
+    {                                                                                                              \
+        FixedpointDecimal product = fixedpoint_decimal_mul_pow10(prefix##_to_decimal(val), n);                     \
+        return prefix##_from_decimal(product, FIXEDPOINT_ROUND_EXACT);                                             \
+    }                                                                                                              \
+                                                                                                                   \
+    Name prefix##_div_pow10(Name val, unsigned n, FixedpointRound mode)                                            \
+    {                                                                                                              \
+        FixedpointDecimal quotient = fixedpoint_decimal_div_pow10(prefix##_to_decimal(val), n, mode);              \
+        return prefix##_from_decimal(quotient, FIXEDPOINT_ROUND_EXACT);                                            \
+    }                                                                                                              \
+                                                                                                                   \
+    int prefix##_is_zero(Name val)                                                                                 \
+    {                                                                                                              \
+        return prefix##_is_valid(val) && val.hi == 0 && val.lo == 0;                                               \
+    }                                                                                                              \
+                                                                                                                   \
+    int prefix##_is_err(Name val)                                                                                  \
+    {                                                                                                              \
+        return !prefix##_is_valid(val);                                                                            \
+    }                                                                                                              \
+                                                                                                                   \
+    int prefix##_is_neg(Name val)                                                                                  \
+    {                                                                                                              \
+        return val.tag == VALID_NEGATIVE;                                                                          \
+    }                                                                                                              \
+                                                                                                                   \
+    int prefix##_is_overflow_neg(Name val)                                                                         \
+    {                                                                                                              \
+        return val.tag == OVERFLOW_NEGATIVE;                                                                       \
+    }                                                                                                              \
+                                                                                                                   \
+    int prefix##_is_overflow_pos(Name val)                                                                         \
+    {                                                                                                              \
+        return val.tag == OVERFLOW_POSITIVE;                                                                       \
+    }                                                                                                              \
+                                                                                                                   \
+    int prefix##_is_underflow_neg(Name val)                                                                        \
+    {                                                                                                              \
+        return val.tag == UNDERFLOW_NEGATIVE;                                                                      \
+    }                                                                                                              \
+                                                                                                                   \
+    int prefix##_is_underflow_pos(Name val)                                                                        \
+    {                                                                                                              \
+        return val.tag == UNDERFLOW_POSITIVE;                                                                      \
+    }                                                                                                              \
+                                                                                                                   \
+    int prefix##_is_valid(Name val)                                                                                \
+    {                                                                                                              \
+        return val.tag == VALID_NEGATIVE || val.tag == VALID_NONNEGATIVE;                                          \
+    }
+
+// Predefined types: cents (scale 2) and micro-units (scale 6)
+FIXEDPOINT_DECIMAL_DECLARE(FixedpointDec2, fixedpoint_dec2, 2);
+FIXEDPOINT_DECIMAL_DECLARE(FixedpointDec6, fixedpoint_dec6, 6);
+
+#endif // FIXEDPOINT_DECIMAL_H
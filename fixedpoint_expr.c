@@ -0,0 +1,723 @@
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "fixedpoint_expr.h"
+#include "fixedpoint_column.h"
+
+// The longest number in a formula
+#define MAX_NUMBER_LEN 40
+
+// The operators of the bytecode
+typedef enum
+{
+    OP_ADD,
+    OP_SUB,
+    OP_MUL,
+    OP_NEG,
+    OP_HALVE,
+    OP_DOUBLE,
+    OP_LT,
+    OP_LE,
+    OP_GT,
+    OP_GE,
+    OP_EQ,
+    OP_NE,
+    OP_SELECT
+} ExprOp;
+
+// The kinds of values an operator can read while a formula is compiled
+typedef enum
+{
+    OPERAND_COLUMN,
+    OPERAND_CONSTANT,
+    OPERAND_REGISTER
+} OperandKind;
+
+// A value an operator reads while a formula is compiled
+//
+// Fields:
+//  kind - the kind of value
+//  index - the column, constant, or instruction that computes it
+typedef struct
+{
+    OperandKind kind;
+    unsigned index;
+} Operand;
+
+// An instruction before registers are assigned; it computes a value of its
+// own, which later instructions refer to by its index
+//
+// Fields:
+//  op - the operator
+//  num_args - the number of operands
+//  args - the operands
+typedef struct
+{
+    ExprOp op;
+    unsigned num_args;
+    Operand args[3];
+} Node;
+
+// The state of a compilation
+//
+// Fields:
+//  source - the formula
+//  pos - the next character to read
+//  names - the column names
+//  num_names - the number of column names
+//  nodes - the instructions so far
+//  num_nodes - the number of instructions
+//  node_alloc - the number of instructions allocated
+//  constants - the constants so far
+//  num_constants - the number of constants
+//  constant_alloc - the number of constants allocated
+//  error - the position of the first error, if any
+//  out_of_memory - whether memory could not be allocated
+typedef struct
+{
+    const char *source;
+    const char *pos;
+    const char *const *names;
+    unsigned num_names;
+    Node *nodes;
+    size_t num_nodes;
+    size_t node_alloc;
+    Fixedpoint *constants;
+    unsigned num_constants;
+    unsigned constant_alloc;
+    const char *error;
+    int out_of_memory;
+} Compiler;
+
+// A function of a formula
+//
+// Fields:
+//  name - the name
+//  op - the operator
+//  num_args - the number of arguments
+typedef struct
+{
+    const char *name;
+    ExprOp op;
+    unsigned num_args;
+} Function;
+
+static const Function functions[] = {
+    {"neg", OP_NEG, 1},
+    {"halve", OP_HALVE, 1},
+    {"double", OP_DOUBLE, 1},
+    {"select", OP_SELECT, 3},
+};
+
+// Get the tag to give the result of an operator with operand val: the tag of
+// val if it is not valid, VALID_NONNEGATIVE if it is
+static inline Tag invalid_tag(Fixedpoint val)
+{
+    return val.tag == VALID_NONNEGATIVE || val.tag == VALID_NEGATIVE ? VALID_NONNEGATIVE : val.tag;
+}
+
+static inline Tag invalid_tag2(Fixedpoint left, Fixedpoint right)
+{
+    Tag tag = invalid_tag(left);
+    return tag != VALID_NONNEGATIVE ? tag : invalid_tag(right);
+}
+
+static inline Fixedpoint tagged(Tag tag)
+{
+    Fixedpoint val = {0, 0, tag};
+    return val;
+}
+
+static inline int compare_holds(ExprOp op, int cmp)
+{
+    switch (op)
+    {
+    case OP_LT:
+        return cmp < 0;
+    case OP_LE:
+        return cmp <= 0;
+    case OP_GT:
+        return cmp > 0;
+    case OP_GE:
+        return cmp >= 0;
+    case OP_EQ:
+        return cmp == 0;
+    default:
+        return cmp != 0;
+    }
+}
+
+// Apply an operator to n rows, n at most FIXEDPOINT_EXPR_BLOCK. Each row is
+// read before it is written, so dst may be one of the operands.
+static void apply(ExprOp op, Fixedpoint *dst, const Fixedpoint *a, const Fixedpoint *b, const Fixedpoint *c, size_t n)
+{
+    switch (op)
+    {
+    case OP_ADD:
+    case OP_SUB:
+    {
+        // The batch functions pack blocks of small values into single words,
+        // so the rows with an operand that is not valid are fixed afterwards
+        Tag tags[FIXEDPOINT_EXPR_BLOCK];
+        int any = 0;
+        for (size_t i = 0; i < n; ++i)
+        {
+            tags[i] = invalid_tag2(a[i], b[i]);
+            any |= tags[i] != VALID_NONNEGATIVE;
+        }
+        if (op == OP_ADD)
+        {
+            fixedpoint_add_batch(a, b, dst, n);
+        }
+        else
+        {
+            fixedpoint_sub_batch(a, b, dst, n);
+        }
+        for (size_t i = 0; any && i < n; ++i)
+        {
+            if (tags[i] != VALID_NONNEGATIVE)
+            {
+                dst[i] = tagged(tags[i]);
+            }
+        }
+        break;
+    }
+    case OP_MUL:
+        for (size_t i = 0; i < n; ++i)
+        {
+            Tag tag = invalid_tag2(a[i], b[i]);
+            dst[i] = tag != VALID_NONNEGATIVE ? tagged(tag) : fixedpoint_mul(a[i], b[i]);
+        }
+        break;
+    case OP_NEG:
+    case OP_HALVE:
+    case OP_DOUBLE:
+    {
+        Fixedpoint (*fn)(Fixedpoint) = op == OP_NEG     ? fixedpoint_negate
+                                       : op == OP_HALVE ? fixedpoint_halve
+                                                        : fixedpoint_double;
+        for (size_t i = 0; i < n; ++i)
+        {
+            Tag tag = invalid_tag(a[i]);
+            dst[i] = tag != VALID_NONNEGATIVE ? tagged(tag) : fn(a[i]);
+        }
+        break;
+    }
+    case OP_SELECT:
+        for (size_t i = 0; i < n; ++i)
+        {
+            Fixedpoint chosen = fixedpoint_is_zero(a[i]) ? c[i] : b[i];
+            Tag tag = invalid_tag2(a[i], chosen);
+            dst[i] = tag != VALID_NONNEGATIVE ? tagged(tag) : chosen;
+        }
+        break;
+    default:
+        for (size_t i = 0; i < n; ++i)
+        {
+            Tag tag = invalid_tag2(a[i], b[i]);
+            dst[i] = tag != VALID_NONNEGATIVE ? tagged(tag)
+                                              : fixedpoint_create(compare_holds(op, fixedpoint_compare(a[i], b[i])));
+        }
+        break;
+    }
+}
+
+// Record an error at the current position, unless there was one before
+static int fail(Compiler *c)
+{
+    if (c->error == NULL)
+    {
+        c->error = c->pos;
+    }
+    return 0;
+}
+
+static void skip_space(Compiler *c)
+{
+    while (isspace((unsigned char)*c->pos))
+    {
+        ++c->pos;
+    }
+}
+
+// Skip spaces, then the given token if it comes next. Returns whether it did.
+static int accept(Compiler *c, const char *token)
+{
+    skip_space(c);
+    size_t len = strlen(token);
+    if (strncmp(c->pos, token, len) != 0)
+    {
+        return 0;
+    }
+    c->pos += len;
+    return 1;
+}
+
+static int add_constant(Compiler *c, Fixedpoint val, Operand *out)
+{
+    if (c->num_constants == c->constant_alloc)
+    {
+        unsigned alloc = c->constant_alloc == 0 ? 8 : 2 * c->constant_alloc;
+        Fixedpoint *constants = realloc(c->constants, alloc * sizeof(Fixedpoint));
+        if (constants == NULL)
+        {
+            c->out_of_memory = 1;
+            return fail(c);
+        }
+        c->constants = constants;
+        c->constant_alloc = alloc;
+    }
+    c->constants[c->num_constants] = val;
+    out->kind = OPERAND_CONSTANT;
+    out->index = c->num_constants++;
+    return 1;
+}
+
+// Add an instruction, or compute its value now if its operands are all
+// constants
+static int emit(Compiler *c, ExprOp op, const Operand *args, unsigned num_args, Operand *out)
+{
+    int constant = 1;
+    for (unsigned i = 0; i < num_args; ++i)
+    {
+        constant &= args[i].kind == OPERAND_CONSTANT;
+    }
+    if (constant)
+    {
+        Fixedpoint vals[3];
+        for (unsigned i = 0; i < 3; ++i)
+        {
+            vals[i] = c->constants[args[i < num_args ? i : 0].index];
+        }
+        Fixedpoint result;
+        apply(op, &result, &vals[0], &vals[1], &vals[2], 1);
+        // The operands, and the constants they were computed from, are the
+        // last constants, and nothing else reads them
+        for (unsigned i = 0; i < num_args; ++i)
+        {
+            c->num_constants = args[i].index < c->num_constants ? args[i].index : c->num_constants;
+        }
+        return add_constant(c, result, out);
+    }
+
+    if (c->num_nodes == c->node_alloc)
+    {
+        size_t alloc = c->node_alloc == 0 ? 16 : 2 * c->node_alloc;
+        Node *nodes = realloc(c->nodes, alloc * sizeof(Node));
+        if (nodes == NULL)
+        {
+            c->out_of_memory = 1;
+            return fail(c);
+        }
+        c->nodes = nodes;
+        c->node_alloc = alloc;
+    }
+    Node *node = &c->nodes[c->num_nodes];
+    node->op = op;
+    node->num_args = num_args;
+    for (unsigned i = 0; i < 3; ++i)
+    {
+        node->args[i] = args[i < num_args ? i : 0];
+    }
+    out->kind = OPERAND_REGISTER;
+    out->index = (unsigned)c->num_nodes++;
+    return 1;
+}
+
+static int parse_comparison(Compiler *c, Operand *out);
+
+static int parse_number(Compiler *c, Operand *out)
+{
+    const char *start = c->pos;
+    while (isxdigit((unsigned char)*c->pos) || *c->pos == '.')
+    {
+        ++c->pos;
+    }
+    size_t len = (size_t)(c->pos - start);
+    char text[MAX_NUMBER_LEN + 1];
+    Fixedpoint val = {0, 0, ERROR};
+    if (len <= MAX_NUMBER_LEN)
+    {
+        memcpy(text, start, len);
+        text[len] = '\0';
+        val = fixedpoint_create_from_hex(text);
+    }
+    if (fixedpoint_is_err(val))
+    {
+        c->pos = start;
+        return fail(c);
+    }
+    return add_constant(c, val, out);
+}
+
+// Parse a function call or a column name
+static int parse_name(Compiler *c, Operand *out)
+{
+    const char *start = c->pos;
+    while (isalnum((unsigned char)*c->pos) || *c->pos == '_')
+    {
+        ++c->pos;
+    }
+    size_t len = (size_t)(c->pos - start);
+
+    if (!accept(c, "("))
+    {
+        for (unsigned i = 0; i < c->num_names; ++i)
+        {
+            if (strncmp(c->names[i], start, len) == 0 && c->names[i][len] == '\0')
+            {
+                out->kind = OPERAND_COLUMN;
+                out->index = i;
+                return 1;
+            }
+        }
+        c->pos = start;
+        return fail(c);
+    }
+
+    const Function *fn = NULL;
+    for (size_t i = 0; i < sizeof(functions) / sizeof(functions[0]); ++i)
+    {
+        if (strncmp(functions[i].name, start, len) == 0 && functions[i].name[len] == '\0')
+        {
+            fn = &functions[i];
+        }
+    }
+    if (fn == NULL)
+    {
+        c->pos = start;
+        return fail(c);
+    }
+    Operand args[3];
+    for (unsigned i = 0; i < fn->num_args; ++i)
+    {
+        if ((i > 0 && !accept(c, ",")) || !parse_comparison(c, &args[i]))
+        {
+            return fail(c);
+        }
+    }
+    if (!accept(c, ")"))
+    {
+        return fail(c);
+    }
+    return emit(c, fn->op, args, fn->num_args, out);
+}
+
+static int parse_primary(Compiler *c, Operand *out)
+{
+    skip_space(c);
+    if (accept(c, "("))
+    {
+        return parse_comparison(c, out) && (accept(c, ")") || fail(c));
+    }
+    if (isdigit((unsigned char)*c->pos))
+    {
+        return parse_number(c, out);
+    }
+    if (isalpha((unsigned char)*c->pos) || *c->pos == '_')
+    {
+        return parse_name(c, out);
+    }
+    return fail(c);
+}
+
+static int parse_unary(Compiler *c, Operand *out)
+{
+    if (accept(c, "-"))
+    {
+        Operand arg;
+        return parse_unary(c, &arg) && emit(c, OP_NEG, &arg, 1, out);
+    }
+    return parse_primary(c, out);
+}
+
+static int parse_product(Compiler *c, Operand *out)
+{
+    if (!parse_unary(c, out))
+    {
+        return 0;
+    }
+    while (accept(c, "*"))
+    {
+        Operand args[2] = {*out};
+        if (!parse_unary(c, &args[1]) || !emit(c, OP_MUL, args, 2, out))
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int parse_sum(Compiler *c, Operand *out)
+{
+    if (!parse_product(c, out))
+    {
+        return 0;
+    }
+    for (;;)
+    {
+        ExprOp op;
+        if (accept(c, "+"))
+        {
+            op = OP_ADD;
+        }
+        else if (accept(c, "-"))
+        {
+            op = OP_SUB;
+        }
+        else
+        {
+            return 1;
+        }
+        Operand args[2] = {*out};
+        if (!parse_product(c, &args[1]) || !emit(c, op, args, 2, out))
+        {
+            return 0;
+        }
+    }
+}
+
+static int parse_comparison(Compiler *c, Operand *out)
+{
+    if (!parse_sum(c, out))
+    {
+        return 0;
+    }
+    // Two character operators are tried first, so that "<=" is not read
+    // as "<"
+    static const struct
+    {
+        const char *token;
+        ExprOp op;
+    } comparisons[] = {{"<=", OP_LE}, {">=", OP_GE}, {"==", OP_EQ}, {"!=", OP_NE}, {"<", OP_LT}, {">", OP_GT}};
+    for (size_t i = 0; i < sizeof(comparisons) / sizeof(comparisons[0]); ++i)
+    {
+        if (accept(c, comparisons[i].token))
+        {
+            Operand args[2] = {*out};
+            return parse_sum(c, &args[1]) && emit(c, comparisons[i].op, args, 2, out);
+        }
+    }
+    return 1;
+}
+
+// Get the slot of an operand, given the register assigned to each
+// instruction
+static unsigned operand_slot(const FixedpointExpr *expr, const unsigned *regs, Operand operand)
+{
+    switch (operand.kind)
+    {
+    case OPERAND_COLUMN:
+        return operand.index;
+    case OPERAND_CONSTANT:
+        return expr->num_columns + operand.index;
+    default:
+        return expr->num_columns + expr->num_constants + regs[operand.index];
+    }
+}
+
+// Assign registers to the instructions, reusing the register of a value
+// after the last instruction that reads it, and write the bytecode
+static int assign_registers(FixedpointExpr *expr, const Compiler *c, Operand result)
+{
+    size_t n = c->num_nodes;
+    size_t *last_use = malloc((n == 0 ? 1 : n) * sizeof(size_t));
+    unsigned *regs = malloc((n == 0 ? 1 : n) * sizeof(unsigned));
+    unsigned *free_regs = malloc((n == 0 ? 1 : n) * sizeof(unsigned));
+    expr->code = malloc((n == 0 ? 1 : n) * sizeof(FixedpointExprInstr));
+    int ok = last_use != NULL && regs != NULL && free_regs != NULL && expr->code != NULL;
+    if (ok)
+    {
+        for (size_t i = 0; i < n; ++i)
+        {
+            last_use[i] = i;
+            for (unsigned j = 0; j < c->nodes[i].num_args; ++j)
+            {
+                if (c->nodes[i].args[j].kind == OPERAND_REGISTER)
+                {
+                    last_use[c->nodes[i].args[j].index] = i;
+                }
+            }
+        }
+
+        unsigned num_free = 0;
+        expr->num_registers = 0;
+        for (size_t i = 0; i < n; ++i)
+        {
+            const Node *node = &c->nodes[i];
+            for (unsigned j = 0; j < node->num_args; ++j)
+            {
+                // An operand read twice is freed once
+                Operand arg = node->args[j];
+                int repeat = j > 0 && arg.kind == node->args[j - 1].kind && arg.index == node->args[j - 1].index;
+                repeat |= j > 1 && arg.kind == node->args[0].kind && arg.index == node->args[0].index;
+                if (arg.kind == OPERAND_REGISTER && last_use[arg.index] == i && !repeat)
+                {
+                    free_regs[num_free++] = regs[arg.index];
+                }
+            }
+            // The last instruction writes the output rather than a register
+            if (i + 1 < n)
+            {
+                regs[i] = num_free > 0 ? free_regs[--num_free] : expr->num_registers++;
+            }
+        }
+
+        expr->code_len = n;
+        for (size_t i = 0; i < n; ++i)
+        {
+            const Node *node = &c->nodes[i];
+            FixedpointExprInstr *instr = &expr->code[i];
+            instr->op = node->op;
+            instr->dst = i + 1 < n ? expr->num_columns + expr->num_constants + regs[i] : 0;
+            instr->a = operand_slot(expr, regs, node->args[0]);
+            instr->b = operand_slot(expr, regs, node->args[1]);
+            instr->c = operand_slot(expr, regs, node->args[2]);
+        }
+        if (n > 0)
+        {
+            expr->result = expr->num_columns + expr->num_constants + expr->num_registers;
+            expr->code[n - 1].dst = expr->result;
+        }
+        else
+        {
+            // With no instructions the result is a column or a constant, so
+            // no register is read
+            expr->result = operand_slot(expr, regs, result);
+        }
+    }
+    free(last_use);
+    free(regs);
+    free(free_regs);
+    return ok;
+}
+
+int fixedpoint_expr_compile(FixedpointExpr *expr, const char *source, const char *const *names, unsigned num_names,
+                            size_t *error_pos)
+{
+    Compiler c = {source, source, names, num_names, NULL, 0, 0, NULL, 0, 0, NULL, 0};
+    Operand result;
+    int ok = parse_comparison(&c, &result);
+    skip_space(&c);
+    if (ok && *c.pos != '\0')
+    {
+        ok = fail(&c);
+    }
+
+    expr->code = NULL;
+    expr->constants = c.constants;
+    expr->num_constants = c.num_constants;
+    expr->num_columns = num_names;
+    ok = ok && assign_registers(expr, &c, result);
+    free(c.nodes);
+    if (!ok)
+    {
+        if (error_pos != NULL && c.error != NULL && !c.out_of_memory)
+        {
+            *error_pos = (size_t)(c.error - source);
+        }
+        fixedpoint_expr_destroy(expr);
+    }
+    return ok;
+}
+
+void fixedpoint_expr_destroy(FixedpointExpr *expr)
+{
+    free(expr->code);
+    free(expr->constants);
+    expr->code = NULL;
+    expr->constants = NULL;
+    expr->code_len = 0;
+}
+
+void fixedpoint_expr_scratch_init(FixedpointExprScratch *scratch)
+{
+    scratch->values = NULL;
+    scratch->slots = NULL;
+    scratch->num_blocks = 0;
+    scratch->num_slots = 0;
+}
+
+void fixedpoint_expr_scratch_destroy(FixedpointExprScratch *scratch)
+{
+    free(scratch->values);
+    free(scratch->slots);
+    fixedpoint_expr_scratch_init(scratch);
+}
+
+// Make scratch memory large enough for a formula
+static int scratch_reserve(FixedpointExprScratch *scratch, size_t num_blocks, size_t num_slots)
+{
+    if (num_blocks > scratch->num_blocks)
+    {
+        Fixedpoint *values = malloc(num_blocks * FIXEDPOINT_EXPR_BLOCK * sizeof(Fixedpoint));
+        if (values == NULL)
+        {
+            return 0;
+        }
+        free(scratch->values);
+        scratch->values = values;
+        scratch->num_blocks = num_blocks;
+    }
+    if (num_slots > scratch->num_slots)
+    {
+        Fixedpoint **slots = malloc(num_slots * sizeof(Fixedpoint *));
+        if (slots == NULL)
+        {
+            return 0;
+        }
+        free(scratch->slots);
+        scratch->slots = slots;
+        scratch->num_slots = num_slots;
+    }
+    return 1;
+}
+
+int fixedpoint_expr_eval(const FixedpointExpr *expr, const Fixedpoint *const *columns, size_t rows, Fixedpoint *out,
+                         FixedpointExprScratch *scratch)
+{
+    size_t num_blocks = (size_t)expr->num_constants + expr->num_registers;
+    size_t num_slots = expr->num_columns + num_blocks + 1;
+    if (!scratch_reserve(scratch, num_blocks, num_slots))
+    {
+        return 0;
+    }
+
+    // The constants and registers stay in the same blocks of scratch memory;
+    // each constant's block holds copies of it, so that the operators only
+    // handle arrays
+    Fixedpoint **slots = scratch->slots;
+    for (size_t i = 0; i < num_blocks; ++i)
+    {
+        slots[expr->num_columns + i] = scratch->values + i * FIXEDPOINT_EXPR_BLOCK;
+    }
+    for (unsigned k = 0; k < expr->num_constants; ++k)
+    {
+        for (size_t i = 0; i < FIXEDPOINT_EXPR_BLOCK; ++i)
+        {
+            slots[expr->num_columns + k][i] = expr->constants[k];
+        }
+    }
+
+    size_t out_slot = num_slots - 1;
+    for (size_t start = 0; start < rows; start += FIXEDPOINT_EXPR_BLOCK)
+    {
+        size_t n = rows - start < FIXEDPOINT_EXPR_BLOCK ? rows - start : FIXEDPOINT_EXPR_BLOCK;
+        for (unsigned i = 0; i < expr->num_columns; ++i)
+        {
+            // Columns are only read
+            slots[i] = (Fixedpoint *)(columns[i] + start);
+        }
+        slots[out_slot] = out + start;
+        for (size_t i = 0; i < expr->code_len; ++i)
+        {
+            const FixedpointExprInstr *instr = &expr->code[i];
+            apply((ExprOp)instr->op, slots[instr->dst], slots[instr->a], slots[instr->b], slots[instr->c], n);
+        }
+        if (expr->result != out_slot)
+        {
+            memmove(out + start, slots[expr->result], n * sizeof(Fixedpoint));
+        }
+    }
+    return 1;
+}
@@ -0,0 +1,149 @@
+#ifndef FIXEDPOINT_EXPR_H
+#define FIXEDPOINT_EXPR_H
+
+#include <stddef.h>
+#include "fixedpoint.h"
+
+// Formulas over named columns of Fixedpoint values, compiled to a register
+// bytecode and evaluated over blocks of rows.
+//
+// A formula is made of:
+//    numbers, written in hex as fixedpoint_create_from_hex reads them, but
+//    starting with a digit (so 0ff.8 rather than ff.8)
+//    column names (a letter or _ followed by letters, digits and _)
+//    a + b, a - b, a * b, -a
+//    a < b, a <= b, a > b, a >= b, a == b, a != b (1 if true, 0 if not;
+//    comparisons do not chain, so a < b < c needs parentheses)
+//    neg(a), halve(a), double(a)
+//    select(c, a, b) (a if c is not 0, b if it is)
+//    parentheses
+// There is no division, since the library has no Fixedpoint division.
+//
+// Each operator gives the result of the scalar function it stands for
+// (fixedpoint_add, fixedpoint_sub, fixedpoint_mul, fixedpoint_negate,
+// fixedpoint_halve, fixedpoint_double or fixedpoint_compare), so a row whose
+// result overflows or underflows gets the Tag that function returns; + and
+// -, like fixedpoint_add_batch, treat a negative zero operand as zero. An
+// operator whose operand is not valid (including an operand that overflowed
+// or underflowed earlier in the formula) gives a value with that operand's
+// tag instead, with the leftmost such operand's tag if there are several;
+// select only passes on the tags of the condition and the chosen value.
+//
+// Each instruction of the bytecode applies one operator to a block of rows
+// at a time, reading and writing registers that each hold a block of
+// values, so the cost of decoding an instruction is shared by the whole
+// block. Operators on numbers only are computed when the formula is
+// compiled, and registers are reused once the values they hold are no
+// longer needed, so a formula needs few of them.
+
+// The number of rows evaluated at a time
+#define FIXEDPOINT_EXPR_BLOCK 256
+
+// An instruction of a compiled formula. Its operands and result are slots:
+// slots 0 to num_columns - 1 are the columns, then come the constants, then
+// the registers, and the last slot is the result.
+//
+// Fields:
+//  op - the operator
+//  dst - the slot of the result
+//  a - the slot of the first operand
+//  b - the slot of the second operand, if any
+//  c - the slot of the third operand, if any
+typedef struct
+{
+    unsigned op;
+    unsigned dst;
+    unsigned a;
+    unsigned b;
+    unsigned c;
+} FixedpointExprInstr;
+
+// A compiled formula
+//
+// Fields:
+//  code - the instructions
+//  code_len - the number of instructions
+//  constants - the values of the constant slots
+//  num_constants - the number of constants
+//  num_columns - the number of columns the formula may refer to
+//  num_registers - the number of registers
+//  result - the slot that holds the result after the last instruction
+typedef struct
+{
+    FixedpointExprInstr *code;
+    size_t code_len;
+    Fixedpoint *constants;
+    unsigned num_constants;
+    unsigned num_columns;
+    unsigned num_registers;
+    unsigned result;
+} FixedpointExpr;
+
+// Memory used to evaluate formulas, which can be reused across
+// evaluations of any formulas to avoid allocating for each one.
+//
+// Fields:
+//  values - the blocks of values of the constants and registers
+//  slots - the address of each slot's values for the current block
+//  num_blocks - the number of blocks of values allocated
+//  num_slots - the number of slot addresses allocated
+typedef struct
+{
+    Fixedpoint *values;
+    Fixedpoint **slots;
+    size_t num_blocks;
+    size_t num_slots;
+} FixedpointExprScratch;
+
+// Compile a formula.
+//
+// Parameters:
+//   expr - pointer to the compiled formula
+//   source - the formula
+//   names - the names of the columns; column i of an evaluation is the
+//           one named names[i]
+//   num_names - the number of columns
+//   error_pos - if not NULL, receives the offset in source of the first
+//               error (if compiling fails because of one)
+//
+// Returns:
+//   1 if successful;
+//   0 if the formula is not valid or memory could not be allocated
+int fixedpoint_expr_compile(FixedpointExpr *expr, const char *source, const char *const *names, unsigned num_names,
+                            size_t *error_pos);
+
+// Free the memory owned by a compiled formula.
+//
+// Parameters:
+//   expr - pointer to the compiled formula
+void fixedpoint_expr_destroy(FixedpointExpr *expr);
+
+// Initialize empty scratch memory.
+//
+// Parameters:
+//   scratch - pointer to the scratch memory
+void fixedpoint_expr_scratch_init(FixedpointExprScratch *scratch);
+
+// Free scratch memory.
+//
+// Parameters:
+//   scratch - pointer to the scratch memory
+void fixedpoint_expr_scratch_destroy(FixedpointExprScratch *scratch);
+
+// Evaluate a compiled formula for each row of a set of columns.
+//
+// Parameters:
+//   expr - pointer to the compiled formula
+//   columns - the columns, in the order of the names the formula was
+//             compiled with
+//   rows - the number of rows
+//   out - receives the result of each row (may be one of the columns)
+//   scratch - pointer to scratch memory, grown if the formula needs more
+//
+// Returns:
+//   1 if successful;
+//   0 if the scratch memory could not be grown
+int fixedpoint_expr_eval(const FixedpointExpr *expr, const Fixedpoint *const *columns, size_t rows, Fixedpoint *out,
+                         FixedpointExprScratch *scratch);
+
+#endif // FIXEDPOINT_EXPR_H
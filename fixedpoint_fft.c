@@ -0,0 +1,578 @@
+#include <stdlib.h>
+#include "fixedpoint_fft.h"
+#include "fixedpoint_wide.h"
+#include "fixedpoint_accum.h"
+
+// pi / 4 in units of 2^-128, rounded
+#define PI_OVER_4_HI 0xc90fdaa22168c234UL
+#define PI_OVER_4_LO 0xc4c6628b80dc1cd1UL
+
+// The number of bits the values may have before a radix-2 stage, which at
+// most doubles them, or a radix-4 stage, which multiplies them by at most
+// 1 + 3 sqrt(2) < 5.25; either way the results stay below 2^127
+#define RADIX2_LIMIT_BITS 125
+#define RADIX4_LIMIT_BITS 124
+
+// A twiddle factor, with components in units of 2^-126
+struct FixedpointFftTwiddle
+{
+    i128 re;
+    i128 im;
+};
+
+// A complex value during a transform, in units of 2^-64
+typedef struct
+{
+    i128 re;
+    i128 im;
+} Value;
+
+// The number of halvings that bring values whose magnitudes OR to bits
+// below 2^limit_bits
+static unsigned stage_shift(u128 bits, unsigned limit_bits)
+{
+    unsigned length = bit_length(bits);
+    return length > limit_bits ? length - limit_bits : 0;
+}
+
+// Convert a valid Fixedpoint value, times 2^-exponent: halved exponent times
+// as by fixedpoint_halve if exponent is positive, or shifted left (exactly)
+// if it is negative
+static i128 to_wide(Fixedpoint val, int exponent)
+{
+    u128 mag = exponent >= 0 ? magnitude(val) >> exponent : magnitude(val) << -exponent;
+    return val.tag == VALID_NEGATIVE ? -(i128)mag : (i128)mag;
+}
+
+static Fixedpoint from_wide(i128 v)
+{
+    u128 mag = abs_wide(v);
+    Fixedpoint val = {(uint64_t)(mag >> 64), (uint64_t)mag, v < 0 ? VALID_NEGATIVE : VALID_NONNEGATIVE};
+    return val;
+}
+
+// Halve a value shift times, truncating the magnitude as fixedpoint_halve does
+static i128 halve_wide(i128 v, unsigned shift)
+{
+    return v < 0 ? -(i128)(-(u128)v >> shift) : (i128)((u128)v >> shift);
+}
+
+static Value halve_value(Value v, unsigned shift)
+{
+    if (shift != 0)
+    {
+        v.re = halve_wide(v.re, shift);
+        v.im = halve_wide(v.im, shift);
+    }
+    return v;
+}
+
+static u128 value_bits(Value v)
+{
+    return abs_wide(v.re) | abs_wide(v.im);
+}
+
+// The product of a value and a twiddle factor component, rounded to the
+// nearest multiple of 2^-64 with ties away from 0
+static i128 mul_twiddle(i128 x, i128 w)
+{
+    u128 upper, lower;
+    mul_128(abs_wide(x), abs_wide(w), &upper, &lower);
+    u128 product = (upper << 2 | lower >> 126) + ((lower >> 125) & 1);
+    return (x < 0) != (w < 0) ? -(i128)product : (i128)product;
+}
+
+// Multiply a value by a twiddle factor, or by its conjugate for an inverse
+// transform
+static Value twiddle_mul(Value x, const FixedpointFftTwiddle *w, int inverse)
+{
+    i128 w_im = inverse ? -w->im : w->im;
+    Value r = {mul_twiddle(x.re, w->re) - mul_twiddle(x.im, w_im),
+               mul_twiddle(x.re, w_im) + mul_twiddle(x.im, w->re)};
+    return r;
+}
+
+// Combine pairs of values into transforms of length 2, after halving them
+// shift times. Returns the OR of the magnitudes of the results.
+static u128 radix2_stage(Value *v, size_t n, unsigned shift)
+{
+    u128 bits = 0;
+    for (size_t i = 0; i < n; i += 2)
+    {
+        Value a = halve_value(v[i], shift);
+        Value b = halve_value(v[i + 1], shift);
+        Value sum = {a.re + b.re, a.im + b.im};
+        Value diff = {a.re - b.re, a.im - b.im};
+        v[i] = sum;
+        v[i + 1] = diff;
+        bits |= value_bits(sum) | value_bits(diff);
+    }
+    return bits;
+}
+
+// Combine groups of four transforms of length quarter into transforms of
+// length 4 * quarter, after halving the values shift times. In the
+// bit-reversed order, the four transforms of a group are those of the
+// elements that are 0, 2, 1 and 3 modulo 4. Returns the OR of the
+// magnitudes of the results.
+static u128 radix4_stage(Value *v, size_t n, size_t quarter, const FixedpointFftTwiddle *twiddles, int inverse,
+                         unsigned shift)
+{
+    size_t stride = n / (4 * quarter);
+    u128 bits = 0;
+    for (size_t start = 0; start < n; start += 4 * quarter)
+    {
+        for (size_t j = 0; j < quarter; ++j)
+        {
+            Value *p = &v[start + j];
+            Value b0 = halve_value(p[0], shift);
+            Value b2 = halve_value(p[quarter], shift);
+            Value b1 = halve_value(p[2 * quarter], shift);
+            Value b3 = halve_value(p[3 * quarter], shift);
+            if (j != 0)
+            {
+                b1 = twiddle_mul(b1, &twiddles[j * stride], inverse);
+                b2 = twiddle_mul(b2, &twiddles[2 * j * stride], inverse);
+                b3 = twiddle_mul(b3, &twiddles[3 * j * stride], inverse);
+            }
+            Value t0 = {b0.re + b2.re, b0.im + b2.im};
+            Value t1 = {b0.re - b2.re, b0.im - b2.im};
+            Value t2 = {b1.re + b3.re, b1.im + b3.im};
+            Value t3 = {b1.re - b3.re, b1.im - b3.im};
+
+            // t3 times -i for a forward transform, or i for an inverse one
+            Value rot = {t3.im, -t3.re};
+            if (inverse)
+            {
+                rot.re = -rot.re;
+                rot.im = -rot.im;
+            }
+            Value x0 = {t0.re + t2.re, t0.im + t2.im};
+            Value x1 = {t1.re + rot.re, t1.im + rot.im};
+            Value x2 = {t0.re - t2.re, t0.im - t2.im};
+            Value x3 = {t1.re - rot.re, t1.im - rot.im};
+            p[0] = x0;
+            p[quarter] = x1;
+            p[2 * quarter] = x2;
+            p[3 * quarter] = x3;
+            bits |= value_bits(x0) | value_bits(x1) | value_bits(x2) | value_bits(x3);
+        }
+    }
+    return bits;
+}
+
+// The number of bits the values may have before the first stage
+static unsigned first_limit_bits(const FixedpointFft *fft)
+{
+    return fft->log2n % 2 ? RADIX2_LIMIT_BITS : RADIX4_LIMIT_BITS;
+}
+
+// Transform values in bit-reversed order, whose magnitudes OR to bits, into
+// natural order. Returns the number of times the values were halved.
+static int run_stages(const FixedpointFft *fft, Value *v, u128 bits, int inverse)
+{
+    int halvings = 0;
+    size_t quarter = 1;
+    if (fft->log2n % 2)
+    {
+        unsigned shift = stage_shift(bits, RADIX2_LIMIT_BITS);
+        bits = radix2_stage(v, fft->n, shift);
+        halvings += (int)shift;
+        quarter = 2;
+    }
+    for (; quarter < fft->n; quarter *= 4)
+    {
+        unsigned shift = stage_shift(bits, RADIX4_LIMIT_BITS);
+        bits = radix4_stage(v, fft->n, quarter, fft->twiddles, inverse, shift);
+        halvings += (int)shift;
+    }
+    return halvings;
+}
+
+// Check count values and convert them, zero padded to the length of the
+// plan, to values in bit-reversed order. The values are scaled by a power of
+// two so that the largest has as many bits as the first stage allows: small
+// values are shifted left, keeping their full precision through the
+// transform. Returns 0 if a value is not valid.
+static int load(const FixedpointFft *fft, const FixedpointComplex *data, size_t count, Value *v, int *exponent,
+                u128 *bits)
+{
+    u128 input_bits = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (!fixedpoint_is_valid(data[i].re) || !fixedpoint_is_valid(data[i].im))
+        {
+            return 0;
+        }
+        input_bits |= magnitude(data[i].re) | magnitude(data[i].im);
+    }
+    int scale = input_bits == 0 ? 0 : (int)bit_length(input_bits) - (int)first_limit_bits(fft);
+    for (size_t i = 0; i < fft->n; ++i)
+    {
+        Value value = {0, 0};
+        if (i < count)
+        {
+            value.re = to_wide(data[i].re, scale);
+            value.im = to_wide(data[i].im, scale);
+        }
+        v[fft->bitrev[i]] = value;
+    }
+    *exponent = scale;
+    *bits = scale >= 0 ? input_bits >> scale : input_bits << -scale;
+    return 1;
+}
+
+static void store(const Value *v, size_t count, FixedpointComplex *data)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        data[i].re = from_wide(v[i].re);
+        data[i].im = from_wide(v[i].im);
+    }
+}
+
+static int transform(const FixedpointFft *fft, FixedpointComplex *data, int inverse, int *exponent)
+{
+    Value *v = malloc(fft->n * sizeof(Value));
+    int scale;
+    u128 bits;
+    if (v == NULL || !load(fft, data, fft->n, v, &scale, &bits))
+    {
+        free(v);
+        return 0;
+    }
+    scale += run_stages(fft, v, bits, inverse);
+    store(v, fft->n, data);
+    free(v);
+    *exponent = inverse ? scale - (int)fft->log2n : scale;
+    return 1;
+}
+
+// a * b / 2^127, rounded, for a and b below 2^128
+static u128 mul_q127(u128 a, u128 b)
+{
+    u128 upper, lower;
+    mul_128(a, b, &upper, &lower);
+    return (upper << 1 | lower >> 127) + ((lower >> 126) & 1);
+}
+
+// The cosine and sine, in units of 2^-126, of an angle of at most pi / 4 in
+// units of 2^-127, from their Taylor series
+static void octant_sincos(u128 angle, i128 *cos_out, i128 *sin_out)
+{
+    u128 square = mul_q127(angle, angle);
+    u128 cos = (u128)1 << 127, sin = angle;
+    u128 cos_term = cos, sin_term = sin;
+    for (uint64_t k = 1; cos_term != 0 || sin_term != 0; ++k)
+    {
+        cos_term = mul_q127(cos_term, square) / ((2 * k - 1) * (2 * k));
+        sin_term = mul_q127(sin_term, square) / ((2 * k) * (2 * k + 1));
+        if (k % 2)
+        {
+            cos -= cos_term;
+            sin -= sin_term;
+        }
+        else
+        {
+            cos += cos_term;
+            sin += sin_term;
+        }
+    }
+    *cos_out = (i128)((cos + 1) >> 1);
+    *sin_out = (i128)((sin + 1) >> 1);
+}
+
+int fixedpoint_fft_init(FixedpointFft *fft, size_t n)
+{
+    if (n == 0 || (n & (n - 1)) != 0)
+    {
+        return 0;
+    }
+    unsigned log2n = 0;
+    while (((size_t)1 << log2n) < n)
+    {
+        log2n++;
+    }
+
+    // The cosines and sines of the first eighth of a turn
+    size_t quarter = n / 4, eighth = n / 8;
+    FixedpointFftTwiddle *twiddles = malloc(n * sizeof(FixedpointFftTwiddle));
+    size_t *bitrev = malloc(n * sizeof(size_t));
+    i128 *octant = malloc(2 * (eighth + 1) * sizeof(i128));
+    if (twiddles == NULL || bitrev == NULL || octant == NULL)
+    {
+        free(twiddles);
+        free(bitrev);
+        free(octant);
+        return 0;
+    }
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        size_t reversed = 0;
+        for (unsigned b = 0; b < log2n; ++b)
+        {
+            reversed |= ((i >> b) & 1) << (log2n - 1 - b);
+        }
+        bitrev[i] = reversed;
+    }
+
+    if (n < 4)
+    {
+        FixedpointFftTwiddle one = {(i128)1 << 126, 0};
+        FixedpointFftTwiddle minus_one = {-((i128)1 << 126), 0};
+        twiddles[0] = one;
+        if (n == 2)
+        {
+            twiddles[1] = minus_one;
+        }
+    }
+    else
+    {
+        // The angle 2 pi j / n is pi / 4 * 8j / n, which in units of 2^-127
+        // is (pi / 4 in units of 2^-128) * j / 2^(log2n - 2)
+        i128 *cosines = octant, *sines = octant + eighth + 1;
+        u128 pi_over_4 = (u128)PI_OVER_4_HI << 64 | PI_OVER_4_LO;
+        unsigned shift = log2n - 2;
+        for (size_t j = 0; j <= eighth; ++j)
+        {
+            u128 upper, lower;
+            mul_128(pi_over_4, j, &upper, &lower);
+            u128 angle = lower;
+            if (shift > 0)
+            {
+                angle = (upper << (128 - shift) | lower >> shift) + ((lower >> (shift - 1)) & 1);
+            }
+            octant_sincos(angle, &cosines[j], &sines[j]);
+        }
+
+        // The rest of the circle follows by symmetry, so that every twiddle
+        // factor has exactly the symmetries of the exact one
+        for (size_t k = 0; k < n; ++k)
+        {
+            size_t r = k % quarter;
+            i128 c = r <= eighth ? cosines[r] : sines[quarter - r];
+            i128 s = r <= eighth ? sines[r] : cosines[quarter - r];
+            i128 cos_k, sin_k;
+            switch (k / quarter)
+            {
+            case 0:
+                cos_k = c;
+                sin_k = s;
+                break;
+            case 1:
+                cos_k = -s;
+                sin_k = c;
+                break;
+            case 2:
+                cos_k = -c;
+                sin_k = -s;
+                break;
+            default:
+                cos_k = s;
+                sin_k = -c;
+                break;
+            }
+            twiddles[k].re = cos_k;
+            twiddles[k].im = -sin_k;
+        }
+    }
+    free(octant);
+
+    fft->n = n;
+    fft->log2n = log2n;
+    fft->twiddles = twiddles;
+    fft->bitrev = bitrev;
+    return 1;
+}
+
+void fixedpoint_fft_destroy(FixedpointFft *fft)
+{
+    free(fft->twiddles);
+    free(fft->bitrev);
+    fft->twiddles = NULL;
+    fft->bitrev = NULL;
+    fft->n = 0;
+}
+
+int fixedpoint_fft_forward(const FixedpointFft *fft, FixedpointComplex *data, int *exponent)
+{
+    return transform(fft, data, 0, exponent);
+}
+
+int fixedpoint_fft_inverse(const FixedpointFft *fft, FixedpointComplex *data, int *exponent)
+{
+    return transform(fft, data, 1, exponent);
+}
+
+int fixedpoint_convolve_direct(const FixedpointComplex *x, size_t nx, const FixedpointComplex *h, size_t nh,
+                               FixedpointComplex *out, FixedpointRound mode)
+{
+    if (nx == 0 || nh == 0)
+    {
+        return 1;
+    }
+
+    // The real and imaginary parts of x, then of h
+    FixedpointProductTerm *packed = malloc(2 * (nx + nh) * sizeof(FixedpointProductTerm));
+    unsigned char *invalid = calloc(nx + nh, 1);
+    if (packed == NULL || invalid == NULL)
+    {
+        free(packed);
+        free(invalid);
+        return 0;
+    }
+    FixedpointProductTerm *x_re = packed, *x_im = packed + nx;
+    FixedpointProductTerm *h_re = packed + 2 * nx, *h_im = packed + 2 * nx + nh;
+    unsigned char *x_invalid = invalid, *h_invalid = invalid + nx;
+    for (size_t j = 0; j < nx; ++j)
+    {
+        x_re[j] = fixedpoint_product_term_checked(x[j].re, &x_invalid[j]);
+        x_im[j] = fixedpoint_product_term_checked(x[j].im, &x_invalid[j]);
+    }
+    for (size_t j = 0; j < nh; ++j)
+    {
+        h_re[j] = fixedpoint_product_term_checked(h[j].re, &h_invalid[j]);
+        h_im[j] = fixedpoint_product_term_checked(h[j].im, &h_invalid[j]);
+    }
+
+    for (size_t k = 0; k < nx + nh - 1; ++k)
+    {
+        FixedpointProductAccum re = {{0}}, im = {{0}};
+        int bad = 0;
+        size_t first = k < nh ? 0 : k - nh + 1;
+        size_t last = k < nx ? k : nx - 1;
+        for (size_t j = first; j <= last; ++j)
+        {
+            // (a + bi)(c + di) = (ac - bd) + (ad + bc)i
+            FixedpointProductTerm neg_h_im = h_im[k - j];
+            neg_h_im.sign = ~neg_h_im.sign;
+            fixedpoint_product_accum_add(&re, x_re[j], h_re[k - j]);
+            fixedpoint_product_accum_add(&re, x_im[j], neg_h_im);
+            fixedpoint_product_accum_add(&im, x_re[j], h_im[k - j]);
+            fixedpoint_product_accum_add(&im, x_im[j], h_re[k - j]);
+            bad |= x_invalid[j] | h_invalid[k - j];
+        }
+        out[k].re = fixedpoint_product_accum_checked_result(&re, bad, mode);
+        out[k].im = fixedpoint_product_accum_checked_result(&im, bad, mode);
+    }
+
+    free(packed);
+    free(invalid);
+    return 1;
+}
+
+// The exact product of two values in units of 2^-64, which is in units of
+// 2^-128
+static Wide wide_product(i128 a, i128 b)
+{
+    Wide r;
+    mul_128(abs_wide(a), abs_wide(b), &r.hi, &r.lo);
+    return (a < 0) != (b < 0) ? wide_negate(r) : r;
+}
+
+static Wide wide_add(Wide a, Wide b)
+{
+    Wide r;
+    r.lo = a.lo + b.lo;
+    r.hi = a.hi + b.hi + (r.lo < a.lo);
+    return r;
+}
+
+// Divide by 2^shift (0 to 255), rounding to the nearest with ties away
+// from 0. The quotient must fit in 127 bits.
+static i128 wide_round_shift(Wide a, unsigned shift)
+{
+    if (shift == 0)
+    {
+        return (i128)a.lo;
+    }
+    int negative = (int)(a.hi >> 127);
+    Wide mag = negative ? wide_negate(a) : a;
+    Wide half = {0, 0};
+    if (shift - 1 < 128)
+    {
+        half.lo = (u128)1 << (shift - 1);
+    }
+    else
+    {
+        half.hi = (u128)1 << (shift - 1 - 128);
+    }
+    mag = wide_add(mag, half);
+    u128 q = shift < 128 ? mag.hi << (128 - shift) | mag.lo >> shift : mag.hi >> (shift - 128);
+    return negative ? -(i128)q : (i128)q;
+}
+
+int fixedpoint_convolve_fft(const FixedpointFft *fft, const FixedpointComplex *x, size_t nx,
+                            const FixedpointComplex *h, size_t nh, FixedpointComplex *out, int *exponent)
+{
+    *exponent = 0;
+    if (nx == 0 || nh == 0)
+    {
+        return 1;
+    }
+    if (nx + nh - 1 > fft->n)
+    {
+        return 0;
+    }
+
+    size_t n = fft->n;
+    Value *xv = malloc(2 * n * sizeof(Value));
+    if (xv == NULL)
+    {
+        return 0;
+    }
+    Value *hv = xv + n;
+    int x_scale, h_scale;
+    u128 x_bits, h_bits;
+    if (!load(fft, x, nx, xv, &x_scale, &x_bits) || !load(fft, h, nh, hv, &h_scale, &h_bits))
+    {
+        free(xv);
+        return 0;
+    }
+    x_scale += run_stages(fft, xv, x_bits, 0);
+    h_scale += run_stages(fft, hv, h_bits, 0);
+
+    // Multiply the transforms, scaled so that the products have as many bits
+    // as the first stage of the inverse transform allows. Each part of a
+    // product is below 2^(length of x + length of h + 1) in units of 2^-128;
+    // dropping shift bits leaves it in units of 2^(shift - 128), which is
+    // 2^(shift - 64) times units of 2^-64.
+    x_bits = 0;
+    h_bits = 0;
+    for (size_t k = 0; k < n; ++k)
+    {
+        x_bits |= value_bits(xv[k]);
+        h_bits |= value_bits(hv[k]);
+    }
+    unsigned product_bits = bit_length(x_bits) + bit_length(h_bits) + 1;
+    unsigned limit_bits = first_limit_bits(fft);
+    unsigned shift = product_bits > limit_bits ? product_bits - limit_bits : 0;
+    u128 bits = 0;
+    for (size_t k = 0; k < n; ++k)
+    {
+        Value a = xv[k], b = hv[k];
+        Wide re = wide_add(wide_product(a.re, b.re), wide_negate(wide_product(a.im, b.im)));
+        Wide im = wide_add(wide_product(a.re, b.im), wide_product(a.im, b.re));
+        Value p = {wide_round_shift(re, shift), wide_round_shift(im, shift)};
+        xv[k] = p;
+        bits |= value_bits(p);
+    }
+
+    // Back to bit-reversed order for the inverse transform
+    for (size_t k = 0; k < n; ++k)
+    {
+        size_t r = fft->bitrev[k];
+        if (k < r)
+        {
+            Value t = xv[k];
+            xv[k] = xv[r];
+            xv[r] = t;
+        }
+    }
+    int scale = x_scale + h_scale + (int)shift - 64 + run_stages(fft, xv, bits, 1);
+    store(xv, nx + nh - 1, out);
+    free(xv);
+    *exponent = scale - (int)fft->log2n;
+    return 1;
+}
@@ -0,0 +1,148 @@
+#ifndef FIXEDPOINT_FFT_H
+#define FIXEDPOINT_FFT_H
+
+#include <stddef.h>
+#include "fixedpoint.h"
+
+// Fast Fourier transforms and convolutions of complex Fixedpoint data.
+//
+// The transforms are computed with radix-4 stages (and one radix-2 stage
+// when the length is an odd power of two) on 128 bit two's complement
+// values, using only integer arithmetic, so the results are the same on
+// every platform. The twiddle factors are computed once, when a plan is
+// built, to 126 fraction bits.
+//
+// The transforms use block floating point. The input is scaled by a power
+// of two so that its largest value fills the 128 bit values up to the
+// headroom of the first stage (small values are shifted left, exactly;
+// large ones are halved with the truncation of fixedpoint_halve), and before
+// each later stage, if the largest value is big enough that the stage could
+// overflow, every value is halved until it is not. The total scaling is
+// reported as an exponent: the transform of the data is the result times
+// 2^exponent, which fixedpoint_shl or fixedpoint_shr can apply.
+//
+// Each twiddle product is rounded to the nearest multiple of 2^-64 (ties
+// away from zero) of the scaled values, so relative to the largest value of
+// the input a transform of length n = 2^k is accurate to about k * 2^-122.
+
+// A struct that holds a complex Fixedpoint number
+//
+// Fields:
+//  re - the real part
+//  im - the imaginary part
+typedef struct
+{
+    Fixedpoint re;
+    Fixedpoint im;
+} FixedpointComplex;
+
+// A twiddle factor (defined in fixedpoint_fft.c)
+typedef struct FixedpointFftTwiddle FixedpointFftTwiddle;
+
+// A struct that holds the precomputed data for transforms of one length
+//
+// Fields:
+//  n - the length of the transforms
+//  log2n - log2 of the length
+//  twiddles - the twiddle factors e^(-2 pi i k / n) for k from 0 to n - 1
+//  bitrev - the bit reversal permutation of the indices 0 to n - 1
+typedef struct
+{
+    size_t n;
+    unsigned log2n;
+    FixedpointFftTwiddle *twiddles;
+    size_t *bitrev;
+} FixedpointFft;
+
+// Build a plan for transforms of a given length.
+//
+// Parameters:
+//   fft - pointer to the plan to initialize
+//   n - the length of the transforms, a power of two
+//
+// Returns:
+//   1 if successful;
+//   0 if n is not a power of two or memory could not be allocated
+int fixedpoint_fft_init(FixedpointFft *fft, size_t n);
+
+// Free the memory owned by a plan.
+//
+// Parameters:
+//   fft - pointer to the plan
+void fixedpoint_fft_destroy(FixedpointFft *fft);
+
+// Compute the discrete Fourier transform of an array, in place:
+// X[k] = sum over j of x[j] e^(-2 pi i j k / n).
+//
+// Parameters:
+//   fft - pointer to the plan
+//   data - the fft->n values to transform
+//   exponent - receives the block exponent: X[k] is data[k] * 2^exponent
+//
+// Returns:
+//   1 if successful;
+//   0 if a value is not valid (data is unchanged) or memory could not be
+//   allocated
+int fixedpoint_fft_forward(const FixedpointFft *fft, FixedpointComplex *data, int *exponent);
+
+// Compute the inverse discrete Fourier transform of an array, in place:
+// x[j] = (1 / n) sum over k of X[k] e^(2 pi i j k / n).
+//
+// Parameters:
+//   fft - pointer to the plan
+//   data - the fft->n values to transform
+//   exponent - receives the block exponent: x[j] is data[j] * 2^exponent
+//              (the factor 1 / n is part of the exponent, so it is usually
+//              negative)
+//
+// Returns:
+//   1 if successful;
+//   0 if a value is not valid (data is unchanged) or memory could not be
+//   allocated
+int fixedpoint_fft_inverse(const FixedpointFft *fft, FixedpointComplex *data, int *exponent);
+
+// Compute the linear convolution of two arrays directly:
+// out[k] = sum over j of x[j] h[k - j]. Each element is the exact sum of
+// exact products, rounded once.
+//
+// Parameters:
+//   x - the first array
+//   nx - the number of elements of x
+//   h - the second array
+//   nh - the number of elements of h
+//   out - receives the nx + nh - 1 elements of the convolution (nothing if
+//         nx or nh is 0); must not overlap x or h
+//   mode - how to round each part of each element to a multiple of 2^-64
+//
+// Returns:
+//   1 if successful, with each part of each element rounded according to
+//   mode (see fixedpoint256_to_fixedpoint for the tags of results that are
+//   inexact with FIXEDPOINT_ROUND_EXACT or that overflow), or set to an
+//   error value if any element it depends on is not valid;
+//   0 if memory could not be allocated
+int fixedpoint_convolve_direct(const FixedpointComplex *x, size_t nx, const FixedpointComplex *h, size_t nh,
+                               FixedpointComplex *out, FixedpointRound mode);
+
+// Compute the linear convolution of two arrays with transforms. This takes
+// O(n log n) time instead of the O(nx nh) time of
+// fixedpoint_convolve_direct, but the result has the rounding error of the
+// transforms and is scaled by a block exponent.
+//
+// Parameters:
+//   fft - pointer to a plan whose length is at least nx + nh - 1
+//   x - the first array
+//   nx - the number of elements of x
+//   h - the second array
+//   nh - the number of elements of h
+//   out - receives the nx + nh - 1 elements of the convolution, scaled:
+//         the convolution is out[k] * 2^exponent (may overlap x or h)
+//   exponent - receives the block exponent
+//
+// Returns:
+//   1 if successful;
+//   0 if the plan is too short, a value is not valid, or memory could not
+//   be allocated
+int fixedpoint_convolve_fft(const FixedpointFft *fft, const FixedpointComplex *x, size_t nx,
+                            const FixedpointComplex *h, size_t nh, FixedpointComplex *out, int *exponent);
+
+#endif // FIXEDPOINT_FFT_H
@@ -0,0 +1,289 @@
+#include <stdlib.h>
+#include <string.h>
+#include "fixedpoint_filter.h"
+
+// The number of coefficients of a biquad section
+#define BIQUAD_COEFFS 5
+
+// Pack an output sample to be fed back; an inexact sample keeps its value
+static FixedpointProductTerm pack_output(Fixedpoint val)
+{
+    FixedpointProductTerm term = fixedpoint_product_term(val);
+    term.sign = val.tag == VALID_NEGATIVE || val.tag == UNDERFLOW_NEGATIVE ? ~0UL : 0;
+    return term;
+}
+
+static Fixedpoint error_value(void)
+{
+    Fixedpoint error = {0, 0, ERROR};
+    return error;
+}
+
+// Convert an accumulated sum to an output sample, rounding it according to
+// mode and handling overflow according to the policy
+static Fixedpoint acc_result(const FixedpointProductAccum *acc, FixedpointRound mode, FixedpointFilterOverflow overflow)
+{
+    Fixedpoint val = fixedpoint_product_accum_result(acc, mode);
+    if (overflow == FIXEDPOINT_FILTER_SATURATE && (val.tag == OVERFLOW_POSITIVE || val.tag == OVERFLOW_NEGATIVE))
+    {
+        val.whole = ~0UL;
+        val.frac = ~0UL;
+        val.tag = val.tag == OVERFLOW_NEGATIVE ? VALID_NEGATIVE : VALID_NONNEGATIVE;
+    }
+    return val;
+}
+
+// Pack coefficients, in reverse order if reverse is 1
+static int pack_coeffs(const Fixedpoint *coeffs, size_t count, int reverse, FixedpointProductTerm *packed)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (!fixedpoint_is_valid(coeffs[i]))
+        {
+            return 0;
+        }
+        packed[reverse ? count - 1 - i : i] = fixedpoint_product_term(coeffs[i]);
+    }
+    return 1;
+}
+
+int fixedpoint_fir_init(FixedpointFir *fir, const Fixedpoint *coeffs, size_t taps, size_t channels,
+                        FixedpointRound mode, FixedpointFilterOverflow overflow)
+{
+    // The delay lines hold 2 * taps * channels samples
+    if (taps == 0 || channels == 0 || taps > SIZE_MAX / (2 * sizeof(FixedpointProductTerm)) / channels)
+    {
+        return 0;
+    }
+    fir->coeffs = malloc(taps * sizeof(FixedpointProductTerm));
+    fir->delay = malloc(2 * taps * channels * sizeof(FixedpointProductTerm));
+    fir->invalid = malloc(taps * channels);
+    fir->invalid_count = malloc(channels * sizeof(size_t));
+    fir->taps = taps;
+    fir->channels = channels;
+    fir->mode = mode;
+    fir->overflow = overflow;
+    if (!fir->coeffs || !fir->delay || !fir->invalid || !fir->invalid_count ||
+        !pack_coeffs(coeffs, taps, 1, fir->coeffs))
+    {
+        fixedpoint_fir_destroy(fir);
+        return 0;
+    }
+    fixedpoint_fir_reset(fir);
+    return 1;
+}
+
+void fixedpoint_fir_reset(FixedpointFir *fir)
+{
+    memset(fir->delay, 0, 2 * fir->taps * fir->channels * sizeof(FixedpointProductTerm));
+    memset(fir->invalid, 0, fir->taps * fir->channels);
+    memset(fir->invalid_count, 0, fir->channels * sizeof(size_t));
+    fir->pos = 0;
+}
+
+void fixedpoint_fir_destroy(FixedpointFir *fir)
+{
+    free(fir->coeffs);
+    free(fir->delay);
+    free(fir->invalid);
+    free(fir->invalid_count);
+    fir->coeffs = NULL;
+    fir->delay = NULL;
+    fir->invalid = NULL;
+    fir->invalid_count = NULL;
+}
+
+// Store a sample of a channel at position pos of its delay line, replacing
+// the oldest sample
+static void fir_push(FixedpointFir *fir, size_t channel, size_t pos, Fixedpoint sample)
+{
+    FixedpointProductTerm *delay = fir->delay + channel * 2 * fir->taps;
+    unsigned char *invalid = fir->invalid + channel * fir->taps;
+    int sample_invalid = !fixedpoint_is_valid(sample);
+    fir->invalid_count[channel] += sample_invalid - invalid[pos];
+    invalid[pos] = (unsigned char)sample_invalid;
+    FixedpointProductTerm zero = {0, 0, 0};
+    delay[pos] = sample_invalid ? zero : fixedpoint_product_term(sample);
+    delay[pos + fir->taps] = delay[pos];
+}
+
+static Fixedpoint fir_output(const FixedpointFir *fir, size_t channel, const FixedpointProductAccum *acc)
+{
+    return fir->invalid_count[channel] ? error_value() : acc_result(acc, fir->mode, fir->overflow);
+}
+
+// Filter a block of samples of one channel, or of two adjacent channels
+// together: their sums are accumulated in the same loop, so that the
+// coefficients are read once and the two chains of additions overlap
+static void fir_channels(FixedpointFir *fir, size_t channel, size_t lanes, const Fixedpoint *in, Fixedpoint *out,
+                         size_t frames)
+{
+    size_t taps = fir->taps;
+    size_t channels = fir->channels;
+    const FixedpointProductTerm *coeffs = fir->coeffs;
+    const FixedpointProductTerm *delay0 = fir->delay + channel * 2 * taps;
+    const FixedpointProductTerm *delay1 = delay0 + (lanes == 2 ? 2 * taps : 0);
+    size_t pos = fir->pos;
+    for (size_t f = 0; f < frames; ++f)
+    {
+        pos = pos + 1 == taps ? 0 : pos + 1;
+        for (size_t l = 0; l < lanes; ++l)
+        {
+            fir_push(fir, channel + l, pos, in[f * channels + channel + l]);
+        }
+
+        // The last taps samples, oldest first, start just after the newest
+        const FixedpointProductTerm *x0 = delay0 + pos + 1;
+        const FixedpointProductTerm *x1 = delay1 + pos + 1;
+        FixedpointProductAccum sum0 = {{0}};
+        FixedpointProductAccum sum1 = {{0}};
+        if (lanes == 2)
+        {
+            for (size_t i = 0; i < taps; ++i)
+            {
+                fixedpoint_product_accum_add(&sum0, coeffs[i], x0[i]);
+                fixedpoint_product_accum_add(&sum1, coeffs[i], x1[i]);
+            }
+            out[f * channels + channel] = fir_output(fir, channel, &sum0);
+            out[f * channels + channel + 1] = fir_output(fir, channel + 1, &sum1);
+        }
+        else
+        {
+            for (size_t i = 0; i < taps; ++i)
+            {
+                fixedpoint_product_accum_add(&sum0, coeffs[i], x0[i]);
+            }
+            out[f * channels + channel] = fir_output(fir, channel, &sum0);
+        }
+    }
+}
+
+void fixedpoint_fir_process(FixedpointFir *fir, const Fixedpoint *in, Fixedpoint *out, size_t frames)
+{
+    // Each pair of channels is filtered over the whole block before the
+    // next, so that their delay lines stay in cache
+    for (size_t c = 0; c < fir->channels; c += 2)
+    {
+        fir_channels(fir, c, fir->channels - c >= 2 ? 2 : 1, in, out, frames);
+    }
+    fir->pos = (fir->pos + frames % fir->taps) % fir->taps;
+}
+
+int fixedpoint_biquad_init(FixedpointBiquad *bq, const Fixedpoint *coeffs, size_t sections, size_t channels,
+                           FixedpointRound mode, FixedpointFilterOverflow overflow)
+{
+    // Neither the state, 2 * (sections + 1) * channels samples, nor the
+    // coefficients may be larger than this bound
+    if (sections == 0 || channels == 0 ||
+        sections >= SIZE_MAX / (2 * BIQUAD_COEFFS * sizeof(FixedpointProductTerm)) / channels)
+    {
+        return 0;
+    }
+    bq->coeffs = malloc(BIQUAD_COEFFS * sections * sizeof(FixedpointProductTerm));
+    bq->state = malloc(2 * (sections + 1) * channels * sizeof(FixedpointProductTerm));
+    bq->failed = malloc(channels);
+    bq->sections = sections;
+    bq->channels = channels;
+    bq->mode = mode;
+    bq->overflow = overflow;
+    if (!bq->coeffs || !bq->state || !bq->failed || !pack_coeffs(coeffs, BIQUAD_COEFFS * sections, 0, bq->coeffs))
+    {
+        fixedpoint_biquad_destroy(bq);
+        return 0;
+    }
+
+    // a1 and a2 are stored negated, so that every term is added
+    for (size_t s = 0; s < sections; ++s)
+    {
+        bq->coeffs[s * BIQUAD_COEFFS + 3].sign ^= ~0UL;
+        bq->coeffs[s * BIQUAD_COEFFS + 4].sign ^= ~0UL;
+    }
+    fixedpoint_biquad_reset(bq);
+    return 1;
+}
+
+void fixedpoint_biquad_reset(FixedpointBiquad *bq)
+{
+    memset(bq->state, 0, 2 * (bq->sections + 1) * bq->channels * sizeof(FixedpointProductTerm));
+    memset(bq->failed, 0, bq->channels);
+}
+
+void fixedpoint_biquad_destroy(FixedpointBiquad *bq)
+{
+    free(bq->coeffs);
+    free(bq->state);
+    free(bq->failed);
+    bq->coeffs = NULL;
+    bq->state = NULL;
+    bq->failed = NULL;
+}
+
+// Filter one sample of a channel through every section. The state of a
+// channel holds x[n-1] and x[n-2] of the first section, then y[n-1] and
+// y[n-2] of each section, which are also x[n-1] and x[n-2] of the next.
+static Fixedpoint biquad_sample(FixedpointBiquad *bq, size_t channel, Fixedpoint sample)
+{
+    if (bq->failed[channel] || !fixedpoint_is_valid(sample))
+    {
+        bq->failed[channel] = 1;
+        return error_value();
+    }
+    FixedpointProductTerm *s = bq->state + channel * 2 * (bq->sections + 1);
+    const FixedpointProductTerm *b = bq->coeffs;
+    FixedpointProductTerm x = fixedpoint_product_term(sample);
+    Fixedpoint y = sample;
+    int inexact = 0;
+    for (size_t k = 0; k < bq->sections; ++k, s += 2, b += BIQUAD_COEFFS)
+    {
+        FixedpointProductAccum acc = {{0}};
+        fixedpoint_product_accum_add(&acc, b[0], x);
+        fixedpoint_product_accum_add(&acc, b[1], s[0]);
+        fixedpoint_product_accum_add(&acc, b[2], s[1]);
+        fixedpoint_product_accum_add(&acc, b[3], s[2]);
+        fixedpoint_product_accum_add(&acc, b[4], s[3]);
+        y = acc_result(&acc, bq->mode, bq->overflow);
+        s[1] = s[0];
+        s[0] = x;
+        if (y.tag == OVERFLOW_POSITIVE || y.tag == OVERFLOW_NEGATIVE)
+        {
+            bq->failed[channel] = 1;
+            return y;
+        }
+        inexact |= y.tag == UNDERFLOW_POSITIVE || y.tag == UNDERFLOW_NEGATIVE;
+        x = pack_output(y);
+    }
+    s[1] = s[0];
+    s[0] = x;
+
+    // With FIXEDPOINT_ROUND_EXACT, the output is inexact if any section was
+    if (inexact)
+    {
+        y.tag = x.sign ? UNDERFLOW_NEGATIVE : UNDERFLOW_POSITIVE;
+    }
+    return y;
+}
+
+void fixedpoint_biquad_process(FixedpointBiquad *bq, const Fixedpoint *in, Fixedpoint *out, size_t frames)
+{
+    // Pairs of channels are filtered together: each output depends on the
+    // previous one, but the two channels' chains are independent and overlap
+    size_t channels = bq->channels;
+    for (size_t c = 0; c < channels; c += 2)
+    {
+        if (channels - c >= 2)
+        {
+            for (size_t f = 0; f < frames; ++f)
+            {
+                out[f * channels + c] = biquad_sample(bq, c, in[f * channels + c]);
+                out[f * channels + c + 1] = biquad_sample(bq, c + 1, in[f * channels + c + 1]);
+            }
+        }
+        else
+        {
+            for (size_t f = 0; f < frames; ++f)
+            {
+                out[f * channels + c] = biquad_sample(bq, c, in[f * channels + c]);
+            }
+        }
+    }
+}
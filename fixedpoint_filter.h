@@ -0,0 +1,170 @@
+#ifndef FIXEDPOINT_FILTER_H
+#define FIXEDPOINT_FILTER_H
+
+#include <stddef.h>
+#include "fixedpoint.h"
+#include "fixedpoint_accum.h"
+
+// Streaming FIR and biquad IIR filters over blocks of Fixedpoint samples,
+// for any number of channels that share the same coefficients.
+//
+// Samples are processed in blocks of frames: frame f of a block holds one
+// sample of each channel, so sample c of frame f is element
+// f * channels + c. The filters keep their state between blocks.
+//
+// Every output sample is the exact sum of the exact products of its
+// coefficients and samples, accumulated in a 320 bit integer and rounded
+// once. A filter processes its channels two at a time, interleaving their
+// sums so that the multiplications of the two channels overlap.
+
+// An enum that holds what a filter does with an output sample too large to
+// represent
+// FIXEDPOINT_FILTER_TAG: Tag it OVERFLOW_POSITIVE or OVERFLOW_NEGATIVE,
+//                        with the magnitude wrapped (as fixedpoint_add does)
+// FIXEDPOINT_FILTER_SATURATE: Clamp it to the largest representable
+//                             magnitude (as fixedpoint_add_sat does)
+typedef enum
+{
+    FIXEDPOINT_FILTER_TAG,
+    FIXEDPOINT_FILTER_SATURATE
+} FixedpointFilterOverflow;
+
+// A struct that holds an FIR filter
+//
+// Fields:
+//  coeffs - the coefficients, in reverse order
+//  delay - for each channel, a delay line of 2 * taps samples: each sample
+//          is stored twice, taps apart, so that the last taps samples are
+//          always contiguous
+//  invalid - for each channel, taps flags marking the samples in the delay
+//            line that were not valid
+//  invalid_count - for each channel, the number of flags set
+//  taps - the number of coefficients
+//  channels - the number of channels
+//  pos - the position in the delay lines of the most recent sample
+//  mode - how output samples are rounded
+//  overflow - what happens to output samples too large to represent
+typedef struct
+{
+    FixedpointProductTerm *coeffs;
+    FixedpointProductTerm *delay;
+    unsigned char *invalid;
+    size_t *invalid_count;
+    size_t taps;
+    size_t channels;
+    size_t pos;
+    FixedpointRound mode;
+    FixedpointFilterOverflow overflow;
+} FixedpointFir;
+
+// A struct that holds a cascade of biquad IIR filters (second-order
+// sections), each computing
+// y[n] = b0 x[n] + b1 x[n-1] + b2 x[n-2] - a1 y[n-1] - a2 y[n-2]
+// in direct form I. The output of each section is rounded before it is
+// fed back or passed to the next section.
+//
+// Fields:
+//  coeffs - the coefficients of each section
+//  state - for each channel, the last two inputs of the first section and
+//          the last two outputs of each section
+//  failed - for each channel, whether a sample that was not valid, or an
+//           output that overflowed with FIXEDPOINT_FILTER_TAG, has entered
+//           the feedback; its outputs are errors until the filter is reset
+//  sections - the number of sections
+//  channels - the number of channels
+//  mode - how output samples are rounded
+//  overflow - what happens to output samples too large to represent
+typedef struct
+{
+    FixedpointProductTerm *coeffs;
+    FixedpointProductTerm *state;
+    unsigned char *failed;
+    size_t sections;
+    size_t channels;
+    FixedpointRound mode;
+    FixedpointFilterOverflow overflow;
+} FixedpointBiquad;
+
+// Build an FIR filter y[n] = coeffs[0] x[n] + ... + coeffs[taps-1] x[n-taps+1],
+// with every channel's delay line filled with zeros.
+//
+// Parameters:
+//   fir - pointer to the filter to initialize
+//   coeffs - the coefficients
+//   taps - the number of coefficients, at least 1
+//   channels - the number of channels, at least 1
+//   mode - how to round output samples (with FIXEDPOINT_ROUND_EXACT, an
+//          inexact output is tagged UNDERFLOW_POSITIVE or UNDERFLOW_NEGATIVE)
+//   overflow - what to do with output samples too large to represent
+//
+// Returns:
+//   1 if successful;
+//   0 if a coefficient is not valid, taps or channels is 0, the delay lines
+//   would be too large to address, or memory could not be allocated
+int fixedpoint_fir_init(FixedpointFir *fir, const Fixedpoint *coeffs, size_t taps, size_t channels,
+                        FixedpointRound mode, FixedpointFilterOverflow overflow);
+
+// Fill the delay lines of an FIR filter with zeros.
+//
+// Parameters:
+//   fir - pointer to the filter
+void fixedpoint_fir_reset(FixedpointFir *fir);
+
+// Free the memory owned by an FIR filter.
+//
+// Parameters:
+//   fir - pointer to the filter
+void fixedpoint_fir_destroy(FixedpointFir *fir);
+
+// Filter a block of samples.
+//
+// Parameters:
+//   fir - pointer to the filter
+//   in - the input samples, frames * fir->channels of them
+//   out - receives the output samples (may be the same array as in); an
+//         output sample is an error value if any of the samples it depends
+//         on is not valid
+//   frames - the number of frames
+void fixedpoint_fir_process(FixedpointFir *fir, const Fixedpoint *in, Fixedpoint *out, size_t frames);
+
+// Build a cascade of biquad filters, with every channel's state set to zero.
+//
+// Parameters:
+//   bq - pointer to the filter to initialize
+//   coeffs - the coefficients b0, b1, b2, a1, a2 of each section, 5 * sections
+//            of them (a0 is 1)
+//   sections - the number of sections, at least 1
+//   channels - the number of channels, at least 1
+//   mode - how to round output samples of each section
+//   overflow - what to do with output samples too large to represent
+//
+// Returns:
+//   1 if successful;
+//   0 if a coefficient is not valid, sections or channels is 0, the state
+//   would be too large to address, or memory could not be allocated
+int fixedpoint_biquad_init(FixedpointBiquad *bq, const Fixedpoint *coeffs, size_t sections, size_t channels,
+                           FixedpointRound mode, FixedpointFilterOverflow overflow);
+
+// Set the state of every channel of a biquad cascade to zero, and clear
+// any failures.
+//
+// Parameters:
+//   bq - pointer to the filter
+void fixedpoint_biquad_reset(FixedpointBiquad *bq);
+
+// Free the memory owned by a biquad cascade.
+//
+// Parameters:
+//   bq - pointer to the filter
+void fixedpoint_biquad_destroy(FixedpointBiquad *bq);
+
+// Filter a block of samples.
+//
+// Parameters:
+//   bq - pointer to the filter
+//   in - the input samples, frames * bq->channels of them
+//   out - receives the output samples (may be the same array as in)
+//   frames - the number of frames
+void fixedpoint_biquad_process(FixedpointBiquad *bq, const Fixedpoint *in, Fixedpoint *out, size_t frames);
+
+#endif // FIXEDPOINT_FILTER_H
@@ -0,0 +1,236 @@
+#include "fixedpoint_flags.h"
+#include "fixedpoint_wide.h"
+
+// The calling thread's sticky flags
+static _Thread_local unsigned sticky_flags;
+
+// The tags that carry a negative sign, as a bit mask indexed by tag
+#define NEGATIVE_TAGS ((1u << VALID_NEGATIVE) | (1u << OVERFLOW_NEGATIVE) | (1u << UNDERFLOW_NEGATIVE))
+
+// The flag of val's tag
+static inline unsigned tag_flag(Fixedpoint val)
+{
+    return (1u << val.tag) & FIXEDPOINT_FLAGS_ALL;
+}
+
+// The sign (0 or 1) that val has in sticky-flag mode: the sign its tag
+// carries, or 0 if its magnitude mag is 0
+static inline uint64_t sign_of(Fixedpoint val, u128 mag)
+{
+    return (NEGATIVE_TAGS >> val.tag) & (mag != 0);
+}
+
+// Build a sticky-flag mode value from a magnitude and a sign (0 or 1). A zero
+// magnitude is always non-negative.
+static inline Fixedpoint make_value(u128 mag, uint64_t sign)
+{
+    Fixedpoint val;
+    val.whole = (uint64_t)(mag >> 64);
+    val.frac = (uint64_t)mag;
+    val.tag = (Tag)(sign & (mag != 0));
+    return val;
+}
+
+// Collect the flag of val's tag into *flags and retag val with its sign
+static inline Fixedpoint strip(Fixedpoint val, unsigned *flags)
+{
+    *flags |= tag_flag(val);
+    return make_value(magnitude(val), sign_of(val, magnitude(val)));
+}
+
+unsigned fixedpoint_flag_of(Tag tag)
+{
+    return (1u << tag) & FIXEDPOINT_FLAGS_ALL;
+}
+
+unsigned fixedpoint_flags_get(void)
+{
+    return sticky_flags;
+}
+
+int fixedpoint_flags_test(unsigned mask)
+{
+    return (sticky_flags & mask) != 0;
+}
+
+void fixedpoint_flags_clear(unsigned mask)
+{
+    sticky_flags &= ~mask;
+}
+
+void fixedpoint_flags_raise(unsigned flags)
+{
+    sticky_flags |= flags & FIXEDPOINT_FLAGS_ALL;
+}
+
+Fixedpoint fixedpoint_sf_value(Fixedpoint val)
+{
+    unsigned flags = 0;
+    val = strip(val, &flags);
+    sticky_flags |= flags;
+    return val;
+}
+
+Fixedpoint fixedpoint_sf_create_from_hex(const char *hex)
+{
+    return fixedpoint_sf_value(fixedpoint_create_from_hex(hex));
+}
+
+// The sticky-flag mode operations, on explicit flag words so that the batch
+// versions can keep the flags in a register. Each computes its result and
+// flags directly from the operands, without branches: the arguments' tags
+// contribute their flags and signs, and the operation raises at most one
+// flag of its own.
+
+// left + right, or left - right if negate_right is 1. The result wraps on
+// overflow, as fixedpoint_add does.
+static inline Fixedpoint sf_add_sub(Fixedpoint left, Fixedpoint right, uint64_t negate_right, unsigned *flags)
+{
+    u128 a = magnitude(left);
+    u128 b = magnitude(right);
+    uint64_t sign_a = sign_of(left, a);
+    uint64_t sign_b = sign_of(right, b) ^ negate_right;
+
+    // Same signs: add the magnitudes, overflowing on carry out
+    u128 sum = a + b;
+    uint64_t carry = sum < a;
+
+    // Different signs: subtract the magnitudes, negating on borrow
+    uint64_t borrow = a < b;
+    u128 borrow_mask = -(u128)borrow;
+    u128 diff = ((a - b) ^ borrow_mask) - borrow_mask;
+
+    uint64_t same = sign_a == sign_b;
+    u128 same_mask = -(u128)same;
+    u128 mag = (sum & same_mask) | (diff & ~same_mask);
+    uint64_t sign = sign_a ^ (borrow & !same);
+    *flags |= tag_flag(left) | tag_flag(right) | (unsigned)(carry & same) << (OVERFLOW_POSITIVE + sign_a);
+    return make_value(mag, sign);
+}
+
+static inline Fixedpoint sf_add(Fixedpoint left, Fixedpoint right, unsigned *flags)
+{
+    return sf_add_sub(left, right, 0, flags);
+}
+
+static inline Fixedpoint sf_sub(Fixedpoint left, Fixedpoint right, unsigned *flags)
+{
+    return sf_add_sub(left, right, 1, flags);
+}
+
+static inline Fixedpoint sf_negate(Fixedpoint val, unsigned *flags)
+{
+    u128 mag = magnitude(val);
+    *flags |= tag_flag(val);
+    return make_value(mag, sign_of(val, mag) ^ 1);
+}
+
+// Halve val, truncating the magnitude and raising an underflow flag if a set
+// bit is shifted out, as fixedpoint_halve does
+static inline Fixedpoint sf_halve(Fixedpoint val, unsigned *flags)
+{
+    u128 mag = magnitude(val);
+    uint64_t sign = sign_of(val, mag);
+    *flags |= tag_flag(val) | (unsigned)(mag & 1) << (UNDERFLOW_POSITIVE + sign);
+    return make_value(mag >> 1, sign);
+}
+
+// Double val, wrapping the magnitude and raising an overflow flag if a set
+// bit is shifted out, as fixedpoint_double does
+static inline Fixedpoint sf_double(Fixedpoint val, unsigned *flags)
+{
+    u128 mag = magnitude(val);
+    uint64_t sign = sign_of(val, mag);
+    *flags |= tag_flag(val) | (unsigned)(mag >> 127) << (OVERFLOW_POSITIVE + sign);
+    return make_value(mag << 1, sign);
+}
+
+Fixedpoint fixedpoint_sf_add(Fixedpoint left, Fixedpoint right)
+{
+    unsigned flags = 0;
+    Fixedpoint result = sf_add(left, right, &flags);
+    sticky_flags |= flags;
+    return result;
+}
+
+Fixedpoint fixedpoint_sf_sub(Fixedpoint left, Fixedpoint right)
+{
+    unsigned flags = 0;
+    Fixedpoint result = sf_sub(left, right, &flags);
+    sticky_flags |= flags;
+    return result;
+}
+
+Fixedpoint fixedpoint_sf_negate(Fixedpoint val)
+{
+    unsigned flags = 0;
+    Fixedpoint result = sf_negate(val, &flags);
+    sticky_flags |= flags;
+    return result;
+}
+
+Fixedpoint fixedpoint_sf_halve(Fixedpoint val)
+{
+    unsigned flags = 0;
+    Fixedpoint result = sf_halve(val, &flags);
+    sticky_flags |= flags;
+    return result;
+}
+
+Fixedpoint fixedpoint_sf_double(Fixedpoint val)
+{
+    unsigned flags = 0;
+    Fixedpoint result = sf_double(val, &flags);
+    sticky_flags |= flags;
+    return result;
+}
+
+void fixedpoint_sf_add_batch(const Fixedpoint *left, const Fixedpoint *right, Fixedpoint *out, size_t n)
+{
+    unsigned flags = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        out[i] = sf_add(left[i], right[i], &flags);
+    }
+    sticky_flags |= flags;
+}
+
+void fixedpoint_sf_sub_batch(const Fixedpoint *left, const Fixedpoint *right, Fixedpoint *out, size_t n)
+{
+    unsigned flags = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        out[i] = sf_sub(left[i], right[i], &flags);
+    }
+    sticky_flags |= flags;
+}
+
+void fixedpoint_sf_negate_batch(const Fixedpoint *vals, Fixedpoint *out, size_t n)
+{
+    unsigned flags = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        out[i] = sf_negate(vals[i], &flags);
+    }
+    sticky_flags |= flags;
+}
+
+void fixedpoint_sf_halve_batch(const Fixedpoint *vals, Fixedpoint *out, size_t n)
+{
+    unsigned flags = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        out[i] = sf_halve(vals[i], &flags);
+    }
+    sticky_flags |= flags;
+}
+
+void fixedpoint_sf_double_batch(const Fixedpoint *vals, Fixedpoint *out, size_t n)
+{
+    unsigned flags = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        out[i] = sf_double(vals[i], &flags);
+    }
+    sticky_flags |= flags;
+}
@@ -0,0 +1,117 @@
+#ifndef FIXEDPOINT_FLAGS_H
+#define FIXEDPOINT_FLAGS_H
+
+#include <stddef.h>
+#include "fixedpoint.h"
+
+// Sticky status flags.
+//
+// In sticky-flag mode (the fixedpoint_sf_* functions) results are always
+// tagged VALID_NONNEGATIVE or VALID_NEGATIVE, giving only the numeric value
+// and its sign. Any other tag the corresponding regular operation would have
+// produced is instead ORed into a thread-local flag word, IEEE 754 style,
+// where it stays until cleared. Callers test and clear the flags once per
+// batch rather than checking each result.
+//
+// Each flag is the bit (1 << tag) of the Tag it stands for, so a flag word
+// maps exactly onto the Tag enum: fixedpoint_sf_add raises
+// FIXEDPOINT_FLAG_OVERFLOW_POSITIVE exactly when fixedpoint_add would have
+// returned a value for which fixedpoint_is_overflow_pos is true, and so on.
+// The numeric value returned is the same whole and frac fixedpoint_add
+// would have returned (e.g. the wrapped magnitude after an overflow).
+#define FIXEDPOINT_FLAG_ERROR (1u << ERROR)
+#define FIXEDPOINT_FLAG_OVERFLOW_POSITIVE (1u << OVERFLOW_POSITIVE)
+#define FIXEDPOINT_FLAG_OVERFLOW_NEGATIVE (1u << OVERFLOW_NEGATIVE)
+#define FIXEDPOINT_FLAG_UNDERFLOW_POSITIVE (1u << UNDERFLOW_POSITIVE)
+#define FIXEDPOINT_FLAG_UNDERFLOW_NEGATIVE (1u << UNDERFLOW_NEGATIVE)
+#define FIXEDPOINT_FLAG_OVERFLOW (FIXEDPOINT_FLAG_OVERFLOW_POSITIVE | FIXEDPOINT_FLAG_OVERFLOW_NEGATIVE)
+#define FIXEDPOINT_FLAG_UNDERFLOW (FIXEDPOINT_FLAG_UNDERFLOW_POSITIVE | FIXEDPOINT_FLAG_UNDERFLOW_NEGATIVE)
+#define FIXEDPOINT_FLAGS_ALL (FIXEDPOINT_FLAG_ERROR | FIXEDPOINT_FLAG_OVERFLOW | FIXEDPOINT_FLAG_UNDERFLOW)
+
+// Get the flag that corresponds to a tag.
+//
+// Parameters:
+//   tag - the tag
+//
+// Returns:
+//   the flag for tag, or 0 if tag is VALID_NONNEGATIVE or VALID_NEGATIVE
+unsigned fixedpoint_flag_of(Tag tag);
+
+// Get the calling thread's sticky flags.
+//
+// Returns:
+//   the flags raised since they were last cleared
+unsigned fixedpoint_flags_get(void);
+
+// Test the calling thread's sticky flags.
+//
+// Parameters:
+//   mask - the flags to test
+//
+// Returns:
+//   1 if any of the flags in mask are raised;
+//   0 otherwise
+int fixedpoint_flags_test(unsigned mask);
+
+// Clear some of the calling thread's sticky flags.
+//
+// Parameters:
+//   mask - the flags to clear (FIXEDPOINT_FLAGS_ALL clears every flag)
+void fixedpoint_flags_clear(unsigned mask);
+
+// Raise some of the calling thread's sticky flags.
+//
+// Parameters:
+//   flags - the flags to raise
+void fixedpoint_flags_raise(unsigned flags);
+
+// Convert a tagged Fixedpoint value to sticky-flag mode: the flag for its
+// tag (if any) is raised, and the value is returned tagged with just its sign.
+// A negative zero is returned as VALID_NONNEGATIVE.
+//
+// Parameters:
+//   val - the Fixedpoint value
+//
+// Returns:
+//   val, tagged VALID_NONNEGATIVE or VALID_NEGATIVE
+Fixedpoint fixedpoint_sf_value(Fixedpoint val);
+
+// Create a Fixedpoint value from a string representation in sticky-flag
+// mode. See fixedpoint_create_from_hex; an invalid string raises
+// FIXEDPOINT_FLAG_ERROR and returns 0.
+//
+// Parameters:
+//   hex - the string representation
+//
+// Returns:
+//   the Fixedpoint value
+Fixedpoint fixedpoint_sf_create_from_hex(const char *hex);
+
+// Sticky-flag mode versions of fixedpoint_add, fixedpoint_sub,
+// fixedpoint_negate, fixedpoint_halve and fixedpoint_double. Each returns
+// the same numeric value as the regular operation, tagged only with its
+// sign, and raises the flag of the tag the regular operation would have
+// returned. Arguments carrying a non-valid tag raise their flag and are
+// treated as their sign.
+Fixedpoint fixedpoint_sf_add(Fixedpoint left, Fixedpoint right);
+Fixedpoint fixedpoint_sf_sub(Fixedpoint left, Fixedpoint right);
+Fixedpoint fixedpoint_sf_negate(Fixedpoint val);
+Fixedpoint fixedpoint_sf_halve(Fixedpoint val);
+Fixedpoint fixedpoint_sf_double(Fixedpoint val);
+
+// Batch versions of the sticky-flag mode operations. out[i] is the result
+// of the operation on element i of the inputs; the flags raised by all
+// elements are collected in a register and ORed into the thread's flag
+// word once, at the end of the batch. out may alias an input.
+//
+// Parameters:
+//   left, right, vals - the input arrays
+//   out - the output array
+//   n - the number of elements
+void fixedpoint_sf_add_batch(const Fixedpoint *left, const Fixedpoint *right, Fixedpoint *out, size_t n);
+void fixedpoint_sf_sub_batch(const Fixedpoint *left, const Fixedpoint *right, Fixedpoint *out, size_t n);
+void fixedpoint_sf_negate_batch(const Fixedpoint *vals, Fixedpoint *out, size_t n);
+void fixedpoint_sf_halve_batch(const Fixedpoint *vals, Fixedpoint *out, size_t n);
+void fixedpoint_sf_double_batch(const Fixedpoint *vals, Fixedpoint *out, size_t n);
+
+#endif // FIXEDPOINT_FLAGS_H
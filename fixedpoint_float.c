@@ -0,0 +1,286 @@
+#include <float.h>
+#include <string.h>
+#include "fixedpoint_float.h"
+
+__extension__ typedef unsigned __int128 u128;
+
+// Kinds of value a floating point number can hold
+typedef enum
+{
+    FLOAT_FINITE,
+    FLOAT_INFINITE,
+    FLOAT_NAN
+} FloatKind;
+
+// Build a Fixedpoint value from a finite float (-1)^sign * mant * 2^exp
+static Fixedpoint from_parts(int sign, u128 mant, int exp, FixedpointRound mode)
+{
+    Fixedpoint val;
+    val.whole = (uint64_t)(mant >> 64);
+    val.frac = (uint64_t)mant;
+    val.tag = sign && mant != 0 ? VALID_NEGATIVE : VALID_NONNEGATIVE;
+
+    // The Fixedpoint magnitude is in units of 2^-64
+    long shift = (long)exp + 64;
+    if (shift >= 0)
+    {
+        return fixedpoint_shl(val, shift > 128 ? 128 : (unsigned)shift);
+    }
+    return fixedpoint_shr(val, -shift > 128 ? 129 : (unsigned)-shift, mode, NULL);
+}
+
+// Build the Fixedpoint value for an infinity or NaN
+static Fixedpoint from_special(int sign, FloatKind kind)
+{
+    Fixedpoint val = fixedpoint_create(0);
+    if (kind == FLOAT_NAN)
+    {
+        val.tag = ERROR;
+    }
+    else
+    {
+        val.tag = sign ? OVERFLOW_NEGATIVE : OVERFLOW_POSITIVE;
+    }
+    return val;
+}
+
+// Classify a Fixedpoint value for conversion to floating point
+static FloatKind kind_of(Fixedpoint val)
+{
+    if (val.tag == ERROR)
+    {
+        return FLOAT_NAN;
+    }
+    if (val.tag == OVERFLOW_POSITIVE || val.tag == OVERFLOW_NEGATIVE)
+    {
+        return FLOAT_INFINITE;
+    }
+    return FLOAT_FINITE;
+}
+
+// Round the magnitude of val to a significand of precision bits, rounding
+// to nearest with ties to even. On return |val| ~= *sig * 2^*exp, where
+// 2^(precision - 1) <= *sig < 2^precision.
+//
+// Returns:
+//   1 if val is nonzero; 0 if it is zero
+static int round_to_precision(Fixedpoint val, int precision, u128 *sig, int *exp)
+{
+    int top = 127 - fixedpoint_clz(val);
+    if (top < 0)
+    {
+        return 0;
+    }
+
+    val.tag = VALID_NONNEGATIVE;
+    int shift = top + 1 - precision;
+    u128 m;
+    if (shift > 0)
+    {
+        Fixedpoint rounded = fixedpoint_shr(val, shift, FIXEDPOINT_ROUND_NEAREST_EVEN, NULL);
+        m = (u128)rounded.whole << 64 | rounded.frac;
+        if (m >> precision)
+        {
+            // Rounding carried into a new leading bit
+            m >>= 1;
+            shift++;
+        }
+    }
+    else
+    {
+        m = ((u128)val.whole << 64 | val.frac) << -shift;
+    }
+
+    *sig = m;
+    *exp = shift - 64;
+    return 1;
+}
+
+Fixedpoint fixedpoint_from_double(double x, FixedpointRound mode)
+{
+    uint64_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    int sign = (int)(bits >> 63);
+    int biased = (int)(bits >> 52) & 0x7ff;
+    uint64_t fraction = bits & 0xfffffffffffffUL;
+
+    if (biased == 0x7ff)
+    {
+        return from_special(sign, fraction != 0 ? FLOAT_NAN : FLOAT_INFINITE);
+    }
+    if (biased == 0)
+    {
+        // Zero or subnormal
+        return from_parts(sign, fraction, -1074, mode);
+    }
+    return from_parts(sign, fraction | (1UL << 52), biased - 1075, mode);
+}
+
+double fixedpoint_to_double(Fixedpoint val)
+{
+    uint64_t bits = 0;
+    uint64_t sign = (uint64_t)(val.tag == VALID_NEGATIVE || val.tag == OVERFLOW_NEGATIVE ||
+                               val.tag == UNDERFLOW_NEGATIVE) << 63;
+    FloatKind kind = kind_of(val);
+    u128 sig;
+    int exp;
+
+    if (kind == FLOAT_NAN)
+    {
+        bits = 0x7ff8000000000000UL;
+    }
+    else if (kind == FLOAT_INFINITE)
+    {
+        bits = sign | 0x7ff0000000000000UL;
+    }
+    else if (round_to_precision(val, 53, &sig, &exp))
+    {
+        bits = sign | (uint64_t)(exp + 52 + 1023) << 52 | ((uint64_t)sig & 0xfffffffffffffUL);
+    }
+
+    double x;
+    memcpy(&x, &bits, sizeof(x));
+    return x;
+}
+
+#if defined(__SIZEOF_FLOAT128__) || LDBL_MANT_DIG == 113
+// Fields of an IEEE binary128 value
+#define BINARY128_FRACTION_MASK (((u128)1 << 112) - 1)
+
+static Fixedpoint from_binary128_bits(u128 bits, FixedpointRound mode)
+{
+    int sign = (int)(bits >> 127);
+    int biased = (int)(bits >> 112) & 0x7fff;
+    u128 fraction = bits & BINARY128_FRACTION_MASK;
+
+    if (biased == 0x7fff)
+    {
+        return from_special(sign, fraction != 0 ? FLOAT_NAN : FLOAT_INFINITE);
+    }
+    if (biased == 0)
+    {
+        return from_parts(sign, fraction, -16494, mode);
+    }
+    return from_parts(sign, fraction | ((u128)1 << 112), biased - 16495, mode);
+}
+
+static u128 to_binary128_bits(Fixedpoint val)
+{
+    u128 sign = (u128)(val.tag == VALID_NEGATIVE || val.tag == OVERFLOW_NEGATIVE ||
+                       val.tag == UNDERFLOW_NEGATIVE) << 127;
+    FloatKind kind = kind_of(val);
+    u128 sig;
+    int exp;
+
+    if (kind == FLOAT_NAN)
+    {
+        return (u128)0xffff << 111;
+    }
+    if (kind == FLOAT_INFINITE)
+    {
+        return sign | (u128)0x7fff << 112;
+    }
+    if (round_to_precision(val, 113, &sig, &exp))
+    {
+        return sign | (u128)(exp + 112 + 16383) << 112 | (sig & BINARY128_FRACTION_MASK);
+    }
+    return 0;
+}
+#endif
+
+#if defined(__SIZEOF_FLOAT128__)
+Fixedpoint fixedpoint_from_float128(__float128 x, FixedpointRound mode)
+{
+    u128 bits;
+    memcpy(&bits, &x, sizeof(bits));
+    return from_binary128_bits(bits, mode);
+}
+
+__float128 fixedpoint_to_float128(Fixedpoint val)
+{
+    u128 bits = to_binary128_bits(val);
+    __float128 x;
+    memcpy(&x, &bits, sizeof(x));
+    return x;
+}
+#endif
+
+#if LDBL_MANT_DIG == 64
+// The x87 80 bit extended format: a 64 bit significand with an explicit
+// integer bit, followed by the sign and a 15 bit exponent
+typedef struct
+{
+    uint64_t significand;
+    uint16_t sign_exponent;
+} X87Bits;
+
+Fixedpoint fixedpoint_from_long_double(long double x, FixedpointRound mode)
+{
+    X87Bits bits;
+    memcpy(&bits, &x, 10);
+    int sign = bits.sign_exponent >> 15;
+    int biased = bits.sign_exponent & 0x7fff;
+
+    if (biased == 0x7fff)
+    {
+        return from_special(sign, (bits.significand << 1) != 0 ? FLOAT_NAN : FLOAT_INFINITE);
+    }
+    // The integer bit is explicit, so subnormals only differ in the exponent
+    return from_parts(sign, bits.significand, (biased == 0 ? 1 : biased) - 16446, mode);
+}
+
+long double fixedpoint_to_long_double(Fixedpoint val)
+{
+    X87Bits bits = {0, 0};
+    uint16_t sign = (uint16_t)((val.tag == VALID_NEGATIVE || val.tag == OVERFLOW_NEGATIVE ||
+                                val.tag == UNDERFLOW_NEGATIVE) << 15);
+    FloatKind kind = kind_of(val);
+    u128 sig;
+    int exp;
+
+    if (kind == FLOAT_NAN)
+    {
+        bits.significand = 0xc000000000000000UL;
+        bits.sign_exponent = 0x7fff;
+    }
+    else if (kind == FLOAT_INFINITE)
+    {
+        bits.significand = 0x8000000000000000UL;
+        bits.sign_exponent = sign | 0x7fff;
+    }
+    else if (round_to_precision(val, 64, &sig, &exp))
+    {
+        bits.significand = (uint64_t)sig;
+        bits.sign_exponent = sign | (uint16_t)(exp + 63 + 16383);
+    }
+
+    long double x = 0;
+    memcpy(&x, &bits, 10);
+    return x;
+}
+#elif LDBL_MANT_DIG == 113
+Fixedpoint fixedpoint_from_long_double(long double x, FixedpointRound mode)
+{
+    u128 bits;
+    memcpy(&bits, &x, sizeof(bits));
+    return from_binary128_bits(bits, mode);
+}
+
+long double fixedpoint_to_long_double(Fixedpoint val)
+{
+    u128 bits = to_binary128_bits(val);
+    long double x;
+    memcpy(&x, &bits, sizeof(x));
+    return x;
+}
+#else
+Fixedpoint fixedpoint_from_long_double(long double x, FixedpointRound mode)
+{
+    return fixedpoint_from_double((double)x, mode);
+}
+
+long double fixedpoint_to_long_double(Fixedpoint val)
+{
+    return fixedpoint_to_double(val);
+}
+#endif
@@ -0,0 +1,61 @@
+#ifndef FIXEDPOINT_FLOAT_H
+#define FIXEDPOINT_FLOAT_H
+
+#include "fixedpoint.h"
+
+// Conversions between Fixedpoint values and binary floating point.
+//
+// These work directly on the sign, exponent and significand bits of the
+// IEEE 754 representation; no floating point arithmetic is involved, so
+// the results are exact (or correctly rounded) and identical on every
+// machine. Every finite Fixedpoint value lies well inside the normal range
+// of all the floating point formats, so subnormals only occur as inputs.
+
+// Convert a double to a Fixedpoint value.
+//
+// Parameters:
+//   x - the value to convert
+//   mode - how to round if x has bits below 2^-64
+//
+// Returns:
+//   x, rounded according to mode (with FIXEDPOINT_ROUND_EXACT, a value for
+//   which fixedpoint_is_underflow_pos or fixedpoint_is_underflow_neg returns
+//   true if bits were lost);
+//   if |x| is too large to represent (including infinity), a value for which
+//   fixedpoint_is_overflow_pos or fixedpoint_is_overflow_neg returns true;
+//   if x is NaN, a value for which fixedpoint_is_err returns true
+Fixedpoint fixedpoint_from_double(double x, FixedpointRound mode);
+
+// Convert a long double to a Fixedpoint value. See fixedpoint_from_double.
+// Supports the x87 80 bit extended format, IEEE binary128 and IEEE double,
+// whichever the compiler uses for long double.
+Fixedpoint fixedpoint_from_long_double(long double x, FixedpointRound mode);
+
+// Convert a Fixedpoint value to a double, rounding to nearest (ties to
+// even), the IEEE 754 default.
+//
+// Parameters:
+//   val - the Fixedpoint value
+//
+// Returns:
+//   val correctly rounded to a double, if val is valid or an underflow value;
+//   +infinity or -infinity if val is an overflow value;
+//   NaN if val is an error value
+double fixedpoint_to_double(Fixedpoint val);
+
+// Convert a Fixedpoint value to a long double. See fixedpoint_to_double.
+// With the x87 or binary128 formats the conversion is exact for every
+// value with at most 64 or 113 significant bits, respectively.
+long double fixedpoint_to_long_double(Fixedpoint val);
+
+#if defined(__SIZEOF_FLOAT128__)
+// Convert an IEEE binary128 value to a Fixedpoint value.
+// See fixedpoint_from_double.
+Fixedpoint fixedpoint_from_float128(__float128 x, FixedpointRound mode);
+
+// Convert a Fixedpoint value to IEEE binary128, rounding to nearest (ties
+// to even). See fixedpoint_to_double.
+__float128 fixedpoint_to_float128(Fixedpoint val);
+#endif
+
+#endif // FIXEDPOINT_FLOAT_H
@@ -0,0 +1,423 @@
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "fixedpoint_groupby.h"
+#include "fixedpoint_hash.h"
+
+// Smallest number of probe slots a table will allocate
+#define GROUPBY_MIN_CAPACITY 16
+
+// Number of partitions per thread in the parallel mode, so that threads
+// that finish early can be given more work by the round-robin assignment
+#define PARTITIONS_PER_THREAD 4
+
+static int allocate_slots(FixedpointGroupBy *gb, size_t capacity)
+{
+    uint32_t *slots = calloc(capacity, sizeof(uint32_t));
+    int64_t *slot_keys = malloc(capacity * sizeof(int64_t));
+    if (slots == NULL || slot_keys == NULL)
+    {
+        free(slots);
+        free(slot_keys);
+        return 0;
+    }
+    gb->slots = slots;
+    gb->slot_keys = slot_keys;
+    gb->capacity = capacity;
+    return 1;
+}
+
+// Find the slot of the group with the given key, or the empty slot where it
+// would be inserted
+static size_t find_slot(const FixedpointGroupBy *gb, int64_t key)
+{
+    size_t mask = gb->capacity - 1;
+    size_t i = fixedpoint_hash_mix((uint64_t)key) & mask;
+    while (gb->slots[i] != 0 && gb->slot_keys[i] != key)
+    {
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+// Double the number of probe slots and reinsert every group
+static int grow_slots(FixedpointGroupBy *gb)
+{
+    uint32_t *old_slots = gb->slots;
+    int64_t *old_keys = gb->slot_keys;
+    size_t old_capacity = gb->capacity;
+    if (!allocate_slots(gb, old_capacity * 2))
+    {
+        return 0;
+    }
+
+    for (size_t i = 0; i < old_capacity; ++i)
+    {
+        if (old_slots[i] != 0)
+        {
+            size_t j = find_slot(gb, old_keys[i]);
+            gb->slots[j] = old_slots[i];
+            gb->slot_keys[j] = old_keys[i];
+        }
+    }
+
+    free(old_slots);
+    free(old_keys);
+    return 1;
+}
+
+// Find the state of the group with the given key, creating an empty group
+// if there is none
+static FixedpointGroupState *find_group(FixedpointGroupBy *gb, int64_t key)
+{
+    size_t i = find_slot(gb, key);
+    if (gb->slots[i] != 0)
+    {
+        return &gb->groups[gb->slots[i] - 1];
+    }
+
+    if (gb->num_groups == UINT32_MAX - 1)
+    {
+        return NULL;
+    }
+    if ((gb->num_groups + 1) * 4 > gb->capacity * 3)
+    {
+        if (!grow_slots(gb))
+        {
+            return NULL;
+        }
+        i = find_slot(gb, key);
+    }
+    if (gb->num_groups == gb->groups_capacity)
+    {
+        size_t new_capacity = gb->groups_capacity * 2;
+        FixedpointGroupState *groups = realloc(gb->groups, new_capacity * sizeof(FixedpointGroupState));
+        if (groups == NULL)
+        {
+            return NULL;
+        }
+        gb->groups = groups;
+        gb->groups_capacity = new_capacity;
+    }
+
+    FixedpointGroupState *group = &gb->groups[gb->num_groups++];
+    group->key = key;
+    fixedpoint_accum_init(&group->sum);
+    group->min = fixedpoint_create(0);
+    group->min.tag = ERROR;
+    group->max = group->min;
+    group->count = 0;
+
+    gb->slots[i] = gb->num_groups;
+    gb->slot_keys[i] = key;
+    return group;
+}
+
+// Fold a candidate minimum and maximum into a group; ERROR marks "no value"
+static void update_min_max(FixedpointGroupState *group, Fixedpoint min, Fixedpoint max)
+{
+    if (fixedpoint_is_valid(min) && (group->min.tag == ERROR || fixedpoint_compare(min, group->min) < 0))
+    {
+        group->min = min;
+    }
+    if (fixedpoint_is_valid(max) && (group->max.tag == ERROR || fixedpoint_compare(max, group->max) > 0))
+    {
+        group->max = max;
+    }
+}
+
+int fixedpoint_groupby_init(FixedpointGroupBy *gb, size_t capacity_hint)
+{
+    size_t capacity = GROUPBY_MIN_CAPACITY;
+    while (capacity / 4 * 3 < capacity_hint)
+    {
+        // Stop before the size of the slots or the groups overflows
+        if (capacity > SIZE_MAX / 2 / sizeof(FixedpointGroupState))
+        {
+            return 0;
+        }
+        capacity *= 2;
+    }
+    if (!allocate_slots(gb, capacity))
+    {
+        return 0;
+    }
+
+    gb->groups_capacity = capacity / 4 * 3;
+    gb->groups = malloc(gb->groups_capacity * sizeof(FixedpointGroupState));
+    gb->num_groups = 0;
+    if (gb->groups == NULL)
+    {
+        free(gb->slots);
+        free(gb->slot_keys);
+        return 0;
+    }
+    return 1;
+}
+
+void fixedpoint_groupby_destroy(FixedpointGroupBy *gb)
+{
+    free(gb->slots);
+    free(gb->slot_keys);
+    free(gb->groups);
+    gb->slots = NULL;
+    gb->slot_keys = NULL;
+    gb->groups = NULL;
+    gb->capacity = 0;
+    gb->num_groups = 0;
+    gb->groups_capacity = 0;
+}
+
+int fixedpoint_groupby_update(FixedpointGroupBy *gb, const int64_t *keys, const Fixedpoint *values, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+    {
+        FixedpointGroupState *group = find_group(gb, keys[i]);
+        if (group == NULL)
+        {
+            return 0;
+        }
+        fixedpoint_accum_add(&group->sum, values[i]);
+        update_min_max(group, values[i], values[i]);
+        group->count++;
+    }
+    return 1;
+}
+
+int fixedpoint_groupby_merge(FixedpointGroupBy *gb, const FixedpointGroupBy *other)
+{
+    for (size_t i = 0; i < other->num_groups; ++i)
+    {
+        const FixedpointGroupState *src = &other->groups[i];
+        FixedpointGroupState *group = find_group(gb, src->key);
+        if (group == NULL)
+        {
+            return 0;
+        }
+        fixedpoint_accum_merge(&group->sum, &src->sum);
+        update_min_max(group, src->min, src->max);
+        group->count += src->count;
+    }
+    return 1;
+}
+
+// Shared state of one parallel aggregation
+typedef struct
+{
+    const int64_t *keys;
+    const Fixedpoint *values;
+    size_t n;
+    unsigned num_threads;
+    unsigned num_partitions;
+    // counts[t * num_partitions + p]: rows of thread t's chunk in partition p,
+    // replaced by the scatter offsets before the scatter phase
+    size_t *counts;
+    // start of each partition in rows, plus one end marker
+    size_t *partition_start;
+    // row indices, grouped by partition
+    size_t *rows;
+    // one table per thread
+    FixedpointGroupBy *tables;
+    int failed;
+} ParallelGroupBy;
+
+typedef struct
+{
+    ParallelGroupBy *shared;
+    unsigned thread;
+} GroupByWorker;
+
+static unsigned partition_of(const ParallelGroupBy *pg, int64_t key)
+{
+    // Use the high bits so the partition is independent of the probe position
+    return (unsigned)((fixedpoint_hash_mix((uint64_t)key) >> 32) % pg->num_partitions);
+}
+
+static void chunk_bounds(const ParallelGroupBy *pg, unsigned thread, size_t *lo, size_t *hi)
+{
+    *lo = pg->n * thread / pg->num_threads;
+    *hi = pg->n * (thread + 1) / pg->num_threads;
+}
+
+static void *count_worker(void *arg)
+{
+    GroupByWorker *worker = arg;
+    ParallelGroupBy *pg = worker->shared;
+    size_t *counts = &pg->counts[(size_t)worker->thread * pg->num_partitions];
+    size_t lo, hi;
+    chunk_bounds(pg, worker->thread, &lo, &hi);
+    for (size_t i = lo; i < hi; ++i)
+    {
+        counts[partition_of(pg, pg->keys[i])]++;
+    }
+    return NULL;
+}
+
+static void *scatter_worker(void *arg)
+{
+    GroupByWorker *worker = arg;
+    ParallelGroupBy *pg = worker->shared;
+    size_t *offsets = &pg->counts[(size_t)worker->thread * pg->num_partitions];
+    size_t lo, hi;
+    chunk_bounds(pg, worker->thread, &lo, &hi);
+    for (size_t i = lo; i < hi; ++i)
+    {
+        pg->rows[offsets[partition_of(pg, pg->keys[i])]++] = i;
+    }
+    return NULL;
+}
+
+static void *aggregate_worker(void *arg)
+{
+    GroupByWorker *worker = arg;
+    ParallelGroupBy *pg = worker->shared;
+    FixedpointGroupBy *table = &pg->tables[worker->thread];
+    for (unsigned p = worker->thread; p < pg->num_partitions; p += pg->num_threads)
+    {
+        for (size_t r = pg->partition_start[p]; r < pg->partition_start[p + 1]; ++r)
+        {
+            size_t i = pg->rows[r];
+            if (!fixedpoint_groupby_update(table, &pg->keys[i], &pg->values[i], 1))
+            {
+                pg->failed = 1;
+                return NULL;
+            }
+        }
+    }
+    return NULL;
+}
+
+// Run fn on every thread and wait for all of them
+static int run_workers(GroupByWorker *workers, pthread_t *threads, unsigned num_threads, void *(*fn)(void *))
+{
+    unsigned started = 0;
+    int ok = 1;
+    for (; started < num_threads; ++started)
+    {
+        if (pthread_create(&threads[started], NULL, fn, &workers[started]) != 0)
+        {
+            ok = 0;
+            break;
+        }
+    }
+    for (unsigned t = 0; t < started; ++t)
+    {
+        pthread_join(threads[t], NULL);
+    }
+    return ok;
+}
+
+int fixedpoint_groupby_update_parallel(FixedpointGroupBy *gb, const int64_t *keys, const Fixedpoint *values,
+                                       size_t n, unsigned num_threads)
+{
+    if (num_threads <= 1 || n < num_threads)
+    {
+        return fixedpoint_groupby_update(gb, keys, values, n);
+    }
+
+    ParallelGroupBy pg;
+    pg.keys = keys;
+    pg.values = values;
+    pg.n = n;
+    pg.num_threads = num_threads;
+    pg.num_partitions = num_threads * PARTITIONS_PER_THREAD;
+    pg.counts = calloc((size_t)num_threads * pg.num_partitions, sizeof(size_t));
+    pg.partition_start = malloc((pg.num_partitions + 1) * sizeof(size_t));
+    pg.rows = malloc(n * sizeof(size_t));
+    pg.tables = calloc(num_threads, sizeof(FixedpointGroupBy));
+    pg.failed = 0;
+    GroupByWorker *workers = malloc(num_threads * sizeof(GroupByWorker));
+    pthread_t *threads = malloc(num_threads * sizeof(pthread_t));
+
+    unsigned tables_initialized = 0;
+    int ok = pg.counts != NULL && pg.partition_start != NULL && pg.rows != NULL && pg.tables != NULL &&
+             workers != NULL && threads != NULL;
+    for (; ok && tables_initialized < num_threads; ++tables_initialized)
+    {
+        ok = fixedpoint_groupby_init(&pg.tables[tables_initialized], 0);
+    }
+    if (!ok && tables_initialized > 0)
+    {
+        // The last init failed and owns no memory
+        tables_initialized--;
+    }
+
+    if (ok)
+    {
+        for (unsigned t = 0; t < num_threads; ++t)
+        {
+            workers[t].shared = &pg;
+            workers[t].thread = t;
+        }
+        ok = run_workers(workers, threads, num_threads, count_worker);
+    }
+
+    if (ok)
+    {
+        // Turn the counts into scatter offsets: partitions are laid out in
+        // order, and within a partition the threads' rows are in thread
+        // order, so every partition lists its rows in input order
+        size_t offset = 0;
+        for (unsigned p = 0; p < pg.num_partitions; ++p)
+        {
+            pg.partition_start[p] = offset;
+            for (unsigned t = 0; t < num_threads; ++t)
+            {
+                size_t *count = &pg.counts[(size_t)t * pg.num_partitions + p];
+                size_t c = *count;
+                *count = offset;
+                offset += c;
+            }
+        }
+        pg.partition_start[pg.num_partitions] = offset;
+
+        ok = run_workers(workers, threads, num_threads, scatter_worker) &&
+             run_workers(workers, threads, num_threads, aggregate_worker) && !pg.failed;
+    }
+
+    // The partitions hold disjoint sets of keys, so merging the per-thread
+    // tables only inserts new groups (or folds into groups gb already had)
+    for (unsigned t = 0; ok && t < num_threads; ++t)
+    {
+        ok = fixedpoint_groupby_merge(gb, &pg.tables[t]);
+    }
+
+    for (unsigned t = 0; t < tables_initialized; ++t)
+    {
+        fixedpoint_groupby_destroy(&pg.tables[t]);
+    }
+    free(pg.counts);
+    free(pg.partition_start);
+    free(pg.rows);
+    free(pg.tables);
+    free(workers);
+    free(threads);
+    return ok;
+}
+
+size_t fixedpoint_groupby_size(const FixedpointGroupBy *gb)
+{
+    return gb->num_groups;
+}
+
+static int compare_group_keys(const void *left, const void *right)
+{
+    int64_t l = ((const FixedpointGroup *)left)->key;
+    int64_t r = ((const FixedpointGroup *)right)->key;
+    return (l > r) - (l < r);
+}
+
+size_t fixedpoint_groupby_results(const FixedpointGroupBy *gb, FixedpointGroup *out)
+{
+    for (size_t i = 0; i < gb->num_groups; ++i)
+    {
+        const FixedpointGroupState *group = &gb->groups[i];
+        out[i].key = group->key;
+        out[i].sum = fixedpoint_accum_result(&group->sum);
+        out[i].min = group->min;
+        out[i].max = group->max;
+        out[i].count = group->count;
+    }
+    qsort(out, gb->num_groups, sizeof(FixedpointGroup), compare_group_keys);
+    return gb->num_groups;
+}
@@ -0,0 +1,153 @@
+#ifndef FIXEDPOINT_GROUPBY_H
+#define FIXEDPOINT_GROUPBY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "fixedpoint.h"
+#include "fixedpoint_accum.h"
+
+// The aggregates computed for one group.
+//
+// Fields:
+//  key - the group key
+//  sum - the exact sum of the group's values (see fixedpoint_accum_result)
+//  min - the smallest valid value in the group, or an ERROR value if the
+//        group has no valid values
+//  max - the largest valid value in the group, or an ERROR value if the
+//        group has no valid values
+//  count - the number of rows in the group (including non-valid values)
+typedef struct
+{
+    int64_t key;
+    Fixedpoint sum;
+    Fixedpoint min;
+    Fixedpoint max;
+    uint64_t count;
+} FixedpointGroup;
+
+// The running state of one group inside a FixedpointGroupBy.
+//
+// Fields:
+//  key - the group key
+//  sum - the exact running sum
+//  min - the smallest valid value seen so far (tag ERROR if none)
+//  max - the largest valid value seen so far (tag ERROR if none)
+//  count - the number of rows seen so far
+typedef struct
+{
+    int64_t key;
+    FixedpointAccum sum;
+    Fixedpoint min;
+    Fixedpoint max;
+    uint64_t count;
+} FixedpointGroupState;
+
+// A hash table that aggregates Fixedpoint values by integer key.
+// The probe table only holds indices into a dense array of group states, so
+// a probe touches a small, densely packed array and the states of the
+// groups are stored contiguously in the order they were first seen.
+//
+// Fields:
+//  slots - the probe table; each entry is a group index plus 1, or 0 if empty
+//  slot_keys - the key of the group referenced by each slot
+//  capacity - the number of slots, always a power of 2
+//  groups - the dense array of group states
+//  num_groups - the number of groups
+//  groups_capacity - the allocated length of groups
+typedef struct
+{
+    uint32_t *slots;
+    int64_t *slot_keys;
+    size_t capacity;
+    FixedpointGroupState *groups;
+    size_t num_groups;
+    size_t groups_capacity;
+} FixedpointGroupBy;
+
+// Initialize an empty group-by table.
+//
+// Parameters:
+//   gb - pointer to the table to initialize
+//   capacity_hint - the number of groups expected
+//
+// Returns:
+//   1 if successful;
+//   0 if memory could not be allocated
+int fixedpoint_groupby_init(FixedpointGroupBy *gb, size_t capacity_hint);
+
+// Free the memory owned by a group-by table.
+//
+// Parameters:
+//   gb - pointer to the table to destroy
+void fixedpoint_groupby_destroy(FixedpointGroupBy *gb);
+
+// Aggregate a batch of rows into a group-by table. This may be called any
+// number of times to aggregate a stream of batches.
+// Each group's sum is exact, and equals the result of adding the group's
+// values in order with fixedpoint_add whenever none of those intermediate
+// sums overflow. min and max are the results of comparing the group's valid
+// values with fixedpoint_compare.
+//
+// Parameters:
+//   gb - pointer to the table
+//   keys - the key of each row
+//   values - the value of each row
+//   n - the number of rows
+//
+// Returns:
+//   1 if successful;
+//   0 if memory could not be allocated (the table then holds some prefix
+//   of the rows)
+int fixedpoint_groupby_update(FixedpointGroupBy *gb, const int64_t *keys, const Fixedpoint *values, size_t n);
+
+// Merge the groups of one table into another. Aggregating two inputs into
+// separate tables and merging them gives the same result as aggregating
+// both into one table.
+//
+// Parameters:
+//   gb - pointer to the table to merge into
+//   other - pointer to the table to merge
+//
+// Returns:
+//   1 if successful;
+//   0 if memory could not be allocated
+int fixedpoint_groupby_merge(FixedpointGroupBy *gb, const FixedpointGroupBy *other);
+
+// Aggregate rows using several threads. The rows are first scattered into
+// partitions by key hash, then each thread aggregates whole partitions, so
+// no two threads ever touch the same group. The result is identical to
+// aggregating all rows with fixedpoint_groupby_update.
+//
+// Parameters:
+//   gb - pointer to an initialized table to aggregate into
+//   keys - the key of each row
+//   values - the value of each row
+//   n - the number of rows
+//   num_threads - the number of threads to use (0 or 1 aggregates serially)
+//
+// Returns:
+//   1 if successful;
+//   0 if memory or threads could not be allocated
+int fixedpoint_groupby_update_parallel(FixedpointGroupBy *gb, const int64_t *keys, const Fixedpoint *values,
+                                       size_t n, unsigned num_threads);
+
+// Get the number of groups in a group-by table.
+//
+// Parameters:
+//   gb - pointer to the table
+//
+// Returns:
+//   the number of groups
+size_t fixedpoint_groupby_size(const FixedpointGroupBy *gb);
+
+// Get the aggregates of every group, sorted by key.
+//
+// Parameters:
+//   gb - pointer to the table
+//   out - array of at least fixedpoint_groupby_size(gb) elements
+//
+// Returns:
+//   the number of groups written to out
+size_t fixedpoint_groupby_results(const FixedpointGroupBy *gb, FixedpointGroup *out);
+
+#endif // FIXEDPOINT_GROUPBY_H
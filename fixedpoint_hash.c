@@ -0,0 +1,303 @@
+#include <stdlib.h>
+#include <string.h>
+#include "fixedpoint_hash.h"
+
+// Smallest number of slots a map will allocate
+#define MAP_MIN_CAPACITY 16
+
+// Put a key into the canonical form used for hashing and storage
+static Fixedpoint canonicalize(Fixedpoint val)
+{
+    if (val.tag == ERROR)
+    {
+        // All error values are the same key
+        val.whole = 0;
+        val.frac = 0;
+    }
+    else if (val.tag == VALID_NEGATIVE && val.whole == 0 && val.frac == 0)
+    {
+        // -0 is the same key as 0
+        val.tag = VALID_NONNEGATIVE;
+    }
+    return val;
+}
+
+uint64_t fixedpoint_hash_mix(uint64_t h)
+{
+    // Finalizer from MurmurHash3
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdUL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53UL;
+    h ^= h >> 33;
+    return h;
+}
+
+uint64_t fixedpoint_hash(Fixedpoint val)
+{
+    val = canonicalize(val);
+
+    uint64_t h = val.whole * 0x9e3779b97f4a7c15UL;
+    h ^= (val.frac << 29 | val.frac >> 35) * 0xbf58476d1ce4e5b9UL;
+    h ^= (uint64_t)val.tag * 0x94d049bb133111ebUL;
+    return fixedpoint_hash_mix(h);
+}
+
+int fixedpoint_hash_equal(Fixedpoint left, Fixedpoint right)
+{
+    left = canonicalize(left);
+    right = canonicalize(right);
+    return left.tag == right.tag && left.whole == right.whole && left.frac == right.frac;
+}
+
+// The hash stored in a slot; 0 is reserved to mark empty slots
+static uint64_t slot_hash(Fixedpoint key)
+{
+    uint64_t h = fixedpoint_hash(key);
+    return h == 0 ? 1 : h;
+}
+
+// Find the slot holding key, or the empty slot where it would be inserted
+static size_t find_slot(const FixedpointMap *map, Fixedpoint key, uint64_t h)
+{
+    size_t mask = map->capacity - 1;
+    size_t i = h & mask;
+    while (map->hashes[i] != 0)
+    {
+        if (map->hashes[i] == h && fixedpoint_hash_equal(map->keys[i], key))
+        {
+            break;
+        }
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+static int allocate_slots(FixedpointMap *map, size_t capacity)
+{
+    map->hashes = calloc(capacity, sizeof(uint64_t));
+    map->keys = malloc(capacity * sizeof(Fixedpoint));
+    map->values = malloc(capacity * sizeof(uint64_t));
+    if (map->hashes == NULL || map->keys == NULL || map->values == NULL)
+    {
+        free(map->hashes);
+        free(map->keys);
+        free(map->values);
+        return 0;
+    }
+    map->capacity = capacity;
+    map->size = 0;
+    return 1;
+}
+
+// Double the number of slots and reinsert every entry (a destroyed map,
+// which has no slots, gets the smallest number)
+static int grow(FixedpointMap *map)
+{
+    FixedpointMap old = *map;
+    if (!allocate_slots(map, old.capacity == 0 ? MAP_MIN_CAPACITY : old.capacity * 2))
+    {
+        *map = old;
+        return 0;
+    }
+
+    for (size_t i = 0; i < old.capacity; ++i)
+    {
+        if (old.hashes[i] != 0)
+        {
+            size_t j = find_slot(map, old.keys[i], old.hashes[i]);
+            map->hashes[j] = old.hashes[i];
+            map->keys[j] = old.keys[i];
+            map->values[j] = old.values[i];
+        }
+    }
+    map->size = old.size;
+
+    free(old.hashes);
+    free(old.keys);
+    free(old.values);
+    return 1;
+}
+
+int fixedpoint_map_init(FixedpointMap *map, size_t capacity_hint)
+{
+    // Keep the load factor at or below 3/4
+    size_t capacity = MAP_MIN_CAPACITY;
+    while (capacity / 4 * 3 < capacity_hint)
+    {
+        // Stop before the size of the slots overflows
+        if (capacity > SIZE_MAX / 2 / sizeof(Fixedpoint))
+        {
+            return 0;
+        }
+        capacity *= 2;
+    }
+    return allocate_slots(map, capacity);
+}
+
+void fixedpoint_map_destroy(FixedpointMap *map)
+{
+    free(map->hashes);
+    free(map->keys);
+    free(map->values);
+    map->hashes = NULL;
+    map->keys = NULL;
+    map->values = NULL;
+    map->capacity = 0;
+    map->size = 0;
+}
+
+void fixedpoint_map_clear(FixedpointMap *map)
+{
+    if (map->capacity != 0)
+    {
+        memset(map->hashes, 0, map->capacity * sizeof(uint64_t));
+    }
+    map->size = 0;
+}
+
+uint64_t *fixedpoint_map_get_or_insert(FixedpointMap *map, Fixedpoint key, uint64_t initial)
+{
+    if (map->capacity == 0 && !grow(map))
+    {
+        return NULL;
+    }
+    uint64_t h = slot_hash(key);
+    size_t i = find_slot(map, key, h);
+    if (map->hashes[i] != 0)
+    {
+        return &map->values[i];
+    }
+
+    if ((map->size + 1) * 4 > map->capacity * 3)
+    {
+        if (!grow(map))
+        {
+            return NULL;
+        }
+        i = find_slot(map, key, h);
+    }
+
+    map->hashes[i] = h;
+    map->keys[i] = canonicalize(key);
+    map->values[i] = initial;
+    map->size++;
+    return &map->values[i];
+}
+
+int fixedpoint_map_put(FixedpointMap *map, Fixedpoint key, uint64_t value)
+{
+    size_t old_size = map->size;
+    uint64_t *slot = fixedpoint_map_get_or_insert(map, key, value);
+    if (slot == NULL)
+    {
+        return -1;
+    }
+    *slot = value;
+    return map->size != old_size;
+}
+
+uint64_t *fixedpoint_map_get(const FixedpointMap *map, Fixedpoint key)
+{
+    if (map->capacity == 0)
+    {
+        return NULL;
+    }
+    size_t i = find_slot(map, key, slot_hash(key));
+    return map->hashes[i] != 0 ? &map->values[i] : NULL;
+}
+
+int fixedpoint_map_remove(FixedpointMap *map, Fixedpoint key)
+{
+    if (map->capacity == 0)
+    {
+        return 0;
+    }
+    size_t mask = map->capacity - 1;
+    size_t i = find_slot(map, key, slot_hash(key));
+    if (map->hashes[i] == 0)
+    {
+        return 0;
+    }
+
+    // Backward shift deletion: move later entries of the probe run into the
+    // hole so that no tombstones are needed
+    size_t j = i;
+    for (;;)
+    {
+        j = (j + 1) & mask;
+        if (map->hashes[j] == 0)
+        {
+            break;
+        }
+        size_t home = map->hashes[j] & mask;
+        // Entry j may fill the hole at i only if its home slot is not in (i, j]
+        if (((j - home) & mask) >= ((j - i) & mask))
+        {
+            map->hashes[i] = map->hashes[j];
+            map->keys[i] = map->keys[j];
+            map->values[i] = map->values[j];
+            i = j;
+        }
+    }
+    map->hashes[i] = 0;
+    map->size--;
+    return 1;
+}
+
+int fixedpoint_map_next(const FixedpointMap *map, size_t *pos, Fixedpoint *key, uint64_t *value)
+{
+    for (size_t i = *pos; i < map->capacity; ++i)
+    {
+        if (map->hashes[i] != 0)
+        {
+            if (key != NULL)
+            {
+                *key = map->keys[i];
+            }
+            if (value != NULL)
+            {
+                *value = map->values[i];
+            }
+            *pos = i + 1;
+            return 1;
+        }
+    }
+    *pos = map->capacity;
+    return 0;
+}
+
+int fixedpoint_set_init(FixedpointSet *set, size_t capacity_hint)
+{
+    return fixedpoint_map_init(&set->map, capacity_hint);
+}
+
+void fixedpoint_set_destroy(FixedpointSet *set)
+{
+    fixedpoint_map_destroy(&set->map);
+}
+
+int fixedpoint_set_add(FixedpointSet *set, Fixedpoint val)
+{
+    size_t old_size = set->map.size;
+    if (fixedpoint_map_get_or_insert(&set->map, val, 0) == NULL)
+    {
+        return -1;
+    }
+    return set->map.size != old_size;
+}
+
+int fixedpoint_set_contains(const FixedpointSet *set, Fixedpoint val)
+{
+    return fixedpoint_map_get(&set->map, val) != NULL;
+}
+
+int fixedpoint_set_remove(FixedpointSet *set, Fixedpoint val)
+{
+    return fixedpoint_map_remove(&set->map, val);
+}
+
+size_t fixedpoint_set_size(const FixedpointSet *set)
+{
+    return set->map.size;
+}
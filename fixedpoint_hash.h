@@ -0,0 +1,222 @@
+#ifndef FIXEDPOINT_HASH_H
+#define FIXEDPOINT_HASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "fixedpoint.h"
+
+// Compute a 64 bit hash of a Fixedpoint value.
+// The hash is canonical: values that fixedpoint_hash_equal considers equal
+// always hash the same. In particular -0 and 0 hash the same (matching the
+// normalization done by parse_hex and fixedpoint_negate), and every value
+// tagged ERROR hashes the same regardless of its whole and frac fields.
+// Overflow and underflow values hash by their tag and (wrapped) magnitude.
+//
+// Parameters:
+//   val - the Fixedpoint value
+//
+// Returns:
+//   the hash of val
+uint64_t fixedpoint_hash(Fixedpoint val);
+
+// Scramble the bits of a 64 bit integer so that every input bit affects
+// every output bit. This is the final step of fixedpoint_hash, and is also
+// suitable for hashing integer keys.
+//
+// Parameters:
+//   h - the value to scramble
+//
+// Returns:
+//   the scrambled value
+uint64_t fixedpoint_hash_mix(uint64_t h);
+
+// Determine whether two Fixedpoint values are the same key for hashing.
+//
+// Parameters:
+//   left - the left Fixedpoint value
+//   right - the right Fixedpoint value
+//
+// Returns:
+//   1 if both values are valid and numerically equal, if both are ERROR
+//   values, or if both have the same non-valid tag and the same magnitude;
+//   0 otherwise
+int fixedpoint_hash_equal(Fixedpoint left, Fixedpoint right);
+
+// An open-addressing (linear probing) hash map from Fixedpoint keys to
+// uint64_t values. The stored hashes live in their own dense array so that
+// a probe sequence touches as few cache lines as possible; the keys are only
+// compared when the hashes match. A stored hash of 0 marks an empty slot.
+//
+// Fields:
+//  hashes - the hash of the key in each slot, or 0 if the slot is empty
+//  keys - the (canonicalized) key in each slot
+//  values - the value in each slot
+//  capacity - the number of slots, always a power of 2 (or 0 after the map
+//             is destroyed)
+//  size - the number of occupied slots
+typedef struct
+{
+    uint64_t *hashes;
+    Fixedpoint *keys;
+    uint64_t *values;
+    size_t capacity;
+    size_t size;
+} FixedpointMap;
+
+// A hash set of Fixedpoint values, built on FixedpointMap.
+//
+// Fields:
+//  map - the underlying map (values are unused)
+typedef struct
+{
+    FixedpointMap map;
+} FixedpointSet;
+
+// Initialize an empty map.
+//
+// Parameters:
+//   map - pointer to the map to initialize
+//   capacity_hint - the number of keys the map should hold without growing
+//
+// Returns:
+//   1 if successful;
+//   0 if memory could not be allocated
+int fixedpoint_map_init(FixedpointMap *map, size_t capacity_hint);
+
+// Free the memory owned by a map. The map is left empty with no slots, and
+// can still be used: it allocates slots again when a key is inserted.
+//
+// Parameters:
+//   map - pointer to the map to destroy
+void fixedpoint_map_destroy(FixedpointMap *map);
+
+// Remove every key from a map without releasing its memory.
+//
+// Parameters:
+//   map - pointer to the map to clear
+void fixedpoint_map_clear(FixedpointMap *map);
+
+// Insert a key or update the value of an existing key.
+//
+// Parameters:
+//   map - pointer to the map
+//   key - the key
+//   value - the value to associate with key
+//
+// Returns:
+//   1 if key was newly inserted;
+//   0 if key was already present and its value was updated;
+//   -1 if the map needed to grow and memory could not be allocated
+int fixedpoint_map_put(FixedpointMap *map, Fixedpoint key, uint64_t value);
+
+// Find the value associated with a key.
+//
+// Parameters:
+//   map - pointer to the map
+//   key - the key
+//
+// Returns:
+//   a pointer to the value stored for key, which remains valid until the
+//   next insertion or removal; NULL if key is not present
+uint64_t *fixedpoint_map_get(const FixedpointMap *map, Fixedpoint key);
+
+// Find the value associated with a key, inserting the key with an initial
+// value if it is not present. This is the usual way to accumulate into a map.
+//
+// Parameters:
+//   map - pointer to the map
+//   key - the key
+//   initial - the value to insert if key is not present
+//
+// Returns:
+//   a pointer to the value stored for key, which remains valid until the
+//   next insertion or removal; NULL if memory could not be allocated
+uint64_t *fixedpoint_map_get_or_insert(FixedpointMap *map, Fixedpoint key, uint64_t initial);
+
+// Remove a key from a map.
+//
+// Parameters:
+//   map - pointer to the map
+//   key - the key to remove
+//
+// Returns:
+//   1 if key was present and removed;
+//   0 if key was not present
+int fixedpoint_map_remove(FixedpointMap *map, Fixedpoint key);
+
+// Iterate over the entries of a map. Start with *pos set to 0 and call
+// repeatedly until it returns 0. The map must not be modified during iteration.
+//
+// Parameters:
+//   map - pointer to the map
+//   pos - pointer to the iteration position
+//   key - where the key of the next entry is written (may be NULL)
+//   value - where the value of the next entry is written (may be NULL)
+//
+// Returns:
+//   1 if an entry was produced;
+//   0 if there are no more entries
+int fixedpoint_map_next(const FixedpointMap *map, size_t *pos, Fixedpoint *key, uint64_t *value);
+
+// Initialize an empty set.
+//
+// Parameters:
+//   set - pointer to the set to initialize
+//   capacity_hint - the number of values the set should hold without growing
+//
+// Returns:
+//   1 if successful;
+//   0 if memory could not be allocated
+int fixedpoint_set_init(FixedpointSet *set, size_t capacity_hint);
+
+// Free the memory owned by a set. As with fixedpoint_map_destroy, the set
+// is left empty and can still be used.
+//
+// Parameters:
+//   set - pointer to the set to destroy
+void fixedpoint_set_destroy(FixedpointSet *set);
+
+// Add a value to a set.
+//
+// Parameters:
+//   set - pointer to the set
+//   val - the value to add
+//
+// Returns:
+//   1 if val was newly added;
+//   0 if val was already present;
+//   -1 if memory could not be allocated
+int fixedpoint_set_add(FixedpointSet *set, Fixedpoint val);
+
+// Determine whether a set contains a value.
+//
+// Parameters:
+//   set - pointer to the set
+//   val - the value to look for
+//
+// Returns:
+//   1 if val is present;
+//   0 otherwise
+int fixedpoint_set_contains(const FixedpointSet *set, Fixedpoint val);
+
+// Remove a value from a set.
+//
+// Parameters:
+//   set - pointer to the set
+//   val - the value to remove
+//
+// Returns:
+//   1 if val was present and removed;
+//   0 if val was not present
+int fixedpoint_set_remove(FixedpointSet *set, Fixedpoint val);
+
+// Get the number of values in a set.
+//
+// Parameters:
+//   set - pointer to the set
+//
+// Returns:
+//   the number of values in the set
+size_t fixedpoint_set_size(const FixedpointSet *set);
+
+#endif // FIXEDPOINT_HASH_H
@@ -0,0 +1,1028 @@
+#include "fixedpoint_math.h"
+#include "fixedpoint_wide.h"
+
+// The polynomials and tables below were generated with exact rational
+// arithmetic. The polynomials interpolate their function at Chebyshev
+// nodes of the reduced interval, which puts them within a small factor of
+// the minimax error; evaluated with truncating 128 bit arithmetic, each has
+// an error below 2^-125 there.
+//
+// Polynomial coefficients and the exp2 table are Q126: signed 128 bit
+// numbers with 126 fraction bits, stored as {upper, lower} 64 bit halves.
+
+#define EXP2_POLY_DEGREE 11
+#define EXP2_TABLE_SIZE 64
+#define LOG2_POLY_DEGREE 13
+#define LOG2_TABLE_SIZE 128
+
+// 2^r on [0, 1/64], Q126, constant term first
+static const uint64_t exp2_poly[EXP2_POLY_DEGREE + 1][2] = {
+    {0x4000000000000000UL, 0x0000000000000000UL},
+    {0x2c5c85fdf473de6aUL, 0xf278ece600fcc1a9UL},
+    {0x0f5fdeffc162c754UL, 0x378b5837648a2322UL},
+    {0x038d611ae09417f1UL, 0x6674ec58443c575fUL},
+    {0x009d955b7dd273b9UL, 0x4e65dceec3cbdf6bUL},
+    {0x0015d87fe78a6731UL, 0x1074781cc63bf986UL},
+    {0x0002861225f0d8f0UL, 0xeb3ba7e2725e4998UL},
+    {0x00003ff97f8b1163UL, 0x23eab67cf481aa26UL},
+    {0x0000058b0088e8d1UL, 0x034638636e82e4f8UL},
+    {0x0000006d494f786dUL, 0xa119c4ed15e5e5d3UL},
+    {0x0000000793364bfdUL, 0x52d3d9bb203d1df9UL},
+    {0x000000007adc92ffUL, 0xa8ec98b8dbd2b03cUL},
+};
+
+// log2(1 + t) on [0, 1/128 + 2^-58], Q126, constant term first
+static const uint64_t log2_poly[LOG2_POLY_DEGREE + 1][2] = {
+    {0x0000000000000000UL, 0x0000000000000000UL},
+    {0x5c551d94ae0bf85dUL, 0xdf43ff68348e78e0UL},
+    {0xd1d57135a8fa03d1UL, 0x105e004bea9888b4UL},
+    {0x1ec709dc3a03fd74UL, 0x9fc154e455030215UL},
+    {0xe8eab89ad47d01e8UL, 0x8830a105244fa147UL},
+    {0x12776c50ef9bfe79UL, 0x26231a3c069a3601UL},
+    {0xf09c7b11e2fe0156UL, 0x942751176fe419f3UL},
+    {0x0d30bb153d6f4ee7UL, 0xeee367c89a486f2eUL},
+    {0xf4755c4d6a62f0e3UL, 0x037a99594c4be4acUL},
+    {0x0a42589e9e87a021UL, 0x25caf98dd5b63d39UL},
+    {0xf6c449ea9e04bbf5UL, 0xef1f229a5b9685d8UL},
+    {0x0864cc30b6c0fe17UL, 0xb2acfaee426b2daaUL},
+    {0xf850696606e8fc7dUL, 0xd102b43045276bbcUL},
+    {0x06c07674d1a63111UL, 0x09af6cf871f797d7UL},
+};
+
+// 2^(j/64), Q126
+static const uint64_t exp2_table[EXP2_TABLE_SIZE][2] = {
+    {0x4000000000000000UL, 0x0000000000000000UL},
+    {0x40b268f9de0183b9UL, 0xbdf2b293de8a6f7aUL},
+    {0x4166c34c5615d0ebUL, 0x9f1523ada3290600UL},
+    {0x421d1461d66f2023UL, 0x0d7c976509fe8ac1UL},
+    {0x42d561b3e6243d8aUL, 0x62e4adc610aa60d9UL},
+    {0x438fb0cb4f468808UL, 0x1d0b93e2bda954abUL},
+    {0x444c0740496d4293UL, 0xaefc6bb64c633ab1UL},
+    {0x450a6abaa4b77ecdUL, 0x040650ec961b4061UL},
+    {0x45cae0f1f545eb73UL, 0x7df23143ac529e48UL},
+    {0x468d6fadbf2dd4f2UL, 0xda63da4b4720d69bUL},
+    {0x47521cc5a2e6a9e0UL, 0x16e00a2643c1ea63UL},
+    {0x4818ee218a3358eeUL, 0x3bac0a5424a743f1UL},
+    {0x48e1e9b9d588e19bUL, 0x07eb6c70572d64ecUL},
+    {0x49ad159789f37495UL, 0xe99cca074ec92774UL},
+    {0x4a7a77d47f7b84b0UL, 0x97457d6892a8ef2aUL},
+    {0x4b4a169b900c2d00UL, 0x24754db41d4e1162UL},
+    {0x4c1bf828c6dc54b7UL, 0xa356918c17217b7bUL},
+    {0x4cf022c9905bfd32UL, 0x721843659a5afe57UL},
+    {0x4dc69cdceaa72a9cUL, 0x51540bd151e61f90UL},
+    {0x4e9f6cd3967fdba8UL, 0x6f24a6782874cd86UL},
+    {0x4f7a993048d088d6UL, 0xd0488f84f5dcfee9UL},
+    {0x50582887dcb8a7e1UL, 0x0c96e3cf6d87ecd5UL},
+    {0x513821818624b40cUL, 0x4dbd0277c067ef54UL},
+    {0x521a8ad704f3404fUL, 0x068eda418bc0f0f7UL},
+    {0x52ff6b54d8a89c75UL, 0x0e5ebfb10b88380eUL},
+    {0x53e6c9da74b29ab4UL, 0xcf62da6a81cfb958UL},
+    {0x54d0ad5a753e077cUL, 0x2a0f12761a98fd3aUL},
+    {0x55bd1cdad49f699bUL, 0xb2c011d93acf003dUL},
+    {0x56ac1f752150a563UL, 0x24c054647acd1762UL},
+    {0x579dbc56b48521baUL, 0x6f93080e65d9a819UL},
+    {0x5891fac0e95612c7UL, 0xc3e81bf4b690aec7UL},
+    {0x5988e20954889244UL, 0x9f678a6e3cc528ceUL},
+    {0x5a827999fcef3242UL, 0x2cbec4d9baa55f50UL},
+    {0x5b7ec8f19468bbc8UL, 0x838b2f86eeaa0d2dUL},
+    {0x5c7dd7a3b17dcf74UL, 0x8dc3cbbc2b35b2d1UL},
+    {0x5d7fad59099f22fdUL, 0xba6a8ce922c9c1c6UL},
+    {0x5e8451cfac061b5fUL, 0x54408fdb3687d7bdUL},
+    {0x5f8bccdb3d398841UL, 0x740ae855e5f85c28UL},
+    {0x6096266533384a2bUL, 0x3e22beacd28043dbUL},
+    {0x61a3666d124bb203UL, 0x907642b0945c1d21UL},
+    {0x62b39508aa836d6eUL, 0x9f156864b26ecf9cUL},
+    {0x63c6ba6455dcd8aeUL, 0x609d171cbb6013bfUL},
+    {0x64dcdec3371793d1UL, 0x4070fc950288b4bfUL},
+    {0x65f60a7f79393e2eUL, 0x7a483e47a2f5fb6eUL},
+    {0x6712460a8fc24071UL, 0xf11ac1c7caf96377UL},
+    {0x683199ed779592caUL, 0x6b6a2e32acd26a81UL},
+    {0x69540ec8f895722dUL, 0x0912472be1ef2014UL},
+    {0x6a79ad55e7f6fd0fUL, 0xac90ef7fd313162dUL},
+    {0x6ba27e656b4eb57aUL, 0x1cd345dcc8169fefUL},
+    {0x6cce8ae13c57ebdaUL, 0xff439ef651f095d6UL},
+    {0x6dfddbcbed791baaUL, 0x9ec206ad4f14d532UL},
+    {0x6f307a412f074891UL, 0xee83d16cf423342dUL},
+    {0x70666f76154a7088UL, 0x832c4a8246e999e5UL},
+    {0x719fc4b95f452d28UL, 0x84dff483cacc0776UL},
+    {0x72dc8373be41a454UL, 0x0f2f47a5276dd876UL},
+    {0x741cb5281e25ee34UL, 0x3c8bc868563863efUL},
+    {0x75606373ee921c97UL, 0x6816bad9b8372a7dUL},
+    {0x76a7980f6cca15c2UL, 0x300696db5325fd89UL},
+    {0x77f25ccdee6d7ae5UL, 0xa32b0e7b4a46dc89UL},
+    {0x7940bb9e2cffd89cUL, 0xf44c054e647a3d26UL},
+    {0x7a92be8a92436616UL, 0x3dce863d76cc07e2UL},
+    {0x7be86fb985689ddcUL, 0x7f486a4b6b07db75UL},
+    {0x7d41d96db915019dUL, 0x3e12dd8a18aebfe6UL},
+    {0x7e9f06067a4360baUL, 0x429f9d2c98f07702UL},
+};
+
+// Reciprocals r_j = 1/(1 + j/128) rounded up, Q63, and -log2(r_j), U0.128
+static const uint64_t log2_recip[LOG2_TABLE_SIZE] = {
+    0x8000000000000000UL,
+    0x7f01fc07f01fc080UL,
+    0x7e07e07e07e07e08UL,
+    0x7d1196792909c560UL,
+    0x7c1f07c1f07c1f08UL,
+    0x7b301ecc07b301edUL,
+    0x7a44c6afc2dd9ca9UL,
+    0x795ceb240795ceb3UL,
+    0x7878787878787879UL,
+    0x77975b8fe21a291dUL,
+    0x76b981dae6076b99UL,
+    0x75ded952e0b0ce46UL,
+    0x7507507507507508UL,
+    0x7432d63dbb01d0ccUL,
+    0x73615a240e6c2b45UL,
+    0x7292cc157b864408UL,
+    0x71c71c71c71c71c8UL,
+    0x70fe3c070fe3c071UL,
+    0x70381c0e070381c1UL,
+    0x6f74ae26501bdd2cUL,
+    0x6eb3e45306eb3e46UL,
+    0x6df5b0f768ce2cacUL,
+    0x6d3a06d3a06d3a07UL,
+    0x6c80d901b2036407UL,
+    0x6bca1af286bca1b0UL,
+    0x6b15c06b15c06b16UL,
+    0x6a63bd81a98ef607UL,
+    0x69b4069b4069b407UL,
+    0x6906906906906907UL,
+    0x685b4fe5e92c0686UL,
+    0x67b23a5440cf6475UL,
+    0x670b453b92840671UL,
+    0x6666666666666667UL,
+    0x65c393e032e1c9f1UL,
+    0x6522c3f35ba78195UL,
+    0x6483ed274388a357UL,
+    0x63e7063e7063e707UL,
+    0x634c0634c0634c07UL,
+    0x62b2e43dafcea68eUL,
+    0x621b97c2aec12653UL,
+    0x6186186186186187UL,
+    0x60f25deacafb74a4UL,
+    0x6060606060606061UL,
+    0x5fd017f405fd0180UL,
+    0x5f417d05f417d060UL,
+    0x5eb4882383b30d52UL,
+    0x5e293205e293205fUL,
+    0x5d9f7390d2a6c406UL,
+    0x5d1745d1745d1746UL,
+    0x5c90a1fd1b7af018UL,
+    0x5c0b81702e05c0b9UL,
+    0x5b87ddad0cdf1b2dUL,
+    0x5b05b05b05b05b06UL,
+    0x5a84f3454dca4110UL,
+    0x5a05a05a05a05a06UL,
+    0x5987b1a9448be406UL,
+    0x590b21642c8590b3UL,
+    0x588fe9dc0588fe9eUL,
+    0x5816058160581606UL,
+    0x579d6ee340579d6fUL,
+    0x572620ae4c415c99UL,
+    0x56b015ac056b015bUL,
+    0x563b48c20563b48dUL,
+    0x55c7b4f141ace689UL,
+    0x5555555555555556UL,
+    0x54e42523d03fab1cUL,
+    0x54741fab8be05475UL,
+    0x5405405405405406UL,
+    0x5397829cbc14e5e1UL,
+    0x532ae21c96bdb9d4UL,
+    0x52bf5a814afd6a06UL,
+    0x5254e78ecb419ba9UL,
+    0x51eb851eb851eb86UL,
+    0x51832f1fd73e6871UL,
+    0x511be1958b67ebbaUL,
+    0x50b59897547e1bbfUL,
+    0x5050505050505051UL,
+    0x4fec04fec04fec05UL,
+    0x4f88b2f392a409f2UL,
+    0x4f265691eeaf9d11UL,
+    0x4ec4ec4ec4ec4ec5UL,
+    0x4e6470b061fd8cddUL,
+    0x4e04e04e04e04e05UL,
+    0x4da637cf781d1e55UL,
+    0x4d4873ecade304d5UL,
+    0x4ceb916d5ef2c784UL,
+    0x4c8f8d28ac42fd9cUL,
+    0x4c346404c346404dUL,
+    0x4bda12f684bda130UL,
+    0x4b8097012e025c05UL,
+    0x4b27ed3604b27ed4UL,
+    0x4ad012b404ad012cUL,
+    0x4a7904a7904a7905UL,
+    0x4a22c04a22c04a23UL,
+    0x49cd42e2049cd42fUL,
+    0x497889c2024bc44fUL,
+    0x4924924924924925UL,
+    0x48d159e26af37c05UL,
+    0x487ede0487ede049UL,
+    0x482d1c319f03621eUL,
+    0x47dc11f7047dc120UL,
+    0x478bbcecfee1d10dUL,
+    0x473c1ab68a0473c2UL,
+    0x46ed29011bb4a405UL,
+    0x469ee58469ee5847UL,
+    0x46514e02328a7012UL,
+    0x4604604604604605UL,
+    0x45b81a2509cde3aeUL,
+    0x456c797dd49c3412UL,
+    0x45217c382b34eda4UL,
+    0x44d72044d72044d8UL,
+    0x448d639d74c0cda9UL,
+    0x4444444444444445UL,
+    0x43fbc043fbc043fcUL,
+    0x43b3d5af9a723f79UL,
+    0x436c82a23d1a5664UL,
+    0x4325c53ef368eb05UL,
+    0x42df9bb096771e4eUL,
+    0x429a0429a0429a05UL,
+    0x4254fce404254fcfUL,
+    0x4210842108421085UL,
+    0x41cc98291fdf19b4UL,
+    0x4189374bc6a7ef9eUL,
+    0x41465fdf5cd01052UL,
+    0x4104104104104105UL,
+    0x40c246d47d78693cUL,
+    0x4081020408102041UL,
+    0x4040404040404041UL,
+};
+
+static const uint64_t log2_table[LOG2_TABLE_SIZE][2] = {
+    {0x0000000000000000UL, 0x0000000000000000UL},
+    {0x02dfca16dde10a2dUL, 0x0f1e095abeca259cUL},
+    {0x05b9e5a170b48a62UL, 0x3f34daefb236c5f4UL},
+    {0x088e68ea899a0976UL, 0x07f84753ed8bb8beUL},
+    {0x0b5d69bac77ec397UL, 0xe2593d21ffc893d5UL},
+    {0x0e26fd5c8555af79UL, 0xbe0ca7f076cb63eaUL},
+    {0x10eb389fa29f9ab1UL, 0x26810091158928b5UL},
+    {0x13aa2fdd27f1c2d5UL, 0xbdf7c760bfb6e6d8UL},
+    {0x1663f6fac913167bUL, 0x2cd47d4435217d1eUL},
+    {0x1918a16e46335aabUL, 0x72aec369cce02297UL},
+    {0x1bc84240adabba60UL, 0xf2bca5576a5f72b0UL},
+    {0x1e72ec117fa5b21cUL, 0xb22b3629943085dfUL},
+    {0x2118b119b4f3c72aUL, 0x257a2e25365d4349UL},
+    {0x23b9a32eaa56f6bbUL, 0x35bef6d989fdda9bUL},
+    {0x2655d3c4f15c343dUL, 0x0ff11f80d522ee01UL},
+    {0x28ed53f307ee9a5fUL, 0xbd5424ed657e6120UL},
+    {0x2b803473f7ad0f3cUL, 0x5d6d376e9cb798b6UL},
+    {0x2e0e85a9de04fe53UL, 0x7a74a3d5b21614cdUL},
+    {0x309857a05e0765fbUL, 0x3c695c87838536b5UL},
+    {0x331dba0efce1be04UL, 0x6d335b9a4aa41ed1UL},
+    {0x359ebc5b69d927ddUL, 0x0dbf39a51712a2adUL},
+    {0x381b6d9bb29bdc81UL, 0x23463d6f6f499419UL},
+    {0x3a93dc9864b2df91UL, 0x536079f2d93714a0UL},
+    {0x3d0817ce9cd4998eUL, 0xd5781d39388e57a4UL},
+    {0x3f782d7204d01444UL, 0x6f0a44a9997ea8f9UL},
+    {0x41e42b6ec0c025bbUL, 0x311f803434124887UL},
+    {0x444c1f6b4c2dd72aUL, 0xee22260f9dd218caUL},
+    {0x46b016ca47c1c148UL, 0xd1c99ab75af8dea2UL},
+    {0x49101eac381ce607UL, 0x8e7b70d94c5c1f61UL},
+    {0x4b6c43f1366abdbbUL, 0x44744126489107cfUL},
+    {0x4dc4933a9337b365UL, 0x0d2e6e825450b232UL},
+    {0x501918ec6c1125d5UL, 0xbc9309afcd916e2aUL},
+    {0x5269e12f346e2bf6UL, 0xfab12a8122779b02UL},
+    {0x54b6f7f1325acdf3UL, 0xf8c03c6bbd883820UL},
+    {0x570068e7ef5a1e7cUL, 0xd5229f5875375a93UL},
+    {0x59463f919dee9b92UL, 0x430a6c67efb68d5eUL},
+    {0x5b8887367433795bUL, 0x69b487d397324c38UL},
+    {0x5dc74ae9fbecef8eUL, 0xcbba7217419df046UL},
+    {0x6002958c587150caUL, 0x476dc2d9a45c2bc1UL},
+    {0x623a71cb82c89692UL, 0x040dbebb97f2fdebUL},
+    {0x646eea247c5c22cfUL, 0x5dab7ca9a4ff9ea1UL},
+    {0x66a008e4788cbcd1UL, 0x654a7b566f53c2aeUL},
+    {0x68cdd829fd814273UL, 0x8d4f7a657a077a8bUL},
+    {0x6af861e5fc7d2383UL, 0xaf2068bda696049bUL},
+    {0x6d1fafdce20a828dUL, 0x6f12f750b83e77cbUL},
+    {0x6f43cba79e40c2aaUL, 0xacffa88744a1552eUL},
+    {0x7164beb4a56d59f6UL, 0xb10c7dcf1895da9bUL},
+    {0x73829248e961f324UL, 0xde1e6b8ce6910f16UL},
+    {0x759d4f80cba83bf8UL, 0x424e2b17f93ce604UL},
+    {0x77b4ff5108d93137UL, 0x7f3ceb534e9b7752UL},
+    {0x79c9aa879d53482dUL, 0x9f9a805062139aadUL},
+    {0x7bdb59cca38881f1UL, 0xc94d94e241d000c2UL},
+    {0x7dea15a32c1b3b37UL, 0x219c1888e2ace38eUL},
+    {0x7ff5e66a0ffe6ae5UL, 0x64533cd6c7dcb143UL},
+    {0x81fed45cbccbf99bUL, 0x1939627359b619d7UL},
+    {0x8404e793fb81ea91UL, 0x2ed73fdc7a5a84c0UL},
+    {0x86082806b1d532c0UL, 0x493cde41ef715ad4UL},
+    {0x88089d8a9e4753d7UL, 0xdd78be71f2c96c90UL},
+    {0x8a064fd50f2a1ceeUL, 0x9a3fe774198dee0bUL},
+    {0x8c01467b94bb5275UL, 0x4e1c31cf753c7b88UL},
+    {0x8df988f4ae806f1bUL, 0x95b3e4cf83722ccaUL},
+    {0x8fef1e9874093210UL, 0xfbb032dd68458827UL},
+    {0x91e20ea1393e403cUL, 0xb86ffa65b2e1a84fUL},
+    {0x93d2602c2e5fc02aUL, 0x8512716e5eb0b190UL},
+    {0x95c01a39fbd6879cUL, 0xbd622564962beae5UL},
+    {0x97ab43af59f930a0UL, 0x9ad1978867f76a8eUL},
+    {0x9993e355a4e5363fUL, 0x8787d58657c1da5aUL},
+    {0x9b79ffdb6c8b11feUL, 0xf10c5ca1b2a131ceUL},
+    {0x9d5d9fd5010b3664UL, 0xcd28499044187100UL},
+    {0x9f3ec9bcfb80b356UL, 0x457dea9c0e9bac05UL},
+    {0xa11d83f4c3554b34UL, 0x88a61b216a7180a4UL},
+    {0xa2f9d4c51039c524UL, 0x9bc5a190cdee2f1cUL},
+    {0xa4d3c25e68dc57eeUL, 0x51b77296f2fb2e64UL},
+    {0xa6ab52d99e76224fUL, 0x43e7a6bc8342b680UL},
+    {0xa8808c384547c6eaUL, 0xdf3711fbbf364eceUL},
+    {0xaa5374652a1c6d8aUL, 0xe324b506a165873aUL},
+    {0xac241134c4e99e19UL, 0x4475d19657fa4b63UL},
+    {0xadf26865a8a1a557UL, 0x5432b737c7edbebaUL},
+    {0xafbe7fa0f04d75c2UL, 0x1bede7536df82d6dUL},
+    {0xb1885c7aa98241ffUL, 0x0498a7d042578170UL},
+    {0xb35004723c465e69UL, 0x1a84fef27b7758c0UL},
+    {0xb5157cf2d078503dUL, 0xd7a7be0b7d81b6a6UL},
+    {0xb6d8cb53b0ca4ecbUL, 0x5979a199b65d4fb3UL},
+    {0xb899f4d8ab63df28UL, 0x5d6e228538682599UL},
+    {0xba58feb2703a9e34UL, 0xeaae05a9467e19a3UL},
+    {0xbc15edfeed32bbd9UL, 0x7c88cb0353045f98UL},
+    {0xbdd0c7c9a817204cUL, 0xfd92b8c678a8b2fbUL},
+    {0xbf89910c1678ae85UL, 0x9b9e13ce5b3db984UL},
+    {0xc1404eadf38396dbUL, 0xfd784978a3434687UL},
+    {0xc2f5058593d93082UL, 0xd7e2c25e381f19b6UL},
+    {0xc4a7ba58377c5a00UL, 0x6442c3590dfc83deUL},
+    {0xc65871da59dded97UL, 0x91ebc0a4d5e3aa33UL},
+    {0xc80730b0001667f0UL, 0x6913f5bc515b6836UL},
+    {0xc9b3fb6d055974e5UL, 0x05c9093957918620UL},
+    {0xcb5ed69565afaf7bUL, 0x02c0a2df78a6f3d0UL},
+    {0xcd07c69d87027eefUL, 0xf58283835ce489efUL},
+    {0xceaecfea80859b31UL, 0x00ca5227ff9dd616UL},
+    {0xd053f6d26089672fUL, 0x429c9153efeaa63aUL},
+    {0xd1f73f9c70c0f681UL, 0x3a8a624d5c8d66ffUL},
+    {0xd398ae8179063de7UL, 0x379ec2b9397353fcUL},
+    {0xd53847ac00a69be4UL, 0x0f1556b3a00a56caUL},
+    {0xd6d60f388e419687UL, 0x105293d38867361dUL},
+    {0xd8720935e6435ebbUL, 0x80d624560ef59c1fUL},
+    {0xda0c39a548045ec8UL, 0xd1d399be1ec42b5aUL},
+    {0xdba4a47aa996d258UL, 0x5fb5f70008f5911cUL},
+    {0xdd3b4d9cf24b2075UL, 0x8e6d9b76ca5bb517UL},
+    {0xded038e633f36da5UL, 0x6c6792ae826d726cUL},
+    {0xe0636a23e2ee9b12UL, 0x9befb3033bab46daUL},
+    {0xe1f4e5170d02a997UL, 0xdf31d949480fc981UL},
+    {0xe384ad748f0e3b01UL, 0x1d70fc7024262b6cUL},
+    {0xe512c6e54998b1abUL, 0x46ca057881a1664eUL},
+    {0xe69f35065448360dUL, 0x9f41e8bcf0c27c1eUL},
+    {0xe829fb693044b394UL, 0xcd12a8a3c2c76f01UL},
+    {0xe9b31d93f98ea94aUL, 0x677e3eb7dfc57273UL},
+    {0xeb3a9f01975077efUL, 0xc067775400a05c41UL},
+    {0xecc08321eb30a618UL, 0xce4fe5e11989d5b7UL},
+    {0xee44cd59ffab62eeUL, 0xcec32c44c4b39128UL},
+    {0xefc781043579625bUL, 0xbc4ed05ed0ce8cf9UL},
+    {0xf148a170700a00f9UL, 0x308b6243a1c0a12dUL},
+    {0xf2c831e4411672acUL, 0x9cf527cf16f7554bUL},
+    {0xf446359b1353954cUL, 0x2ea13029ce257b69UL},
+    {0xf5c2afc65447d869UL, 0xe778d4e3aae7d992UL},
+    {0xf73da38d9d4a83e9UL, 0xb77b477569856bddUL},
+    {0xf8b7140edbb181d6UL, 0xbff5c47725d25ccdUL},
+    {0xfa2f045e7832aa6dUL, 0x18f7b36719cc748bUL},
+    {0xfba577877d7d6ebbUL, 0x571eae9a2d8b05abUL},
+    {0xfd1a708bbe119b11UL, 0xbd3eadc799364e0aUL},
+    {0xfe8df263f957ca11UL, 0x42d65f49a3f390eeUL},
+};
+
+// ln(2), U0.128, and log2(e), U1.127
+#define LN2_U128 ((u128)0xb17217f7d1cf79abUL << 64 | 0xc9e3b39803f2f6afUL)
+#define LOG2E_U128 ((u128)0xb8aa3b295c17f0bbUL << 64 | 0xbe87fed0691d3e89UL)
+
+static u128 table_value(const uint64_t entry[2])
+{
+    return (u128)entry[0] << 64 | entry[1];
+}
+
+static Fixedpoint make_value(u128 mag, int negative)
+{
+    Fixedpoint val;
+    val.whole = (uint64_t)(mag >> 64);
+    val.frac = (uint64_t)mag;
+    val.tag = negative && mag != 0 ? VALID_NEGATIVE : VALID_NONNEGATIVE;
+    return val;
+}
+
+static Fixedpoint tagged_value(Tag tag)
+{
+    Fixedpoint val = {0, 0, tag};
+    return val;
+}
+
+static int clz_128(u128 x)
+{
+    return 128 - (int)bit_length(x);
+}
+
+// Round a signed fixed point number with the given number of fraction bits
+// (at least 65) to the nearest Fixedpoint value
+static Fixedpoint round_fixed(i128 v, unsigned frac_bits)
+{
+    u128 mag = abs_wide(v);
+    unsigned shift = frac_bits - 64;
+    return make_value((mag + ((u128)1 << (shift - 1))) >> shift, v < 0);
+}
+
+// Evaluate a Q126 polynomial at t in [0, 1), given in units of 2^-128,
+// with Horner's rule. Each product is truncated towards zero.
+static i128 horner(const uint64_t (*poly)[2], int degree, u128 t)
+{
+    i128 acc = (i128)table_value(poly[degree]);
+    for (int i = degree - 1; i >= 0; --i)
+    {
+        u128 upper, lower;
+        mul_128(abs_wide(acc), t, &upper, &lower);
+        acc = (i128)table_value(poly[i]) + (acc < 0 ? -(i128)upper : (i128)upper);
+    }
+    return acc;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Square root
+//////////////////////////////////////////////////////////////////////
+
+// ceil(sqrt((i + 1) * 2^60)), a starting point for Newton's method
+static const uint64_t sqrt_seeds[16] = {
+    0x40000000UL, 0x5a82799aUL, 0x6ed9eba2UL, 0x80000000UL, 0x8f1bbcddUL, 0x9cc470a1UL,
+    0xa953fd4fUL, 0xb504f334UL, 0xc0000000UL, 0xca62c1d7UL, 0xd44394a0UL, 0xddb3d743UL,
+    0xe6c15a24UL, 0xef77508cUL, 0xf7def58bUL, 0x100000000UL,
+};
+
+// Integer square root of x >= 2^62 by Newton's method, starting above the
+// root so that the iterates decrease to it. Stores x - root^2 in rem.
+static uint64_t sqrtrem_64(uint64_t x, uint64_t *rem)
+{
+    uint64_t root = sqrt_seeds[x >> 60];
+    for (;;)
+    {
+        uint64_t next = (root + x / root) >> 1;
+        if (next >= root)
+        {
+            break;
+        }
+        root = next;
+    }
+    *rem = x - root * root;
+    return root;
+}
+
+// Extend the integer square root s of the upper part of x = upper * 2^64 +
+// lower to the square root of x with one Newton step done as a division
+// (Zimmermann, "Karatsuba Square Root", 1999): the 32 bit digit q below s is
+// (r * 2^32 + a1) / 2s, where r = upper - s^2 and a1 is the next 32 bits,
+// and the remainder tells whether that step went one too far. s must be at
+// least 2^31.
+static u128 sqrtrem_step(u128 root, u128 rem, uint64_t lower, u128 *new_rem)
+{
+    u128 num = rem << 32 | (lower >> 32);
+    u128 q = num / (root << 1);
+    u128 u = num % (root << 1);
+    u128 result = (root << 32) + q;
+    i128 r = (i128)(u << 32 | (uint32_t)lower) - (i128)(q * q);
+    if (r < 0)
+    {
+        r += (i128)(result << 1) - 1;
+        --result;
+    }
+    *new_rem = (u128)r;
+    return result;
+}
+
+Fixedpoint fixedpoint_sqrt(Fixedpoint val, FixedpointRound mode)
+{
+    if (!fixedpoint_is_valid(val) || val.tag == VALID_NEGATIVE)
+    {
+        return tagged_value(ERROR);
+    }
+    u128 mag = magnitude(val);
+    if (mag == 0)
+    {
+        return val;
+    }
+
+    // The root of val in units of 2^-64 is sqrt(mag * 2^64). Scale the
+    // radicand by 4^k so that its top two bits are not both zero, then
+    // take the root of the 64 bit top, the 128 bit top and all 192 bits.
+    unsigned k = (unsigned)clz_128(mag) / 2;
+    u128 top = mag << (2 * k);
+    uint64_t rem64;
+    u128 rem;
+    u128 root = sqrtrem_64((uint64_t)(top >> 64), &rem64);
+    root = sqrtrem_step(root, rem64, (uint64_t)top, &rem);
+    root = sqrtrem_step(root, rem, 0, &rem);
+
+    // The exact root is (root + fraction) / 2^k, with a nonzero fraction
+    // below 1 when rem is nonzero
+    u128 result = root >> k;
+    u128 dropped = k > 0 ? root & (((u128)1 << k) - 1) : 0;
+    int inexact = dropped != 0 || rem != 0;
+    int up = 0;
+    switch (mode)
+    {
+    case FIXEDPOINT_ROUND_NEAREST_EVEN:
+        // The root of an integer is never halfway between two integers
+        up = k > 0 ? (int)((root >> (k - 1)) & 1) : rem > root;
+        break;
+    case FIXEDPOINT_ROUND_CEILING:
+        up = inexact;
+        break;
+    default:
+        break;
+    }
+    Fixedpoint out = make_value(result + (u128)up, 0);
+    if (mode == FIXEDPOINT_ROUND_EXACT && inexact)
+    {
+        out.tag = UNDERFLOW_POSITIVE;
+    }
+    return out;
+}
+
+//////////////////////////////////////////////////////////////////////
+// Exponentials
+//////////////////////////////////////////////////////////////////////
+
+// Compute 2^(n + f), where f is a fraction in units of 2^-128, rounded to
+// the nearest multiple of 2^-64. 2^f is 2^(j/64) from the table times a
+// polynomial for 2^r, where j is the top 6 bits of f and r the rest.
+static Fixedpoint exp2_reduced(int64_t n, u128 f)
+{
+    if (n >= 64)
+    {
+        return tagged_value(OVERFLOW_POSITIVE);
+    }
+    if (n < -65)
+    {
+        return make_value(0, 0);
+    }
+    unsigned j = (unsigned)(f >> 122);
+    u128 r = f & (((u128)1 << 122) - 1);
+    u128 poly = (u128)horner(exp2_poly, EXP2_POLY_DEGREE, r);
+    u128 upper, lower;
+    mul_128(table_value(exp2_table[j]), poly, &upper, &lower);
+    // 2^f in Q126, in [1, 2)
+    u128 m = upper << 2 | lower >> 126;
+
+    // The result in units of 2^-64 is m * 2^(n - 62)
+    int shift = 62 - (int)n;
+    if (shift <= 0)
+    {
+        return make_value(m << -shift, 0);
+    }
+    return make_value((m + ((u128)1 << (shift - 1))) >> shift, 0);
+}
+
+// Compute 2^(-(n + f)) with exp2_reduced
+static Fixedpoint exp2_reduced_neg(int64_t n, u128 f)
+{
+    return f != 0 ? exp2_reduced(-n - 1, -f) : exp2_reduced(-n, 0);
+}
+
+Fixedpoint fixedpoint_exp2(Fixedpoint val)
+{
+    if (!fixedpoint_is_valid(val))
+    {
+        return tagged_value(ERROR);
+    }
+    // Bound the whole part so that it fits an int64_t; any exponent beyond
+    // the bound overflows or rounds to zero
+    int64_t n = val.whole < 128 ? (int64_t)val.whole : 128;
+    u128 f = (u128)val.frac << 64;
+    return val.tag == VALID_NEGATIVE ? exp2_reduced_neg(n, f) : exp2_reduced(n, f);
+}
+
+Fixedpoint fixedpoint_exp(Fixedpoint val)
+{
+    if (!fixedpoint_is_valid(val))
+    {
+        return tagged_value(ERROR);
+    }
+    if (val.whole >= 128)
+    {
+        return val.tag == VALID_NEGATIVE ? make_value(0, 0) : tagged_value(OVERFLOW_POSITIVE);
+    }
+    // val * log2(e) in units of 2^-191, below 2^199
+    u128 upper, lower;
+    mul_128(magnitude(val), LOG2E_U128, &upper, &lower);
+    int64_t n = (int64_t)(upper >> 63);
+    u128 f = upper << 65 | lower >> 63;
+    return val.tag == VALID_NEGATIVE ? exp2_reduced_neg(n, f) : exp2_reduced(n, f);
+}
+
+//////////////////////////////////////////////////////////////////////
+// Logarithms
+//////////////////////////////////////////////////////////////////////
+
+// Compute log2 of a nonzero magnitude in units of 2^-64, as a signed
+// number with 120 fraction bits. With mag = 2^e * m and m in [1, 2),
+// log2(m) = log2(m * r_j) - log2(r_j), where r_j is the table reciprocal
+// for the top 7 fraction bits j of m, and m * r_j = 1 + t with t in
+// [0, 1/128 + 2^-58].
+static i128 log2_reduced(u128 mag)
+{
+    int lz = clz_128(mag);
+    int e = 63 - lz;
+    // m in Q127
+    u128 m = mag << lz;
+    unsigned j = (unsigned)(m >> 120) & (LOG2_TABLE_SIZE - 1);
+    // m * r_j in Q190 is 2^190 + t, and t fits in 121 bits as a Q128
+    uint64_t recip = log2_recip[j];
+    u128 lo = (u128)(uint64_t)m * recip;
+    u128 hi = (m >> 64) * recip + (lo >> 64);
+    u128 t = (hi - ((u128)1 << 126)) << 2 | (uint64_t)lo >> 62;
+    i128 frac = (i128)(table_value(log2_table[j]) >> 2) + horner(log2_poly, LOG2_POLY_DEGREE, t);
+    return (i128)e * ((i128)1 << 120) + (frac >> 6);
+}
+
+// Check the argument of a logarithm, storing the result for arguments that
+// have no finite logarithm
+static int log_domain(Fixedpoint val, Fixedpoint *result)
+{
+    if (!fixedpoint_is_valid(val) || val.tag == VALID_NEGATIVE)
+    {
+        *result = tagged_value(ERROR);
+        return 0;
+    }
+    if (val.whole == 0 && val.frac == 0)
+    {
+        *result = tagged_value(OVERFLOW_NEGATIVE);
+        return 0;
+    }
+    return 1;
+}
+
+Fixedpoint fixedpoint_log2(Fixedpoint val)
+{
+    Fixedpoint result;
+    if (!log_domain(val, &result))
+    {
+        return result;
+    }
+    return round_fixed(log2_reduced(magnitude(val)), 120);
+}
+
+Fixedpoint fixedpoint_log(Fixedpoint val)
+{
+    Fixedpoint result;
+    if (!log_domain(val, &result))
+    {
+        return result;
+    }
+    i128 v = log2_reduced(magnitude(val));
+    u128 upper, lower;
+    mul_128(abs_wide(v), LN2_U128, &upper, &lower);
+    return round_fixed(v < 0 ? -(i128)upper : (i128)upper, 120);
+}
+
+Fixedpoint fixedpoint_pow(Fixedpoint base, Fixedpoint exponent)
+{
+    if (!fixedpoint_is_valid(base) || !fixedpoint_is_valid(exponent) || base.tag == VALID_NEGATIVE)
+    {
+        return tagged_value(ERROR);
+    }
+    u128 exp_mag = magnitude(exponent);
+    if (exp_mag == 0)
+    {
+        return make_value((u128)1 << 64, 0);
+    }
+    if (base.whole == 0 && base.frac == 0)
+    {
+        return exponent.tag == VALID_NEGATIVE ? tagged_value(OVERFLOW_POSITIVE) : make_value(0, 0);
+    }
+
+    // exponent * log2(base) in units of 2^-184
+    i128 lg = log2_reduced(magnitude(base));
+    int negative = (lg < 0) != (exponent.tag == VALID_NEGATIVE);
+    u128 upper, lower;
+    mul_128(exp_mag, abs_wide(lg), &upper, &lower);
+    u128 whole = upper >> 56;
+    if (whole >= 128)
+    {
+        return negative ? make_value(0, 0) : tagged_value(OVERFLOW_POSITIVE);
+    }
+    u128 f = upper << 72 | lower >> 56;
+    return negative ? exp2_reduced_neg((int64_t)whole, f) : exp2_reduced((int64_t)whole, f);
+}
+
+//////////////////////////////////////////////////////////////////////
+// Trigonometric functions
+//////////////////////////////////////////////////////////////////////
+
+// CORDIC (Volder, 1959) rotates a vector by a sequence of angles atan(2^-i),
+// each rotation needing only shifts and additions. Values are Q125 (signed,
+// 125 fraction bits). After n iterations the remaining angle is below
+// atan(2^-(n - 1)), so 68 iterations leave an error of about 2^-67 plus
+// one unit of 2^-125 per iteration, well below the final rounding.
+
+#define CORDIC_ITERATIONS 68
+
+// atan(2^-i), Q125
+static const uint64_t cordic_angles[CORDIC_ITERATIONS][2] = {
+    {0x1921fb54442d1846UL, 0x9898cc51701b839aUL},
+    {0x0ed63382b0dda7b4UL, 0x56fe445ecbc3a8d0UL},
+    {0x07d6dd7e4b203758UL, 0xab6e3cf7afbd10bfUL},
+    {0x03fab7535585edb8UL, 0xcb225e627cfa223cUL},
+    {0x01ff55bb72cfde9cUL, 0x6d964f25b81c5c1bUL},
+    {0x00ffeaaddd4bb125UL, 0x42779d776dda8c62UL},
+    {0x007ffd556eedca6aUL, 0xddf3c62b200afbb0UL},
+    {0x003fffaaab77752eUL, 0x5a0188d47eef982cUL},
+    {0x001ffff5555bbbb7UL, 0x2976255f6d6da9f0UL},
+    {0x000ffffeaaaaddddUL, 0xd4b94d5bd56044a4UL},
+    {0x0007ffffd55556eeUL, 0xeedca5cb4033f79dUL},
+    {0x0003fffffaaaaab7UL, 0x777752e52ec4ac49UL},
+    {0x0001ffffff555555UL, 0xbbbbbb729729ab7bUL},
+    {0x0000ffffffeaaaaaUL, 0xaddddddd4b94b968UL},
+    {0x00007ffffffd5555UL, 0x556eeeeeedca5ca6UL},
+    {0x00003fffffffaaaaUL, 0xaaab777777752e53UL},
+    {0x00001ffffffff555UL, 0x55555bbbbbbbb729UL},
+    {0x00000ffffffffeaaUL, 0xaaaaaaddddddddd5UL},
+    {0x000007ffffffffd5UL, 0x55555556eeeeeeefUL},
+    {0x000003fffffffffaUL, 0xaaaaaaaab7777777UL},
+    {0x000001ffffffffffUL, 0x5555555555bbbbbcUL},
+    {0x000000ffffffffffUL, 0xeaaaaaaaaaaddddeUL},
+    {0x0000007fffffffffUL, 0xfd55555555556eefUL},
+    {0x0000003fffffffffUL, 0xffaaaaaaaaaaab77UL},
+    {0x0000001fffffffffUL, 0xfff555555555555cUL},
+    {0x0000000fffffffffUL, 0xfffeaaaaaaaaaaabUL},
+    {0x00000007ffffffffUL, 0xffffd55555555555UL},
+    {0x00000003ffffffffUL, 0xfffffaaaaaaaaaabUL},
+    {0x00000001ffffffffUL, 0xffffff5555555555UL},
+    {0x00000000ffffffffUL, 0xffffffeaaaaaaaabUL},
+    {0x000000007fffffffUL, 0xfffffffd55555555UL},
+    {0x000000003fffffffUL, 0xffffffffaaaaaaabUL},
+    {0x000000001fffffffUL, 0xfffffffff5555555UL},
+    {0x000000000fffffffUL, 0xfffffffffeaaaaabUL},
+    {0x0000000007ffffffUL, 0xffffffffffd55555UL},
+    {0x0000000003ffffffUL, 0xfffffffffffaaaabUL},
+    {0x0000000001ffffffUL, 0xffffffffffff5555UL},
+    {0x0000000000ffffffUL, 0xffffffffffffeaabUL},
+    {0x00000000007fffffUL, 0xfffffffffffffd55UL},
+    {0x00000000003fffffUL, 0xffffffffffffffabUL},
+    {0x00000000001fffffUL, 0xfffffffffffffff5UL},
+    {0x00000000000fffffUL, 0xffffffffffffffffUL},
+    {0x0000000000080000UL, 0x0000000000000000UL},
+    {0x0000000000040000UL, 0x0000000000000000UL},
+    {0x0000000000020000UL, 0x0000000000000000UL},
+    {0x0000000000010000UL, 0x0000000000000000UL},
+    {0x0000000000008000UL, 0x0000000000000000UL},
+    {0x0000000000004000UL, 0x0000000000000000UL},
+    {0x0000000000002000UL, 0x0000000000000000UL},
+    {0x0000000000001000UL, 0x0000000000000000UL},
+    {0x0000000000000800UL, 0x0000000000000000UL},
+    {0x0000000000000400UL, 0x0000000000000000UL},
+    {0x0000000000000200UL, 0x0000000000000000UL},
+    {0x0000000000000100UL, 0x0000000000000000UL},
+    {0x0000000000000080UL, 0x0000000000000000UL},
+    {0x0000000000000040UL, 0x0000000000000000UL},
+    {0x0000000000000020UL, 0x0000000000000000UL},
+    {0x0000000000000010UL, 0x0000000000000000UL},
+    {0x0000000000000008UL, 0x0000000000000000UL},
+    {0x0000000000000004UL, 0x0000000000000000UL},
+    {0x0000000000000002UL, 0x0000000000000000UL},
+    {0x0000000000000001UL, 0x0000000000000000UL},
+    {0x0000000000000000UL, 0x8000000000000000UL},
+    {0x0000000000000000UL, 0x4000000000000000UL},
+    {0x0000000000000000UL, 0x2000000000000000UL},
+    {0x0000000000000000UL, 0x1000000000000000UL},
+    {0x0000000000000000UL, 0x0800000000000000UL},
+    {0x0000000000000000UL, 0x0400000000000000UL},
+};
+
+// The product of 1 / sqrt(1 + 2^-2i) over all iterations, which cancels
+// the growth of the vector, Q125
+static const uint64_t cordic_gain[2] = {0x136e9db5086bcb4cUL, 0xfebf21257affa81dUL};
+
+// pi, Q125
+static const uint64_t pi_q125[2] = {0x6487ed5110b4611aUL, 0x62633145c06e0e69UL};
+
+// pi / 2, U1.127
+static const uint64_t half_pi[2] = {0xc90fdaa22168c234UL, 0xc4c6628b80dc1cd1UL};
+
+// The first 256 fraction bits of 2 / pi, least significant limb first
+static const uint64_t two_over_pi[4] = {
+    0xfe5163abdebbc561UL, 0xdb6295993c439041UL, 0xfc2757d1f534ddc0UL, 0xa2f9836e4e441529UL,
+};
+
+// Reduce an angle magnitude in units of 2^-64 modulo pi / 2, the
+// Payne-Hanek way: multiply it by 2 / pi to 256 bits, so that the quadrant
+// and the fraction below it are exact to far below 2^-128. Returns the
+// nearest quadrant count modulo 4, and stores the rest of the angle, in
+// [-pi/4, pi/4], in reduced as a Q125.
+static unsigned reduce_angle(u128 mag, i128 *reduced)
+{
+    // mag * 2/pi in units of 2^-320
+    uint64_t product[6] = {0};
+    uint64_t m[2] = {(uint64_t)mag, (uint64_t)(mag >> 64)};
+    for (int i = 0; i < 2; ++i)
+    {
+        uint64_t carry = 0;
+        for (int j = 0; j < 4; ++j)
+        {
+            u128 t = (u128)m[i] * two_over_pi[j] + product[i + j] + carry;
+            product[i + j] = (uint64_t)t;
+            carry = (uint64_t)(t >> 64);
+        }
+        product[i + 4] = carry;
+    }
+
+    // A fraction of a half or more rounds up to the next quadrant, leaving
+    // the two's complement fraction as a negative remainder
+    u128 frac = (u128)product[4] << 64 | product[3];
+    unsigned quadrant = ((unsigned)product[5] + (unsigned)(frac >> 127)) & 3;
+    i128 f = (i128)frac;
+
+    // f * pi/2, from units of 2^-255 to Q125
+    u128 upper, lower;
+    mul_128(abs_wide(f), table_value(half_pi), &upper, &lower);
+    *reduced = f < 0 ? -(i128)(upper >> 2) : (i128)(upper >> 2);
+    return quadrant;
+}
+
+// Negate v if mask is all ones; leave it alone if mask is zero. The
+// CORDIC loops use this instead of branching on a sign that is as good as
+// random at every iteration.
+static i128 negate_if(i128 v, i128 mask)
+{
+    return (v ^ mask) - mask;
+}
+
+// Rotate (gain, 0) by the angle z in [-pi/4, pi/4], giving (cos z, sin z)
+static void cordic_rotate(i128 z, i128 *cos_out, i128 *sin_out)
+{
+    i128 x = (i128)table_value(cordic_gain), y = 0;
+    for (int i = 0; i < CORDIC_ITERATIONS; ++i)
+    {
+        // Rotate towards z = 0: counterclockwise when z >= 0
+        i128 mask = z >> 127;
+        i128 dx = negate_if(y >> i, mask), dy = negate_if(x >> i, mask);
+        x -= dx;
+        y += dy;
+        z -= negate_if((i128)table_value(cordic_angles[i]), mask);
+    }
+    *cos_out = x;
+    *sin_out = y;
+}
+
+void fixedpoint_sincos(Fixedpoint val, Fixedpoint *sin_out, Fixedpoint *cos_out)
+{
+    if (!fixedpoint_is_valid(val))
+    {
+        *sin_out = *cos_out = tagged_value(ERROR);
+        return;
+    }
+    i128 reduced, c, s;
+    unsigned quadrant = reduce_angle(magnitude(val), &reduced);
+    cordic_rotate(reduced, &c, &s);
+
+    // Rotate by the quadrant: sin(x + k pi/2) and cos(x + k pi/2)
+    i128 sin_val = (quadrant & 1) ? c : s;
+    i128 cos_val = (quadrant & 1) ? s : c;
+    if (quadrant == 2 || quadrant == 3)
+    {
+        sin_val = -sin_val;
+    }
+    if (quadrant == 1 || quadrant == 2)
+    {
+        cos_val = -cos_val;
+    }
+    if (val.tag == VALID_NEGATIVE)
+    {
+        sin_val = -sin_val;
+    }
+    *sin_out = round_fixed(sin_val, 125);
+    *cos_out = round_fixed(cos_val, 125);
+}
+
+Fixedpoint fixedpoint_sin(Fixedpoint val)
+{
+    Fixedpoint s, c;
+    fixedpoint_sincos(val, &s, &c);
+    return s;
+}
+
+Fixedpoint fixedpoint_cos(Fixedpoint val)
+{
+    Fixedpoint s, c;
+    fixedpoint_sincos(val, &s, &c);
+    return c;
+}
+
+Fixedpoint fixedpoint_atan2(Fixedpoint y, Fixedpoint x)
+{
+    if (!fixedpoint_is_valid(y) || !fixedpoint_is_valid(x))
+    {
+        return tagged_value(ERROR);
+    }
+    u128 mx = magnitude(x), my = magnitude(y);
+    if (mx == 0 && my == 0)
+    {
+        return make_value(0, 0);
+    }
+
+    // Scale the vector so that the larger coordinate is just below 2^124,
+    // which leaves room for the CORDIC gain of about 1.65
+    int shift = clz_128(mx > my ? mx : my) - 4;
+    mx = shift >= 0 ? mx << shift : mx >> -shift;
+    my = shift >= 0 ? my << shift : my >> -shift;
+
+    // Rotate (|x|, y) onto the x axis, adding up the angles: z becomes
+    // atan2(y, |x|), in [-pi/2, pi/2]
+    i128 cx = (i128)mx, cy = y.tag == VALID_NEGATIVE ? -(i128)my : (i128)my, z = 0;
+    for (int i = 0; i < CORDIC_ITERATIONS; ++i)
+    {
+        // Rotate towards y = 0: clockwise when y >= 0
+        i128 mask = cy >> 127;
+        i128 dx = negate_if(cy >> i, mask), dy = negate_if(cx >> i, mask);
+        cx += dx;
+        cy -= dy;
+        z += negate_if((i128)table_value(cordic_angles[i]), mask);
+    }
+
+    // Reflect the angle for a negative x
+    if (x.tag == VALID_NEGATIVE)
+    {
+        i128 pi = (i128)table_value(pi_q125);
+        z = y.tag == VALID_NEGATIVE ? -pi - z : pi - z;
+    }
+    return round_fixed(z, 125);
+}
+
+//////////////////////////////////////////////////////////////////////
+// Batch versions
+//////////////////////////////////////////////////////////////////////
+
+void fixedpoint_sqrt_batch(const Fixedpoint *vals, FixedpointRound mode, Fixedpoint *out, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        out[i] = fixedpoint_sqrt(vals[i], mode);
+    }
+}
+
+void fixedpoint_exp2_batch(const Fixedpoint *vals, Fixedpoint *out, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        out[i] = fixedpoint_exp2(vals[i]);
+    }
+}
+
+void fixedpoint_exp_batch(const Fixedpoint *vals, Fixedpoint *out, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        out[i] = fixedpoint_exp(vals[i]);
+    }
+}
+
+void fixedpoint_log2_batch(const Fixedpoint *vals, Fixedpoint *out, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        out[i] = fixedpoint_log2(vals[i]);
+    }
+}
+
+void fixedpoint_log_batch(const Fixedpoint *vals, Fixedpoint *out, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        out[i] = fixedpoint_log(vals[i]);
+    }
+}
+
+void fixedpoint_pow_batch(const Fixedpoint *base, const Fixedpoint *exponent, Fixedpoint *out, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        out[i] = fixedpoint_pow(base[i], exponent[i]);
+    }
+}
+
+void fixedpoint_sin_batch(const Fixedpoint *vals, Fixedpoint *out, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        out[i] = fixedpoint_sin(vals[i]);
+    }
+}
+
+void fixedpoint_cos_batch(const Fixedpoint *vals, Fixedpoint *out, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        out[i] = fixedpoint_cos(vals[i]);
+    }
+}
+
+void fixedpoint_sincos_batch(const Fixedpoint *vals, Fixedpoint *sin_out, Fixedpoint *cos_out, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        // Read the angle first, since the outputs may alias the input
+        Fixedpoint val = vals[i];
+        fixedpoint_sincos(val, &sin_out[i], &cos_out[i]);
+    }
+}
+
+void fixedpoint_atan2_batch(const Fixedpoint *y, const Fixedpoint *x, Fixedpoint *out, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        out[i] = fixedpoint_atan2(y[i], x[i]);
+    }
+}
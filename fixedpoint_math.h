@@ -0,0 +1,153 @@
+#ifndef FIXEDPOINT_MATH_H
+#define FIXEDPOINT_MATH_H
+
+#include <stddef.h>
+#include "fixedpoint.h"
+
+// Elementary functions on Fixedpoint values, computed entirely in integer
+// arithmetic so that the results are the same on every platform.
+//
+// The square root is exact (correctly rounded). The other functions reduce
+// their argument to a small interval with a lookup table and evaluate a
+// polynomial there in 128 bit fixed point, so their results carry a small
+// error before the final rounding to a multiple of 2^-64. The bound for each
+// function is given with it; "ulp" means 2^-64, the spacing of Fixedpoint
+// values. None of the functions tag a rounded result as an underflow.
+//
+// The trigonometric functions use CORDIC, which needs only shifts and
+// additions, after an exact reduction of the angle modulo pi/2. Their
+// results are within 1 ulp of the exact values for every angle.
+
+// Compute the square root of a Fixedpoint value.
+//
+// Parameters:
+//   val - the value
+//   mode - how to round the root
+//
+// Returns:
+//   the square root of val, rounded according to mode (with
+//   FIXEDPOINT_ROUND_EXACT, a value tagged UNDERFLOW_POSITIVE if the root
+//   is not a multiple of 2^-64);
+//   an error value if val is negative or not valid
+Fixedpoint fixedpoint_sqrt(Fixedpoint val, FixedpointRound mode);
+
+// Compute 2^val. The result is within 0.5 ulp + |2^val| * 2^-118 of the
+// exact value, which is below 1 ulp whenever val < 54. Integer powers of
+// two are exact.
+//
+// Parameters:
+//   val - the exponent
+//
+// Returns:
+//   2^val;
+//   a value tagged OVERFLOW_POSITIVE if val >= 64;
+//   an error value if val is not valid
+Fixedpoint fixedpoint_exp2(Fixedpoint val);
+
+// Compute e^val. The error bound is the same as for fixedpoint_exp2; the
+// result is below 1 ulp from the exact value whenever val < 37.
+//
+// Parameters:
+//   val - the exponent
+//
+// Returns:
+//   e^val;
+//   a value tagged OVERFLOW_POSITIVE if the result is 2^64 or more (val is
+//   above 44.36);
+//   an error value if val is not valid
+Fixedpoint fixedpoint_exp(Fixedpoint val);
+
+// Compute the base 2 logarithm of a Fixedpoint value. The result is within
+// 0.5 ulp + 2^-118 of the exact value (so below 1 ulp), and is exact for
+// powers of two.
+//
+// Parameters:
+//   val - the value
+//
+// Returns:
+//   log2(val);
+//   a value tagged OVERFLOW_NEGATIVE if val is zero;
+//   an error value if val is negative or not valid
+Fixedpoint fixedpoint_log2(Fixedpoint val);
+
+// Compute the natural logarithm of a Fixedpoint value. The error bound is
+// the same as for fixedpoint_log2.
+//
+// Parameters:
+//   val - the value
+//
+// Returns:
+//   ln(val);
+//   a value tagged OVERFLOW_NEGATIVE if val is zero;
+//   an error value if val is negative or not valid
+Fixedpoint fixedpoint_log(Fixedpoint val);
+
+// Compute base^exponent as 2^(exponent * log2(base)). The error of the
+// logarithm is scaled by the exponent, so the result is within
+// 0.5 ulp + |base^exponent| * 2^-117 * (1 + |exponent|) of the exact value.
+//
+// Parameters:
+//   base - the base
+//   exponent - the exponent
+//
+// Returns:
+//   base^exponent (1 if exponent is zero, including for a zero base);
+//   a value tagged OVERFLOW_POSITIVE if the result is 2^64 or more, or if
+//   base is zero and exponent is negative;
+//   an error value if base is negative or either value is not valid
+Fixedpoint fixedpoint_pow(Fixedpoint base, Fixedpoint exponent);
+
+// Compute the sine and cosine of an angle in radians together.
+//
+// Parameters:
+//   val - the angle
+//   sin_out - where to store sin(val)
+//   cos_out - where to store cos(val)
+//
+// Stores error values if val is not valid.
+void fixedpoint_sincos(Fixedpoint val, Fixedpoint *sin_out, Fixedpoint *cos_out);
+
+// Compute the sine of an angle in radians.
+//
+// Parameters:
+//   val - the angle
+//
+// Returns:
+//   sin(val), or an error value if val is not valid
+Fixedpoint fixedpoint_sin(Fixedpoint val);
+
+// Compute the cosine of an angle in radians. See fixedpoint_sin.
+Fixedpoint fixedpoint_cos(Fixedpoint val);
+
+// Compute the angle of the point (x, y) from the positive x axis.
+//
+// Parameters:
+//   y - the y coordinate
+//   x - the x coordinate
+//
+// Returns:
+//   the angle in radians, in [-pi, pi] (pi when y is zero and x negative,
+//   and zero when both are zero);
+//   an error value if either value is not valid
+Fixedpoint fixedpoint_atan2(Fixedpoint y, Fixedpoint x);
+
+// Batch versions of the elementary functions. out[i] is the result of the
+// function on element i of the inputs. out may alias an input.
+//
+// Parameters:
+//   vals, base, exponent, y, x - the input arrays
+//   mode - how to round (fixedpoint_sqrt_batch only)
+//   out, sin_out, cos_out - the output arrays
+//   count - the number of elements
+void fixedpoint_sqrt_batch(const Fixedpoint *vals, FixedpointRound mode, Fixedpoint *out, size_t count);
+void fixedpoint_exp2_batch(const Fixedpoint *vals, Fixedpoint *out, size_t count);
+void fixedpoint_exp_batch(const Fixedpoint *vals, Fixedpoint *out, size_t count);
+void fixedpoint_log2_batch(const Fixedpoint *vals, Fixedpoint *out, size_t count);
+void fixedpoint_log_batch(const Fixedpoint *vals, Fixedpoint *out, size_t count);
+void fixedpoint_pow_batch(const Fixedpoint *base, const Fixedpoint *exponent, Fixedpoint *out, size_t count);
+void fixedpoint_sin_batch(const Fixedpoint *vals, Fixedpoint *out, size_t count);
+void fixedpoint_cos_batch(const Fixedpoint *vals, Fixedpoint *out, size_t count);
+void fixedpoint_sincos_batch(const Fixedpoint *vals, Fixedpoint *sin_out, Fixedpoint *cos_out, size_t count);
+void fixedpoint_atan2_batch(const Fixedpoint *y, const Fixedpoint *x, Fixedpoint *out, size_t count);
+
+#endif // FIXEDPOINT_MATH_H
@@ -0,0 +1,351 @@
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "fixedpoint_matrix.h"
+#include "fixedpoint_accum.h"
+
+// The number of rows of a (or columns of b) in a packed panel (see kernel)
+#define PANEL 2
+
+// The number of rows and columns of an output tile (a multiple of PANEL)
+#define TILE 32
+
+// The number of terms of a tile computed per pass over its panels: the part
+// of the panels that one pass reads (about 100 KB) stays in cache for the
+// whole pass
+#define DEPTH_BLOCK 128
+
+// The number of matrix rows fixedpoint_gemv computes together, so that each
+// element of x is read once per group of rows
+#define GEMV_ROWS 2
+
+// A matrix product and how it is divided among threads
+//
+// Fields:
+//  a - the packed rows of a, in panels of PANEL rows (gemm only)
+//  b - the packed columns of b, in panels of PANEL columns, or the packed x
+//  a_elements - the elements of a (gemv packs them as it reads them)
+//  row_invalid - for each row of a, whether it holds a value that is not valid
+//  col_invalid - for each column of b (or for x), whether it holds a value that is
+//                not valid
+//  out - the output matrix
+//  m, n, k - the dimensions of the product
+//  mode - how to round the results
+//  num_threads - the number of threads
+//  tiles_across - the number of output tiles in a row of tiles
+//  num_tiles - the number of output tiles
+typedef struct
+{
+    const FixedpointProductTerm *a;
+    const FixedpointProductTerm *b;
+    const Fixedpoint *a_elements;
+    const unsigned char *row_invalid;
+    const unsigned char *col_invalid;
+    Fixedpoint *out;
+    size_t m, n, k;
+    FixedpointRound mode;
+    unsigned num_threads;
+    size_t tiles_across;
+    size_t num_tiles;
+} MatrixJob;
+
+// The part of a job done by one thread
+//
+// Fields:
+//  job - the job
+//  thread - the index of the thread
+typedef struct
+{
+    const MatrixJob *job;
+    unsigned thread;
+} MatrixWorker;
+
+// Pack the rows of a in panels of PANEL rows: the panel of rows i..i+PANEL-1
+// holds element l of each of its rows, then element l + 1, and so on. Rows
+// past the end of a are filled with zeros.
+static void pack_rows(const Fixedpoint *a, size_t m, size_t k, FixedpointProductTerm *packed, unsigned char *invalid)
+{
+    FixedpointProductTerm zero = {0, 0, 0};
+    for (size_t i = 0; i < m; i += PANEL)
+    {
+        for (size_t l = 0; l < k; ++l)
+        {
+            for (size_t r = 0; r < PANEL; ++r)
+            {
+                *packed++ = i + r < m ? fixedpoint_product_term_checked(a[(i + r) * k + l], &invalid[i + r]) : zero;
+            }
+        }
+    }
+}
+
+// Pack the columns of b in panels of PANEL columns, in the same way
+static void pack_cols(const Fixedpoint *b, size_t k, size_t n, FixedpointProductTerm *packed, unsigned char *invalid)
+{
+    FixedpointProductTerm zero = {0, 0, 0};
+    for (size_t j = 0; j < n; j += PANEL)
+    {
+        for (size_t l = 0; l < k; ++l)
+        {
+            for (size_t r = 0; r < PANEL; ++r)
+            {
+                *packed++ = j + r < n ? fixedpoint_product_term_checked(b[l * n + j + r], &invalid[j + r]) : zero;
+            }
+        }
+    }
+}
+
+// Accumulate depth terms of the PANEL by PANEL block of outputs of a panel
+// of a and a panel of b. acc points to the block's first accumulator, and
+// stride is the distance between its rows. The block is computed a row at a
+// time, with the two sums of the row in local variables so that they stay
+// in registers (this is written for PANEL = 2).
+static void kernel(const FixedpointProductTerm *a, const FixedpointProductTerm *b, size_t depth, FixedpointProductAccum *acc,
+                   size_t stride)
+{
+    for (size_t r = 0; r < PANEL; ++r)
+    {
+        FixedpointProductAccum sum0 = acc[r * stride];
+        FixedpointProductAccum sum1 = acc[r * stride + 1];
+        for (size_t l = 0; l < depth; ++l)
+        {
+            FixedpointProductTerm x = a[l * PANEL + r];
+            fixedpoint_product_accum_add(&sum0, x, b[l * PANEL]);
+            fixedpoint_product_accum_add(&sum1, x, b[l * PANEL + 1]);
+        }
+        acc[r * stride] = sum0;
+        acc[r * stride + 1] = sum1;
+    }
+}
+
+static size_t min_size(size_t a, size_t b)
+{
+    return a < b ? a : b;
+}
+
+// Compute one output tile
+static void gemm_tile(const MatrixJob *job, size_t tile, FixedpointProductAccum *acc)
+{
+    size_t i0 = tile / job->tiles_across * TILE;
+    size_t j0 = tile % job->tiles_across * TILE;
+    size_t rows = min_size(TILE, job->m - i0);
+    size_t cols = min_size(TILE, job->n - j0);
+    size_t k = job->k;
+    memset(acc, 0, TILE * TILE * sizeof(FixedpointProductAccum));
+
+    for (size_t l0 = 0; l0 < k; l0 += DEPTH_BLOCK)
+    {
+        size_t depth = min_size(DEPTH_BLOCK, k - l0);
+        for (size_t r = 0; r < rows; r += PANEL)
+        {
+            const FixedpointProductTerm *a = job->a + ((i0 + r) * k + l0 * PANEL);
+            for (size_t s = 0; s < cols; s += PANEL)
+            {
+                const FixedpointProductTerm *b = job->b + ((j0 + s) * k + l0 * PANEL);
+                kernel(a, b, depth, &acc[r * TILE + s], TILE);
+            }
+        }
+    }
+
+    for (size_t r = 0; r < rows; ++r)
+    {
+        for (size_t s = 0; s < cols; ++s)
+        {
+            int invalid = job->row_invalid[i0 + r] || job->col_invalid[j0 + s];
+            job->out[(i0 + r) * job->n + j0 + s] =
+                fixedpoint_product_accum_checked_result(&acc[r * TILE + s], invalid, job->mode);
+        }
+    }
+}
+
+static void *gemm_worker(void *arg)
+{
+    MatrixWorker *worker = arg;
+    const MatrixJob *job = worker->job;
+    FixedpointProductAccum acc[TILE * TILE];
+    for (size_t tile = worker->thread; tile < job->num_tiles; tile += job->num_threads)
+    {
+        gemm_tile(job, tile, acc);
+    }
+    return NULL;
+}
+
+// Compute the rows of a matrix-vector product assigned to one thread, in
+// groups of GEMV_ROWS rows
+static void *gemv_worker(void *arg)
+{
+    MatrixWorker *worker = arg;
+    const MatrixJob *job = worker->job;
+    size_t k = job->k;
+    size_t begin = job->m * worker->thread / job->num_threads;
+    size_t end = job->m * (worker->thread + 1) / job->num_threads;
+
+    for (size_t i0 = begin; i0 < end; i0 += GEMV_ROWS)
+    {
+        size_t rows = min_size(GEMV_ROWS, end - i0);
+        FixedpointProductAccum acc[GEMV_ROWS] = {{{0}}};
+        unsigned char invalid[GEMV_ROWS] = {0};
+        const Fixedpoint *a = job->a_elements + i0 * k;
+        if (rows == GEMV_ROWS)
+        {
+            for (size_t l = 0; l < k; ++l)
+            {
+                for (size_t r = 0; r < GEMV_ROWS; ++r)
+                {
+                    FixedpointProductTerm term = fixedpoint_product_term_checked(a[r * k + l], &invalid[r]);
+                    fixedpoint_product_accum_add(&acc[r], term, job->b[l]);
+                }
+            }
+        }
+        else
+        {
+            for (size_t r = 0; r < rows; ++r)
+            {
+                for (size_t l = 0; l < k; ++l)
+                {
+                    FixedpointProductTerm term = fixedpoint_product_term_checked(a[r * k + l], &invalid[r]);
+                    fixedpoint_product_accum_add(&acc[r], term, job->b[l]);
+                }
+            }
+        }
+        for (size_t r = 0; r < rows; ++r)
+        {
+            int bad = invalid[r] || job->col_invalid[0];
+            job->out[i0 + r] = fixedpoint_product_accum_checked_result(&acc[r], bad, job->mode);
+        }
+    }
+    return NULL;
+}
+
+// Run fn on every thread of a job and wait for all of them. A job with one
+// thread runs on the calling thread.
+static int run_workers(const MatrixJob *job, void *(*fn)(void *))
+{
+    if (job->num_threads == 1)
+    {
+        MatrixWorker worker = {job, 0};
+        fn(&worker);
+        return 1;
+    }
+
+    MatrixWorker *workers = malloc(job->num_threads * sizeof(MatrixWorker));
+    pthread_t *threads = malloc(job->num_threads * sizeof(pthread_t));
+    unsigned started = 0;
+    int ok = workers != NULL && threads != NULL;
+    for (; ok && started < job->num_threads; ++started)
+    {
+        workers[started].job = job;
+        workers[started].thread = started;
+        if (pthread_create(&threads[started], NULL, fn, &workers[started]) != 0)
+        {
+            ok = 0;
+            break;
+        }
+    }
+    for (unsigned t = 0; t < started; ++t)
+    {
+        pthread_join(threads[t], NULL);
+    }
+    free(workers);
+    free(threads);
+    return ok;
+}
+
+int fixedpoint_gemm(const Fixedpoint *a, const Fixedpoint *b, Fixedpoint *c, size_t m, size_t n, size_t k,
+                    FixedpointRound mode, unsigned num_threads)
+{
+    if (m == 0 || n == 0)
+    {
+        return 1;
+    }
+    if (k == 0)
+    {
+        Fixedpoint zero = {0, 0, VALID_NONNEGATIVE};
+        for (size_t i = 0; i < m * n; ++i)
+        {
+            c[i] = zero;
+        }
+        return 1;
+    }
+
+    size_t row_panels = (m + PANEL - 1) / PANEL;
+    size_t col_panels = (n + PANEL - 1) / PANEL;
+    FixedpointProductTerm *packed_a = malloc(row_panels * PANEL * k * sizeof(FixedpointProductTerm));
+    FixedpointProductTerm *packed_b = malloc(col_panels * PANEL * k * sizeof(FixedpointProductTerm));
+    unsigned char *row_invalid = calloc(m, 1);
+    unsigned char *col_invalid = calloc(n, 1);
+    int ok = packed_a != NULL && packed_b != NULL && row_invalid != NULL && col_invalid != NULL;
+
+    if (ok)
+    {
+        pack_rows(a, m, k, packed_a, row_invalid);
+        pack_cols(b, k, n, packed_b, col_invalid);
+
+        MatrixJob job;
+        job.a = packed_a;
+        job.b = packed_b;
+        job.a_elements = a;
+        job.row_invalid = row_invalid;
+        job.col_invalid = col_invalid;
+        job.out = c;
+        job.m = m;
+        job.n = n;
+        job.k = k;
+        job.mode = mode;
+        job.tiles_across = (n + TILE - 1) / TILE;
+        job.num_tiles = (m + TILE - 1) / TILE * job.tiles_across;
+        job.num_threads = num_threads == 0 ? 1 : num_threads;
+        if (job.num_threads > job.num_tiles)
+        {
+            job.num_threads = (unsigned)job.num_tiles;
+        }
+        ok = run_workers(&job, gemm_worker);
+    }
+
+    free(packed_a);
+    free(packed_b);
+    free(row_invalid);
+    free(col_invalid);
+    return ok;
+}
+
+int fixedpoint_gemv(const Fixedpoint *a, const Fixedpoint *x, Fixedpoint *y, size_t m, size_t k,
+                    FixedpointRound mode, unsigned num_threads)
+{
+    if (m == 0)
+    {
+        return 1;
+    }
+
+    FixedpointProductTerm *packed_x = malloc((k == 0 ? 1 : k) * sizeof(FixedpointProductTerm));
+    if (packed_x == NULL)
+    {
+        return 0;
+    }
+    unsigned char x_invalid = 0;
+    for (size_t l = 0; l < k; ++l)
+    {
+        packed_x[l] = fixedpoint_product_term_checked(x[l], &x_invalid);
+    }
+
+    MatrixJob job;
+    job.a = NULL;
+    job.b = packed_x;
+    job.a_elements = a;
+    job.row_invalid = NULL;
+    job.col_invalid = &x_invalid;
+    job.out = y;
+    job.m = m;
+    job.n = 1;
+    job.k = k;
+    job.mode = mode;
+    job.tiles_across = 1;
+    job.num_tiles = (m + GEMV_ROWS - 1) / GEMV_ROWS;
+    job.num_threads = num_threads == 0 ? 1 : num_threads;
+    if (job.num_threads > job.num_tiles)
+    {
+        job.num_threads = (unsigned)job.num_tiles;
+    }
+    int ok = run_workers(&job, gemv_worker);
+    free(packed_x);
+    return ok;
+}
@@ -0,0 +1,63 @@
+#ifndef FIXEDPOINT_MATRIX_H
+#define FIXEDPOINT_MATRIX_H
+
+#include <stddef.h>
+#include "fixedpoint.h"
+
+// Matrix products of Fixedpoint matrices, stored row-major.
+//
+// Every output element is the exact sum of the exact products, rounded
+// once: the products are accumulated in a FixedpointProductAccum, which
+// cannot overflow for fewer than 2^63 terms, and the range of the result is
+// checked only when it is converted back. The result therefore does not
+// depend on the blocking or the number of threads. It is not always what
+// summing fixedpoint256_mul products with fixedpoint256_add would give: a
+// partial sum that overflows 128.128 there does not matter here, as long as
+// the exact sum can be represented.
+//
+// The operands are first converted to a packed layout without tags, in
+// panels of a few rows of a and a few columns of b, so that the inner loop
+// reads both operands sequentially. The output is computed in tiles small
+// enough for the panels they use to stay in cache, and the tiles are
+// divided among the threads.
+
+// Multiply two matrices: c = a b.
+//
+// Parameters:
+//   a - the left matrix, m rows by k columns
+//   b - the right matrix, k rows by n columns
+//   c - receives the product, m rows by n columns (must not overlap a or b)
+//   m - the number of rows of a and c
+//   n - the number of columns of b and c
+//   k - the number of columns of a and rows of b
+//   mode - how to round each element of the product to a multiple of 2^-64
+//   num_threads - the number of threads to use (0 or 1 computes serially)
+//
+// Returns:
+//   1 if successful, with each element of c set to its value rounded
+//   according to mode (see fixedpoint256_to_fixedpoint for the tags of
+//   results that are inexact with FIXEDPOINT_ROUND_EXACT or that overflow),
+//   or to an error value if its row of a or its column of b holds a value
+//   that is not valid;
+//   0 if memory or threads could not be allocated
+int fixedpoint_gemm(const Fixedpoint *a, const Fixedpoint *b, Fixedpoint *c, size_t m, size_t n, size_t k,
+                    FixedpointRound mode, unsigned num_threads);
+
+// Multiply a matrix by a vector: y = a x.
+//
+// Parameters:
+//   a - the matrix, m rows by k columns
+//   x - the vector, k elements
+//   y - receives the product, m elements (must not overlap a or x)
+//   m - the number of rows of a
+//   k - the number of columns of a
+//   mode - how to round each element of the product
+//   num_threads - the number of threads to use (0 or 1 computes serially)
+//
+// Returns:
+//   1 if successful, with y set as for fixedpoint_gemm with n = 1;
+//   0 if memory or threads could not be allocated
+int fixedpoint_gemv(const Fixedpoint *a, const Fixedpoint *x, Fixedpoint *y, size_t m, size_t k,
+                    FixedpointRound mode, unsigned num_threads);
+
+#endif // FIXEDPOINT_MATRIX_H
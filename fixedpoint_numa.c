@@ -0,0 +1,411 @@
+// pthread_attr_setaffinity_np and the CPU_SET macros are GNU extensions
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include "fixedpoint_numa.h"
+#include "fixedpoint_accum.h"
+
+// The memory policy of mbind that allocates only on the given nodes, as
+// numaif.h defines it (the system call is used directly, so that the
+// library does not depend on libnuma)
+#define NUMA_MPOL_BIND 2
+
+// Partitions start on multiples of this many values: 6 MB, the least
+// common multiple of the 2 MB huge page size and the size of a Fixedpoint,
+// so every partition is made of whole (huge) pages
+#define PART_ALIGN_VALUES 262144
+
+// The alignment of an array's memory: the huge page size
+#define HUGE_PAGE_SIZE (2UL << 20)
+
+// The directory that describes the NUMA nodes
+#define NODE_DIR "/sys/devices/system/node"
+
+// The loop over one partition of an array
+//
+// Fields:
+//  pool - the pool of the partition's node
+//  cpus - the CPUs of the node (NULL if unknown)
+//  num_cpus - the number of CPUs of the node
+//  offset - the index of the partition's first value
+//  count - the number of values of the partition
+//  fn - the function of the loop
+//  arg - the argument of the loop
+typedef struct
+{
+    FixedpointPool *pool;
+    const int *cpus;
+    size_t num_cpus;
+    size_t offset;
+    size_t count;
+    FixedpointPoolFn fn;
+    void *arg;
+} NumaPart;
+
+// The state of a parallel sum
+//
+// Fields:
+//  vals - the values
+//  sum - the sum of the ranges summed so far
+//  lock - protects sum
+typedef struct
+{
+    const Fixedpoint *vals;
+    FixedpointAccum sum;
+    pthread_mutex_t lock;
+} NumaSum;
+
+// Read a list of numbers in the kernel's format, such as "0-3,8,10-11",
+// from a file. Returns the number of numbers read, up to max, or 0 if the
+// file could not be read.
+static size_t read_list(const char *path, int *out, size_t max)
+{
+    FILE *in = fopen(path, "r");
+    if (in == NULL)
+    {
+        return 0;
+    }
+    size_t count = 0;
+    int first;
+    while (fscanf(in, "%d", &first) == 1)
+    {
+        int last = first;
+        int sep = fgetc(in);
+        if (sep == '-')
+        {
+            if (fscanf(in, "%d", &last) != 1)
+            {
+                break;
+            }
+            sep = fgetc(in);
+        }
+        for (int n = first; n <= last && count < max; ++n)
+        {
+            out[count++] = n;
+        }
+        if (sep != ',')
+        {
+            break;
+        }
+    }
+    fclose(in);
+    return count;
+}
+
+// Find the nodes with CPUs and their CPUs. Returns 0 if memory could not be
+// allocated.
+static int find_nodes(FixedpointNuma *numa)
+{
+    int ids[FIXEDPOINT_NUMA_MAX_NODES];
+    size_t num_ids = read_list(NODE_DIR "/online", ids, FIXEDPOINT_NUMA_MAX_NODES);
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+    {
+        num_ids = 0;
+    }
+    long configured = sysconf(_SC_NPROCESSORS_CONF);
+    size_t max_cpus = configured > 0 ? (size_t)configured : 1;
+    numa->num_nodes = 0;
+    numa->cpus = num_ids > 0 ? malloc(max_cpus * sizeof(int)) : NULL;
+    if (num_ids > 0 && numa->cpus == NULL)
+    {
+        return 0;
+    }
+
+    size_t used = 0;
+    for (size_t i = 0; i < num_ids; ++i)
+    {
+        // Skip a node numbered too high to use, rather than ending the scan
+        if (ids[i] < 0 || ids[i] >= FIXEDPOINT_NUMA_MAX_NODES)
+        {
+            continue;
+        }
+        char path[64];
+        snprintf(path, sizeof(path), NODE_DIR "/node%d/cpulist", ids[i]);
+        size_t listed = read_list(path, numa->cpus + used, max_cpus - used);
+        // Only the CPUs the process may run on are used
+        size_t num_cpus = 0;
+        for (size_t c = 0; c < listed; ++c)
+        {
+            int cpu = numa->cpus[used + c];
+            if (cpu >= 0 && cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed))
+            {
+                numa->cpus[used + num_cpus++] = cpu;
+            }
+        }
+        // Nodes with memory but no CPUs cannot run their partitions
+        if (num_cpus > 0)
+        {
+            numa->node_ids[numa->num_nodes] = ids[i];
+            numa->cpu_begin[numa->num_nodes] = used;
+            ++numa->num_nodes;
+            used += num_cpus;
+        }
+    }
+    if (numa->num_nodes == 0)
+    {
+        free(numa->cpus);
+        numa->cpus = NULL;
+        numa->num_nodes = 1;
+        numa->node_ids[0] = 0;
+        numa->cpu_begin[0] = 0;
+    }
+    numa->cpu_begin[numa->num_nodes] = used;
+    return 1;
+}
+
+int fixedpoint_numa_init(FixedpointNuma *numa, unsigned threads_per_node)
+{
+    if (!find_nodes(numa))
+    {
+        return 0;
+    }
+    for (unsigned n = 0; n < numa->num_nodes; ++n)
+    {
+        FixedpointPoolConfig config = {threads_per_node, 0, NULL, 0};
+        if (numa->cpus != NULL)
+        {
+            config.cpus = numa->cpus + numa->cpu_begin[n];
+            config.num_cpus = numa->cpu_begin[n + 1] - numa->cpu_begin[n];
+            if (config.num_threads == 0)
+            {
+                config.num_threads = (unsigned)config.num_cpus;
+            }
+        }
+        if (!fixedpoint_pool_init(&numa->pools[n], &config))
+        {
+            numa->num_nodes = n;
+            fixedpoint_numa_destroy(numa);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+void fixedpoint_numa_destroy(FixedpointNuma *numa)
+{
+    for (unsigned n = 0; n < numa->num_nodes; ++n)
+    {
+        fixedpoint_pool_destroy(&numa->pools[n]);
+    }
+    free(numa->cpus);
+    numa->cpus = NULL;
+    numa->num_nodes = 0;
+}
+
+// Get the loop over partition p of an array
+static NumaPart array_part(FixedpointNuma *numa, const FixedpointNumaArray *array, unsigned p, FixedpointPoolFn fn,
+                           void *arg)
+{
+    NumaPart part = {&numa->pools[p], NULL, 0, p * array->part_count, 0, fn, arg};
+    part.count = array->count - part.offset < array->part_count ? array->count - part.offset : array->part_count;
+    if (numa->cpus != NULL)
+    {
+        part.cpus = numa->cpus + numa->cpu_begin[p];
+        part.num_cpus = numa->cpu_begin[p + 1] - numa->cpu_begin[p];
+    }
+    return part;
+}
+
+// Apply a partition's function to a range of the partition
+static void part_range(void *arg, size_t begin, size_t end)
+{
+    const NumaPart *part = arg;
+    part->fn(part->arg, part->offset + begin, part->offset + end);
+}
+
+static void *part_main(void *arg)
+{
+    NumaPart *part = arg;
+    fixedpoint_pool_for(part->pool, part->count, part_range, part);
+    return NULL;
+}
+
+// Start a thread that runs a partition's loop, on the partition's node
+static int start_part(NumaPart *part, pthread_t *thread)
+{
+    pthread_attr_t attr;
+    if (pthread_attr_init(&attr) != 0)
+    {
+        return 0;
+    }
+    if (part->cpus != NULL)
+    {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        for (size_t i = 0; i < part->num_cpus; ++i)
+        {
+            if (part->cpus[i] >= 0 && part->cpus[i] < CPU_SETSIZE)
+            {
+                CPU_SET(part->cpus[i], &cpus);
+            }
+        }
+        // Without the affinity, the loop still runs, only not on the node
+        pthread_attr_setaffinity_np(&attr, sizeof(cpus), &cpus);
+    }
+    int ok = pthread_create(thread, &attr, part_main, part) == 0;
+    pthread_attr_destroy(&attr);
+    return ok;
+}
+
+void fixedpoint_numa_for(FixedpointNuma *numa, const FixedpointNumaArray *array, FixedpointPoolFn fn, void *arg)
+{
+    NumaPart parts[FIXEDPOINT_NUMA_MAX_NODES];
+    pthread_t threads[FIXEDPOINT_NUMA_MAX_NODES];
+    int started[FIXEDPOINT_NUMA_MAX_NODES];
+    for (unsigned p = 0; p < array->num_parts; ++p)
+    {
+        parts[p] = array_part(numa, array, p, fn, arg);
+        started[p] = start_part(&parts[p], &threads[p]);
+    }
+    for (unsigned p = 0; p < array->num_parts; ++p)
+    {
+        if (started[p])
+        {
+            pthread_join(threads[p], NULL);
+        }
+        else
+        {
+            part_main(&parts[p]);
+        }
+    }
+}
+
+// Write 0 to every value of a range, so that its pages are placed on the
+// node of the thread
+static void touch_range(void *arg, size_t begin, size_t end)
+{
+    Fixedpoint *vals = arg;
+    Fixedpoint zero = {0, 0, VALID_NONNEGATIVE};
+    for (size_t i = begin; i < end; ++i)
+    {
+        vals[i] = zero;
+    }
+}
+
+// Bind the pages of each partition of an array to its node. Returns 0 if
+// the kernel does not allow it.
+static int bind_parts(const FixedpointNuma *numa, const FixedpointNumaArray *array)
+{
+    for (unsigned p = 0; p < array->num_parts; ++p)
+    {
+        unsigned long mask = 1UL << numa->node_ids[p];
+        char *begin = (char *)(array->vals + (size_t)p * array->part_count);
+        char *end = p + 1 < array->num_parts ? (char *)(array->vals + (size_t)(p + 1) * array->part_count)
+                                             : (char *)array->map + array->map_size;
+        if (syscall(SYS_mbind, begin, (unsigned long)(end - begin), NUMA_MPOL_BIND, &mask,
+                    (unsigned long)FIXEDPOINT_NUMA_MAX_NODES + 1, 0UL) != 0)
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int fixedpoint_numa_alloc(FixedpointNuma *numa, FixedpointNumaArray *array, size_t count,
+                          FixedpointNumaPlacement placement)
+{
+    // The size in bytes, rounded up to whole huge pages plus the extra huge
+    // page mapped for alignment, must not overflow
+    if (count > (SIZE_MAX - 2 * HUGE_PAGE_SIZE) / sizeof(Fixedpoint))
+    {
+        return 0;
+    }
+    size_t bytes = (count == 0 ? 1 : count) * sizeof(Fixedpoint);
+    size_t size = (bytes + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+    // Map an extra huge page, and unmap what lies outside the aligned part
+    char *raw = mmap(NULL, size + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED)
+    {
+        return 0;
+    }
+    char *map = (char *)(((uintptr_t)raw + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1));
+    if (map > raw)
+    {
+        munmap(raw, (size_t)(map - raw));
+    }
+    munmap(map + size, HUGE_PAGE_SIZE - (size_t)(map - raw));
+#ifdef MADV_HUGEPAGE
+    // Huge pages are only a hint: without them the array is still usable
+    madvise(map, size, MADV_HUGEPAGE);
+#endif
+
+    size_t per_node = (count + numa->num_nodes - 1) / numa->num_nodes;
+    array->vals = (Fixedpoint *)map;
+    array->count = count;
+    array->part_count = (per_node + PART_ALIGN_VALUES - 1) / PART_ALIGN_VALUES * PART_ALIGN_VALUES;
+    array->num_parts = count == 0 ? 1 : (unsigned)((count - 1) / array->part_count + 1);
+    array->map = map;
+    array->map_size = size;
+    array->placement = placement;
+    if (placement == FIXEDPOINT_NUMA_BIND && (numa->cpus == NULL || !bind_parts(numa, array)))
+    {
+        array->placement = FIXEDPOINT_NUMA_FIRST_TOUCH;
+    }
+    fixedpoint_numa_for(numa, array, touch_range, array->vals);
+    return 1;
+}
+
+void fixedpoint_numa_free(FixedpointNumaArray *array)
+{
+    if (array->map != NULL)
+    {
+        munmap(array->map, array->map_size);
+    }
+    array->map = NULL;
+    array->vals = NULL;
+    array->count = 0;
+}
+
+int fixedpoint_numa_map(FixedpointNuma *numa, const FixedpointNumaArray *in, FixedpointNumaArray *out,
+                        Fixedpoint (*fn)(Fixedpoint))
+{
+    if (in->count != out->count)
+    {
+        return 0;
+    }
+    FixedpointPoolMap map = {in->vals, NULL, out->vals, fn, NULL};
+    fixedpoint_numa_for(numa, out, fixedpoint_pool_map_range, &map);
+    return 1;
+}
+
+int fixedpoint_numa_map2(FixedpointNuma *numa, const FixedpointNumaArray *left, const FixedpointNumaArray *right,
+                         FixedpointNumaArray *out, Fixedpoint (*fn)(Fixedpoint, Fixedpoint))
+{
+    if (left->count != out->count || right->count != out->count)
+    {
+        return 0;
+    }
+    FixedpointPoolMap map = {left->vals, right->vals, out->vals, NULL, fn};
+    fixedpoint_numa_for(numa, out, fixedpoint_pool_map_range, &map);
+    return 1;
+}
+
+static void sum_range(void *arg, size_t begin, size_t end)
+{
+    NumaSum *state = arg;
+    FixedpointAccum sum;
+    fixedpoint_accum_init(&sum);
+    for (size_t i = begin; i < end; ++i)
+    {
+        fixedpoint_accum_add(&sum, state->vals[i]);
+    }
+    pthread_mutex_lock(&state->lock);
+    fixedpoint_accum_merge(&state->sum, &sum);
+    pthread_mutex_unlock(&state->lock);
+}
+
+Fixedpoint fixedpoint_numa_sum(FixedpointNuma *numa, const FixedpointNumaArray *array)
+{
+    NumaSum state;
+    state.vals = array->vals;
+    fixedpoint_accum_init(&state.sum);
+    pthread_mutex_init(&state.lock, NULL);
+    fixedpoint_numa_for(numa, array, sum_range, &state);
+    pthread_mutex_destroy(&state.lock);
+    return fixedpoint_accum_result(&state.sum);
+}
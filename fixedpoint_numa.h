@@ -0,0 +1,179 @@
+#ifndef FIXEDPOINT_NUMA_H
+#define FIXEDPOINT_NUMA_H
+
+#include <stddef.h>
+#include "fixedpoint.h"
+#include "fixedpoint_pool.h"
+
+// Large Fixedpoint arrays placed across NUMA nodes, and parallel loops that
+// run each part of an array on the node whose memory holds it.
+//
+// An array is split into one contiguous partition per node. Its memory is
+// mapped directly from the operating system, aligned to 2 MB and marked
+// for transparent huge pages where the kernel supports them, and each
+// partition's pages are placed on its node, either by binding them to the
+// node (mbind) or by having threads of the node touch them first.
+//
+// A FixedpointNuma holds the nodes and a thread pool for each, whose
+// threads run only on the node's CPUs. A loop over an array runs every
+// partition at the same time, each on its own node's pool, so threads
+// mostly read and write memory local to their socket.
+//
+// The nodes and their CPUs are read from /sys/devices/system/node. Where
+// that is not available, the machine is treated as a single node.
+
+// The largest number of nodes used
+#define FIXEDPOINT_NUMA_MAX_NODES 64
+
+// How the memory of an array is placed on the nodes
+typedef enum
+{
+    // Each partition's pages are first written by threads of its node, so
+    // the kernel's default policy places them there
+    FIXEDPOINT_NUMA_FIRST_TOUCH,
+    // Each partition's pages are bound to its node with mbind; if the kernel
+    // does not allow it, the first touch placement is used instead
+    FIXEDPOINT_NUMA_BIND
+} FixedpointNumaPlacement;
+
+// The NUMA nodes of the machine and a thread pool for each. It must not be
+// moved or copied while initialized.
+//
+// Fields:
+//  num_nodes - the number of nodes with CPUs
+//  node_ids - the operating system's number of each node
+//  cpus - the CPUs of all nodes, node by node (NULL if the CPUs are
+//         unknown, in which case threads are not pinned)
+//  cpu_begin - node n's CPUs are cpus[cpu_begin[n]] to
+//              cpus[cpu_begin[n + 1] - 1]
+//  pools - the thread pool of each node
+typedef struct
+{
+    unsigned num_nodes;
+    int node_ids[FIXEDPOINT_NUMA_MAX_NODES];
+    int *cpus;
+    size_t cpu_begin[FIXEDPOINT_NUMA_MAX_NODES + 1];
+    FixedpointPool pools[FIXEDPOINT_NUMA_MAX_NODES];
+} FixedpointNuma;
+
+// An array of Fixedpoint values split into partitions, one per node
+//
+// Fields:
+//  vals - the values
+//  count - the number of values
+//  part_count - the number of values of each partition (the last
+//               partition may have fewer); partition p, on node p, holds
+//               vals[p * part_count] onwards
+//  num_parts - the number of partitions
+//  placement - how the memory was placed
+//  map - the start of the memory mapping
+//  map_size - the size of the memory mapping in bytes
+typedef struct
+{
+    Fixedpoint *vals;
+    size_t count;
+    size_t part_count;
+    unsigned num_parts;
+    FixedpointNumaPlacement placement;
+    void *map;
+    size_t map_size;
+} FixedpointNumaArray;
+
+// Find the NUMA nodes of the machine and start a thread pool on each.
+//
+// Parameters:
+//   numa - pointer to the nodes
+//   threads_per_node - the number of threads of each node's pool (0 for
+//                      the number of CPUs of the node)
+//
+// Returns:
+//   1 if successful;
+//   0 if memory or threads could not be allocated
+int fixedpoint_numa_init(FixedpointNuma *numa, unsigned threads_per_node);
+
+// Stop the thread pools of a set of nodes and free the memory it owns.
+//
+// Parameters:
+//   numa - pointer to the nodes
+void fixedpoint_numa_destroy(FixedpointNuma *numa);
+
+// Allocate an array of values, all 0, split into a partition per node.
+// Partitions start on multiples of 2 MB, so arrays smaller than a few MB
+// per node have fewer partitions than there are nodes.
+//
+// Parameters:
+//   numa - pointer to the nodes
+//   array - pointer to the array
+//   count - the number of values
+//   placement - how to place the memory on the nodes (array->placement
+//               records the placement used)
+//
+// Returns:
+//   1 if successful;
+//   0 if memory could not be mapped (including if count values would not
+//   fit in the address space)
+int fixedpoint_numa_alloc(FixedpointNuma *numa, FixedpointNumaArray *array, size_t count,
+                          FixedpointNumaPlacement placement);
+
+// Free the memory of an array.
+//
+// Parameters:
+//   array - pointer to the array
+void fixedpoint_numa_free(FixedpointNumaArray *array);
+
+// Run a parallel loop over the elements of an array, with each partition's
+// elements handled by the pool of its node, as fixedpoint_pool_for does.
+//
+// Parameters:
+//   numa - pointer to the nodes the array was allocated with
+//   array - pointer to the array
+//   fn - the function to apply to each range of elements
+//   arg - the argument to pass to fn
+void fixedpoint_numa_for(FixedpointNuma *numa, const FixedpointNumaArray *array, FixedpointPoolFn fn, void *arg);
+
+// Apply a function to each element of an array in parallel:
+// out[i] = fn(in[i]).
+//
+// Parameters:
+//   numa - pointer to the nodes the arrays were allocated with
+//   in - pointer to the array of values
+//   out - pointer to the array that receives the results (may be in)
+//   fn - the function to apply, which must be safe to call from several
+//        threads
+//
+// Returns:
+//   1 if successful;
+//   0 if the arrays have different counts (so are partitioned differently)
+int fixedpoint_numa_map(FixedpointNuma *numa, const FixedpointNumaArray *in, FixedpointNumaArray *out,
+                        Fixedpoint (*fn)(Fixedpoint));
+
+// Apply a function to each pair of elements of two arrays in parallel:
+// out[i] = fn(left[i], right[i]).
+//
+// Parameters:
+//   numa - pointer to the nodes the arrays were allocated with
+//   left - pointer to the array of left operands
+//   right - pointer to the array of right operands
+//   out - pointer to the array that receives the results (may be left or
+//         right)
+//   fn - the function to apply, which must be safe to call from several
+//        threads
+//
+// Returns:
+//   1 if successful;
+//   0 if the arrays have different counts
+int fixedpoint_numa_map2(FixedpointNuma *numa, const FixedpointNumaArray *left, const FixedpointNumaArray *right,
+                         FixedpointNumaArray *out, Fixedpoint (*fn)(Fixedpoint, Fixedpoint));
+
+// Sum the values of an array in parallel. The sum is exact, so it does not
+// depend on how the work is split.
+//
+// Parameters:
+//   numa - pointer to the nodes the array was allocated with
+//   array - pointer to the array
+//
+// Returns:
+//   the sum, tagged as fixedpoint_accum_result tags it
+Fixedpoint fixedpoint_numa_sum(FixedpointNuma *numa, const FixedpointNumaArray *array);
+
+#endif // FIXEDPOINT_NUMA_H
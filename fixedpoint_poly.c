@@ -0,0 +1,267 @@
+#include <stdlib.h>
+#include "fixedpoint_poly.h"
+#include "fixedpoint_wide.h"
+#include "fixedpoint256.h"
+
+// Intermediate values are Wide numbers in units of 2^-128: hi is the whole
+// part (with the sign) and lo the fraction
+
+// The state of one argument during an evaluation
+//
+// Fields:
+//  power - the power of x that the current level multiplies by
+//  overflow - set when a value reached 2^127
+//  inexact - set when a product was rounded
+typedef struct
+{
+    Wide power;
+    int overflow;
+    int inexact;
+} Lane;
+
+// The coefficient pairs that fit in a buffer on the stack
+#define STACK_PAIRS 32
+
+static int wide_is_neg(Wide a)
+{
+    return (int)(a.hi >> 127);
+}
+
+static Wide wide_abs(Wide a)
+{
+    return wide_is_neg(a) ? wide_negate(a) : a;
+}
+
+// The sum of two values; sets *overflow if it does not fit
+static Wide wide_add(Wide a, Wide b, int *overflow)
+{
+    Wide r;
+    r.lo = a.lo + b.lo;
+    r.hi = a.hi + b.hi + (r.lo < a.lo);
+    *overflow |= wide_is_neg(a) == wide_is_neg(b) && wide_is_neg(r) != wide_is_neg(a);
+    return r;
+}
+
+// The exact product of two 128 bit magnitudes in units of 2^-64, which is
+// in units of 2^-128; sets *overflow if it does not fit
+static Wide wide_product(u128 a, u128 b, int negative, int *overflow)
+{
+    Wide r;
+    mul_128(a, b, &r.hi, &r.lo);
+    *overflow |= wide_is_neg(r);
+    return negative ? wide_negate(r) : r;
+}
+
+// Add a 256 bit number to r, setting *overflow on a carry out of it
+static void add_256(Wide *r, u128 hi, u128 lo, int *overflow)
+{
+    r->lo += lo;
+    u128 carry = r->lo < lo;
+    u128 sum = r->hi + hi;
+    *overflow |= sum < hi;
+    r->hi = sum + carry;
+    *overflow |= r->hi < carry;
+}
+
+// The product of two values, rounded to the nearest multiple of 2^-128.
+// With x = xh + xl and y = yh + yl split into whole and fractional parts,
+// the product is xh yh + xh yl + xl yh + xl yl; the whole parts are often
+// zero (for powers of an argument below 1, say), and then their terms are
+// skipped.
+static Wide wide_mul(Wide a, Wide b, int *overflow, int *inexact)
+{
+    int negative = wide_is_neg(a) != wide_is_neg(b);
+    Wide x = wide_abs(a), y = wide_abs(b);
+    Wide r;
+    u128 upper, lower;
+
+    // xl yl, rounded at bit 127 of the low half
+    mul_128(x.lo, y.lo, &upper, &lower);
+    *inexact |= lower != 0;
+    r.lo = upper + (lower >> 127);
+    r.hi = r.lo < upper;
+    if (x.hi != 0)
+    {
+        mul_128(x.hi, y.lo, &upper, &lower);
+        add_256(&r, upper, lower, overflow);
+    }
+    if (y.hi != 0)
+    {
+        mul_128(y.hi, x.lo, &upper, &lower);
+        add_256(&r, upper, lower, overflow);
+    }
+    if (x.hi != 0 && y.hi != 0)
+    {
+        mul_128(x.hi, y.hi, &upper, &lower);
+        *overflow |= upper != 0;
+        add_256(&r, lower, 0, overflow);
+    }
+    *overflow |= wide_is_neg(r);
+    return negative ? wide_negate(r) : r;
+}
+
+static Wide wide_from_fixedpoint(Fixedpoint val)
+{
+    Wide r = {(u128)val.frac << 64, val.whole};
+    return val.tag == VALID_NEGATIVE ? wide_negate(r) : r;
+}
+
+// Round a result to a Fixedpoint value
+static Fixedpoint wide_to_fixedpoint(Wide a, const Lane *lane, FixedpointRound mode)
+{
+    int negative = wide_is_neg(a);
+    Wide mag = wide_abs(a);
+    if (lane->overflow)
+    {
+        Fixedpoint val = {(uint64_t)mag.hi, (uint64_t)(mag.lo >> 64), negative ? OVERFLOW_NEGATIVE : OVERFLOW_POSITIVE};
+        return val;
+    }
+    Fixedpoint256 wide = {{(uint64_t)mag.lo, (uint64_t)(mag.lo >> 64), (uint64_t)mag.hi, (uint64_t)(mag.hi >> 64)},
+                          negative ? VALID_NEGATIVE : VALID_NONNEGATIVE};
+    Fixedpoint val = fixedpoint256_to_fixedpoint(wide, mode);
+    if (lane->inexact && mode == FIXEDPOINT_ROUND_EXACT && fixedpoint_is_valid(val))
+    {
+        val.tag = negative ? UNDERFLOW_NEGATIVE : UNDERFLOW_POSITIVE;
+    }
+    return val;
+}
+
+// Evaluate the polynomial at lanes arguments with Estrin's scheme. terms
+// has room for lanes * ((count + 1) / 2) values; the terms of a lane are
+// interleaved with the other lanes so that each step runs across all lanes.
+static void estrin(const Fixedpoint *coeffs, size_t count, const Fixedpoint *xs, size_t lanes, FixedpointRound mode,
+                   Wide *terms, Fixedpoint *out)
+{
+    Lane lane[FIXEDPOINT_POLY_LANES] = {0};
+    size_t m = (count + 1) / 2;
+
+    // Level 0: c[2i] + c[2i+1] x, exactly
+    for (size_t i = 0; i < m; ++i)
+    {
+        for (size_t l = 0; l < lanes; ++l)
+        {
+            Wide term = wide_from_fixedpoint(coeffs[2 * i]);
+            if (2 * i + 1 < count)
+            {
+                Fixedpoint c = coeffs[2 * i + 1];
+                int negative = (c.tag == VALID_NEGATIVE) != (xs[l].tag == VALID_NEGATIVE);
+                Wide product = wide_product(magnitude(c), magnitude(xs[l]), negative, &lane[l].overflow);
+                term = wide_add(term, product, &lane[l].overflow);
+            }
+            terms[i * lanes + l] = term;
+        }
+    }
+    for (size_t l = 0; m > 1 && l < lanes; ++l)
+    {
+        u128 mag = magnitude(xs[l]);
+        lane[l].power = wide_product(mag, mag, 0, &lane[l].overflow);
+    }
+
+    // Each level combines pairs of terms with the next power of x
+    while (m > 1)
+    {
+        for (size_t i = 0; i < m / 2; ++i)
+        {
+            for (size_t l = 0; l < lanes; ++l)
+            {
+                Lane *ln = &lane[l];
+                Wide product = wide_mul(terms[(2 * i + 1) * lanes + l], ln->power, &ln->overflow, &ln->inexact);
+                terms[i * lanes + l] = wide_add(terms[2 * i * lanes + l], product, &ln->overflow);
+            }
+        }
+        if (m % 2)
+        {
+            for (size_t l = 0; l < lanes; ++l)
+            {
+                terms[(m / 2) * lanes + l] = terms[(m - 1) * lanes + l];
+            }
+        }
+        m = (m + 1) / 2;
+        if (m > 1)
+        {
+            for (size_t l = 0; l < lanes; ++l)
+            {
+                lane[l].power = wide_mul(lane[l].power, lane[l].power, &lane[l].overflow, &lane[l].inexact);
+            }
+        }
+    }
+
+    for (size_t l = 0; l < lanes; ++l)
+    {
+        out[l] = wide_to_fixedpoint(terms[l], &lane[l], mode);
+    }
+}
+
+static int coeffs_valid(const Fixedpoint *coeffs, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (!fixedpoint_is_valid(coeffs[i]))
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+Fixedpoint fixedpoint_poly_eval(const Fixedpoint *coeffs, size_t count, Fixedpoint x, FixedpointRound mode)
+{
+    Fixedpoint result;
+    fixedpoint_poly_eval_batch(coeffs, count, &x, mode, &result, 1);
+    return result;
+}
+
+void fixedpoint_poly_eval_batch(const Fixedpoint *coeffs, size_t count, const Fixedpoint *xs, FixedpointRound mode,
+                                Fixedpoint *out, size_t n)
+{
+    Fixedpoint error = {0, 0, ERROR};
+    Fixedpoint zero = {0, 0, VALID_NONNEGATIVE};
+    Wide stack_terms[FIXEDPOINT_POLY_LANES * STACK_PAIRS];
+    Wide *terms = stack_terms;
+    size_t pairs = (count + 1) / 2;
+    int valid = coeffs_valid(coeffs, count);
+    if (valid && pairs > STACK_PAIRS)
+    {
+        terms = malloc(FIXEDPOINT_POLY_LANES * pairs * sizeof(Wide));
+        valid = terms != NULL;
+    }
+
+    size_t i = 0;
+    while (i < n)
+    {
+        // Gather up to a full set of lanes of valid arguments; invalid ones
+        // get their result at once
+        Fixedpoint args[FIXEDPOINT_POLY_LANES];
+        size_t index[FIXEDPOINT_POLY_LANES];
+        size_t lanes = 0;
+        for (; i < n && lanes < FIXEDPOINT_POLY_LANES; ++i)
+        {
+            if (!valid || !fixedpoint_is_valid(xs[i]))
+            {
+                out[i] = error;
+            }
+            else if (count == 0)
+            {
+                out[i] = zero;
+            }
+            else
+            {
+                args[lanes] = xs[i];
+                index[lanes++] = i;
+            }
+        }
+        Fixedpoint results[FIXEDPOINT_POLY_LANES];
+        if (lanes > 0)
+        {
+            estrin(coeffs, count, args, lanes, mode, terms, results);
+        }
+        for (size_t l = 0; l < lanes; ++l)
+        {
+            out[index[l]] = results[l];
+        }
+    }
+    if (terms != stack_terms)
+    {
+        free(terms);
+    }
+}
@@ -0,0 +1,55 @@
+#ifndef FIXEDPOINT_POLY_H
+#define FIXEDPOINT_POLY_H
+
+#include <stddef.h>
+#include "fixedpoint.h"
+
+// Polynomial evaluation with Estrin's scheme: pairs of coefficients are
+// combined as c[2i] + c[2i+1] x, then pairs of those with x^2, then with
+// x^4 and so on. The pairs at each level are independent, so unlike
+// Horner's rule the multiplications do not wait on each other.
+//
+// Intermediate values are kept in 256 bit two's complement fixed point
+// with 128 fraction bits. The products c[2i+1] x are exact, every other
+// product is rounded to the nearest multiple of 2^-128, and the result is
+// rounded once to a multiple of 2^-64. For |x| <= 1 the intermediate
+// roundings add less than count * 2^-128 to the error of the final
+// rounding. Coefficients and arguments are checked once, not at every step.
+
+// The number of arguments the batch version evaluates together
+#define FIXEDPOINT_POLY_LANES 4
+
+// Evaluate the polynomial coeffs[0] + coeffs[1] x + ... + coeffs[count-1] x^(count-1).
+//
+// Parameters:
+//   coeffs - the coefficients, constant term first
+//   count - the number of coefficients (the degree plus one)
+//   x - the argument
+//   mode - how to round the result to a multiple of 2^-64
+//
+// Returns:
+//   the value of the polynomial, rounded according to mode (with
+//   FIXEDPOINT_ROUND_EXACT, a value tagged UNDERFLOW_POSITIVE or
+//   UNDERFLOW_NEGATIVE if any rounding lost bits);
+//   a value tagged OVERFLOW_POSITIVE or OVERFLOW_NEGATIVE if the result or
+//   an intermediate value (including the powers x^2, x^4, ... that the
+//   scheme uses) is 2^127 or more in magnitude, or the result is 2^64 or more;
+//   an error value if x or any coefficient is not valid
+Fixedpoint fixedpoint_poly_eval(const Fixedpoint *coeffs, size_t count, Fixedpoint x, FixedpointRound mode);
+
+// Evaluate a polynomial at each element of an array. The arguments are
+// processed FIXEDPOINT_POLY_LANES at a time, with the steps for all of them
+// interleaved so that their multiplications overlap. out[i] is the same as
+// fixedpoint_poly_eval(coeffs, count, xs[i], mode). out may alias xs.
+//
+// Parameters:
+//   coeffs - the coefficients, constant term first
+//   count - the number of coefficients
+//   xs - the arguments
+//   mode - how to round the results
+//   out - the output array
+//   n - the number of arguments
+void fixedpoint_poly_eval_batch(const Fixedpoint *coeffs, size_t count, const Fixedpoint *xs, FixedpointRound mode,
+                                Fixedpoint *out, size_t n);
+
+#endif // FIXEDPOINT_POLY_H
@@ -0,0 +1,326 @@
+// pthread_attr_setaffinity_np and the CPU_SET macros are GNU extensions
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <sched.h>
+#include <unistd.h>
+#include "fixedpoint_pool.h"
+
+__extension__ typedef unsigned __int128 u128;
+
+// The per-thread state of a pool
+//
+// Fields:
+//  lock - protects front and back
+//  front - the next chunk the thread takes from its share
+//  back - one past the last chunk of the thread's share
+//  pool - the pool
+//  index - the index of the thread (0 for the thread that starts a loop)
+//  thread - the thread, for worker threads
+//  started - whether thread was started
+struct FixedpointPoolWorker
+{
+    _Alignas(64) pthread_mutex_t lock;
+    size_t front;
+    size_t back;
+    FixedpointPool *pool;
+    unsigned index;
+    pthread_t thread;
+    int started;
+};
+
+// Take a chunk from the front of a thread's own share
+static int take_own(FixedpointPoolWorker *self, size_t *chunk)
+{
+    pthread_mutex_lock(&self->lock);
+    int found = self->front < self->back;
+    if (found)
+    {
+        *chunk = self->front++;
+    }
+    pthread_mutex_unlock(&self->lock);
+    return found;
+}
+
+// Steal the back half of another thread's remaining chunks: return the first
+// of them, and make the rest the thief's own share
+static int steal(FixedpointPoolWorker *self, FixedpointPoolWorker *victim, size_t *chunk)
+{
+    pthread_mutex_lock(&victim->lock);
+    size_t remaining = victim->back - victim->front;
+    size_t taken = (remaining + 1) / 2;
+    size_t end = victim->back;
+    victim->back -= taken;
+    pthread_mutex_unlock(&victim->lock);
+    if (taken == 0)
+    {
+        return 0;
+    }
+
+    *chunk = end - taken;
+    pthread_mutex_lock(&self->lock);
+    self->front = end - taken + 1;
+    self->back = end;
+    pthread_mutex_unlock(&self->lock);
+    return 1;
+}
+
+// Work on the current loop until no thread has chunks left
+static void run_part(FixedpointPool *pool, FixedpointPoolWorker *self)
+{
+    size_t chunk;
+    for (;;)
+    {
+        int found = take_own(self, &chunk);
+        for (unsigned i = 1; !found && i < pool->num_threads; ++i)
+        {
+            found = steal(self, &pool->workers[(self->index + i) % pool->num_threads], &chunk);
+        }
+        if (!found)
+        {
+            return;
+        }
+        size_t begin = chunk * pool->chunk;
+        size_t end = pool->count - begin < pool->chunk ? pool->count : begin + pool->chunk;
+        pool->fn(pool->arg, begin, end);
+    }
+}
+
+// Count a thread as having finished its part of the current loop; the pool's
+// lock must be held
+static void finish_part(FixedpointPool *pool)
+{
+    if (--pool->busy == 0)
+    {
+        pthread_cond_signal(&pool->done);
+    }
+}
+
+static void *worker_main(void *arg)
+{
+    FixedpointPoolWorker *self = arg;
+    FixedpointPool *pool = self->pool;
+    uint64_t seen = 0;
+    pthread_mutex_lock(&pool->lock);
+    for (;;)
+    {
+        while (!pool->stop && pool->generation == seen)
+        {
+            pthread_cond_wait(&pool->start, &pool->lock);
+        }
+        if (pool->stop)
+        {
+            break;
+        }
+        seen = pool->generation;
+        pthread_mutex_unlock(&pool->lock);
+        run_part(pool, self);
+        pthread_mutex_lock(&pool->lock);
+        finish_part(pool);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+// Start a worker thread, pinned to its CPU if the configuration lists CPUs
+static int start_worker(FixedpointPoolWorker *worker, const FixedpointPoolConfig *config)
+{
+    pthread_attr_t attr;
+    if (pthread_attr_init(&attr) != 0)
+    {
+        return 0;
+    }
+    int ok = 1;
+    if (config != NULL && config->cpus != NULL && config->num_cpus > 0)
+    {
+        int cpu = config->cpus[(worker->index - 1) % config->num_cpus];
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        ok = cpu >= 0 && cpu < CPU_SETSIZE;
+        if (ok)
+        {
+            CPU_SET(cpu, &cpus);
+            ok = pthread_attr_setaffinity_np(&attr, sizeof(cpus), &cpus) == 0;
+        }
+    }
+    ok = ok && pthread_create(&worker->thread, &attr, worker_main, worker) == 0;
+    pthread_attr_destroy(&attr);
+    worker->started = ok;
+    return ok;
+}
+
+int fixedpoint_pool_init(FixedpointPool *pool, const FixedpointPoolConfig *config)
+{
+    unsigned num_threads = config != NULL ? config->num_threads : 0;
+    if (num_threads == 0)
+    {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        num_threads = online > 0 ? (unsigned)online : 1;
+    }
+    size_t chunk = config != NULL ? config->chunk : 0;
+    pool->num_threads = num_threads;
+    pool->chunk = chunk != 0 ? chunk : FIXEDPOINT_POOL_DEFAULT_CHUNK;
+    pool->generation = 0;
+    pool->busy = 0;
+    pool->stop = 0;
+    pool->count = 0;
+    pool->workers = aligned_alloc(_Alignof(FixedpointPoolWorker), num_threads * sizeof(FixedpointPoolWorker));
+    if (pool->workers == NULL)
+    {
+        return 0;
+    }
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_mutex_init(&pool->run_lock, NULL);
+    pthread_cond_init(&pool->start, NULL);
+    pthread_cond_init(&pool->done, NULL);
+    for (unsigned i = 0; i < num_threads; ++i)
+    {
+        FixedpointPoolWorker *worker = &pool->workers[i];
+        pthread_mutex_init(&worker->lock, NULL);
+        worker->front = worker->back = 0;
+        worker->pool = pool;
+        worker->index = i;
+        worker->started = 0;
+    }
+    for (unsigned i = 1; i < num_threads; ++i)
+    {
+        if (!start_worker(&pool->workers[i], config))
+        {
+            fixedpoint_pool_destroy(pool);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+void fixedpoint_pool_destroy(FixedpointPool *pool)
+{
+    if (pool->workers == NULL)
+    {
+        return;
+    }
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = 1;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+    for (unsigned i = 0; i < pool->num_threads; ++i)
+    {
+        if (pool->workers[i].started)
+        {
+            pthread_join(pool->workers[i].thread, NULL);
+        }
+        pthread_mutex_destroy(&pool->workers[i].lock);
+    }
+    pthread_mutex_destroy(&pool->lock);
+    pthread_mutex_destroy(&pool->run_lock);
+    pthread_cond_destroy(&pool->start);
+    pthread_cond_destroy(&pool->done);
+    free(pool->workers);
+    pool->workers = NULL;
+}
+
+unsigned fixedpoint_pool_num_threads(const FixedpointPool *pool)
+{
+    return pool != NULL ? pool->num_threads : 1;
+}
+
+void fixedpoint_pool_for(FixedpointPool *pool, size_t count, FixedpointPoolFn fn, void *arg)
+{
+    if (count == 0)
+    {
+        return;
+    }
+    if (pool == NULL || pool->num_threads == 1 || count <= pool->chunk)
+    {
+        fn(arg, 0, count);
+        return;
+    }
+
+    pthread_mutex_lock(&pool->run_lock);
+    size_t chunks = (count - 1) / pool->chunk + 1;
+    pthread_mutex_lock(&pool->lock);
+    pool->fn = fn;
+    pool->arg = arg;
+    pool->count = count;
+    // No thread works on a loop until the generation changes, so the shares
+    // can be set without their locks
+    for (unsigned i = 0; i < pool->num_threads; ++i)
+    {
+        pool->workers[i].front = (size_t)((u128)chunks * i / pool->num_threads);
+        pool->workers[i].back = (size_t)((u128)chunks * (i + 1) / pool->num_threads);
+    }
+    pool->busy = pool->num_threads;
+    ++pool->generation;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+
+    run_part(pool, &pool->workers[0]);
+
+    pthread_mutex_lock(&pool->lock);
+    finish_part(pool);
+    while (pool->busy > 0)
+    {
+        pthread_cond_wait(&pool->done, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    pthread_mutex_unlock(&pool->run_lock);
+}
+
+void fixedpoint_pool_map_range(void *arg, size_t begin, size_t end)
+{
+    const FixedpointPoolMap *map = arg;
+    if (map->binary != NULL)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            map->out[i] = map->binary(map->left[i], map->right[i]);
+        }
+    }
+    else
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            map->out[i] = map->unary(map->left[i]);
+        }
+    }
+}
+
+void fixedpoint_pool_map(FixedpointPool *pool, const Fixedpoint *in, Fixedpoint *out, size_t count,
+                         Fixedpoint (*fn)(Fixedpoint))
+{
+    FixedpointPoolMap map = {in, NULL, out, fn, NULL};
+    fixedpoint_pool_for(pool, count, fixedpoint_pool_map_range, &map);
+}
+
+void fixedpoint_pool_map2(FixedpointPool *pool, const Fixedpoint *left, const Fixedpoint *right, Fixedpoint *out,
+                          size_t count, Fixedpoint (*fn)(Fixedpoint, Fixedpoint))
+{
+    FixedpointPoolMap map = {left, right, out, NULL, fn};
+    fixedpoint_pool_for(pool, count, fixedpoint_pool_map_range, &map);
+}
+
+void fixedpoint_pool_add(FixedpointPool *pool, const Fixedpoint *left, const Fixedpoint *right, Fixedpoint *out,
+                         size_t count)
+{
+    fixedpoint_pool_map2(pool, left, right, out, count, fixedpoint_add);
+}
+
+void fixedpoint_pool_sub(FixedpointPool *pool, const Fixedpoint *left, const Fixedpoint *right, Fixedpoint *out,
+                         size_t count)
+{
+    fixedpoint_pool_map2(pool, left, right, out, count, fixedpoint_sub);
+}
+
+void fixedpoint_pool_negate(FixedpointPool *pool, const Fixedpoint *in, Fixedpoint *out, size_t count)
+{
+    fixedpoint_pool_map(pool, in, out, count, fixedpoint_negate);
+}
+
+void fixedpoint_pool_halve(FixedpointPool *pool, const Fixedpoint *in, Fixedpoint *out, size_t count)
+{
+    fixedpoint_pool_map(pool, in, out, count, fixedpoint_halve);
+}
+
+void fixedpoint_pool_double(FixedpointPool *pool, const Fixedpoint *in, Fixedpoint *out, size_t count)
+{
+    fixedpoint_pool_map(pool, in, out, count, fixedpoint_double);
+}
@@ -0,0 +1,207 @@
+#ifndef FIXEDPOINT_POOL_H
+#define FIXEDPOINT_POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "fixedpoint.h"
+
+// A thread pool that runs parallel loops over arrays, and elementwise
+// Fixedpoint operations built on it.
+//
+// A loop over count elements is split into chunks of a fixed number of
+// elements, and each thread starts with an equal, contiguous share of the
+// chunks. A thread takes chunks from the front of its own share; when its
+// share is used up, it steals the back half of the remaining chunks of
+// another thread. So threads that finish early, or that the operating
+// system runs less often, take over work from the others, while each
+// thread mostly works through contiguous memory.
+//
+// The worker threads are started once, when the pool is initialized, and
+// wait between loops. The thread that runs a loop works on it as one of the
+// pool's threads.
+
+// The per-thread state of a pool, defined in fixedpoint_pool.c
+typedef struct FixedpointPoolWorker FixedpointPoolWorker;
+
+// A function that a parallel loop applies to ranges of elements
+//
+// Parameters:
+//   arg - the argument passed to the loop
+//   begin - the first element of the range
+//   end - one past the last element of the range
+typedef void (*FixedpointPoolFn)(void *arg, size_t begin, size_t end);
+
+// The arguments of an elementwise operation, for fixedpoint_pool_map_range
+//
+// Fields:
+//  left - the operands (the left operands of a binary operation)
+//  right - the right operands of a binary operation
+//  out - the results
+//  unary - the function of a unary operation (NULL for a binary one)
+//  binary - the function of a binary operation (NULL for a unary one)
+typedef struct
+{
+    const Fixedpoint *left;
+    const Fixedpoint *right;
+    Fixedpoint *out;
+    Fixedpoint (*unary)(Fixedpoint);
+    Fixedpoint (*binary)(Fixedpoint, Fixedpoint);
+} FixedpointPoolMap;
+
+// How a pool is set up
+//
+// Fields:
+//  num_threads - the number of threads that run a loop, including the thread
+//                that starts it (0 for the number of online CPUs)
+//  chunk - the number of elements in a chunk (0 for
+//          FIXEDPOINT_POOL_DEFAULT_CHUNK)
+//  cpus - if not NULL, the CPUs to run the worker threads on: worker thread
+//         i (from 1) runs only on CPU cpus[(i - 1) % num_cpus]; the thread
+//         that starts a loop is not pinned
+//  num_cpus - the number of CPUs in cpus
+typedef struct
+{
+    unsigned num_threads;
+    size_t chunk;
+    const int *cpus;
+    size_t num_cpus;
+} FixedpointPoolConfig;
+
+// A thread pool. It must not be moved or copied while initialized.
+//
+// Fields:
+//  workers - the per-thread state, one for each thread
+//  num_threads - the number of threads that run a loop
+//  chunk - the number of elements in a chunk
+//  lock - protects generation, busy, stop and the current loop
+//  start - signaled when a loop starts or the pool is destroyed
+//  done - signaled when the last thread finishes its part of a loop
+//  run_lock - held while a loop runs, so that loops run one at a time
+//  generation - the number of loops started
+//  busy - the number of threads still working on the current loop
+//  stop - whether the worker threads should exit
+//  fn - the function of the current loop
+//  arg - the argument of the current loop
+//  count - the number of elements of the current loop
+typedef struct
+{
+    FixedpointPoolWorker *workers;
+    unsigned num_threads;
+    size_t chunk;
+    pthread_mutex_t lock;
+    pthread_cond_t start;
+    pthread_cond_t done;
+    pthread_mutex_t run_lock;
+    uint64_t generation;
+    unsigned busy;
+    int stop;
+    FixedpointPoolFn fn;
+    void *arg;
+    size_t count;
+} FixedpointPool;
+
+// The number of elements in a chunk if the configuration does not set it:
+// enough that taking a chunk costs little compared with working on it
+#define FIXEDPOINT_POOL_DEFAULT_CHUNK 2048
+
+// Initialize a pool and start its worker threads.
+//
+// Parameters:
+//   pool - pointer to the pool
+//   config - how to set up the pool (NULL for the defaults of every field)
+//
+// Returns:
+//   1 if successful;
+//   0 if memory or threads could not be allocated, or a worker thread could
+//   not be pinned to its CPU
+int fixedpoint_pool_init(FixedpointPool *pool, const FixedpointPoolConfig *config);
+
+// Stop the worker threads of a pool and free the memory it owns.
+//
+// Parameters:
+//   pool - pointer to the pool
+void fixedpoint_pool_destroy(FixedpointPool *pool);
+
+// Get the number of threads that run a pool's loops.
+//
+// Parameters:
+//   pool - pointer to the pool (or NULL)
+//
+// Returns:
+//   the number of threads (1 if pool is NULL)
+unsigned fixedpoint_pool_num_threads(const FixedpointPool *pool);
+
+// Run a parallel loop: call fn on ranges of elements that together cover
+// every element from 0 to count - 1 exactly once, and wait for all of them
+// to finish. Calls from several threads run one loop at a time; fn must not
+// start a loop on the same pool.
+//
+// Parameters:
+//   pool - pointer to the pool (NULL runs the loop on the calling thread)
+//   count - the number of elements
+//   fn - the function to apply to each range
+//   arg - the argument to pass to fn
+void fixedpoint_pool_for(FixedpointPool *pool, size_t count, FixedpointPoolFn fn, void *arg);
+
+// The function of the loops of fixedpoint_pool_map and fixedpoint_pool_map2,
+// for running the same elementwise operation with other loops: set
+// out[i] = unary(left[i]) or out[i] = binary(left[i], right[i]) for each
+// element of a range.
+//
+// Parameters:
+//   arg - pointer to a FixedpointPoolMap
+//   begin - the first element of the range
+//   end - one past the last element of the range
+void fixedpoint_pool_map_range(void *arg, size_t begin, size_t end);
+
+// Apply a function to each element of an array in parallel:
+// out[i] = fn(in[i]).
+//
+// Parameters:
+//   pool - pointer to the pool (or NULL)
+//   in - the values
+//   out - receives the results (may be the same array as in)
+//   count - the number of values
+//   fn - the function to apply, which must be safe to call from several
+//        threads
+void fixedpoint_pool_map(FixedpointPool *pool, const Fixedpoint *in, Fixedpoint *out, size_t count,
+                         Fixedpoint (*fn)(Fixedpoint));
+
+// Apply a function to each pair of elements of two arrays in parallel:
+// out[i] = fn(left[i], right[i]).
+//
+// Parameters:
+//   pool - pointer to the pool (or NULL)
+//   left - the left operands
+//   right - the right operands
+//   out - receives the results (may be the same array as left or right)
+//   count - the number of values
+//   fn - the function to apply, which must be safe to call from several
+//        threads
+void fixedpoint_pool_map2(FixedpointPool *pool, const Fixedpoint *left, const Fixedpoint *right, Fixedpoint *out,
+                          size_t count, Fixedpoint (*fn)(Fixedpoint, Fixedpoint));
+
+// Add arrays of Fixedpoint values elementwise in parallel, with the same
+// results as fixedpoint_add. See fixedpoint_pool_map2.
+void fixedpoint_pool_add(FixedpointPool *pool, const Fixedpoint *left, const Fixedpoint *right, Fixedpoint *out,
+                         size_t count);
+
+// Subtract arrays of Fixedpoint values elementwise in parallel, with the
+// same results as fixedpoint_sub. See fixedpoint_pool_map2.
+void fixedpoint_pool_sub(FixedpointPool *pool, const Fixedpoint *left, const Fixedpoint *right, Fixedpoint *out,
+                         size_t count);
+
+// Negate an array of Fixedpoint values in parallel, with the same results
+// as fixedpoint_negate. See fixedpoint_pool_map.
+void fixedpoint_pool_negate(FixedpointPool *pool, const Fixedpoint *in, Fixedpoint *out, size_t count);
+
+// Halve an array of Fixedpoint values in parallel, with the same results as
+// fixedpoint_halve. See fixedpoint_pool_map.
+void fixedpoint_pool_halve(FixedpointPool *pool, const Fixedpoint *in, Fixedpoint *out, size_t count);
+
+// Double an array of Fixedpoint values in parallel, with the same results
+// as fixedpoint_double. See fixedpoint_pool_map.
+void fixedpoint_pool_double(FixedpointPool *pool, const Fixedpoint *in, Fixedpoint *out, size_t count);
+
+#endif // FIXEDPOINT_POOL_H
@@ -0,0 +1,47 @@
+#include "fixedpoint_q.h"
+
+Fixedpoint fixedpoint_q_to_fixedpoint(uint64_t bits, Tag tag, unsigned frac_bits)
+{
+    Fixedpoint val;
+    val.whole = bits >> frac_bits;
+    // The fraction field moves to the top of the 64 bit fraction
+    val.frac = frac_bits == 0 ? 0 : bits << (64 - frac_bits);
+    val.tag = tag;
+    return val;
+}
+
+uint64_t fixedpoint_q_from_fixedpoint(Fixedpoint val, unsigned int_bits, unsigned frac_bits, FixedpointRound mode,
+                                      Tag *tag)
+{
+    Tag original = val.tag;
+    int negative = original == VALID_NEGATIVE || original == OVERFLOW_NEGATIVE || original == UNDERFLOW_NEGATIVE;
+    val.tag = negative ? VALID_NEGATIVE : VALID_NONNEGATIVE;
+
+    // Drop the fraction bits the format does not have; the result is the
+    // magnitude in units of 2^-frac_bits
+    Fixedpoint scaled = fixedpoint_shr(val, 64 - frac_bits, mode, NULL);
+    uint64_t max = FIXEDPOINT_QFORMAT_MAX(int_bits, frac_bits);
+    uint64_t bits = scaled.frac & max;
+
+    if (scaled.whole != 0 || scaled.frac > max)
+    {
+        *tag = negative ? OVERFLOW_NEGATIVE : OVERFLOW_POSITIVE;
+    }
+    else if (original != VALID_NONNEGATIVE && original != VALID_NEGATIVE)
+    {
+        *tag = original;
+    }
+    else if (bits == 0 && fixedpoint_is_valid(scaled))
+    {
+        // Negative values that round to zero become +0
+        *tag = VALID_NONNEGATIVE;
+    }
+    else
+    {
+        *tag = scaled.tag;
+    }
+    return bits;
+}
+
+FIXEDPOINT_QFORMAT_DEFINE(FixedpointQ32_32, fixedpoint_q32_32, 32, 32)
+FIXEDPOINT_QFORMAT_DEFINE(FixedpointQ16_48, fixedpoint_q16_48, 16, 48)
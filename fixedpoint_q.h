@@ -0,0 +1,330 @@
+#ifndef FIXEDPOINT_Q_H
+#define FIXEDPOINT_Q_H
+
+#include <stdint.h>
+#include "fixedpoint.h"
+
+// Fixed point formats narrower than Fixedpoint, generated by macros.
+//
+// A Q format with INT_BITS integer bits and FRAC_BITS fraction bits (where
+// INT_BITS + FRAC_BITS <= 64 and FRAC_BITS < 64) stores the magnitude of a
+// value as a single 64 bit word in units of 2^-FRAC_BITS, plus a Tag, so
+// every operation is a handful of integer instructions on one word instead
+// of two. Values are sign-magnitude with the same tags as Fixedpoint.
+//
+// FIXEDPOINT_QFORMAT_DECLARE(Name, prefix, INT_BITS, FRAC_BITS) declares the
+// struct type Name and the following functions (it goes in a header), and
+// FIXEDPOINT_QFORMAT_DEFINE(Name, prefix, INT_BITS, FRAC_BITS) defines the
+// functions (it goes in exactly one source file). Except where noted, each
+// function behaves like the Fixedpoint function of the same name.
+//
+//   Name prefix_create(uint64_t whole)
+//     OVERFLOW_POSITIVE if whole does not fit in INT_BITS bits
+//   Name prefix_create2(uint64_t whole, uint64_t frac)
+//     frac is the fraction field, in units of 2^-FRAC_BITS; bits of frac
+//     above FRAC_BITS are ignored
+//   Name prefix_create_from_hex(const char *hex)
+//     error value if hex is not a value of the format
+//   uint64_t prefix_whole_part(Name val)
+//   uint64_t prefix_frac_part(Name val)
+//     the fraction field, in units of 2^-FRAC_BITS
+//   Name prefix_add(Name left, Name right)
+//   Name prefix_sub(Name left, Name right)
+//   Name prefix_negate(Name val)
+//   Name prefix_halve(Name val)
+//   Name prefix_double(Name val)
+//   int prefix_compare(Name left, Name right)
+//   int prefix_is_zero(Name val)
+//   int prefix_is_err(Name val)
+//   int prefix_is_neg(Name val)
+//   int prefix_is_overflow_neg(Name val)
+//   int prefix_is_overflow_pos(Name val)
+//   int prefix_is_underflow_neg(Name val)
+//   int prefix_is_underflow_pos(Name val)
+//   int prefix_is_valid(Name val)
+//   char *prefix_format_as_hex(Name val)
+//   Fixedpoint prefix_to_fixedpoint(Name val)
+//     exact, and keeps the tag
+//   Name prefix_from_fixedpoint(Fixedpoint val, FixedpointRound mode)
+//     rounds bits below 2^-FRAC_BITS according to mode; OVERFLOW_POSITIVE
+//     or OVERFLOW_NEGATIVE (with the magnitude wrapped) if the value does
+//     not fit. A non-valid tag of val is kept.
+//
+// Every Q format converts to Fixedpoint exactly, so converting between two
+// formats through Fixedpoint, as in
+//   q16_48_from_fixedpoint(q32_32_to_fixedpoint(val), FIXEDPOINT_ROUND_EXACT)
+// is exact whenever the value is representable in the target format, and
+// is tagged OVERFLOW_* or UNDERFLOW_* otherwise.
+
+// The largest magnitude of a format with the given widths, in units of 2^-FRAC_BITS
+#define FIXEDPOINT_QFORMAT_MAX(INT_BITS, FRAC_BITS) (UINT64_MAX >> (64 - (INT_BITS) - (FRAC_BITS)))
+
+#define FIXEDPOINT_QFORMAT_DECLARE(Name, prefix, INT_BITS, FRAC_BITS)                                         \
+    _Static_assert((INT_BITS) >= 0 && (FRAC_BITS) >= 0 && (FRAC_BITS) < 64 && (INT_BITS) + (FRAC_BITS) > 0 && \
+                       (INT_BITS) + (FRAC_BITS) <= 64,                                                        \
+                   "invalid Q format widths");                                                                \
+    typedef struct                                                                                            \
+    {                                                                                                         \
+        uint64_t bits;                                                                                        \
+        Tag tag;                                                                                              \
+    } Name;                                                                                                   \
+    Name prefix##_create(uint64_t whole);                                                                     \
+    Name prefix##_create2(uint64_t whole, uint64_t frac);                                                     \
+    Name prefix##_create_from_hex(const char *hex);                                                           \
+    uint64_t prefix##_whole_part(Name val);                                                                   \
+    uint64_t prefix##_frac_part(Name val);                                                                    \
+    Name prefix##_add(Name left, Name right);                                                                 \
+    Name prefix##_sub(Name left, Name right);                                                                 \
+    Name prefix##_negate(Name val);                                                                           \
+    Name prefix##_halve(Name val);                                                                            \
+    Name prefix##_double(Name val);                                                                           \
+    int prefix##_compare(Name left, Name right);                                                              \
+    int prefix##_is_zero(Name val);                                                                           \
+    int prefix##_is_err(Name val);                                                                            \
+    int prefix##_is_neg(Name val);                                                                            \
+    int prefix##_is_overflow_neg(Name val);                                                                   \
+    int prefix##_is_overflow_pos(Name val);                                                                   \
+    int prefix##_is_underflow_neg(Name val);                                                                  \
+    int prefix##_is_underflow_pos(Name val);                                                                  \
+    int prefix##_is_valid(Name val);                                                                          \
+    char *prefix##_format_as_hex(Name val);                                                                   \
+    Fixedpoint prefix##_to_fixedpoint(Name val);                                                              \
+    Name prefix##_from_fixedpoint(Fixedpoint val, FixedpointRound mode)
+
+#define FIXEDPOINT_QFORMAT_DEFINE(Name, prefix, INT_BITS, FRAC_BITS)                                   \
+    Name prefix##_create(uint64_t whole)                                                               \
+    {                                                                                                  \
+        return prefix##_create2(whole, 0);                                                             \
+    }                                                                                                  \
+                                                                                                       \
+    Name prefix##_create2(uint64_t whole, uint64_t frac)                                               \
+    {                                                                                                  \
+        Name val;                                                                                      \
+        frac &= (1UL << (FRAC_BITS)) - 1;                                                              \
+        val.bits = fixedpoint_q_pack(whole, frac, FRAC_BITS);                                          \
+        val.bits &= FIXEDPOINT_QFORMAT_MAX(INT_BITS, FRAC_BITS);                                       \
+        val.tag = VALID_NONNEGATIVE;                                                                   \
+        if (fixedpoint_q_unpack(val.bits, FRAC_BITS) != whole)                                         \
+        {                                                                                              \
+            val.tag = OVERFLOW_POSITIVE;                                                               \
+        }                                                                                              \
+        return val;                                                                                    \
+    }                                                                                                  \
+                                                                                                       \
+    Name prefix##_create_from_hex(const char *hex)                                                     \
+    {                                                                                                  \
+        Name val = prefix##_from_fixedpoint(fixedpoint_create_from_hex(hex), FIXEDPOINT_ROUND_EXACT);  \
+        if (!prefix##_is_valid(val))                                                                   \
+        {                                                                                              \
+            val.bits = 0;                                                                              \
+            val.tag = ERROR;                                                                           \
+        }                                                                                              \
+        return val;                                                                                    \
+    }                                                                                                  \
+                                                                                                       \
+    uint64_t prefix##_whole_part(Name val)                                                             \
+    {                                                                                                  \
+        return fixedpoint_q_unpack(val.bits, FRAC_BITS);                                               \
+    }                                                                                                  \
+                                                                                                       \
+    uint64_t prefix##_frac_part(Name val)                                                              \
+    {                                                                                                  \
+        return val.bits & ((1UL << (FRAC_BITS)) - 1);                                                 \
+    }                                                                                                  \
+                                                                                                       \
+    Name prefix##_add(Name left, Name right)                                                           \
+    {                                                                                                  \
+        if (left.tag != right.tag)                                                                     \
+        {                                                                                              \
+            return prefix##_sub(left, prefix##_negate(right));                                         \
+        }                                                                                              \
+        Name sum;                                                                                      \
+        sum.bits = left.bits + right.bits;                                                             \
+        sum.tag = left.tag;                                                                            \
+        if (sum.bits < left.bits || sum.bits > FIXEDPOINT_QFORMAT_MAX(INT_BITS, FRAC_BITS))            \
+        {                                                                                              \
+            sum.bits &= FIXEDPOINT_QFORMAT_MAX(INT_BITS, FRAC_BITS);                                   \
+            sum.tag = left.tag == VALID_NONNEGATIVE ? OVERFLOW_POSITIVE : OVERFLOW_NEGATIVE;           \
+        }                                                                                              \
+        return sum;                                                                                    \
+    }                                                                                                  \
+                                                                                                       \
+    Name prefix##_sub(Name left, Name right)                                                           \
+    {                                                                                                  \
+        if (left.tag != right.tag)                                                                     \
+        {                                                                                              \
+            return prefix##_add(left, prefix##_negate(right));                                         \
+        }                                                                                              \
+        Name difference;                                                                               \
+        if (left.bits >= right.bits)                                                                   \
+        {                                                                                              \
+            difference.bits = left.bits - right.bits;                                                  \
+            difference.tag = left.tag;                                                                 \
+        }                                                                                              \
+        else                                                                                           \
+        {                                                                                              \
+            difference.bits = right.bits - left.bits;                                                  \
+            difference.tag = left.tag == VALID_NONNEGATIVE ? VALID_NEGATIVE : VALID_NONNEGATIVE;       \
+        }                                                                                              \
+        if (difference.bits == 0)                                                                      \
+        {                                                                                              \
+            difference.tag = VALID_NONNEGATIVE;                                                        \
+        }                                                                                              \
+        return difference;                                                                             \
+    }                                                                                                  \
+                                                                                                       \
+    Name prefix##_negate(Name val)                                                                     \
+    {                                                                                                  \
+        val.tag = val.bits != 0 && val.tag == VALID_NONNEGATIVE ? VALID_NEGATIVE : VALID_NONNEGATIVE;  \
+        return val;                                                                                    \
+    }                                                                                                  \
+                                                                                                       \
+    Name prefix##_halve(Name val)                                                                      \
+    {                                                                                                  \
+        if (val.bits & 1UL)                                                                            \
+        {                                                                                              \
+            val.tag = val.tag == VALID_NONNEGATIVE ? UNDERFLOW_POSITIVE : UNDERFLOW_NEGATIVE;          \
+        }                                                                                              \
+        val.bits >>= 1;                                                                                \
+        return val;                                                                                    \
+    }                                                                                                  \
+                                                                                                       \
+    Name prefix##_double(Name val)                                                                     \
+    {                                                                                                  \
+        if (val.bits > FIXEDPOINT_QFORMAT_MAX(INT_BITS, FRAC_BITS) >> 1)                               \
+        {                                                                                              \
+            val.tag = val.tag == VALID_NONNEGATIVE ? OVERFLOW_POSITIVE : OVERFLOW_NEGATIVE;            \
+        }                                                                                              \
+        val.bits = (val.bits << 1) & FIXEDPOINT_QFORMAT_MAX(INT_BITS, FRAC_BITS);                      \
+        return val;                                                                                    \
+    }                                                                                                  \
+                                                                                                       \
+    int prefix##_compare(Name left, Name right)                                                        \
+    {                                                                                                  \
+        if (left.tag != right.tag)                                                                     \
+        {                                                                                              \
+            return left.tag == VALID_NONNEGATIVE ? 1 : -1;                                             \
+        }                                                                                              \
+        int result = (left.bits > right.bits) - (left.bits < right.bits);                              \
+        return left.tag == VALID_NONNEGATIVE ? result : -result;                                       \
+    }                                                                                                  \
+                                                                                                       \
+    int prefix##_is_zero(Name val)                                                                     \
+    {                                                                                                  \
+        return prefix##_is_valid(val) && val.bits == 0;                                                \
+    }                                                                                                  \
+                                                                                                       \
+    int prefix##_is_err(Name val)                                                                      \
+    {                                                                                                  \
+        return !prefix##_is_valid(val);                                                                \
+    }                                                                                                  \
+                                                                                                       \
+    int prefix##_is_neg(Name val)                                                                      \
+    {                                                                                                  \
+        return val.tag == VALID_NEGATIVE;                                                              \
+    }                                                                                                  \
+                                                                                                       \
+    int prefix##_is_overflow_neg(Name val)                                                             \
+    {                                                                                                  \
+        return val.tag == OVERFLOW_NEGATIVE;                                                           \
+    }                                                                                                  \
+                                                                                                       \
+    int prefix##_is_overflow_pos(Name val)                                                             \
+    {                                                                                                  \
+        return val.tag == OVERFLOW_POSITIVE;                                                           \
+    }                                                                                                  \
+                                                                                                       \
+    int prefix##_is_underflow_neg(Name val)                                                            \
+    {                                                                                                  \
+        return val.tag == UNDERFLOW_NEGATIVE;                                                          \
+    }                                                                                                  \
+                                                                                                       \
+    int prefix##_is_underflow_pos(Name val)                                                            \
+    {                                                                                                  \
+        return val.tag == UNDERFLOW_POSITIVE;                                                          \
+    }                                                                                                  \
+                                                                                                       \
+    int prefix##_is_valid(Name val)                                                                    \
+    {                                                                                                  \
+        return val.tag == VALID_NEGATIVE || val.tag == VALID_NONNEGATIVE;                              \
+    }                                                                                                  \
+                                                                                                       \
+    char *prefix##_format_as_hex(Name val)                                                             \
+    {                                                                                                  \
+        return fixedpoint_format_as_hex(prefix##_to_fixedpoint(val));                                  \
+    }                                                                                                  \
+                                                                                                       \
+    Fixedpoint prefix##_to_fixedpoint(Name val)                                                        \
+    {                                                                                                  \
+        return fixedpoint_q_to_fixedpoint(val.bits, val.tag, FRAC_BITS);                               \
+    }                                                                                                  \
+                                                                                                       \
+    Name prefix##_from_fixedpoint(Fixedpoint val, FixedpointRound mode)                                \
+    {                                                                                                  \
+        Name result;                                                                                   \
+        result.bits = fixedpoint_q_from_fixedpoint(val, INT_BITS, FRAC_BITS, mode, &result.tag);       \
+        return result;                                                                                 \
+    }
+
+// Helpers used by the generated functions.
+
+// Combine a whole part and a fraction field into a magnitude, in units of
+// 2^-frac_bits (truncated to 64 bits).
+//
+// Parameters:
+//   whole - the whole part
+//   frac - the fraction field, less than 2^frac_bits
+//   frac_bits - the number of fraction bits (less than 64)
+//
+// Returns:
+//   the low 64 bits of whole * 2^frac_bits + frac
+static inline uint64_t fixedpoint_q_pack(uint64_t whole, uint64_t frac, unsigned frac_bits)
+{
+    return whole << frac_bits | frac;
+}
+
+// Get the whole part of a magnitude in units of 2^-frac_bits.
+//
+// Parameters:
+//   bits - the magnitude
+//   frac_bits - the number of fraction bits (less than 64)
+//
+// Returns:
+//   bits / 2^frac_bits
+static inline uint64_t fixedpoint_q_unpack(uint64_t bits, unsigned frac_bits)
+{
+    return bits >> frac_bits;
+}
+
+// Convert a Q format value to a Fixedpoint value.
+//
+// Parameters:
+//   bits - the magnitude, in units of 2^-frac_bits
+//   tag - the tag of the value
+//   frac_bits - the number of fraction bits (less than 64)
+//
+// Returns:
+//   the same value as a Fixedpoint, with the same tag
+Fixedpoint fixedpoint_q_to_fixedpoint(uint64_t bits, Tag tag, unsigned frac_bits);
+
+// Convert a Fixedpoint value to a Q format value.
+//
+// Parameters:
+//   val - the Fixedpoint value
+//   int_bits - the number of integer bits of the format
+//   frac_bits - the number of fraction bits of the format (less than 64)
+//   mode - how to round bits below 2^-frac_bits
+//   tag - receives the tag of the result
+//
+// Returns:
+//   the magnitude of the result, in units of 2^-frac_bits, wrapped to
+//   int_bits + frac_bits bits if the value does not fit (in which case *tag
+//   is OVERFLOW_POSITIVE or OVERFLOW_NEGATIVE)
+uint64_t fixedpoint_q_from_fixedpoint(Fixedpoint val, unsigned int_bits, unsigned frac_bits, FixedpointRound mode,
+                                      Tag *tag);
+
+// Predefined formats
+FIXEDPOINT_QFORMAT_DECLARE(FixedpointQ32_32, fixedpoint_q32_32, 32, 32);
+FIXEDPOINT_QFORMAT_DECLARE(FixedpointQ16_48, fixedpoint_q16_48, 16, 48);
+
+#endif // FIXEDPOINT_Q_H
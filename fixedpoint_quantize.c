@@ -0,0 +1,380 @@
+#include <string.h>
+#include "fixedpoint_quantize.h"
+#include "fixedpoint_float.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define HAVE_X86_VECTORS 1
+#endif
+
+// The instruction set in use, or -1 if not yet chosen
+static int selected_isa = -1;
+
+FixedpointIsa fixedpoint_isa_detect(void)
+{
+#if defined(HAVE_X86_VECTORS)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512cd") &&
+        __builtin_cpu_supports("avx512dq"))
+    {
+        return FIXEDPOINT_ISA_AVX512;
+    }
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return FIXEDPOINT_ISA_AVX2;
+    }
+#endif
+    return FIXEDPOINT_ISA_SCALAR;
+}
+
+int fixedpoint_isa_select(FixedpointIsa isa)
+{
+    if (isa > fixedpoint_isa_detect())
+    {
+        return 0;
+    }
+    selected_isa = isa;
+    return 1;
+}
+
+static FixedpointIsa current_isa(void)
+{
+    if (selected_isa < 0)
+    {
+        selected_isa = fixedpoint_isa_detect();
+    }
+    return (FixedpointIsa)selected_isa;
+}
+
+// Convert one element with the scalar code, recording it in the bitmap
+static size_t quantize_one(const double *in, Fixedpoint *out, size_t i, FixedpointRound mode, uint64_t *bitmap)
+{
+    out[i] = fixedpoint_from_double(in[i], mode);
+    if (fixedpoint_is_valid(out[i]))
+    {
+        return 0;
+    }
+    if (bitmap != NULL)
+    {
+        bitmap[i / 64] |= 1UL << (i % 64);
+    }
+    return 1;
+}
+
+// Store lanes computed by a vector kernel: lanes whose bit is set in fast
+// are taken from whole, frac and tag, the others are converted by the
+// scalar code
+static size_t store_lanes(const double *in, Fixedpoint *out, size_t base, unsigned lanes, unsigned fast,
+                          const uint64_t *whole, const uint64_t *frac, const uint64_t *tag, FixedpointRound mode,
+                          uint64_t *bitmap)
+{
+    size_t invalid = 0;
+    for (unsigned j = 0; j < lanes; ++j)
+    {
+        if (fast & (1u << j))
+        {
+            out[base + j].whole = whole[j];
+            out[base + j].frac = frac[j];
+            out[base + j].tag = (Tag)tag[j];
+        }
+        else
+        {
+            invalid += quantize_one(in, out, base + j, mode, bitmap);
+        }
+    }
+    return invalid;
+}
+
+#if defined(HAVE_X86_VECTORS)
+// Quantize with AVX2. A double with biased exponent b in [1011, 1086] has
+// its lowest significand bit at or above 2^-64 and its value below 2^64,
+// so it converts exactly by shifting the significand into place: the
+// whole part is the significand shifted by b - 1075 (left if positive,
+// right if negative; out-of-range shift counts give 0 with vpsllvq and
+// vpsrlvq), and the fractional part is the significand shifted left by
+// b - 1011. Zeros are also handled here; everything else is left to the
+// scalar code.
+__attribute__((target("avx2"))) static size_t quantize_avx2(const double *in, Fixedpoint *out, size_t n,
+                                                             FixedpointRound mode, uint64_t *bitmap)
+{
+    const __m256i exp_mask = _mm256_set1_epi64x(0x7ff);
+    const __m256i frac_mask = _mm256_set1_epi64x(0xfffffffffffffL);
+    const __m256i implicit_bit = _mm256_set1_epi64x(1L << 52);
+    const __m256i abs_mask = _mm256_set1_epi64x(0x7fffffffffffffffL);
+    const __m256i zero = _mm256_setzero_si256();
+    uint64_t whole[4], frac[4], tag[4];
+    size_t invalid = 0;
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4)
+    {
+        __m256i bits = _mm256_loadu_si256((const __m256i *)(in + i));
+        __m256i biased = _mm256_and_si256(_mm256_srli_epi64(bits, 52), exp_mask);
+        __m256i sig = _mm256_or_si256(_mm256_and_si256(bits, frac_mask), implicit_bit);
+        __m256i is_zero = _mm256_cmpeq_epi64(_mm256_and_si256(bits, abs_mask), zero);
+        __m256i in_range = _mm256_and_si256(_mm256_cmpgt_epi64(biased, _mm256_set1_epi64x(1010)),
+                                            _mm256_cmpgt_epi64(_mm256_set1_epi64x(1087), biased));
+
+        __m256i w = _mm256_or_si256(_mm256_sllv_epi64(sig, _mm256_sub_epi64(biased, _mm256_set1_epi64x(1075))),
+                                    _mm256_srlv_epi64(sig, _mm256_sub_epi64(_mm256_set1_epi64x(1075), biased)));
+        __m256i f = _mm256_sllv_epi64(sig, _mm256_sub_epi64(biased, _mm256_set1_epi64x(1011)));
+        w = _mm256_andnot_si256(is_zero, w);
+        f = _mm256_andnot_si256(is_zero, f);
+        __m256i t = _mm256_andnot_si256(is_zero, _mm256_srli_epi64(bits, 63));
+
+        _mm256_storeu_si256((__m256i *)whole, w);
+        _mm256_storeu_si256((__m256i *)frac, f);
+        _mm256_storeu_si256((__m256i *)tag, t);
+        unsigned fast = (unsigned)_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_or_si256(in_range, is_zero)));
+        invalid += store_lanes(in, out, i, 4, fast, whole, frac, tag, mode, bitmap);
+    }
+    for (; i < n; ++i)
+    {
+        invalid += quantize_one(in, out, i, mode, bitmap);
+    }
+    return invalid;
+}
+
+// Quantize with AVX-512; the same algorithm as quantize_avx2, 8 lanes at a time
+__attribute__((target("avx512f"))) static size_t quantize_avx512(const double *in, Fixedpoint *out, size_t n,
+                                                                  FixedpointRound mode, uint64_t *bitmap)
+{
+    const __m512i exp_mask = _mm512_set1_epi64(0x7ff);
+    const __m512i frac_mask = _mm512_set1_epi64(0xfffffffffffffL);
+    const __m512i implicit_bit = _mm512_set1_epi64(1L << 52);
+    const __m512i abs_mask = _mm512_set1_epi64(0x7fffffffffffffffL);
+    uint64_t whole[8], frac[8], tag[8];
+    size_t invalid = 0;
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8)
+    {
+        __m512i bits = _mm512_loadu_si512(in + i);
+        __m512i biased = _mm512_and_si512(_mm512_srli_epi64(bits, 52), exp_mask);
+        __m512i sig = _mm512_or_si512(_mm512_and_si512(bits, frac_mask), implicit_bit);
+        __mmask8 is_zero = _mm512_testn_epi64_mask(bits, abs_mask);
+        __mmask8 in_range = _mm512_cmpgt_epi64_mask(biased, _mm512_set1_epi64(1010)) &
+                            _mm512_cmplt_epi64_mask(biased, _mm512_set1_epi64(1087));
+
+        __m512i w = _mm512_or_si512(_mm512_sllv_epi64(sig, _mm512_sub_epi64(biased, _mm512_set1_epi64(1075))),
+                                    _mm512_srlv_epi64(sig, _mm512_sub_epi64(_mm512_set1_epi64(1075), biased)));
+        __m512i f = _mm512_sllv_epi64(sig, _mm512_sub_epi64(biased, _mm512_set1_epi64(1011)));
+        w = _mm512_maskz_mov_epi64((__mmask8)~is_zero, w);
+        f = _mm512_maskz_mov_epi64((__mmask8)~is_zero, f);
+        __m512i t = _mm512_maskz_mov_epi64((__mmask8)~is_zero, _mm512_srli_epi64(bits, 63));
+
+        _mm512_storeu_si512(whole, w);
+        _mm512_storeu_si512(frac, f);
+        _mm512_storeu_si512(tag, t);
+        invalid += store_lanes(in, out, i, 8, in_range | is_zero, whole, frac, tag, mode, bitmap);
+    }
+    for (; i < n; ++i)
+    {
+        invalid += quantize_one(in, out, i, mode, bitmap);
+    }
+    return invalid;
+}
+#endif
+
+size_t fixedpoint_quantize(const double *in, Fixedpoint *out, size_t n, FixedpointRound mode, uint64_t *bitmap)
+{
+    if (bitmap != NULL)
+    {
+        memset(bitmap, 0, (n + 63) / 64 * sizeof(uint64_t));
+    }
+
+#if defined(HAVE_X86_VECTORS)
+    switch (current_isa())
+    {
+    case FIXEDPOINT_ISA_AVX512:
+        return quantize_avx512(in, out, n, mode, bitmap);
+    case FIXEDPOINT_ISA_AVX2:
+        return quantize_avx2(in, out, n, mode, bitmap);
+    default:
+        break;
+    }
+#else
+    (void)current_isa;
+#endif
+
+    size_t invalid = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        invalid += quantize_one(in, out, i, mode, bitmap);
+    }
+    return invalid;
+}
+
+// Gather the fields of a block of Fixedpoint values into separate arrays
+// for the vector kernels. Returns a bit mask of the lanes holding valid values.
+static unsigned gather_lanes(const Fixedpoint *in, unsigned lanes, uint64_t *whole, uint64_t *frac, uint64_t *sign)
+{
+    unsigned valid = 0;
+    for (unsigned j = 0; j < lanes; ++j)
+    {
+        whole[j] = in[j].whole;
+        frac[j] = in[j].frac;
+        // Like fixedpoint_to_double, a negative zero converts to +0.0
+        sign[j] = (uint64_t)(in[j].tag == VALID_NEGATIVE && (in[j].whole | in[j].frac) != 0) << 63;
+        valid |= (unsigned)fixedpoint_is_valid(in[j]) << j;
+    }
+    return valid;
+}
+
+#if defined(HAVE_X86_VECTORS)
+// Convert 64 bit lanes holding values below 2^52 to doubles exactly, by
+// placing them in the significand of 2^52 and subtracting 2^52
+__attribute__((target("avx2"))) static inline __m256d small_u64_to_double(__m256i x)
+{
+    const __m256d two52 = _mm256_set1_pd(0x1p52);
+    return _mm256_sub_pd(_mm256_castsi256_pd(_mm256_or_si256(x, _mm256_castpd_si256(two52))), two52);
+}
+
+// Count leading zeros of 64 bit lanes with AVX2, which has no lzcnt:
+// convert each 32 bit half exactly to a double and read its exponent
+__attribute__((target("avx2"))) static inline __m256i lzcnt_avx2(__m256i x)
+{
+    const __m256i low_mask = _mm256_set1_epi64x(0xffffffffL);
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i hi = _mm256_srli_epi64(x, 32);
+    __m256i lo = _mm256_and_si256(x, low_mask);
+    // floor(log2) + 1023 of each half (meaningless if the half is zero)
+    __m256i hi_exp = _mm256_srli_epi64(_mm256_castpd_si256(small_u64_to_double(hi)), 52);
+    __m256i lo_exp = _mm256_srli_epi64(_mm256_castpd_si256(small_u64_to_double(lo)), 52);
+    __m256i hi_lz = _mm256_sub_epi64(_mm256_set1_epi64x(1023 + 31), hi_exp);
+    __m256i lo_lz = _mm256_sub_epi64(_mm256_set1_epi64x(1023 + 63), lo_exp);
+    __m256i lz = _mm256_blendv_epi8(hi_lz, lo_lz, _mm256_cmpeq_epi64(hi, zero));
+    return _mm256_blendv_epi8(lz, _mm256_set1_epi64x(64), _mm256_cmpeq_epi64(x, zero));
+}
+
+// Dequantize with AVX2. Each magnitude is normalized so that its leading
+// one is the top bit of a 64 bit word, with any nonzero bits below that
+// word folded into its lowest bit (a sticky bit, which is below the rounding
+// position of a double and so does not change the rounding). The word is
+// converted to a double with a single rounding, as the sum of its exactly
+// converted 32 bit halves, and then scaled by an exact power of two.
+__attribute__((target("avx2"))) static void dequantize_avx2(const Fixedpoint *in, double *out, size_t n)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i one = _mm256_set1_epi64x(1);
+    const __m256i sixty_four = _mm256_set1_epi64x(64);
+    const __m256i low_mask = _mm256_set1_epi64x(0xffffffffL);
+    uint64_t whole[4], frac[4], sign[4];
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4)
+    {
+        unsigned valid = gather_lanes(in + i, 4, whole, frac, sign);
+        __m256i w = _mm256_loadu_si256((const __m256i *)whole);
+        __m256i f = _mm256_loadu_si256((const __m256i *)frac);
+        __m256i whole_zero = _mm256_cmpeq_epi64(w, zero);
+
+        // Whole part nonzero: shift the 128 bit magnitude left by lz(whole)
+        __m256i lz_w = lzcnt_avx2(w);
+        __m256i top_w = _mm256_or_si256(_mm256_sllv_epi64(w, lz_w),
+                                        _mm256_srlv_epi64(f, _mm256_sub_epi64(sixty_four, lz_w)));
+        __m256i rest = _mm256_sllv_epi64(f, lz_w);
+        top_w = _mm256_or_si256(top_w, _mm256_andnot_si256(_mm256_cmpeq_epi64(rest, zero), one));
+
+        // Whole part zero: shift the fractional part left by lz(frac)
+        __m256i lz_f = lzcnt_avx2(f);
+        __m256i top_f = _mm256_sllv_epi64(f, lz_f);
+
+        __m256i top = _mm256_blendv_epi8(top_w, top_f, whole_zero);
+        __m256i scale = _mm256_blendv_epi8(lz_w, _mm256_add_epi64(lz_f, sixty_four), whole_zero);
+
+        __m256d hi = _mm256_mul_pd(small_u64_to_double(_mm256_srli_epi64(top, 32)), _mm256_set1_pd(0x1p32));
+        __m256d d = _mm256_add_pd(hi, small_u64_to_double(_mm256_and_si256(top, low_mask)));
+        // 2^-scale, built from its exponent bits; zero magnitudes give 0 * 2^-128
+        __m256d factor = _mm256_castsi256_pd(_mm256_slli_epi64(_mm256_sub_epi64(_mm256_set1_epi64x(1023), scale), 52));
+        d = _mm256_mul_pd(d, factor);
+        d = _mm256_or_pd(d, _mm256_loadu_pd((const double *)sign));
+        _mm256_storeu_pd(out + i, d);
+
+        for (unsigned j = 0; j < 4; ++j)
+        {
+            if (!(valid & (1u << j)))
+            {
+                out[i + j] = fixedpoint_to_double(in[i + j]);
+            }
+        }
+    }
+    for (; i < n; ++i)
+    {
+        out[i] = fixedpoint_to_double(in[i]);
+    }
+}
+
+// Dequantize with AVX-512; the same algorithm as dequantize_avx2, but with
+// native leading zero counts and 64 bit integer to double conversion
+__attribute__((target("avx512f,avx512cd,avx512dq"))) static void dequantize_avx512(const Fixedpoint *in, double *out,
+                                                                                   size_t n)
+{
+    const __m512i one = _mm512_set1_epi64(1);
+    const __m512i sixty_four = _mm512_set1_epi64(64);
+    uint64_t whole[8], frac[8], sign[8];
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8)
+    {
+        unsigned valid = gather_lanes(in + i, 8, whole, frac, sign);
+        __m512i w = _mm512_loadu_si512(whole);
+        __m512i f = _mm512_loadu_si512(frac);
+        __mmask8 whole_zero = _mm512_testn_epi64_mask(w, w);
+
+        __m512i lz_w = _mm512_lzcnt_epi64(w);
+        __m512i top_w = _mm512_or_si512(_mm512_sllv_epi64(w, lz_w),
+                                        _mm512_srlv_epi64(f, _mm512_sub_epi64(sixty_four, lz_w)));
+        __m512i rest = _mm512_sllv_epi64(f, lz_w);
+        top_w = _mm512_mask_or_epi64(top_w, _mm512_test_epi64_mask(rest, rest), top_w, one);
+
+        __m512i lz_f = _mm512_lzcnt_epi64(f);
+        __m512i top_f = _mm512_sllv_epi64(f, lz_f);
+
+        __m512i top = _mm512_mask_blend_epi64(whole_zero, top_w, top_f);
+        __m512i scale = _mm512_mask_blend_epi64(whole_zero, lz_w, _mm512_add_epi64(lz_f, sixty_four));
+
+        __m512d d = _mm512_cvtepu64_pd(top);
+        __m512d factor = _mm512_castsi512_pd(_mm512_slli_epi64(_mm512_sub_epi64(_mm512_set1_epi64(1023), scale), 52));
+        d = _mm512_mul_pd(d, factor);
+        d = _mm512_castsi512_pd(_mm512_or_si512(_mm512_castpd_si512(d), _mm512_loadu_si512(sign)));
+        _mm512_storeu_pd(out + i, d);
+
+        for (unsigned j = 0; j < 8; ++j)
+        {
+            if (!(valid & (1u << j)))
+            {
+                out[i + j] = fixedpoint_to_double(in[i + j]);
+            }
+        }
+    }
+    for (; i < n; ++i)
+    {
+        out[i] = fixedpoint_to_double(in[i]);
+    }
+}
+#endif
+
+void fixedpoint_dequantize(const Fixedpoint *in, double *out, size_t n)
+{
+#if defined(HAVE_X86_VECTORS)
+    switch (current_isa())
+    {
+    case FIXEDPOINT_ISA_AVX512:
+        dequantize_avx512(in, out, n);
+        return;
+    case FIXEDPOINT_ISA_AVX2:
+        dequantize_avx2(in, out, n);
+        return;
+    default:
+        break;
+    }
+#else
+    (void)gather_lanes;
+#endif
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        out[i] = fixedpoint_to_double(in[i]);
+    }
+}
@@ -0,0 +1,70 @@
+#ifndef FIXEDPOINT_QUANTIZE_H
+#define FIXEDPOINT_QUANTIZE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "fixedpoint.h"
+
+// Batch conversion between arrays of doubles and arrays of Fixedpoint values.
+//
+// The results are identical to converting each element with
+// fixedpoint_from_double and fixedpoint_to_double, but the common cases
+// are converted several elements at a time with AVX2 or AVX-512 when the
+// processor supports them. Elements the vector code cannot handle (NaN,
+// infinities, out of range or inexact inputs, non-valid Fixedpoint values)
+// fall back to the scalar conversion.
+
+// An enum that holds the instruction sets the batch conversions can use
+// FIXEDPOINT_ISA_SCALAR: No vector instructions
+// FIXEDPOINT_ISA_AVX2: AVX2 (4 elements at a time)
+// FIXEDPOINT_ISA_AVX512: AVX-512 F, CD and DQ (8 elements at a time)
+typedef enum
+{
+    FIXEDPOINT_ISA_SCALAR,
+    FIXEDPOINT_ISA_AVX2,
+    FIXEDPOINT_ISA_AVX512
+} FixedpointIsa;
+
+// Get the best instruction set supported by the processor.
+//
+// Returns:
+//   the best supported instruction set
+FixedpointIsa fixedpoint_isa_detect(void);
+
+// Choose the instruction set used by the batch conversions. By default the
+// best supported one is used; this is mainly useful for testing and
+// benchmarking the different code paths.
+//
+// Parameters:
+//   isa - the instruction set to use
+//
+// Returns:
+//   1 if isa is supported and was selected;
+//   0 if isa is not supported (the selection is unchanged)
+int fixedpoint_isa_select(FixedpointIsa isa);
+
+// Convert an array of doubles to Fixedpoint values.
+//
+// Parameters:
+//   in - the doubles to convert
+//   out - the array that receives the Fixedpoint values
+//   n - the number of elements
+//   mode - how to round inputs with bits below 2^-64
+//   bitmap - if not NULL, an array of (n + 63) / 64 words; bit (i % 64) of
+//            bitmap[i / 64] is set if out[i] is not a valid value (i.e. it
+//            is tagged ERROR, OVERFLOW_* or UNDERFLOW_*), and cleared otherwise
+//
+// Returns:
+//   the number of elements of out that are not valid values
+size_t fixedpoint_quantize(const double *in, Fixedpoint *out, size_t n, FixedpointRound mode, uint64_t *bitmap);
+
+// Convert an array of Fixedpoint values to doubles, rounding to nearest
+// (ties to even).
+//
+// Parameters:
+//   in - the Fixedpoint values to convert
+//   out - the array that receives the doubles
+//   n - the number of elements
+void fixedpoint_dequantize(const Fixedpoint *in, double *out, size_t n);
+
+#endif // FIXEDPOINT_QUANTIZE_H
@@ -0,0 +1,305 @@
+#include <stdlib.h>
+#include <pthread.h>
+#include "fixedpoint_scan.h"
+#include "fixedpoint_wide.h"
+
+// A 192 bit two's complement number in units of 2^-64, least significant
+// word first
+typedef struct
+{
+    uint64_t word[3];
+} Wide192;
+
+// What the first pass finds out about a block
+//
+// Fields:
+//  sum - the sum of the block's values
+//  min - the smallest running total within the block, from its start
+//  max - the largest running total within the block, from its start
+//  invalid - whether the block holds a value that is not valid (if so, sum,
+//            min and max only cover the values before it)
+//  offset - the sum of the values of the blocks before it
+//  written - whether the second pass has written the block's prefix sums
+typedef struct
+{
+    Wide192 sum;
+    Wide192 min;
+    Wide192 max;
+    int invalid;
+    Wide192 offset;
+    int written;
+} ScanBlock;
+
+// A scan and how it is divided among threads
+//
+// Fields:
+//  in - the values
+//  out - the prefix sums
+//  count - the number of values
+//  exclusive - whether the scan is exclusive
+//  blocks - one block per thread
+//  num_threads - the number of threads
+//  clean_blocks - the number of blocks, from the first, that the second pass
+//                 writes
+typedef struct
+{
+    const Fixedpoint *in;
+    Fixedpoint *out;
+    size_t count;
+    int exclusive;
+    ScanBlock *blocks;
+    unsigned num_threads;
+    unsigned clean_blocks;
+} ScanJob;
+
+// The part of a job done by one thread
+//
+// Fields:
+//  job - the job
+//  thread - the index of the thread
+typedef struct
+{
+    ScanJob *job;
+    unsigned thread;
+} ScanWorker;
+
+// Add a valid value to a wide number
+static inline void wide192_add(Wide192 *w, Fixedpoint val)
+{
+    // A negative value is added as its two's complement
+    uint64_t mask = val.tag == VALID_NEGATIVE ? ~0UL : 0;
+    u128 sum = (u128)w->word[0] + (val.frac ^ mask) + (mask & 1);
+    w->word[0] = (uint64_t)sum;
+    sum = (u128)w->word[1] + (val.whole ^ mask) + (uint64_t)(sum >> 64);
+    w->word[1] = (uint64_t)sum;
+    w->word[2] += mask + (uint64_t)(sum >> 64);
+}
+
+static inline void wide192_add_wide(Wide192 *w, const Wide192 *other)
+{
+    u128 sum = (u128)w->word[0] + other->word[0];
+    w->word[0] = (uint64_t)sum;
+    sum = (u128)w->word[1] + other->word[1] + (uint64_t)(sum >> 64);
+    w->word[1] = (uint64_t)sum;
+    w->word[2] += other->word[2] + (uint64_t)(sum >> 64);
+}
+
+static inline int wide192_less(const Wide192 *left, const Wide192 *right)
+{
+    if (left->word[2] != right->word[2])
+    {
+        return (int64_t)left->word[2] < (int64_t)right->word[2];
+    }
+    if (left->word[1] != right->word[1])
+    {
+        return left->word[1] < right->word[1];
+    }
+    return left->word[0] < right->word[0];
+}
+
+// Whether a wide number's magnitude is below 2^64, so it is a Fixedpoint
+// value
+static inline int wide192_fits(const Wide192 *w)
+{
+    return w->word[2] == 0 || (w->word[2] == ~0UL && (w->word[1] | w->word[0]) != 0);
+}
+
+// Convert a wide number that fits to a Fixedpoint value, with 0 non-negative
+// as fixedpoint_add returns it
+static inline Fixedpoint wide192_result(const Wide192 *w)
+{
+    uint64_t mask = w->word[2] ? ~0UL : 0;
+    u128 mag = ((u128)w->word[1] << 64 | w->word[0]) ^ ((u128)mask << 64 | mask);
+    mag += mask & 1;
+    Fixedpoint val = {(uint64_t)(mag >> 64), (uint64_t)mag, mask ? VALID_NEGATIVE : VALID_NONNEGATIVE};
+    return val;
+}
+
+// Write the prefix sums of in[begin..end) starting from total, stopping at
+// the first value that is not valid or that makes the total overflow.
+// Returns the index it stopped at (end if it did not stop), with total
+// updated to the sum of the values before it.
+static size_t scan_range(const Fixedpoint *in, Fixedpoint *out, size_t begin, size_t end, int exclusive, Wide192 *total)
+{
+    Wide192 sum = *total;
+    size_t i = begin;
+    for (; i < end; ++i)
+    {
+        Fixedpoint val = in[i];
+        if (!fixedpoint_is_valid(val))
+        {
+            break;
+        }
+        Wide192 next = sum;
+        wide192_add(&next, val);
+        if (!wide192_fits(&next))
+        {
+            break;
+        }
+        out[i] = wide192_result(exclusive ? &sum : &next);
+        sum = next;
+    }
+    *total = sum;
+    return i;
+}
+
+// Continue the sequential loop from index begin with the given total
+static void scan_sequential(const Fixedpoint *in, Fixedpoint *out, size_t begin, size_t count, int exclusive,
+                            Fixedpoint total)
+{
+    for (size_t i = begin; i < count; ++i)
+    {
+        Fixedpoint val = in[i];
+        if (exclusive)
+        {
+            out[i] = total;
+        }
+        total = fixedpoint_add(total, val);
+        if (!exclusive)
+        {
+            out[i] = total;
+        }
+    }
+}
+
+static size_t block_begin(const ScanJob *job, unsigned b)
+{
+    return (size_t)((u128)job->count * b / job->num_threads);
+}
+
+// Find the sum of a block and the range of its running totals
+static void *sum_worker(void *arg)
+{
+    ScanWorker *worker = arg;
+    ScanJob *job = worker->job;
+    ScanBlock *block = &job->blocks[worker->thread];
+    size_t end = block_begin(job, worker->thread + 1);
+    Wide192 sum = {{0, 0, 0}};
+    Wide192 min = sum;
+    Wide192 max = sum;
+    block->invalid = 0;
+    block->written = 0;
+    for (size_t i = block_begin(job, worker->thread); i < end; ++i)
+    {
+        Fixedpoint val = job->in[i];
+        if (!fixedpoint_is_valid(val))
+        {
+            block->invalid = 1;
+            break;
+        }
+        wide192_add(&sum, val);
+        min = wide192_less(&sum, &min) ? sum : min;
+        max = wide192_less(&max, &sum) ? sum : max;
+    }
+    block->sum = sum;
+    block->min = min;
+    block->max = max;
+    return NULL;
+}
+
+// Write the prefix sums of a block known to be clean. A block is written
+// only once, since in may be the same array as out.
+static void *write_worker(void *arg)
+{
+    ScanWorker *worker = arg;
+    ScanJob *job = worker->job;
+    ScanBlock *block = &job->blocks[worker->thread];
+    if (worker->thread < job->clean_blocks && !block->written)
+    {
+        Wide192 total = block->offset;
+        scan_range(job->in, job->out, block_begin(job, worker->thread), block_begin(job, worker->thread + 1),
+                   job->exclusive, &total);
+        block->written = 1;
+    }
+    return NULL;
+}
+
+// Run fn on every thread of a job and wait for all of them
+static int run_workers(ScanJob *job, void *(*fn)(void *))
+{
+    ScanWorker *workers = malloc(job->num_threads * sizeof(ScanWorker));
+    pthread_t *threads = malloc(job->num_threads * sizeof(pthread_t));
+    unsigned started = 0;
+    int ok = workers != NULL && threads != NULL;
+    for (; ok && started < job->num_threads; ++started)
+    {
+        workers[started].job = job;
+        workers[started].thread = started;
+        if (pthread_create(&threads[started], NULL, fn, &workers[started]) != 0)
+        {
+            ok = 0;
+            break;
+        }
+    }
+    for (unsigned t = 0; t < started; ++t)
+    {
+        pthread_join(threads[t], NULL);
+    }
+    free(workers);
+    free(threads);
+    return ok;
+}
+
+// Run fn for every block of a job on the calling thread
+static void run_remaining(ScanJob *job, void *(*fn)(void *))
+{
+    for (unsigned t = 0; t < job->num_threads; ++t)
+    {
+        ScanWorker worker = {job, t};
+        fn(&worker);
+    }
+}
+
+static size_t scan(const Fixedpoint *in, Fixedpoint *out, size_t count, unsigned num_threads, int exclusive)
+{
+    Wide192 total = {{0, 0, 0}};
+    size_t start = 0;
+    if (num_threads > 1 && count >= num_threads)
+    {
+        ScanJob job = {in, out, count, exclusive, malloc(num_threads * sizeof(ScanBlock)), num_threads, 0};
+        if (job.blocks && run_workers(&job, sum_worker))
+        {
+            // The blocks before the first one whose running totals may leave
+            // the range, or that holds a value that is not valid, are clean
+            Wide192 offset = total;
+            for (; job.clean_blocks < num_threads; ++job.clean_blocks)
+            {
+                ScanBlock *block = &job.blocks[job.clean_blocks];
+                Wide192 low = offset;
+                Wide192 high = offset;
+                wide192_add_wide(&low, &block->min);
+                wide192_add_wide(&high, &block->max);
+                if (block->invalid || !wide192_fits(&low) || !wide192_fits(&high))
+                {
+                    break;
+                }
+                block->offset = offset;
+                wide192_add_wide(&offset, &block->sum);
+            }
+            if (!run_workers(&job, write_worker))
+            {
+                run_remaining(&job, write_worker);
+            }
+            total = offset;
+            start = block_begin(&job, job.clean_blocks);
+        }
+        free(job.blocks);
+    }
+
+    size_t stop = scan_range(in, out, start, count, exclusive, &total);
+    if (stop < count)
+    {
+        scan_sequential(in, out, stop, count, exclusive, wide192_result(&total));
+    }
+    return stop;
+}
+
+size_t fixedpoint_scan_inclusive(const Fixedpoint *in, Fixedpoint *out, size_t count, unsigned num_threads)
+{
+    return scan(in, out, count, num_threads, 0);
+}
+
+size_t fixedpoint_scan_exclusive(const Fixedpoint *in, Fixedpoint *out, size_t count, unsigned num_threads)
+{
+    return scan(in, out, count, num_threads, 1);
+}
@@ -0,0 +1,58 @@
+#ifndef FIXEDPOINT_SCAN_H
+#define FIXEDPOINT_SCAN_H
+
+#include <stddef.h>
+#include "fixedpoint.h"
+
+// Prefix sums (scans) of Fixedpoint arrays.
+//
+// The results are exactly those of a sequential loop of fixedpoint_add
+// starting from 0, but are computed in two parallel passes over blocks of
+// the array, one per thread: the first computes each block's exact sum and
+// the smallest and largest running totals within it, then the offset of
+// each block is the sum of the blocks before it, and the second pass writes
+// each block's running totals starting from its offset. The totals are kept
+// in 192 bit two's complement numbers, so no intermediate result overflows.
+//
+// The first pass also finds the first block in which the running total
+// could overflow, or that holds a value that is not valid. From the first
+// such element, the outputs are computed by the sequential loop itself, so
+// they are the same as the loop's even past that point.
+
+// Compute the inclusive prefix sums of an array:
+// out[i] = in[0] + ... + in[i], as the loop
+// total = 0; for each i, total = fixedpoint_add(total, in[i]), out[i] = total
+// computes them.
+//
+// Parameters:
+//   in - the values
+//   out - receives the prefix sums (may be the same array as in)
+//   count - the number of values
+//   num_threads - the number of threads to use (0 or 1 computes serially;
+//                 if threads or memory cannot be allocated, the sums are
+//                 computed serially)
+//
+// Returns:
+//   the index of the first value that is not valid or that makes the
+//   running total overflow, or count if there is none
+size_t fixedpoint_scan_inclusive(const Fixedpoint *in, Fixedpoint *out, size_t count, unsigned num_threads);
+
+// Compute the exclusive prefix sums of an array:
+// out[i] = in[0] + ... + in[i - 1] (so out[0] = 0), as the loop
+// total = 0; for each i, out[i] = total, total = fixedpoint_add(total, in[i])
+// computes them.
+//
+// Parameters:
+//   in - the values
+//   out - receives the prefix sums (may be the same array as in)
+//   count - the number of values
+//   num_threads - the number of threads to use, as for
+//                 fixedpoint_scan_inclusive
+//
+// Returns:
+//   the index of the first value that is not valid or that makes the
+//   running total overflow (so out[i] is the exact sum for every i up to
+//   and including it), or count if there is none
+size_t fixedpoint_scan_exclusive(const Fixedpoint *in, Fixedpoint *out, size_t count, unsigned num_threads);
+
+#endif // FIXEDPOINT_SCAN_H
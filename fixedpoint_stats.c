@@ -0,0 +1,464 @@
+#include <stdlib.h>
+#include <string.h>
+#include "fixedpoint_stats.h"
+#include "fixedpoint256.h"
+
+__extension__ typedef unsigned __int128 u128;
+
+// The number of 64 bit words of the numerator of a variance
+#define NUMERATOR_WORDS 6
+
+// The smallest capacity of a level of a KLL sketch (the smallest k)
+#define MIN_CAPACITY 8
+
+// A value of a KLL sketch with its weight, for estimating quantiles
+//
+// Fields:
+//  value - the value
+//  weight - the number of original values it stands for
+typedef struct
+{
+    Fixedpoint value;
+    uint64_t weight;
+} Weighted;
+
+static Fixedpoint tagged_value(Tag tag)
+{
+    Fixedpoint val = {0, 0, tag};
+    return val;
+}
+
+// Add v * 2^(64 * offset) to a number of count words; v is at most the
+// product of two words
+static void add_words(uint64_t *words, size_t count, size_t offset, u128 v)
+{
+    u128 sum = (u128)words[offset] + (uint64_t)v;
+    words[offset] = (uint64_t)sum;
+    uint64_t carry = (uint64_t)(sum >> 64) + (uint64_t)(v >> 64);
+    for (size_t i = offset + 1; i < count && carry != 0; ++i)
+    {
+        sum = (u128)words[i] + carry;
+        words[i] = (uint64_t)sum;
+        carry = (uint64_t)(sum >> 64);
+    }
+}
+
+// Multiply two numbers of na and nb words into out, which has na + nb words
+static void mul_words(const uint64_t *a, size_t na, const uint64_t *b, size_t nb, uint64_t *out)
+{
+    memset(out, 0, (na + nb) * sizeof(uint64_t));
+    for (size_t i = 0; i < na; ++i)
+    {
+        for (size_t j = 0; j < nb; ++j)
+        {
+            add_words(out, na + nb, i + j, (u128)a[i] * b[j]);
+        }
+    }
+}
+
+// Divide a number of count words by divisor in place, returning the remainder
+static uint64_t div_words(uint64_t *words, size_t count, uint64_t divisor)
+{
+    u128 rem = 0;
+    for (size_t i = count; i-- > 0;)
+    {
+        u128 cur = rem << 64 | words[i];
+        words[i] = (uint64_t)(cur / divisor);
+        rem = cur % divisor;
+    }
+    return (uint64_t)rem;
+}
+
+void fixedpoint_moments_init(FixedpointMoments *m)
+{
+    m->count = 0;
+    fixedpoint_accum_init(&m->sum);
+    memset(m->sum_squares, 0, sizeof(m->sum_squares));
+}
+
+void fixedpoint_moments_update(FixedpointMoments *m, const Fixedpoint *vals, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        Fixedpoint val = vals[i];
+        fixedpoint_accum_add(&m->sum, val);
+        if (!fixedpoint_is_valid(val))
+        {
+            continue;
+        }
+        ++m->count;
+
+        // (whole 2^64 + frac)^2 = whole^2 2^128 + 2 whole frac 2^64 + frac^2
+        u128 mid = (u128)val.whole * val.frac;
+        add_words(m->sum_squares, FIXEDPOINT_MOMENTS_SQUARE_WORDS, 0, (u128)val.frac * val.frac);
+        add_words(m->sum_squares, FIXEDPOINT_MOMENTS_SQUARE_WORDS, 1, mid);
+        add_words(m->sum_squares, FIXEDPOINT_MOMENTS_SQUARE_WORDS, 1, mid);
+        add_words(m->sum_squares, FIXEDPOINT_MOMENTS_SQUARE_WORDS, 2, (u128)val.whole * val.whole);
+    }
+}
+
+void fixedpoint_moments_merge(FixedpointMoments *m, const FixedpointMoments *other)
+{
+    m->count += other->count;
+    fixedpoint_accum_merge(&m->sum, &other->sum);
+    for (size_t i = 0; i < FIXEDPOINT_MOMENTS_SQUARE_WORDS; ++i)
+    {
+        add_words(m->sum_squares, FIXEDPOINT_MOMENTS_SQUARE_WORDS, i, other->sum_squares[i]);
+    }
+}
+
+Fixedpoint fixedpoint_moments_mean(const FixedpointMoments *m, FixedpointRound mode)
+{
+    return fixedpoint_accum_div(&m->sum, m->count, mode);
+}
+
+// Compute (n sum_squares - sum^2) / (n divisor), which is the population
+// variance for divisor = n and the sample variance for divisor = n - 1
+static Fixedpoint variance(const FixedpointMoments *m, uint64_t divisor, FixedpointRound mode)
+{
+    if (m->sum.tag != VALID_NONNEGATIVE)
+    {
+        return tagged_value(m->sum.tag);
+    }
+    if (divisor == 0)
+    {
+        return tagged_value(ERROR);
+    }
+
+    // The magnitude of the sum, in units of 2^-64
+    uint64_t mask = (int64_t)m->sum.high < 0 ? ~0UL : 0;
+    uint64_t sum[3] = {m->sum.frac ^ mask, m->sum.whole ^ mask, m->sum.high ^ mask};
+    add_words(sum, 3, 0, mask & 1);
+
+    // The numerator, in units of 2^-128, is never negative
+    uint64_t n = m->count;
+    uint64_t num[NUMERATOR_WORDS];
+    uint64_t square[NUMERATOR_WORDS];
+    mul_words(m->sum_squares, FIXEDPOINT_MOMENTS_SQUARE_WORDS, &n, 1, num);
+    mul_words(sum, 3, sum, 3, square);
+    u128 borrow = 0;
+    for (size_t i = 0; i < NUMERATOR_WORDS; ++i)
+    {
+        u128 diff = (u128)num[i] - square[i] - borrow;
+        num[i] = (uint64_t)diff;
+        borrow = (diff >> 64) & 1;
+    }
+
+    // Divide by n and then by the divisor; a nonzero remainder only matters
+    // as a bit below the lowest word, which is enough to round correctly
+    uint64_t rem = div_words(num, NUMERATOR_WORDS, n);
+    rem |= div_words(num, NUMERATOR_WORDS, divisor);
+    if (num[4] != 0 || num[5] != 0)
+    {
+        Fixedpoint wrapped = {num[2], num[1], OVERFLOW_POSITIVE};
+        return wrapped;
+    }
+    Fixedpoint256 wide = {{num[0] | (rem != 0), num[1], num[2], num[3]}, VALID_NONNEGATIVE};
+    return fixedpoint256_to_fixedpoint(wide, mode);
+}
+
+Fixedpoint fixedpoint_moments_variance(const FixedpointMoments *m, FixedpointRound mode)
+{
+    return variance(m, m->count, mode);
+}
+
+Fixedpoint fixedpoint_moments_sample_variance(const FixedpointMoments *m, FixedpointRound mode)
+{
+    return variance(m, m->count ? m->count - 1 : 0, mode);
+}
+
+int fixedpoint_kll_init(FixedpointKll *sketch, size_t k)
+{
+    if (k < MIN_CAPACITY)
+    {
+        return 0;
+    }
+    memset(sketch, 0, sizeof(*sketch));
+    sketch->num_levels = 1;
+    sketch->k = k;
+    sketch->tag = VALID_NONNEGATIVE;
+    return 1;
+}
+
+void fixedpoint_kll_destroy(FixedpointKll *sketch)
+{
+    for (unsigned h = 0; h < FIXEDPOINT_KLL_MAX_LEVELS; ++h)
+    {
+        free(sketch->levels[h]);
+        sketch->levels[h] = NULL;
+    }
+}
+
+// Compute the capacity of each level: k for the top level, and about 2/3
+// of the capacity of the level above for each level below, but at least
+// MIN_CAPACITY, so that the low levels are not compacted for every few
+// values. Returns the total capacity.
+static size_t level_capacities(const FixedpointKll *sketch, size_t *capacities)
+{
+    size_t capacity = sketch->k;
+    size_t total = 0;
+    for (unsigned h = sketch->num_levels; h-- > 0;)
+    {
+        capacities[h] = capacity;
+        total += capacity;
+        capacity = (2 * capacity + 2) / 3;
+        capacity = capacity < MIN_CAPACITY ? MIN_CAPACITY : capacity;
+    }
+    return total;
+}
+
+static size_t retained(const FixedpointKll *sketch)
+{
+    size_t total = 0;
+    for (unsigned h = 0; h < sketch->num_levels; ++h)
+    {
+        total += sketch->sizes[h];
+    }
+    return total;
+}
+
+// Make room for extra more values in level h
+static int reserve(FixedpointKll *sketch, unsigned h, size_t extra)
+{
+    size_t needed = sketch->sizes[h] + extra;
+    if (needed <= sketch->allocs[h])
+    {
+        return 1;
+    }
+    size_t alloc = sketch->allocs[h] ? sketch->allocs[h] : 16;
+    while (alloc < needed)
+    {
+        alloc *= 2;
+    }
+    Fixedpoint *level = realloc(sketch->levels[h], alloc * sizeof(Fixedpoint));
+    if (!level)
+    {
+        return 0;
+    }
+    sketch->levels[h] = level;
+    sketch->allocs[h] = alloc;
+    return 1;
+}
+
+// Whether left < right, for valid values
+static inline int less(Fixedpoint left, Fixedpoint right)
+{
+    u128 a = (u128)left.whole << 64 | left.frac;
+    u128 b = (u128)right.whole << 64 | right.frac;
+    int left_neg = left.tag == VALID_NEGATIVE && a != 0;
+    int right_neg = right.tag == VALID_NEGATIVE && b != 0;
+    if (left_neg != right_neg)
+    {
+        return left_neg;
+    }
+    return left_neg ? b < a : a < b;
+}
+
+static int compare_values(const void *left, const void *right)
+{
+    Fixedpoint a = *(const Fixedpoint *)left;
+    Fixedpoint b = *(const Fixedpoint *)right;
+    return less(a, b) ? -1 : less(b, a);
+}
+
+// Merge the sorted values src into the sorted values dst, which has room
+// for them, from the back
+static void merge_sorted(Fixedpoint *dst, size_t dst_size, const Fixedpoint *src, size_t src_size)
+{
+    size_t i = dst_size;
+    size_t j = src_size;
+    size_t out = dst_size + src_size;
+    while (j > 0)
+    {
+        if (i > 0 && less(src[j - 1], dst[i - 1]))
+        {
+            dst[--out] = dst[--i];
+        }
+        else
+        {
+            dst[--out] = src[--j];
+        }
+    }
+}
+
+// Move every other value of level h up to level h + 1, keeping the
+// smallest value in level h if there is an odd number. Level 0 is sorted
+// first; the levels above it are always sorted, so the values moved up are
+// merged into them.
+static int compact(FixedpointKll *sketch, unsigned h)
+{
+    if (h + 1 == FIXEDPOINT_KLL_MAX_LEVELS)
+    {
+        return 0;
+    }
+    size_t size = sketch->sizes[h];
+    size_t half = size / 2;
+    if (!reserve(sketch, h + 1, half))
+    {
+        return 0;
+    }
+    if (h + 1 == sketch->num_levels)
+    {
+        ++sketch->num_levels;
+    }
+    Fixedpoint *level = sketch->levels[h];
+    if (h == 0)
+    {
+        qsort(level, size, sizeof(Fixedpoint), compare_values);
+    }
+    Fixedpoint kept = level[0];
+    size_t first = (size & 1) + ((sketch->parity >> h) & 1);
+    for (size_t i = 0; i < half; ++i)
+    {
+        level[i] = level[first + 2 * i];
+    }
+    merge_sorted(sketch->levels[h + 1], sketch->sizes[h + 1], level, half);
+    sketch->sizes[h + 1] += half;
+    level[0] = kept;
+    sketch->sizes[h] = size & 1;
+    sketch->parity ^= (uint64_t)1 << h;
+    return 1;
+}
+
+// Compact the lowest full level until the sketch holds no more values than
+// its levels' total capacity
+static int compress(FixedpointKll *sketch)
+{
+    size_t capacities[FIXEDPOINT_KLL_MAX_LEVELS];
+    while (retained(sketch) > level_capacities(sketch, capacities))
+    {
+        unsigned h = 0;
+        while (h + 1 < sketch->num_levels && sketch->sizes[h] < capacities[h])
+        {
+            ++h;
+        }
+        if (!compact(sketch, h))
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int fixedpoint_kll_update(FixedpointKll *sketch, const Fixedpoint *vals, size_t count)
+{
+    size_t capacities[FIXEDPOINT_KLL_MAX_LEVELS];
+    size_t capacity = level_capacities(sketch, capacities);
+    size_t total = retained(sketch);
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (!fixedpoint_is_valid(vals[i]))
+        {
+            if (sketch->tag == VALID_NONNEGATIVE)
+            {
+                sketch->tag = vals[i].tag;
+            }
+            continue;
+        }
+        if (!reserve(sketch, 0, 1))
+        {
+            return 0;
+        }
+        sketch->levels[0][sketch->sizes[0]++] = vals[i];
+        ++sketch->count;
+        if (++total > capacity)
+        {
+            if (!compress(sketch))
+            {
+                return 0;
+            }
+            total = retained(sketch);
+            capacity = level_capacities(sketch, capacities);
+        }
+    }
+    return 1;
+}
+
+int fixedpoint_kll_merge(FixedpointKll *sketch, const FixedpointKll *other)
+{
+    if (sketch->k != other->k)
+    {
+        return 0;
+    }
+    if (sketch->tag == VALID_NONNEGATIVE)
+    {
+        sketch->tag = other->tag;
+    }
+    for (unsigned h = 0; h < other->num_levels; ++h)
+    {
+        if (!reserve(sketch, h, other->sizes[h]))
+        {
+            return 0;
+        }
+        if (h == 0)
+        {
+            memcpy(sketch->levels[0] + sketch->sizes[0], other->levels[0], other->sizes[0] * sizeof(Fixedpoint));
+        }
+        else
+        {
+            merge_sorted(sketch->levels[h], sketch->sizes[h], other->levels[h], other->sizes[h]);
+        }
+        sketch->sizes[h] += other->sizes[h];
+    }
+    if (other->num_levels > sketch->num_levels)
+    {
+        sketch->num_levels = other->num_levels;
+    }
+    sketch->count += other->count;
+    return compress(sketch);
+}
+
+uint64_t fixedpoint_kll_count(const FixedpointKll *sketch)
+{
+    return sketch->count;
+}
+
+static int compare_weighted(const void *left, const void *right)
+{
+    return compare_values(&((const Weighted *)left)->value, &((const Weighted *)right)->value);
+}
+
+Fixedpoint fixedpoint_kll_quantile(const FixedpointKll *sketch, Fixedpoint fraction)
+{
+    if (sketch->tag != VALID_NONNEGATIVE)
+    {
+        return tagged_value(sketch->tag);
+    }
+    if (sketch->count == 0 || fraction.tag != VALID_NONNEGATIVE || fraction.whole > 1 ||
+        (fraction.whole == 1 && fraction.frac != 0))
+    {
+        return tagged_value(ERROR);
+    }
+
+    size_t total = retained(sketch);
+    Weighted *items = malloc(total * sizeof(Weighted));
+    if (!items)
+    {
+        return tagged_value(ERROR);
+    }
+    size_t n = 0;
+    for (unsigned h = 0; h < sketch->num_levels; ++h)
+    {
+        for (size_t i = 0; i < sketch->sizes[h]; ++i)
+        {
+            items[n].value = sketch->levels[h][i];
+            items[n].weight = (uint64_t)1 << h;
+            ++n;
+        }
+    }
+    qsort(items, total, sizeof(Weighted), compare_weighted);
+
+    // The rank to reach is fraction * count, rounded up, and at least 1
+    u128 scaled = (u128)fraction.frac * sketch->count;
+    u128 target = fraction.whole ? sketch->count : (scaled >> 64) + ((uint64_t)scaled != 0);
+    target = target ? target : 1;
+    u128 rank = 0;
+    size_t i = 0;
+    while (i + 1 < total && (rank += items[i].weight) < target)
+    {
+        ++i;
+    }
+    Fixedpoint result = items[i].value;
+    free(items);
+    return result;
+}
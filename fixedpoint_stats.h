@@ -0,0 +1,201 @@
+#ifndef FIXEDPOINT_STATS_H
+#define FIXEDPOINT_STATS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "fixedpoint.h"
+#include "fixedpoint_accum.h"
+
+// Single pass statistics over Fixedpoint values whose partial results, such
+// as those of different threads, can be merged.
+//
+// Means and variances are computed from exact sums of the values and of
+// their squares, so they do not depend on the order in which values are
+// added or partials merged, and each is rounded once.
+//
+// Quantiles are estimated with a KLL sketch: the values are kept in levels,
+// where a value in level h stands for 2^h of the original values. When the
+// sketch is full, a level is sorted and every other value is moved up a
+// level, so the sketch holds O(k log(n / k)) values, and the rank of an
+// estimated quantile is typically within a few multiples of n / k of the
+// exact one. The values moved up alternate between the odd and the even
+// positions of each level, instead of being chosen at random, so a sketch
+// built from the same values with the same updates and merges always gives
+// the same estimates.
+
+// The number of 64 bit words of a sum of squares
+#define FIXEDPOINT_MOMENTS_SQUARE_WORDS 5
+
+// The largest number of levels of a KLL sketch
+#define FIXEDPOINT_KLL_MAX_LEVELS 64
+
+// A struct that holds the moments of a set of values
+//
+// Fields:
+//  count - the number of valid values
+//  sum - the exact sum of the values (its tag records the first value that
+//        was not valid)
+//  sum_squares - the exact sum of the squares of the values, in units of
+//                2^-128, least significant word first
+typedef struct
+{
+    uint64_t count;
+    FixedpointAccum sum;
+    uint64_t sum_squares[FIXEDPOINT_MOMENTS_SQUARE_WORDS];
+} FixedpointMoments;
+
+// A struct that holds a KLL quantile sketch
+//
+// Fields:
+//  levels - the values of each level; level h holds values of weight 2^h,
+//           sorted for every level but level 0
+//  sizes - the number of values in each level
+//  allocs - the number of values allocated for each level
+//  num_levels - the number of levels in use
+//  k - the accuracy parameter: the capacity of the top level
+//  count - the number of valid values added
+//  parity - bit h is the position (0 for even, 1 for odd) of the values
+//           the next compaction of level h moves up
+//  tag - VALID_NONNEGATIVE while every value added was valid; otherwise the
+//        tag of the first value that was not
+typedef struct
+{
+    Fixedpoint *levels[FIXEDPOINT_KLL_MAX_LEVELS];
+    size_t sizes[FIXEDPOINT_KLL_MAX_LEVELS];
+    size_t allocs[FIXEDPOINT_KLL_MAX_LEVELS];
+    unsigned num_levels;
+    size_t k;
+    uint64_t count;
+    uint64_t parity;
+    Tag tag;
+} FixedpointKll;
+
+// Initialize the moments of an empty set of values.
+//
+// Parameters:
+//   m - pointer to the moments
+void fixedpoint_moments_init(FixedpointMoments *m);
+
+// Add values to a set of moments. A value that is not valid is not counted,
+// but is remembered in the tag of the sum (if it is the first).
+//
+// Parameters:
+//   m - pointer to the moments
+//   vals - the values
+//   count - the number of values
+void fixedpoint_moments_update(FixedpointMoments *m, const Fixedpoint *vals, size_t count);
+
+// Add the values of one set of moments to another.
+//
+// Parameters:
+//   m - pointer to the moments to add to
+//   other - pointer to the moments to add
+void fixedpoint_moments_merge(FixedpointMoments *m, const FixedpointMoments *other);
+
+// Get the mean of a set of values.
+//
+// Parameters:
+//   m - pointer to the moments
+//   mode - how to round the mean to a multiple of 2^-64
+//
+// Returns:
+//   the mean, as fixedpoint_accum_div returns it;
+//   an error value if there are no values
+Fixedpoint fixedpoint_moments_mean(const FixedpointMoments *m, FixedpointRound mode);
+
+// Get the population variance of a set of values: the mean of the squared
+// differences from the mean.
+//
+// Parameters:
+//   m - pointer to the moments
+//   mode - how to round the variance to a multiple of 2^-64
+//
+// Returns:
+//   the variance rounded according to mode (see fixedpoint256_to_fixedpoint
+//   for the tags of results that are inexact with FIXEDPOINT_ROUND_EXACT or
+//   that overflow);
+//   if a value was not valid, a value with that value's tag;
+//   an error value if there are no values
+Fixedpoint fixedpoint_moments_variance(const FixedpointMoments *m, FixedpointRound mode);
+
+// Get the sample variance of a set of values: the sum of the squared
+// differences from the mean, divided by one less than the number of values.
+//
+// Parameters:
+//   m - pointer to the moments
+//   mode - how to round the variance to a multiple of 2^-64
+//
+// Returns:
+//   the variance, as for fixedpoint_moments_variance;
+//   an error value if there are fewer than 2 values
+Fixedpoint fixedpoint_moments_sample_variance(const FixedpointMoments *m, FixedpointRound mode);
+
+// Initialize an empty KLL sketch.
+//
+// Parameters:
+//   sketch - pointer to the sketch
+//   k - the accuracy parameter, at least 8 (200 gives estimates typically
+//       within about 1% of the count in rank)
+//
+// Returns:
+//   1 if successful;
+//   0 if k is less than 8
+int fixedpoint_kll_init(FixedpointKll *sketch, size_t k);
+
+// Free the memory owned by a KLL sketch.
+//
+// Parameters:
+//   sketch - pointer to the sketch
+void fixedpoint_kll_destroy(FixedpointKll *sketch);
+
+// Add values to a KLL sketch. A value that is not valid is not added, but
+// is remembered in the sketch's tag (if it is the first).
+//
+// Parameters:
+//   sketch - pointer to the sketch
+//   vals - the values
+//   count - the number of values
+//
+// Returns:
+//   1 if successful;
+//   0 if memory could not be allocated (the sketch is left with only some
+//   of the values)
+int fixedpoint_kll_update(FixedpointKll *sketch, const Fixedpoint *vals, size_t count);
+
+// Add the values of one KLL sketch to another.
+//
+// Parameters:
+//   sketch - pointer to the sketch to add to
+//   other - pointer to the sketch to add, with the same k
+//
+// Returns:
+//   1 if successful;
+//   0 if the sketches have different values of k, or memory could not be
+//   allocated (the sketch is left with only some of the values)
+int fixedpoint_kll_merge(FixedpointKll *sketch, const FixedpointKll *other);
+
+// Get the number of values added to a KLL sketch.
+//
+// Parameters:
+//   sketch - pointer to the sketch
+//
+// Returns:
+//   the number of valid values added, including those of merged sketches
+uint64_t fixedpoint_kll_count(const FixedpointKll *sketch);
+
+// Estimate a quantile of the values added to a KLL sketch: the smallest
+// value whose estimated rank is at least fraction times the count.
+//
+// Parameters:
+//   sketch - pointer to the sketch
+//   fraction - the quantile, from 0 (about the minimum) to 1 (about the
+//              maximum)
+//
+// Returns:
+//   the estimated quantile, one of the values added;
+//   if a value added was not valid, a value with that value's tag;
+//   an error value if the sketch is empty, fraction is not between 0 and 1,
+//   or memory could not be allocated
+Fixedpoint fixedpoint_kll_quantile(const FixedpointKll *sketch, Fixedpoint fraction);
+
+#endif // FIXEDPOINT_STATS_H
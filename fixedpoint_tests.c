@@ -1,6 +1,32 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
 #include "fixedpoint.h"
+#include "fixedpoint_hash.h"
+#include "fixedpoint_groupby.h"
+#include "fixedpoint_atomic.h"
+#include "fixedpoint_flags.h"
+#include "fixedpoint_float.h"
+#include "fixedpoint_quantize.h"
+#include "fixedpoint_q.h"
+#include "fixedpoint_column.h"
+#include "fixedpoint256.h"
+#include "fixedpoint_decimal.h"
+#include "fixedpoint_math.h"
+#include "fixedpoint_curve.h"
+#include "fixedpoint_poly.h"
+#include "fixedpoint_matrix.h"
+#include "fixedpoint_fft.h"
+#include "fixedpoint_filter.h"
+#include "fixedpoint_window.h"
+#include "fixedpoint_stats.h"
+#include "fixedpoint_scan.h"
+#include "fixedpoint_pool.h"
+#include "fixedpoint_numa.h"
+#include "fixedpoint_expr.h"
 #include "tctest.h"
 
 // Test fixture object, has some useful values for testing
@@ -62,6 +88,42 @@ void test_fixedpoint_is_underflow_neg(TestObjs *objs);
 void test_fixedpoint_is_underflow_pos(TestObjs *objs);
 void test_fixedpoint_is_valid(TestObjs *objs);
 void test_fixedpoint_format_as_hex(TestObjs *objs);
+void test_fixedpoint_hash(TestObjs *objs);
+void test_fixedpoint_map(TestObjs *objs);
+void test_fixedpoint_accum(TestObjs *objs);
+void test_fixedpoint_groupby(TestObjs *objs);
+void test_fixedpoint_atomic(TestObjs *objs);
+void test_fixedpoint_sticky_flags(TestObjs *objs);
+void test_fixedpoint_saturating(TestObjs *objs);
+void test_fixedpoint_shifts(TestObjs *objs);
+void test_fixedpoint_float_conversions(TestObjs *objs);
+void test_fixedpoint_quantize(TestObjs *objs);
+void test_fixedpoint_qformat(TestObjs *objs);
+void test_fixedpoint_column(TestObjs *objs);
+void test_fixedpoint_mul(TestObjs *objs);
+void test_fixedpoint256(TestObjs *objs);
+void test_fixedpoint_decimal(TestObjs *objs);
+void test_fixedpoint_sqrt(TestObjs *objs);
+void test_fixedpoint_exp_log(TestObjs *objs);
+void test_fixedpoint_trig(TestObjs *objs);
+void test_fixedpoint_curve(TestObjs *objs);
+void test_fixedpoint_poly(TestObjs *objs);
+void test_fixedpoint_matrix(TestObjs *objs);
+void test_fixedpoint_fft(TestObjs *objs);
+void test_fixedpoint_convolve(TestObjs *objs);
+void test_fixedpoint_fir(TestObjs *objs);
+void test_fixedpoint_biquad(TestObjs *objs);
+void test_fixedpoint_rolling(TestObjs *objs);
+void test_fixedpoint_ema(TestObjs *objs);
+void test_fixedpoint_bars(TestObjs *objs);
+void test_fixedpoint_moments(TestObjs *objs);
+void test_fixedpoint_kll(TestObjs *objs);
+void test_fixedpoint_scan(TestObjs *objs);
+void test_fixedpoint_pool_for(TestObjs *objs);
+void test_fixedpoint_pool_ops(TestObjs *objs);
+void test_fixedpoint_numa(TestObjs *objs);
+void test_fixedpoint_expr_eval(TestObjs *objs);
+void test_fixedpoint_expr_compile(TestObjs *objs);
 
 int main(int argc, char **argv)
 {
@@ -111,6 +173,42 @@ int main(int argc, char **argv)
     TEST(test_fixedpoint_is_underflow_pos);
     TEST(test_fixedpoint_is_valid);
     TEST(test_fixedpoint_format_as_hex);
+    TEST(test_fixedpoint_hash);
+    TEST(test_fixedpoint_map);
+    TEST(test_fixedpoint_accum);
+    TEST(test_fixedpoint_groupby);
+    TEST(test_fixedpoint_atomic);
+    TEST(test_fixedpoint_sticky_flags);
+    TEST(test_fixedpoint_saturating);
+    TEST(test_fixedpoint_shifts);
+    TEST(test_fixedpoint_float_conversions);
+    TEST(test_fixedpoint_quantize);
+    TEST(test_fixedpoint_qformat);
+    TEST(test_fixedpoint_column);
+    TEST(test_fixedpoint_mul);
+    TEST(test_fixedpoint256);
+    TEST(test_fixedpoint_decimal);
+    TEST(test_fixedpoint_sqrt);
+    TEST(test_fixedpoint_exp_log);
+    TEST(test_fixedpoint_trig);
+    TEST(test_fixedpoint_curve);
+    TEST(test_fixedpoint_poly);
+    TEST(test_fixedpoint_matrix);
+    TEST(test_fixedpoint_fft);
+    TEST(test_fixedpoint_convolve);
+    TEST(test_fixedpoint_fir);
+    TEST(test_fixedpoint_biquad);
+    TEST(test_fixedpoint_rolling);
+    TEST(test_fixedpoint_ema);
+    TEST(test_fixedpoint_bars);
+    TEST(test_fixedpoint_moments);
+    TEST(test_fixedpoint_kll);
+    TEST(test_fixedpoint_scan);
+    TEST(test_fixedpoint_pool_for);
+    TEST(test_fixedpoint_pool_ops);
+    TEST(test_fixedpoint_numa);
+    TEST(test_fixedpoint_expr_eval);
+    TEST(test_fixedpoint_expr_compile);
 
     TEST_FINI();
 }
@@ -1029,4 +1127,2821 @@ void test_fixedpoint_format_as_hex(TestObjs *objs)
     char *test6 = fixedpoint_format_as_hex(fixedpoint_create_from_hex("-aff74682477b5c8.d4"));
     ASSERT(strcmp(test6, "-aff74682477b5c8.d4") == 0);
     free(test6);
-}
\ No newline at end of file
+}
+
+void test_fixedpoint_hash(TestObjs *objs)
+{
+    // 0 and -0 are the same key
+    Fixedpoint neg_zero = fixedpoint_create_from_hex("0");
+    neg_zero.tag = VALID_NEGATIVE;
+    ASSERT(fixedpoint_hash(objs->zero) == fixedpoint_hash(neg_zero));
+    ASSERT(fixedpoint_hash_equal(objs->zero, neg_zero));
+
+    // Equal values hash the same, different values differ
+    ASSERT(fixedpoint_hash(objs->large1) == fixedpoint_hash(fixedpoint_create2(0x4b19efceaUL, 0xec9a1e2418UL)));
+    ASSERT(fixedpoint_hash(objs->one) != fixedpoint_hash(fixedpoint_negate(objs->one)));
+    ASSERT(!fixedpoint_hash_equal(objs->one, fixedpoint_negate(objs->one)));
+    ASSERT(fixedpoint_hash(objs->one) != fixedpoint_hash(objs->one_half));
+
+    // All error values are one key, distinct from valid values
+    Fixedpoint other_error = fixedpoint_create_from_hex("xyz");
+    other_error.whole = 42;
+    ASSERT(fixedpoint_hash(objs->format_error) == fixedpoint_hash(other_error));
+    ASSERT(fixedpoint_hash_equal(objs->format_error, other_error));
+    ASSERT(!fixedpoint_hash_equal(objs->format_error, objs->zero));
+
+    // Overflow values are distinguished by their tag
+    ASSERT(!fixedpoint_hash_equal(objs->overflow_positive, objs->overflow_negative));
+}
+
+void test_fixedpoint_map(TestObjs *objs)
+{
+    FixedpointMap map;
+    // A capacity too large to allocate fails instead of looping
+    ASSERT(!fixedpoint_map_init(&map, SIZE_MAX));
+    ASSERT(fixedpoint_map_init(&map, 0));
+
+    ASSERT(fixedpoint_map_put(&map, objs->one, 1) == 1);
+    ASSERT(fixedpoint_map_put(&map, objs->one_half, 2) == 1);
+    ASSERT(fixedpoint_map_put(&map, objs->one, 3) == 0);
+    ASSERT(map.size == 2);
+    ASSERT(*fixedpoint_map_get(&map, objs->one) == 3);
+    ASSERT(fixedpoint_map_get(&map, objs->max) == NULL);
+
+    // -0 finds the entry for 0
+    ASSERT(fixedpoint_map_put(&map, objs->zero, 7) == 1);
+    Fixedpoint neg_zero = objs->zero;
+    neg_zero.tag = VALID_NEGATIVE;
+    ASSERT(*fixedpoint_map_get(&map, neg_zero) == 7);
+
+    // Grow well past the initial capacity, then remove every other key
+    for (uint64_t i = 0; i < 1000; ++i)
+    {
+        *fixedpoint_map_get_or_insert(&map, fixedpoint_create2(i, i << 32), 0) += i;
+    }
+    ASSERT(map.size == 1002);
+    for (uint64_t i = 0; i < 1000; i += 2)
+    {
+        ASSERT(fixedpoint_map_remove(&map, fixedpoint_create2(i, i << 32)));
+    }
+    ASSERT(!fixedpoint_map_remove(&map, fixedpoint_create2(0, 0)));
+    ASSERT(map.size == 502);
+    for (uint64_t i = 0; i < 1000; ++i)
+    {
+        uint64_t *value = fixedpoint_map_get(&map, fixedpoint_create2(i, i << 32));
+        ASSERT((i % 2 == 0) ? value == NULL : (value != NULL && *value == i));
+    }
+
+    // Iteration visits every entry once
+    size_t pos = 0;
+    size_t count = 0;
+    while (fixedpoint_map_next(&map, &pos, NULL, NULL))
+    {
+        count++;
+    }
+    ASSERT(count == 502);
+    fixedpoint_map_destroy(&map);
+
+    // A destroyed map is empty, and grows again on insertion
+    ASSERT(fixedpoint_map_get(&map, objs->one) == NULL);
+    ASSERT(!fixedpoint_map_remove(&map, objs->one));
+    fixedpoint_map_clear(&map);
+    pos = 0;
+    ASSERT(!fixedpoint_map_next(&map, &pos, NULL, NULL));
+    ASSERT(fixedpoint_map_put(&map, objs->one, 5) == 1);
+    ASSERT(*fixedpoint_map_get(&map, objs->one) == 5);
+    fixedpoint_map_destroy(&map);
+
+    FixedpointSet set;
+    ASSERT(fixedpoint_set_init(&set, 4));
+    ASSERT(fixedpoint_set_add(&set, objs->random1) == 1);
+    ASSERT(fixedpoint_set_add(&set, objs->random1) == 0);
+    ASSERT(fixedpoint_set_contains(&set, objs->random1));
+    ASSERT(!fixedpoint_set_contains(&set, objs->random2));
+    ASSERT(fixedpoint_set_remove(&set, objs->random1));
+    ASSERT(fixedpoint_set_size(&set) == 0);
+    fixedpoint_set_destroy(&set);
+}
+
+// A small deterministic pseudo-random generator (xorshift64) for tests
+// that compare a fast path against a scalar loop over many values
+static uint64_t test_rand(uint64_t *state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+void test_fixedpoint_accum(TestObjs *objs)
+{
+    FixedpointAccum acc;
+
+    // Matches fixedpoint_add when nothing overflows
+    fixedpoint_accum_init(&acc);
+    fixedpoint_accum_add(&acc, objs->random2);
+    fixedpoint_accum_add(&acc, fixedpoint_negate(objs->random3));
+    fixedpoint_accum_add(&acc, objs->one_half);
+    Fixedpoint sum = fixedpoint_accum_result(&acc);
+    Fixedpoint expected = fixedpoint_add(fixedpoint_add(objs->random2, fixedpoint_negate(objs->random3)), objs->one_half);
+    ASSERT(fixedpoint_compare(sum, expected) == 0);
+
+    // Intermediate overflow does not matter if the final sum is in range
+    fixedpoint_accum_init(&acc);
+    fixedpoint_accum_add(&acc, objs->max);
+    fixedpoint_accum_add(&acc, objs->max);
+    fixedpoint_accum_sub(&acc, objs->max);
+    sum = fixedpoint_accum_result(&acc);
+    ASSERT(sum.tag == VALID_NONNEGATIVE);
+    ASSERT(sum.whole == objs->max.whole && sum.frac == objs->max.frac);
+
+    // Final overflow is tagged like fixedpoint_add
+    fixedpoint_accum_add(&acc, objs->max);
+    sum = fixedpoint_accum_result(&acc);
+    ASSERT(sum.tag == OVERFLOW_POSITIVE);
+    ASSERT(sum.whole == objs->overflow_positive.whole && sum.frac == objs->overflow_positive.frac);
+    fixedpoint_accum_init(&acc);
+    fixedpoint_accum_sub(&acc, objs->max);
+    fixedpoint_accum_sub(&acc, objs->one);
+    ASSERT(fixedpoint_is_overflow_neg(fixedpoint_accum_result(&acc)));
+
+    // Negative sums and exact zero
+    fixedpoint_accum_init(&acc);
+    fixedpoint_accum_sub(&acc, objs->one_fourth);
+    sum = fixedpoint_accum_result(&acc);
+    ASSERT(sum.tag == VALID_NEGATIVE && sum.whole == 0 && sum.frac == 0x4000000000000000UL);
+    fixedpoint_accum_add(&acc, objs->one_fourth);
+    ASSERT(fixedpoint_is_zero(fixedpoint_accum_result(&acc)));
+
+    // Non-valid values poison the sum
+    fixedpoint_accum_add(&acc, objs->format_error);
+    fixedpoint_accum_add(&acc, objs->overflow_positive);
+    ASSERT(fixedpoint_is_err(fixedpoint_accum_result(&acc)));
+    ASSERT(fixedpoint_accum_result(&acc).tag == ERROR);
+}
+
+void test_fixedpoint_groupby(TestObjs *objs)
+{
+    (void)objs;
+
+    enum { NUM_ROWS = 20000, NUM_KEYS = 37 };
+    int64_t *keys = malloc(NUM_ROWS * sizeof(int64_t));
+    Fixedpoint *values = malloc(NUM_ROWS * sizeof(Fixedpoint));
+    uint64_t state = 0x2545f4914f6cdd1dUL;
+    for (size_t i = 0; i < NUM_ROWS; ++i)
+    {
+        keys[i] = (int64_t)(test_rand(&state) % NUM_KEYS) - 10;
+        values[i] = fixedpoint_create2(test_rand(&state) >> 24, test_rand(&state));
+        if (test_rand(&state) & 1)
+        {
+            values[i] = fixedpoint_negate(values[i]);
+        }
+    }
+
+    // Scalar reference: a loop of fixedpoint_add and fixedpoint_compare per key
+    Fixedpoint ref_sum[NUM_KEYS], ref_min[NUM_KEYS], ref_max[NUM_KEYS];
+    uint64_t ref_count[NUM_KEYS] = {0};
+    for (size_t i = 0; i < NUM_ROWS; ++i)
+    {
+        size_t k = (size_t)(keys[i] + 10);
+        if (ref_count[k]++ == 0)
+        {
+            ref_sum[k] = ref_min[k] = ref_max[k] = values[i];
+            continue;
+        }
+        ref_sum[k] = fixedpoint_add(ref_sum[k], values[i]);
+        if (fixedpoint_compare(values[i], ref_min[k]) < 0)
+        {
+            ref_min[k] = values[i];
+        }
+        if (fixedpoint_compare(values[i], ref_max[k]) > 0)
+        {
+            ref_max[k] = values[i];
+        }
+    }
+
+    FixedpointGroupBy serial, parallel;
+    // A capacity too large to allocate fails instead of looping
+    ASSERT(!fixedpoint_groupby_init(&serial, SIZE_MAX));
+    ASSERT(fixedpoint_groupby_init(&serial, 0));
+    ASSERT(fixedpoint_groupby_init(&parallel, 0));
+    ASSERT(fixedpoint_groupby_update(&serial, keys, values, NUM_ROWS / 2));
+    ASSERT(fixedpoint_groupby_update(&serial, keys + NUM_ROWS / 2, values + NUM_ROWS / 2, NUM_ROWS - NUM_ROWS / 2));
+    ASSERT(fixedpoint_groupby_update_parallel(&parallel, keys, values, NUM_ROWS, 4));
+    ASSERT(fixedpoint_groupby_size(&serial) == NUM_KEYS);
+    ASSERT(fixedpoint_groupby_size(&parallel) == NUM_KEYS);
+
+    FixedpointGroup serial_groups[NUM_KEYS], parallel_groups[NUM_KEYS];
+    fixedpoint_groupby_results(&serial, serial_groups);
+    fixedpoint_groupby_results(&parallel, parallel_groups);
+    for (size_t k = 0; k < NUM_KEYS; ++k)
+    {
+        FixedpointGroup *groups[2] = {&serial_groups[k], &parallel_groups[k]};
+        for (int j = 0; j < 2; ++j)
+        {
+            ASSERT(groups[j]->key == (int64_t)k - 10);
+            ASSERT(groups[j]->count == ref_count[k]);
+            ASSERT(groups[j]->sum.tag == ref_sum[k].tag);
+            ASSERT(fixedpoint_compare(groups[j]->sum, ref_sum[k]) == 0);
+            ASSERT(fixedpoint_compare(groups[j]->min, ref_min[k]) == 0);
+            ASSERT(fixedpoint_compare(groups[j]->max, ref_max[k]) == 0);
+        }
+    }
+
+    fixedpoint_groupby_destroy(&serial);
+    fixedpoint_groupby_destroy(&parallel);
+    free(keys);
+    free(values);
+}
+
+// Arguments of the threads in test_fixedpoint_atomic
+typedef struct
+{
+    FixedpointAtomic *shared;
+    FixedpointAtomicStriped *striped;
+    const Fixedpoint *values;
+    size_t n;
+} AtomicTestArgs;
+
+static void *atomic_test_thread(void *arg)
+{
+    AtomicTestArgs *args = arg;
+    for (size_t i = 0; i < args->n; ++i)
+    {
+        fixedpoint_atomic_add(args->shared, args->values[i]);
+        fixedpoint_atomic_striped_add(args->striped, args->values[i]);
+    }
+    return NULL;
+}
+
+// Make the accumulator's sum cross zero many times
+static void *atomic_zero_crossing_thread(void *arg)
+{
+    FixedpointAtomic *acc = arg;
+    Fixedpoint one = fixedpoint_create(1UL);
+    for (size_t i = 0; i < 200000; ++i)
+    {
+        fixedpoint_atomic_sub(acc, one);
+        fixedpoint_atomic_add(acc, one);
+    }
+    return NULL;
+}
+
+void test_fixedpoint_atomic(TestObjs *objs)
+{
+    FixedpointAtomic acc;
+
+    // The sum may leave the range of a Fixedpoint and come back
+    fixedpoint_atomic_init(&acc);
+    fixedpoint_atomic_add(&acc, objs->max);
+    fixedpoint_atomic_add(&acc, objs->max);
+    ASSERT(fixedpoint_is_overflow_pos(fixedpoint_atomic_load(&acc)));
+    fixedpoint_atomic_sub(&acc, objs->max);
+    Fixedpoint sum = fixedpoint_atomic_load(&acc);
+    ASSERT(sum.tag == VALID_NONNEGATIVE && sum.whole == objs->max.whole && sum.frac == objs->max.frac);
+    fixedpoint_atomic_sub(&acc, objs->max);
+    fixedpoint_atomic_sub(&acc, objs->one_half);
+    sum = fixedpoint_atomic_load(&acc);
+    ASSERT(sum.tag == VALID_NEGATIVE && sum.whole == 0 && sum.frac == 0x8000000000000000UL);
+    fixedpoint_atomic_sub(&acc, objs->max);
+    ASSERT(fixedpoint_is_overflow_neg(fixedpoint_atomic_load(&acc)));
+
+    // Non-valid values are remembered
+    fixedpoint_atomic_init(&acc);
+    fixedpoint_atomic_add(&acc, objs->underflow_negative);
+    fixedpoint_atomic_add(&acc, objs->format_error);
+    ASSERT(fixedpoint_is_underflow_neg(fixedpoint_atomic_load(&acc)));
+
+    // Crossing zero does not change the carry word, so a concurrent load
+    // always sees -1 or 0
+    fixedpoint_atomic_init(&acc);
+    fixedpoint_atomic_sub(&acc, objs->one);
+    ASSERT(acc.carry == 0);
+    fixedpoint_atomic_add(&acc, objs->one);
+    ASSERT(acc.carry == 0);
+    pthread_t crossing;
+    ASSERT(pthread_create(&crossing, NULL, atomic_zero_crossing_thread, &acc) == 0);
+    for (size_t i = 0; i < 20000; ++i)
+    {
+        sum = fixedpoint_atomic_load(&acc);
+        ASSERT(fixedpoint_is_valid(sum) && sum.whole <= 1 && sum.frac == 0);
+    }
+    pthread_join(crossing, NULL);
+    ASSERT(fixedpoint_is_zero(fixedpoint_atomic_load(&acc)));
+
+    // Concurrent updates from several threads give the exact sum
+    enum { NUM_THREADS = 4, PER_THREAD = 20000 };
+    Fixedpoint *values = malloc(NUM_THREADS * PER_THREAD * sizeof(Fixedpoint));
+    FixedpointAccum expected;
+    fixedpoint_accum_init(&expected);
+    uint64_t state = 0x9e3779b97f4a7c15UL;
+    for (size_t i = 0; i < NUM_THREADS * PER_THREAD; ++i)
+    {
+        values[i] = fixedpoint_create2(test_rand(&state) >> 1, test_rand(&state));
+        if (i % 3 != 0)
+        {
+            values[i] = fixedpoint_negate(values[i]);
+        }
+        fixedpoint_accum_add(&expected, values[i]);
+    }
+
+    FixedpointAtomicStriped striped;
+    ASSERT(fixedpoint_atomic_striped_init(&striped, NUM_THREADS));
+    fixedpoint_atomic_init(&acc);
+    pthread_t threads[NUM_THREADS];
+    AtomicTestArgs args[NUM_THREADS];
+    for (size_t t = 0; t < NUM_THREADS; ++t)
+    {
+        args[t].shared = &acc;
+        args[t].striped = &striped;
+        args[t].values = values + t * PER_THREAD;
+        args[t].n = PER_THREAD;
+        ASSERT(pthread_create(&threads[t], NULL, atomic_test_thread, &args[t]) == 0);
+    }
+    for (size_t t = 0; t < NUM_THREADS; ++t)
+    {
+        pthread_join(threads[t], NULL);
+    }
+
+    Fixedpoint want = fixedpoint_accum_result(&expected);
+    Fixedpoint got = fixedpoint_atomic_load(&acc);
+    Fixedpoint got_striped = fixedpoint_atomic_striped_load(&striped);
+    ASSERT(got.tag == want.tag && got.whole == want.whole && got.frac == want.frac);
+    ASSERT(got_striped.tag == want.tag && got_striped.whole == want.whole && got_striped.frac == want.frac);
+
+    fixedpoint_atomic_striped_destroy(&striped);
+    free(values);
+}
+
+// Retag a value with its sign, as sticky-flag mode treats arguments and
+// results, collecting the flag of its tag
+static Fixedpoint sticky_reference(Fixedpoint val, unsigned *flags)
+{
+    *flags |= fixedpoint_flag_of(val.tag);
+    int negative = val.tag == VALID_NEGATIVE || val.tag == OVERFLOW_NEGATIVE || val.tag == UNDERFLOW_NEGATIVE;
+    val.tag = negative && (val.whole | val.frac) != 0 ? VALID_NEGATIVE : VALID_NONNEGATIVE;
+    return val;
+}
+
+void test_fixedpoint_sticky_flags(TestObjs *objs)
+{
+    fixedpoint_flags_clear(FIXEDPOINT_FLAGS_ALL);
+    ASSERT(fixedpoint_flags_get() == 0);
+
+    // Valid results raise nothing and match the regular operations
+    Fixedpoint sum = fixedpoint_sf_add(objs->large1, fixedpoint_negate(objs->large2));
+    Fixedpoint expected = fixedpoint_add(objs->large1, fixedpoint_negate(objs->large2));
+    ASSERT(sum.tag == expected.tag && sum.whole == expected.whole && sum.frac == expected.frac);
+    ASSERT(!fixedpoint_flags_test(FIXEDPOINT_FLAGS_ALL));
+
+    // Overflow keeps the wrapped value, tagged with its sign
+    Fixedpoint wrapped = fixedpoint_sf_add(objs->max, objs->one);
+    ASSERT(wrapped.tag == VALID_NONNEGATIVE);
+    ASSERT(wrapped.whole == fixedpoint_add(objs->max, objs->one).whole);
+    ASSERT(fixedpoint_flags_get() == FIXEDPOINT_FLAG_OVERFLOW_POSITIVE);
+
+    // Flags are sticky and accumulate
+    Fixedpoint halved = fixedpoint_sf_halve(fixedpoint_create_from_hex("-0.0000000000000001"));
+    ASSERT(halved.tag == VALID_NONNEGATIVE && fixedpoint_is_zero(halved));
+    ASSERT(fixedpoint_flags_get() == (FIXEDPOINT_FLAG_OVERFLOW_POSITIVE | FIXEDPOINT_FLAG_UNDERFLOW_NEGATIVE));
+    fixedpoint_sf_double(objs->one);
+    ASSERT(fixedpoint_flags_test(FIXEDPOINT_FLAG_UNDERFLOW));
+    fixedpoint_flags_clear(FIXEDPOINT_FLAG_UNDERFLOW);
+    ASSERT(fixedpoint_flags_get() == FIXEDPOINT_FLAG_OVERFLOW_POSITIVE);
+    fixedpoint_flags_clear(FIXEDPOINT_FLAGS_ALL);
+
+    // Parse errors and tagged arguments raise their flags
+    Fixedpoint err = fixedpoint_sf_create_from_hex("1.2.3");
+    ASSERT(fixedpoint_is_valid(err) && fixedpoint_is_zero(err));
+    ASSERT(fixedpoint_flags_get() == FIXEDPOINT_FLAG_ERROR);
+    fixedpoint_sf_negate(objs->overflow_negative);
+    ASSERT(fixedpoint_flags_test(FIXEDPOINT_FLAG_OVERFLOW_NEGATIVE));
+    fixedpoint_flags_clear(FIXEDPOINT_FLAGS_ALL);
+
+    // The flag of each tag is the flag for the same event
+    ASSERT(fixedpoint_flag_of(VALID_NEGATIVE) == 0);
+    ASSERT(fixedpoint_flag_of(OVERFLOW_NEGATIVE) == FIXEDPOINT_FLAG_OVERFLOW_NEGATIVE);
+
+    // Batch: one flag update for the whole batch
+    Fixedpoint left[3] = {objs->one, fixedpoint_negate(objs->max), objs->one_fourth};
+    Fixedpoint right[3] = {objs->one_half, fixedpoint_negate(objs->max), objs->one_fourth};
+    Fixedpoint out[3];
+    fixedpoint_sf_add_batch(left, right, out, 3);
+    ASSERT(out[0].whole == 1 && out[0].frac == 0x8000000000000000UL && out[0].tag == VALID_NONNEGATIVE);
+    ASSERT(out[1].tag == VALID_NEGATIVE);
+    ASSERT(out[2].whole == 0 && out[2].frac == 0x8000000000000000UL);
+    ASSERT(fixedpoint_flags_get() == FIXEDPOINT_FLAG_OVERFLOW_NEGATIVE);
+    fixedpoint_flags_clear(FIXEDPOINT_FLAGS_ALL);
+
+    // Each operation gives what the regular operation gives for the
+    // arguments retagged with their signs, for arguments with any tag and
+    // magnitudes near the carries
+    uint64_t state = 29;
+    uint64_t patterns[4] = {0, 1, ~0UL, 0x8000000000000000UL};
+    for (int i = 0; i < 4000; ++i)
+    {
+        Fixedpoint args[2];
+        for (int j = 0; j < 2; ++j)
+        {
+            uint64_t r = test_rand(&state);
+            args[j].whole = r & 1 ? patterns[(r >> 1) & 3] : test_rand(&state);
+            args[j].frac = r & 8 ? patterns[(r >> 4) & 3] : test_rand(&state);
+            args[j].tag = (Tag)((r >> 8) % 7);
+        }
+        unsigned expected_flags = 0;
+        Fixedpoint left = sticky_reference(args[0], &expected_flags);
+        Fixedpoint right = sticky_reference(args[1], &expected_flags);
+        Fixedpoint expected[5] = {fixedpoint_add(left, right), fixedpoint_sub(left, right), fixedpoint_negate(left),
+                                  fixedpoint_halve(left), fixedpoint_double(left)};
+        Fixedpoint results[5];
+        unsigned flags[5];
+        results[0] = fixedpoint_sf_add(args[0], args[1]);
+        flags[0] = fixedpoint_flags_get();
+        fixedpoint_flags_clear(FIXEDPOINT_FLAGS_ALL);
+        results[1] = fixedpoint_sf_sub(args[0], args[1]);
+        flags[1] = fixedpoint_flags_get();
+        fixedpoint_flags_clear(FIXEDPOINT_FLAGS_ALL);
+        results[2] = fixedpoint_sf_negate(args[0]);
+        flags[2] = fixedpoint_flags_get();
+        fixedpoint_flags_clear(FIXEDPOINT_FLAGS_ALL);
+        results[3] = fixedpoint_sf_halve(args[0]);
+        flags[3] = fixedpoint_flags_get();
+        fixedpoint_flags_clear(FIXEDPOINT_FLAGS_ALL);
+        results[4] = fixedpoint_sf_double(args[0]);
+        flags[4] = fixedpoint_flags_get();
+        fixedpoint_flags_clear(FIXEDPOINT_FLAGS_ALL);
+        for (int op = 0; op < 5; ++op)
+        {
+            unsigned op_flags = op < 2 ? expected_flags : fixedpoint_flag_of(args[0].tag);
+            Fixedpoint want = sticky_reference(expected[op], &op_flags);
+            ASSERT(results[op].whole == want.whole && results[op].frac == want.frac && results[op].tag == want.tag);
+            ASSERT(flags[op] == op_flags);
+        }
+    }
+}
+
+void test_fixedpoint_saturating(TestObjs *objs)
+{
+    Fixedpoint neg_max = fixedpoint_negate(objs->max);
+
+    // Clamp on overflow, keeping the sign of the exact result
+    Fixedpoint test1 = fixedpoint_add_sat(objs->max, objs->one);
+    ASSERT(test1.tag == VALID_NONNEGATIVE && test1.whole == objs->max.whole && test1.frac == objs->max.frac);
+    Fixedpoint test2 = fixedpoint_sub_sat(neg_max, objs->one_half);
+    ASSERT(test2.tag == VALID_NEGATIVE && test2.whole == objs->max.whole && test2.frac == objs->max.frac);
+    ASSERT(fixedpoint_compare(fixedpoint_double_sat(objs->random1), objs->max) == 0);
+    ASSERT(fixedpoint_compare(fixedpoint_double_sat(fixedpoint_negate(objs->random1)), neg_max) == 0);
+
+    // Exact results where fixedpoint_add does not overflow
+    Fixedpoint test3 = fixedpoint_sub_sat(objs->one_fourth, objs->one);
+    ASSERT(test3.tag == VALID_NEGATIVE && test3.whole == 0 && test3.frac == 0xc000000000000000UL);
+    Fixedpoint test4 = fixedpoint_add_sat(objs->max, neg_max);
+    ASSERT(test4.tag == VALID_NONNEGATIVE && fixedpoint_is_zero(test4));
+    uint64_t state = 0x1234567UL;
+    for (int i = 0; i < 1000; ++i)
+    {
+        Fixedpoint a = fixedpoint_create2(test_rand(&state), test_rand(&state));
+        Fixedpoint b = fixedpoint_create2(test_rand(&state) >> (i % 64), test_rand(&state));
+        if (i & 1)
+        {
+            a = fixedpoint_negate(a);
+        }
+        if (i & 2)
+        {
+            b = fixedpoint_negate(b);
+        }
+        Fixedpoint exact = fixedpoint_add(a, b);
+        Fixedpoint sat = fixedpoint_add_sat(a, b);
+        if (fixedpoint_is_valid(exact))
+        {
+            ASSERT(sat.tag == exact.tag && sat.whole == exact.whole && sat.frac == exact.frac);
+        }
+        else
+        {
+            ASSERT(sat.whole == objs->max.whole && sat.frac == objs->max.frac);
+            ASSERT(sat.tag == (fixedpoint_is_overflow_neg(exact) ? VALID_NEGATIVE : VALID_NONNEGATIVE));
+        }
+    }
+
+    // Shifts
+    Fixedpoint test5 = fixedpoint_shl_sat(objs->one_fourth, 2);
+    ASSERT(test5.tag == VALID_NONNEGATIVE && test5.whole == 1 && test5.frac == 0);
+    ASSERT(fixedpoint_shl_sat(objs->one_fourth, 65).whole == 0x8000000000000000UL);
+    ASSERT(fixedpoint_shl_sat(objs->one, 63).whole == 0x8000000000000000UL);
+    ASSERT(fixedpoint_compare(fixedpoint_shl_sat(objs->one, 64), objs->max) == 0);
+    ASSERT(fixedpoint_compare(fixedpoint_shl_sat(objs->one, 1000), objs->max) == 0);
+    ASSERT(fixedpoint_is_zero(fixedpoint_shl_sat(objs->zero, 1000)));
+    ASSERT(fixedpoint_compare(fixedpoint_shl_sat(objs->large1, 0), objs->large1) == 0);
+
+    // Errors
+    ASSERT(fixedpoint_is_err(fixedpoint_add_sat(objs->format_error, objs->one)));
+    ASSERT(fixedpoint_is_err(fixedpoint_shl_sat(objs->overflow_positive, 1)));
+
+    // Batch forms match the scalar forms
+    Fixedpoint left[3] = {objs->max, objs->one, neg_max};
+    Fixedpoint right[3] = {objs->max, objs->one_half, objs->one};
+    Fixedpoint out[3];
+    fixedpoint_add_sat_batch(left, right, out, 3);
+    for (int i = 0; i < 3; ++i)
+    {
+        ASSERT(fixedpoint_compare(out[i], fixedpoint_add_sat(left[i], right[i])) == 0);
+    }
+    fixedpoint_sub_sat_batch(left, right, out, 3);
+    for (int i = 0; i < 3; ++i)
+    {
+        ASSERT(fixedpoint_compare(out[i], fixedpoint_sub_sat(left[i], right[i])) == 0);
+    }
+    fixedpoint_double_sat_batch(left, out, 3);
+    fixedpoint_shl_sat_batch(left, 1, left, 3);
+    for (int i = 0; i < 3; ++i)
+    {
+        ASSERT(fixedpoint_compare(out[i], left[i]) == 0);
+    }
+}
+
+void test_fixedpoint_shifts(TestObjs *objs)
+{
+    // Left shifts across the whole/frac boundary
+    Fixedpoint test1 = fixedpoint_shl(fixedpoint_create_from_hex("-0.0000000000000003"), 65);
+    ASSERT(test1.tag == VALID_NEGATIVE && test1.whole == 6 && test1.frac == 0);
+    ASSERT(fixedpoint_is_overflow_pos(fixedpoint_shl(objs->one, 64)));
+    ASSERT(fixedpoint_is_overflow_neg(fixedpoint_shl(fixedpoint_negate(objs->one_half), 65)));
+    ASSERT(fixedpoint_is_overflow_pos(fixedpoint_shl(objs->one_half, 200)));
+    ASSERT(fixedpoint_compare(fixedpoint_shl(objs->large2, 0), objs->large2) == 0);
+
+    // Shifting by k matches k calls to fixedpoint_double
+    Fixedpoint repeated = objs->large1;
+    for (int i = 0; i < 20; ++i)
+    {
+        repeated = fixedpoint_double(repeated);
+    }
+    Fixedpoint shifted = fixedpoint_shl(objs->large1, 20);
+    ASSERT(shifted.tag == repeated.tag && shifted.whole == repeated.whole && shifted.frac == repeated.frac);
+
+    // Right shifts with exact semantics match repeated fixedpoint_halve;
+    // once a bit has been lost, every longer shift underflows too
+    repeated = objs->random1;
+    int lost = 0;
+    for (int i = 0; i < 70; ++i)
+    {
+        repeated = fixedpoint_halve(repeated);
+        shifted = fixedpoint_shr(objs->random1, i + 1, FIXEDPOINT_ROUND_EXACT, NULL);
+        ASSERT(shifted.whole == repeated.whole && shifted.frac == repeated.frac);
+        lost = lost || !fixedpoint_is_valid(repeated);
+        ASSERT(lost ? fixedpoint_is_underflow_pos(shifted) : shifted.tag == VALID_NONNEGATIVE);
+        repeated.tag = VALID_NONNEGATIVE;
+    }
+
+    // Rounding modes: 0x...0.0000000000000003 / 2 = 1.5 ulp, -0x...2.8 etc.
+    Fixedpoint three_ulp = fixedpoint_create_from_hex("0.0000000000000003");
+    Fixedpoint neg_three_ulp = fixedpoint_negate(three_ulp);
+    ASSERT(fixedpoint_shr(three_ulp, 1, FIXEDPOINT_ROUND_TRUNCATE, NULL).frac == 1);
+    ASSERT(fixedpoint_shr(three_ulp, 1, FIXEDPOINT_ROUND_NEAREST_EVEN, NULL).frac == 2);
+    ASSERT(fixedpoint_shr(objs->one, 65, FIXEDPOINT_ROUND_NEAREST_EVEN, NULL).frac == 0);
+    ASSERT(fixedpoint_shr(three_ulp, 2, FIXEDPOINT_ROUND_NEAREST_EVEN, NULL).frac == 1);
+    ASSERT(fixedpoint_shr(three_ulp, 1, FIXEDPOINT_ROUND_CEILING, NULL).frac == 2);
+    Fixedpoint test2 = fixedpoint_shr(neg_three_ulp, 1, FIXEDPOINT_ROUND_CEILING, NULL);
+    ASSERT(test2.tag == VALID_NEGATIVE && test2.frac == 1);
+    Fixedpoint test3 = fixedpoint_shr(neg_three_ulp, 1, FIXEDPOINT_ROUND_FLOOR, NULL);
+    ASSERT(test3.tag == VALID_NEGATIVE && test3.frac == 2);
+    Fixedpoint test4 = fixedpoint_shr(neg_three_ulp, 2, FIXEDPOINT_ROUND_TRUNCATE, NULL);
+    ASSERT(test4.tag == VALID_NONNEGATIVE && fixedpoint_is_zero(test4));
+    Fixedpoint test5 = fixedpoint_shr(objs->one, 127, FIXEDPOINT_ROUND_CEILING, NULL);
+    ASSERT(test5.whole == 0 && test5.frac == 1);
+
+    // Remainders
+    Fixedpoint rem;
+    Fixedpoint test6 = fixedpoint_shr(fixedpoint_create_from_hex("-13.8"), 4, FIXEDPOINT_ROUND_TRUNCATE, &rem);
+    ASSERT(test6.tag == VALID_NEGATIVE && test6.whole == 1 && test6.frac == 0x3800000000000000UL);
+    ASSERT(rem.tag == VALID_NONNEGATIVE && fixedpoint_is_zero(rem));
+    fixedpoint_shr(fixedpoint_create_from_hex("-13.8"), 68, FIXEDPOINT_ROUND_TRUNCATE, &rem);
+    ASSERT(rem.tag == VALID_NEGATIVE && rem.whole == 3 && rem.frac == 0x8000000000000000UL);
+    fixedpoint_shr(objs->large1, 200, FIXEDPOINT_ROUND_NEAREST_EVEN, &rem);
+    ASSERT(fixedpoint_compare(rem, objs->large1) == 0);
+
+    // A value that is not valid gives its tag to the quotient and remainder
+    Fixedpoint test7 = fixedpoint_shr(objs->overflow_negative, 4, FIXEDPOINT_ROUND_TRUNCATE, &rem);
+    ASSERT(fixedpoint_is_overflow_neg(test7) && fixedpoint_is_overflow_neg(rem));
+    fixedpoint_shr(objs->format_error, 68, FIXEDPOINT_ROUND_EXACT, &rem);
+    ASSERT(rem.tag == ERROR);
+
+    // Batch forms
+    Fixedpoint vals[2] = {objs->one, fixedpoint_negate(objs->one_fourth)};
+    Fixedpoint out[2];
+    fixedpoint_shr_batch(vals, 2, FIXEDPOINT_ROUND_EXACT, out, 2);
+    ASSERT(out[0].frac == 0x4000000000000000UL && out[1].frac == 0x1000000000000000UL && out[1].tag == VALID_NEGATIVE);
+    fixedpoint_shl_batch(out, 2, out, 2);
+    ASSERT(fixedpoint_compare(out[0], vals[0]) == 0 && fixedpoint_compare(out[1], vals[1]) == 0);
+
+    // Normalization helpers
+    ASSERT(fixedpoint_clz(objs->zero) == 128);
+    ASSERT(fixedpoint_clz(objs->one) == 63);
+    ASSERT(fixedpoint_clz(objs->max) == 0);
+    ASSERT(fixedpoint_ilog2(objs->one) == 0);
+    ASSERT(fixedpoint_ilog2(objs->one_fourth) == -2);
+    ASSERT(fixedpoint_ilog2(fixedpoint_negate(objs->large1)) == 34);
+    ASSERT(fixedpoint_ilog2(fixedpoint_create_from_hex("0.0000000000000001")) == -64);
+    ASSERT(fixedpoint_ilog2(objs->zero) == FIXEDPOINT_ILOG2_ZERO);
+}
+
+void test_fixedpoint_float_conversions(TestObjs *objs)
+{
+    // Exact conversions from double
+    Fixedpoint test1 = fixedpoint_from_double(0.1, FIXEDPOINT_ROUND_EXACT);
+    ASSERT(test1.tag == VALID_NONNEGATIVE && test1.whole == 0 && test1.frac == 0x1999999999999a00UL);
+    Fixedpoint test2 = fixedpoint_from_double(-1234.5, FIXEDPOINT_ROUND_EXACT);
+    ASSERT(test2.tag == VALID_NEGATIVE && test2.whole == 1234 && test2.frac == 0x8000000000000000UL);
+    Fixedpoint test3 = fixedpoint_from_double(-0.0, FIXEDPOINT_ROUND_EXACT);
+    ASSERT(test3.tag == VALID_NONNEGATIVE && fixedpoint_is_zero(test3));
+    Fixedpoint test4 = fixedpoint_from_double(18446744073709549568.0, FIXEDPOINT_ROUND_EXACT);
+    ASSERT(test4.tag == VALID_NONNEGATIVE && test4.whole == 0xfffffffffffff800UL && test4.frac == 0);
+
+    // Out of range, infinities and NaN
+    ASSERT(fixedpoint_is_overflow_pos(fixedpoint_from_double(18446744073709551616.0, FIXEDPOINT_ROUND_EXACT)));
+    ASSERT(fixedpoint_is_overflow_neg(fixedpoint_from_double(-1e300, FIXEDPOINT_ROUND_EXACT)));
+    ASSERT(fixedpoint_is_overflow_neg(fixedpoint_from_double(-__builtin_inf(), FIXEDPOINT_ROUND_EXACT)));
+    ASSERT(fixedpoint_is_err(fixedpoint_from_double(__builtin_nan(""), FIXEDPOINT_ROUND_EXACT)));
+
+    // Values with bits below 2^-64 are rounded
+    double tiny = 0x1.8p-65;
+    ASSERT(fixedpoint_is_underflow_pos(fixedpoint_from_double(tiny, FIXEDPOINT_ROUND_EXACT)));
+    ASSERT(fixedpoint_from_double(tiny, FIXEDPOINT_ROUND_NEAREST_EVEN).frac == 1);
+    ASSERT(fixedpoint_from_double(tiny, FIXEDPOINT_ROUND_TRUNCATE).frac == 0);
+    ASSERT(fixedpoint_from_double(-tiny, FIXEDPOINT_ROUND_FLOOR).frac == 1);
+    ASSERT(fixedpoint_from_double(5e-324, FIXEDPOINT_ROUND_CEILING).frac == 1);
+    ASSERT(fixedpoint_from_double(0x1.0000000000001p-1, FIXEDPOINT_ROUND_EXACT).frac == 0x8000000000000800UL);
+
+    // Conversions to double round to nearest, ties to even
+    ASSERT(fixedpoint_to_double(objs->one_half) == 0.5);
+    ASSERT(fixedpoint_to_double(fixedpoint_negate(objs->large1)) == -0x4b19efcea.000000ec9a1e2418p0);
+    ASSERT(fixedpoint_to_double(fixedpoint_create((1UL << 53) + 1)) == 0x1p53);
+    ASSERT(fixedpoint_to_double(fixedpoint_create((1UL << 53) + 3)) == 0x1p53 + 4);
+    ASSERT(fixedpoint_to_double(objs->max) == 0x1p64);
+    ASSERT(fixedpoint_to_double(fixedpoint_create_from_hex("0.0000000000000001")) == 0x1p-64);
+    ASSERT(fixedpoint_to_double(objs->zero) == 0.0);
+    ASSERT(fixedpoint_to_double(objs->overflow_negative) == -__builtin_inf());
+    double nan = fixedpoint_to_double(objs->format_error);
+    ASSERT(nan != nan);
+
+    // Round trips
+    uint64_t state = 0xabcdef12345UL;
+    for (int i = 0; i < 1000; ++i)
+    {
+        // Any double in range with no bits below 2^-64 converts exactly
+        double d = (double)(int64_t)test_rand(&state) * 0x1p-52;
+        Fixedpoint val = fixedpoint_from_double(d, FIXEDPOINT_ROUND_EXACT);
+        ASSERT(fixedpoint_is_valid(val));
+        ASSERT(fixedpoint_to_double(val) == d);
+
+        // Any value with at most 64 significant bits converts exactly
+        // through long double, and any value through binary128 is correctly
+        // rounded to the nearest double
+        Fixedpoint wide = fixedpoint_create2(test_rand(&state) >> (i % 64), test_rand(&state));
+        Fixedpoint narrow = fixedpoint_shr(wide, 64, FIXEDPOINT_ROUND_TRUNCATE, NULL);
+        narrow = fixedpoint_shl(narrow, i % 64);
+        Fixedpoint back = fixedpoint_from_long_double(fixedpoint_to_long_double(narrow), FIXEDPOINT_ROUND_EXACT);
+        ASSERT(fixedpoint_compare(back, narrow) == 0 && back.tag == narrow.tag);
+#if defined(__SIZEOF_FLOAT128__)
+        __float128 q = fixedpoint_to_float128(wide);
+        ASSERT((double)q == fixedpoint_to_double(wide));
+        Fixedpoint back128 = fixedpoint_from_float128(q, FIXEDPOINT_ROUND_NEAREST_EVEN);
+        Fixedpoint error = fixedpoint_sub(back128, wide);
+        ASSERT(fixedpoint_ilog2(error) < fixedpoint_ilog2(wide) - 112);
+#endif
+    }
+
+#if defined(__SIZEOF_FLOAT128__)
+    ASSERT(fixedpoint_compare(fixedpoint_from_float128((__float128)-1.5, FIXEDPOINT_ROUND_EXACT),
+                              fixedpoint_create_from_hex("-1.8")) == 0);
+    ASSERT(fixedpoint_is_overflow_pos(fixedpoint_from_float128((__float128)0x1p64, FIXEDPOINT_ROUND_EXACT)));
+#endif
+}
+
+void test_fixedpoint_quantize(TestObjs *objs)
+{
+    (void)objs;
+    enum { N = 1037 };
+    static double in[N], out[N], expected_out[N];
+    static Fixedpoint vals[N], expected[N];
+    uint64_t bitmap[(N + 63) / 64];
+    uint64_t state = 0x5eed1234UL;
+
+    // A mix of exact, inexact, out of range and special inputs
+    for (int i = 0; i < N; ++i)
+    {
+        switch (i % 8)
+        {
+        case 0:
+            in[i] = (double)(int64_t)test_rand(&state) * 0x1p-40;
+            break;
+        case 1:
+            in[i] = (double)test_rand(&state) * 0x1p-120;
+            break;
+        case 2:
+            in[i] = (double)(int64_t)test_rand(&state) * ((i & 16) ? 0x1p2 : 0x1p-80);
+            break;
+        case 3:
+            in[i] = (i & 8) ? -0.0 : 0.0;
+            break;
+        case 4:
+            in[i] = (i & 8) ? __builtin_nan("") : -__builtin_inf();
+            break;
+        default:
+        {
+            uint64_t bits = (test_rand(&state) & 0x800fffffffffffffUL) | (uint64_t)(1000 + i % 90) << 52;
+            memcpy(&in[i], &bits, sizeof(bits));
+            break;
+        }
+        }
+    }
+
+    size_t expected_invalid = 0;
+    for (int i = 0; i < N; ++i)
+    {
+        expected[i] = fixedpoint_from_double(in[i], FIXEDPOINT_ROUND_EXACT);
+        expected_invalid += !fixedpoint_is_valid(expected[i]);
+        expected_out[i] = fixedpoint_to_double(expected[i]);
+    }
+    // Values only the vector dequantize fast path sees
+    Fixedpoint wide = fixedpoint_create2(0x123456789abcdefUL, 0xfedcba9876543211UL);
+    expected[N - 3] = wide;
+    expected[N - 2] = fixedpoint_create2(0, 0x8000000000000401UL);
+    expected[N - 1] = fixedpoint_negate(fixedpoint_create(0));
+    for (int i = N - 3; i < N; ++i)
+    {
+        expected_out[i] = fixedpoint_to_double(expected[i]);
+    }
+
+    for (int isa = FIXEDPOINT_ISA_SCALAR; isa <= FIXEDPOINT_ISA_AVX512; ++isa)
+    {
+        if (!fixedpoint_isa_select((FixedpointIsa)isa))
+        {
+            ASSERT(isa > (int)fixedpoint_isa_detect());
+            continue;
+        }
+
+        memset(bitmap, 0xff, sizeof(bitmap));
+        size_t invalid = fixedpoint_quantize(in, vals, N, FIXEDPOINT_ROUND_EXACT, bitmap);
+        ASSERT(invalid == expected_invalid);
+        for (int i = 0; i < N - 3; ++i)
+        {
+            ASSERT(vals[i].whole == expected[i].whole && vals[i].frac == expected[i].frac);
+            ASSERT(vals[i].tag == expected[i].tag);
+            ASSERT((int)((bitmap[i / 64] >> (i % 64)) & 1) == !fixedpoint_is_valid(expected[i]));
+        }
+
+        fixedpoint_dequantize(expected, out, N);
+        for (int i = 0; i < N; ++i)
+        {
+            int both_nan = out[i] != out[i] && expected_out[i] != expected_out[i];
+            ASSERT(both_nan || memcmp(&out[i], &expected_out[i], sizeof(double)) == 0);
+        }
+    }
+    fixedpoint_isa_select(fixedpoint_isa_detect());
+}
+
+void test_fixedpoint_qformat(TestObjs *objs)
+{
+    (void)objs;
+
+    FixedpointQ32_32 one = fixedpoint_q32_32_create(1);
+    FixedpointQ32_32 half = fixedpoint_q32_32_create2(0, 0x80000000UL);
+    ASSERT(one.bits == 0x100000000UL && fixedpoint_q32_32_is_valid(one));
+    ASSERT(fixedpoint_q32_32_whole_part(half) == 0 && fixedpoint_q32_32_frac_part(half) == 0x80000000UL);
+    ASSERT(fixedpoint_q32_32_is_overflow_pos(fixedpoint_q32_32_create(0x100000000UL)));
+    ASSERT(fixedpoint_q16_48_is_overflow_pos(fixedpoint_q16_48_create(0x10000UL)));
+
+    // Hex strings
+    FixedpointQ16_48 q = fixedpoint_q16_48_create_from_hex("-ffff.000000000001");
+    ASSERT(fixedpoint_q16_48_is_neg(q) && q.bits == 0xffff000000000001UL);
+    char *s = fixedpoint_q16_48_format_as_hex(q);
+    ASSERT(0 == strcmp(s, "-ffff.000000000001"));
+    free(s);
+    ASSERT(fixedpoint_q16_48_is_err(fixedpoint_q16_48_create_from_hex("10000")));
+    ASSERT(fixedpoint_q16_48_is_err(fixedpoint_q16_48_create_from_hex("0.0000000000000001")));
+    ASSERT(fixedpoint_q16_48_is_err(fixedpoint_q16_48_create_from_hex("xyz")));
+    s = fixedpoint_q32_32_format_as_hex(fixedpoint_q32_32_sub(half, one));
+    ASSERT(0 == strcmp(s, "-0.8"));
+    free(s);
+
+    // Arithmetic edge cases
+    FixedpointQ32_32 max = fixedpoint_q32_32_create_from_hex("ffffffff.ffffffff");
+    ASSERT(fixedpoint_q32_32_is_overflow_pos(fixedpoint_q32_32_add(max, one)));
+    ASSERT(fixedpoint_q32_32_is_overflow_neg(fixedpoint_q32_32_double(fixedpoint_q32_32_negate(max))));
+    ASSERT(fixedpoint_q32_32_is_underflow_pos(fixedpoint_q32_32_halve(max)));
+    ASSERT(fixedpoint_q32_32_is_zero(fixedpoint_q32_32_sub(one, one)));
+    ASSERT(fixedpoint_q32_32_sub(one, one).tag == VALID_NONNEGATIVE);
+    ASSERT(fixedpoint_q32_32_negate(fixedpoint_q32_32_create(0)).tag == VALID_NONNEGATIVE);
+    ASSERT(fixedpoint_q32_32_compare(half, one) < 0);
+    ASSERT(fixedpoint_q32_32_compare(fixedpoint_q32_32_negate(half), half) < 0);
+
+    // Results agree with Fixedpoint arithmetic whenever they fit
+    uint64_t state = 0x9e3779b97f4a7c15UL;
+    for (int i = 0; i < 2000; ++i)
+    {
+        FixedpointQ16_48 a, b;
+        a.bits = test_rand(&state) >> (i % 8);
+        a.tag = (Tag)(test_rand(&state) & 1);
+        b.bits = test_rand(&state) >> (i % 5);
+        b.tag = (Tag)(test_rand(&state) & 1);
+        if (a.bits == 0)
+        {
+            a.tag = VALID_NONNEGATIVE;
+        }
+        Fixedpoint fa = fixedpoint_q16_48_to_fixedpoint(a);
+        Fixedpoint fb = fixedpoint_q16_48_to_fixedpoint(b);
+        ASSERT(fixedpoint_q16_48_compare(a, b) == fixedpoint_compare(fa, fb) || (a.bits == 0 && b.bits == 0));
+
+        Fixedpoint sums[4] = {fixedpoint_add(fa, fb), fixedpoint_sub(fa, fb), fixedpoint_halve(fa),
+                              fixedpoint_double(fa)};
+        FixedpointQ16_48 qsums[4] = {fixedpoint_q16_48_add(a, b), fixedpoint_q16_48_sub(a, b),
+                                     fixedpoint_q16_48_halve(a), fixedpoint_q16_48_double(a)};
+        for (int j = 0; j < 4; ++j)
+        {
+            FixedpointQ16_48 expected = fixedpoint_q16_48_from_fixedpoint(sums[j], FIXEDPOINT_ROUND_EXACT);
+            ASSERT(qsums[j].bits == expected.bits && qsums[j].tag == expected.tag);
+        }
+
+        // Conversions between formats are exact when the value fits
+        FixedpointQ32_32 c = fixedpoint_q32_32_from_fixedpoint(fa, FIXEDPOINT_ROUND_EXACT);
+        if (fixedpoint_q32_32_is_valid(c))
+        {
+            ASSERT((a.bits & 0xffffUL) == 0);
+            Fixedpoint wide = fixedpoint_q32_32_to_fixedpoint(c);
+            FixedpointQ16_48 back = fixedpoint_q16_48_from_fixedpoint(wide, FIXEDPOINT_ROUND_EXACT);
+            ASSERT(back.bits == a.bits && back.tag == a.tag);
+        }
+        else
+        {
+            ASSERT((a.bits & 0xffffUL) != 0 && fixedpoint_q32_32_is_underflow_pos(c) == (a.tag == VALID_NONNEGATIVE));
+        }
+    }
+}
+
+void test_fixedpoint_column(TestObjs *objs)
+{
+    (void)objs;
+    enum { N = 700 };
+    static Fixedpoint a[N], b[N], sums[N], expected[N];
+    uint64_t state = 0x1234567UL;
+
+    // Range analysis
+    FixedpointRange range;
+    Fixedpoint small[3] = {fixedpoint_create2(5, 0x8000000000000000UL), fixedpoint_create_from_hex("-0.01"),
+                           fixedpoint_create(0)};
+    fixedpoint_range_analyze(small, 3, &range);
+    ASSERT(range.whole_bits == 3 && range.frac_bits == 8 && range.invalid == 0);
+    ASSERT(fixedpoint_range_fits_packed(&range));
+    small[2].tag = ERROR;
+    fixedpoint_range_analyze(small, 3, &range);
+    ASSERT(range.invalid == 1 && !fixedpoint_range_fits_packed(&range));
+
+    // Narrow values, with a few wide ones to force the scalar path in some blocks
+    for (int i = 0; i < N; ++i)
+    {
+        a[i] = fixedpoint_create2(test_rand(&state) >> 42, test_rand(&state) << 24);
+        b[i] = fixedpoint_create2(test_rand(&state) >> 44, test_rand(&state) << 30);
+        if (test_rand(&state) & 1)
+        {
+            a[i] = fixedpoint_negate(a[i]);
+        }
+        if (test_rand(&state) & 1)
+        {
+            b[i] = fixedpoint_negate(b[i]);
+        }
+    }
+    a[N - 5] = fixedpoint_create2(~0UL, 1);
+
+    fixedpoint_add_batch(a, b, sums, N);
+    for (int i = 0; i < N; ++i)
+    {
+        Fixedpoint sum = fixedpoint_add(a[i], b[i]);
+        ASSERT(fixedpoint_compare(sums[i], sum) == 0 && sums[i].tag == sum.tag);
+    }
+    fixedpoint_sub_batch(a, b, sums, N);
+    for (int i = 0; i < N; ++i)
+    {
+        Fixedpoint difference = fixedpoint_sub(a[i], b[i]);
+        ASSERT(fixedpoint_compare(sums[i], difference) == 0 && sums[i].tag == difference.tag);
+    }
+
+    // Columns stay packed while results fit
+    a[N - 5] = fixedpoint_create(0);
+    FixedpointColumn ca, cb;
+    ASSERT(fixedpoint_column_init(&ca, a, N) && fixedpoint_column_init(&cb, b, N));
+    ASSERT(fixedpoint_column_is_packed(&ca) && fixedpoint_column_is_packed(&cb));
+    ASSERT(ca.frac_bits == 40 && cb.frac_bits == 34);
+    ASSERT(fixedpoint_column_sub(&ca, &cb));
+    ASSERT(fixedpoint_column_is_packed(&ca) && ca.frac_bits == 40);
+    for (int i = 0; i < N; ++i)
+    {
+        expected[i] = fixedpoint_sub(a[i], b[i]);
+        ASSERT(fixedpoint_compare(fixedpoint_column_get(&ca, i), expected[i]) == 0);
+    }
+
+    // A sum that leaves the packed range widens the column exactly
+    Fixedpoint big[N];
+    for (int i = 0; i < N; ++i)
+    {
+        big[i] = fixedpoint_create(0);
+    }
+    big[N / 2] = fixedpoint_create(0x7fffff);
+    FixedpointColumn cbig;
+    ASSERT(fixedpoint_column_init(&cbig, big, N) && fixedpoint_column_is_packed(&cbig));
+    for (int k = 0; k < 2; ++k)
+    {
+        ASSERT(fixedpoint_column_add(&ca, &cbig));
+        for (int i = 0; i < N; ++i)
+        {
+            expected[i] = fixedpoint_add(expected[i], big[i]);
+        }
+    }
+    ASSERT(!fixedpoint_column_is_packed(&ca));
+    fixedpoint_column_read(&ca, sums);
+    for (int i = 0; i < N; ++i)
+    {
+        ASSERT(fixedpoint_compare(sums[i], expected[i]) == 0 && sums[i].tag == expected[i].tag);
+    }
+
+    // Narrowing again after the large values are gone
+    ASSERT(fixedpoint_column_sub(&ca, &cbig) && fixedpoint_column_sub(&ca, &cbig));
+    ASSERT(fixedpoint_column_narrow(&ca));
+    ASSERT(fixedpoint_column_widen(&ca) && !fixedpoint_column_is_packed(&ca));
+
+    fixedpoint_column_destroy(&ca);
+    fixedpoint_column_destroy(&cb);
+    fixedpoint_column_destroy(&cbig);
+}
+
+void test_fixedpoint_mul(TestObjs *objs)
+{
+    Fixedpoint one_and_one_half = fixedpoint_create_from_hex("1.8");
+    Fixedpoint product = fixedpoint_mul(one_and_one_half, one_and_one_half);
+    ASSERT(product.tag == VALID_NONNEGATIVE && product.whole == 2 && product.frac == 0x4000000000000000UL);
+    product = fixedpoint_mul(fixedpoint_negate(objs->one_half), fixedpoint_create(100));
+    ASSERT(product.tag == VALID_NEGATIVE && product.whole == 50 && product.frac == 0);
+    ASSERT(fixedpoint_is_overflow_pos(fixedpoint_mul(objs->max, one_and_one_half)));
+    ASSERT(fixedpoint_is_zero(fixedpoint_mul(objs->zero, fixedpoint_negate(objs->max))));
+
+    // 2^-64 * 2^-1 is below the smallest representable value
+    Fixedpoint tiny = fixedpoint_create2(0, 1);
+    ASSERT(fixedpoint_is_underflow_neg(fixedpoint_mul(fixedpoint_negate(tiny), objs->one_half)));
+    ASSERT(fixedpoint_is_zero(fixedpoint_mul_round(tiny, objs->one_half, FIXEDPOINT_ROUND_NEAREST_EVEN)));
+    product = fixedpoint_mul_round(tiny, one_and_one_half, FIXEDPOINT_ROUND_NEAREST_EVEN);
+    ASSERT(product.whole == 0 && product.frac == 2);
+    product = fixedpoint_mul_round(fixedpoint_negate(tiny), objs->one_half, FIXEDPOINT_ROUND_FLOOR);
+    ASSERT(product.tag == VALID_NEGATIVE && product.frac == 1);
+    ASSERT(fixedpoint_is_err(fixedpoint_mul(objs->format_error, objs->one)));
+}
+
+void test_fixedpoint256(TestObjs *objs)
+{
+    (void)objs;
+    char *s;
+
+    // Hex strings
+    Fixedpoint256 a = fixedpoint256_create_from_hex("123456789abcdef0fedcba9876543210.deadbeefcafebabe0123456789abcdef");
+    Fixedpoint256 b = fixedpoint256_create_from_hex("3.08000000000000000000000000000001");
+    ASSERT(a.limb[3] == 0x123456789abcdef0UL && a.limb[2] == 0xfedcba9876543210UL);
+    ASSERT(a.limb[1] == 0xdeadbeefcafebabeUL && a.limb[0] == 0x0123456789abcdefUL);
+    s = fixedpoint256_format_as_hex(fixedpoint256_negate(b));
+    ASSERT(0 == strcmp(s, "-3.08000000000000000000000000000001"));
+    free(s);
+    s = fixedpoint256_format_as_hex(fixedpoint256_create_from_hex("-0.8"));
+    ASSERT(0 == strcmp(s, "-0.8"));
+    free(s);
+    ASSERT(fixedpoint256_is_zero(fixedpoint256_create_from_hex("-0")));
+    ASSERT(!fixedpoint256_is_neg(fixedpoint256_create_from_hex("-0.0")));
+    ASSERT(!fixedpoint256_is_valid(fixedpoint256_create_from_hex("1000000000000000000000000000000000")));
+    ASSERT(!fixedpoint256_is_valid(fixedpoint256_create_from_hex("1.000000000000000000000000000000001")));
+    ASSERT(!fixedpoint256_is_valid(fixedpoint256_create_from_hex("1.2.3")));
+    s = fixedpoint256_format_as_hex(fixedpoint256_create_from_hex("xyz"));
+    ASSERT(0 == strcmp(s, "<invalid>"));
+    free(s);
+
+    // Addition and subtraction carry across all limbs
+    Fixedpoint256 max = fixedpoint256_create_from_hex("ffffffffffffffffffffffffffffffff.ffffffffffffffffffffffffffffffff");
+    Fixedpoint256 ulp = fixedpoint256_create_from_hex("0.00000000000000000000000000000001");
+    ASSERT(!fixedpoint256_is_valid(fixedpoint256_add(max, ulp)));
+    ASSERT(fixedpoint256_add(fixedpoint256_negate(max), fixedpoint256_negate(ulp)).tag == OVERFLOW_NEGATIVE);
+    Fixedpoint256 difference = fixedpoint256_sub(ulp, fixedpoint256_create(1));
+    s = fixedpoint256_format_as_hex(difference);
+    ASSERT(0 == strcmp(s, "-0.ffffffffffffffffffffffffffffffff"));
+    free(s);
+    ASSERT(fixedpoint256_is_zero(fixedpoint256_add(difference, fixedpoint256_sub(fixedpoint256_create(1), ulp))));
+    ASSERT(fixedpoint256_compare(difference, ulp) < 0 && fixedpoint256_compare(max, a) > 0);
+
+    // Multiplication, rounded several ways
+    Fixedpoint256 p = fixedpoint256_mul(a, b, FIXEDPOINT_ROUND_TRUNCATE);
+    s = fixedpoint256_format_as_hex(p);
+    ASSERT(0 == strcmp(s, "372ea61d950c83ca848d159e26af37c3.3533013f7a110500f24fa4fa4fa4fa4d"));
+    free(s);
+    ASSERT(fixedpoint256_compare(fixedpoint256_mul(a, b, FIXEDPOINT_ROUND_NEAREST_EVEN), p) == 0);
+    ASSERT(fixedpoint256_mul(a, b, FIXEDPOINT_ROUND_EXACT).tag == UNDERFLOW_POSITIVE);
+    p = fixedpoint256_mul(fixedpoint256_negate(a), b, FIXEDPOINT_ROUND_FLOOR);
+    ASSERT(p.tag == VALID_NEGATIVE && p.limb[0] == 0xf24fa4fa4fa4fa4eUL);
+    ASSERT(fixedpoint256_mul(a, a, FIXEDPOINT_ROUND_EXACT).tag == OVERFLOW_POSITIVE);
+    ASSERT(!fixedpoint256_is_valid(fixedpoint256_mul(fixedpoint256_create_from_hex("g"), b, FIXEDPOINT_ROUND_EXACT)));
+
+    // Products of Fixedpoint values are exact, and narrow to the same results as fixedpoint_mul_round
+    uint64_t state = 0x7777UL;
+    for (int i = 0; i < 2000; ++i)
+    {
+        Fixedpoint x = fixedpoint_create2(test_rand(&state) >> (i % 64), test_rand(&state));
+        Fixedpoint y = fixedpoint_create2(test_rand(&state) >> (63 - i % 64), test_rand(&state));
+        if (i & 1)
+        {
+            y = fixedpoint_negate(y);
+        }
+        Fixedpoint256 exact = fixedpoint256_mul(fixedpoint256_from_fixedpoint(x), fixedpoint256_from_fixedpoint(y),
+                                                FIXEDPOINT_ROUND_EXACT);
+        ASSERT(fixedpoint256_is_valid(exact));
+        for (int mode = FIXEDPOINT_ROUND_EXACT; mode <= FIXEDPOINT_ROUND_FLOOR; ++mode)
+        {
+            Fixedpoint narrow = fixedpoint256_to_fixedpoint(exact, (FixedpointRound)mode);
+            Fixedpoint expected = fixedpoint_mul_round(x, y, (FixedpointRound)mode);
+            ASSERT(narrow.whole == expected.whole && narrow.frac == expected.frac && narrow.tag == expected.tag);
+        }
+
+        // The product distributes over addition when no bits are lost
+        Fixedpoint256 u = {{test_rand(&state), test_rand(&state), test_rand(&state), test_rand(&state) >> 8},
+                           VALID_NONNEGATIVE};
+        Fixedpoint256 v = {{test_rand(&state), test_rand(&state), test_rand(&state), test_rand(&state) >> 8},
+                           VALID_NEGATIVE};
+        Fixedpoint256 w = fixedpoint256_negate(fixedpoint256_create(test_rand(&state) >> 58));
+        Fixedpoint256 lhs = fixedpoint256_mul(fixedpoint256_add(u, v), w, FIXEDPOINT_ROUND_EXACT);
+        Fixedpoint256 rhs = fixedpoint256_add(fixedpoint256_mul(u, w, FIXEDPOINT_ROUND_EXACT),
+                                              fixedpoint256_mul(v, w, FIXEDPOINT_ROUND_EXACT));
+        ASSERT(fixedpoint256_is_valid(rhs) && fixedpoint256_compare(lhs, rhs) == 0);
+    }
+
+    // Full width operands; the magnitude of the product wraps
+    Fixedpoint256 c = fixedpoint256_create_from_hex("fedcba98765432100123456789abcdef.0f1e2d3c4b5a69788796a5b4c3d2e1f0");
+    p = fixedpoint256_mul(a, c, FIXEDPOINT_ROUND_TRUNCATE);
+    ASSERT(p.tag == OVERFLOW_POSITIVE);
+    ASSERT(p.limb[0] == 0x15f467e7ebeb5dbaUL && p.limb[1] == 0x66b99b1a17566a45UL);
+    ASSERT(p.limb[2] == 0x42f35b63f7b568ebUL && p.limb[3] == 0x893020dced3ef2d7UL);
+
+    // Narrowing
+    ASSERT(fixedpoint_is_overflow_neg(fixedpoint256_to_fixedpoint(fixedpoint256_negate(a), FIXEDPOINT_ROUND_EXACT)));
+    Fixedpoint narrow = fixedpoint256_to_fixedpoint(fixedpoint256_create_from_hex("1.ffffffffffffffff8"),
+                                                    FIXEDPOINT_ROUND_NEAREST_EVEN);
+    ASSERT(narrow.tag == VALID_NONNEGATIVE && narrow.whole == 2 && narrow.frac == 0);
+    ASSERT(fixedpoint_is_underflow_pos(fixedpoint256_to_fixedpoint(ulp, FIXEDPOINT_ROUND_EXACT)));
+}
+
+void test_fixedpoint_decimal(TestObjs *objs)
+{
+    (void)objs;
+    char *s;
+
+    // 0.01 is exact, so a hundred cents make exactly one unit
+    FixedpointDec2 cent = fixedpoint_dec2_create_from_string("0.01");
+    FixedpointDec2 total = fixedpoint_dec2_create(0);
+    for (int i = 0; i < 100; ++i)
+    {
+        total = fixedpoint_dec2_add(total, cent);
+    }
+    ASSERT(fixedpoint_dec2_compare(total, fixedpoint_dec2_create(1)) == 0);
+
+    // Strings
+    FixedpointDec2 price = fixedpoint_dec2_create_from_string("-1234.5");
+    ASSERT(fixedpoint_dec2_is_neg(price) && price.lo == 123450);
+    s = fixedpoint_dec2_format_as_string(price);
+    ASSERT(0 == strcmp(s, "-1234.5"));
+    free(s);
+    s = fixedpoint_dec2_format_as_string(fixedpoint_dec2_sub(cent, fixedpoint_dec2_create(3)));
+    ASSERT(0 == strcmp(s, "-2.99"));
+    free(s);
+    ASSERT(fixedpoint_dec2_is_err(fixedpoint_dec2_create_from_string("1.001")));
+    ASSERT(fixedpoint_dec2_is_err(fixedpoint_dec2_create_from_string("12a")));
+    ASSERT(fixedpoint_dec2_is_err(fixedpoint_dec2_create_from_string("1.2.3")));
+    ASSERT(fixedpoint_dec2_is_zero(fixedpoint_dec2_create_from_string("-0.00")));
+    ASSERT(!fixedpoint_dec2_is_neg(fixedpoint_dec2_negate(fixedpoint_dec2_create(0))));
+    s = fixedpoint_dec2_format_as_string(fixedpoint_dec2_create_from_string("xyz"));
+    ASSERT(0 == strcmp(s, "<invalid>"));
+    free(s);
+
+    // The largest value, and overflow
+    const char *max_string = "3402823669209384634633746074317682114.55";
+    FixedpointDec2 max = fixedpoint_dec2_create_from_string(max_string);
+    ASSERT(max.hi == ~0UL && max.lo == ~0UL);
+    s = fixedpoint_dec2_format_as_string(max);
+    ASSERT(0 == strcmp(s, max_string));
+    free(s);
+    ASSERT(fixedpoint_dec2_is_err(fixedpoint_dec2_create_from_string("3402823669209384634633746074317682114.56")));
+    ASSERT(fixedpoint_dec2_is_overflow_pos(fixedpoint_dec2_add(max, cent)));
+    ASSERT(fixedpoint_dec2_is_overflow_neg(fixedpoint_dec2_mul_pow10(price, 36)));
+    ASSERT(fixedpoint_dec2_is_overflow_pos(fixedpoint_dec2_mul_pow10(max, 1)));
+    FixedpointDec2 big = fixedpoint_dec2_mul_pow10(cent, 38);
+    ASSERT(fixedpoint_dec2_is_valid(big));
+    s = fixedpoint_dec2_format_as_string(big);
+    ASSERT(0 == strcmp(s, "1000000000000000000000000000000000000"));
+    free(s);
+
+    // Division by powers of ten, rounded several ways
+    FixedpointDec2 x = fixedpoint_dec2_create_from_string("-2.5");
+    ASSERT(fixedpoint_dec2_is_underflow_neg(fixedpoint_dec2_div_pow10(x, 2, FIXEDPOINT_ROUND_EXACT)));
+    ASSERT(fixedpoint_dec2_div_pow10(x, 2, FIXEDPOINT_ROUND_TRUNCATE).lo == 2);
+    ASSERT(fixedpoint_dec2_div_pow10(x, 2, FIXEDPOINT_ROUND_NEAREST_EVEN).lo == 2);
+    ASSERT(fixedpoint_dec2_div_pow10(x, 1, FIXEDPOINT_ROUND_NEAREST_EVEN).lo == 25);
+    FixedpointDec2 y = fixedpoint_dec2_create_from_string("3.5");
+    ASSERT(fixedpoint_dec2_div_pow10(y, 2, FIXEDPOINT_ROUND_NEAREST_EVEN).lo == 4);
+    ASSERT(fixedpoint_dec2_div_pow10(x, 2, FIXEDPOINT_ROUND_FLOOR).lo == 3);
+    ASSERT(fixedpoint_dec2_div_pow10(x, 2, FIXEDPOINT_ROUND_CEILING).lo == 2);
+
+    __extension__ typedef unsigned __int128 u128;
+    uint64_t state = 0x31415926UL;
+    for (int i = 0; i < 3000; ++i)
+    {
+        FixedpointDecimal val = {test_rand(&state) >> (i % 64), test_rand(&state), 6, VALID_NONNEGATIVE};
+        unsigned n = (unsigned)i % (FIXEDPOINT_DECIMAL_MAX_POW10 + 1);
+        u128 mag = (u128)val.hi << 64 | val.lo;
+        u128 p = 1;
+        for (unsigned k = 0; k < n; ++k)
+        {
+            p *= 10;
+        }
+        FixedpointDecimal q = fixedpoint_decimal_div_pow10(val, n, FIXEDPOINT_ROUND_TRUNCATE);
+        ASSERT(((u128)q.hi << 64 | q.lo) == mag / p);
+
+        // Multiplying back restores the truncated part
+        FixedpointDecimal back = fixedpoint_decimal_mul_pow10(q, n);
+        ASSERT(((u128)back.hi << 64 | back.lo) == mag - mag % p);
+
+        q = fixedpoint_decimal_div_pow10(val, n, FIXEDPOINT_ROUND_EXACT);
+        ASSERT((q.tag == UNDERFLOW_POSITIVE) == (mag % p != 0));
+    }
+
+    // Conversions between scales
+    FixedpointDec6 micro = fixedpoint_dec6_create_from_string("-0.125001");
+    FixedpointDecimal general = fixedpoint_dec6_to_decimal(micro);
+    FixedpointDec2 rounded = fixedpoint_dec2_from_decimal(general, FIXEDPOINT_ROUND_NEAREST_EVEN);
+    ASSERT(rounded.tag == VALID_NEGATIVE && rounded.lo == 13);
+    FixedpointDec6 widened = fixedpoint_dec6_from_decimal(fixedpoint_dec2_to_decimal(price), FIXEDPOINT_ROUND_EXACT);
+    s = fixedpoint_dec6_format_as_string(widened);
+    ASSERT(0 == strcmp(s, "-1234.5") && widened.lo == 1234500000UL);
+    free(s);
+}
+
+// Check that a value is within tolerance units of 2^-64 of a hex value
+static int fixedpoint_is_near(Fixedpoint val, const char *hex, uint64_t tolerance)
+{
+    Fixedpoint diff = fixedpoint_sub(val, fixedpoint_create_from_hex(hex));
+    return fixedpoint_is_valid(val) && diff.whole == 0 && diff.frac <= tolerance;
+}
+
+void test_fixedpoint_sqrt(TestObjs *objs)
+{
+    Fixedpoint root = fixedpoint_sqrt(fixedpoint_create(4), FIXEDPOINT_ROUND_EXACT);
+    ASSERT(root.tag == VALID_NONNEGATIVE && root.whole == 2 && root.frac == 0);
+    root = fixedpoint_sqrt(fixedpoint_create_from_hex("0.0000000000000001"), FIXEDPOINT_ROUND_EXACT);
+    ASSERT(root.tag == VALID_NONNEGATIVE && root.whole == 0 && root.frac == 0x100000000UL);
+
+    // sqrt(2) = 1.6a09e667f3bcc908b2...
+    Fixedpoint two = fixedpoint_create(2);
+    root = fixedpoint_sqrt(two, FIXEDPOINT_ROUND_EXACT);
+    ASSERT(fixedpoint_is_underflow_pos(root) && root.whole == 1 && root.frac == 0x6a09e667f3bcc908UL);
+    root = fixedpoint_sqrt(two, FIXEDPOINT_ROUND_TRUNCATE);
+    ASSERT(root.tag == VALID_NONNEGATIVE && root.frac == 0x6a09e667f3bcc908UL);
+    root = fixedpoint_sqrt(two, FIXEDPOINT_ROUND_NEAREST_EVEN);
+    ASSERT(root.tag == VALID_NONNEGATIVE && root.frac == 0x6a09e667f3bcc909UL);
+    root = fixedpoint_sqrt(two, FIXEDPOINT_ROUND_CEILING);
+    ASSERT(root.frac == 0x6a09e667f3bcc909UL);
+
+    // The root of the largest value rounds up to 2^32
+    root = fixedpoint_sqrt(objs->max, FIXEDPOINT_ROUND_FLOOR);
+    ASSERT(root.whole == 0xffffffffUL && root.frac == 0xffffffffffffffffUL);
+    root = fixedpoint_sqrt(objs->max, FIXEDPOINT_ROUND_NEAREST_EVEN);
+    ASSERT(root.whole == 0x100000000UL && root.frac == 0);
+
+    ASSERT(fixedpoint_is_zero(fixedpoint_sqrt(objs->zero, FIXEDPOINT_ROUND_EXACT)));
+    ASSERT(fixedpoint_is_err(fixedpoint_sqrt(fixedpoint_negate(objs->one), FIXEDPOINT_ROUND_EXACT)));
+    ASSERT(fixedpoint_is_err(fixedpoint_sqrt(objs->overflow_positive, FIXEDPOINT_ROUND_EXACT)));
+
+    // The truncated root r of v satisfies r^2 <= v < (r + 2^-64)^2, which
+    // Fixedpoint256 computes exactly
+    Fixedpoint vals[64], roots[64];
+    uint64_t state = 0x2545f4914f6cdd1dUL;
+    for (int i = 0; i < 64; ++i)
+    {
+        vals[i] = fixedpoint_create2(test_rand(&state) >> (i % 64), test_rand(&state) >> (i / 4));
+    }
+    fixedpoint_sqrt_batch(vals, FIXEDPOINT_ROUND_TRUNCATE, roots, 64);
+    Fixedpoint ulp = fixedpoint_create2(0, 1);
+    for (int i = 0; i < 64; ++i)
+    {
+        Fixedpoint256 val = fixedpoint256_from_fixedpoint(vals[i]);
+        Fixedpoint256 low = fixedpoint256_from_fixedpoint(roots[i]);
+        Fixedpoint256 high = fixedpoint256_from_fixedpoint(fixedpoint_add(roots[i], ulp));
+        ASSERT(fixedpoint256_compare(fixedpoint256_mul(low, low, FIXEDPOINT_ROUND_EXACT), val) <= 0);
+        ASSERT(fixedpoint256_compare(fixedpoint256_mul(high, high, FIXEDPOINT_ROUND_EXACT), val) > 0);
+    }
+}
+
+void test_fixedpoint_exp_log(TestObjs *objs)
+{
+    // Reference values are the exact results rounded to the nearest
+    // multiple of 2^-64. The tolerances follow the documented error bounds:
+    // 1 unit, or 2^10 units for results near 2^64.
+    ASSERT(fixedpoint_is_near(fixedpoint_exp2(objs->one_half), "1.6a09e667f3bcc909", 1));
+    ASSERT(fixedpoint_is_near(fixedpoint_exp2(fixedpoint_create_from_hex("-1.4")), "0.6ba27e656b4eb57a", 1));
+    ASSERT(fixedpoint_is_near(fixedpoint_exp2(fixedpoint_create_from_hex("28.3")), "12387a6e756.23866c1fadb1c15d", 1));
+    ASSERT(fixedpoint_is_near(fixedpoint_exp2(fixedpoint_create_from_hex("3f.ff")),
+                              "ff4ecb59511ec8a5.301ba217ef18dd7c", 1024));
+    ASSERT(fixedpoint_is_near(fixedpoint_exp2(fixedpoint_create_from_hex("-3f.c")), "0.0000000000000001", 0));
+    ASSERT(fixedpoint_is_near(fixedpoint_exp(objs->one), "2.b7e151628aed2a6b", 1));
+    ASSERT(fixedpoint_is_near(fixedpoint_exp(fixedpoint_create_from_hex("-0.8")), "0.9b4597e37cb04ff4", 1));
+    ASSERT(fixedpoint_is_near(fixedpoint_exp(fixedpoint_create_from_hex("-14.a")), "0.00000004bd0af74c", 1));
+    ASSERT(fixedpoint_is_near(fixedpoint_exp(fixedpoint_create_from_hex("2c.5")),
+                              "f3c729a08bdb08be.6cdca20fe43327bf", 1024));
+    ASSERT(fixedpoint_is_near(fixedpoint_log2(fixedpoint_create(3)), "1.95c01a39fbd687a", 1));
+    ASSERT(fixedpoint_is_near(fixedpoint_log2(fixedpoint_create_from_hex("1.8")), "0.95c01a39fbd687a", 1));
+    ASSERT(fixedpoint_is_near(fixedpoint_log2(fixedpoint_create_from_hex("0.0000000000000003")),
+                              "-3e.6a3fe5c60429786", 1));
+    ASSERT(fixedpoint_is_near(fixedpoint_log(fixedpoint_create(2)), "0.b17217f7d1cf79ac", 1));
+    ASSERT(fixedpoint_is_near(fixedpoint_log(fixedpoint_create_from_hex("0.1")), "-2.c5c85fdf473de6af", 1));
+    ASSERT(fixedpoint_is_near(fixedpoint_log(objs->max), "2c.5c85fdf473de6af2", 1));
+    ASSERT(fixedpoint_is_near(fixedpoint_log(fixedpoint_create_from_hex("1.0000000000000001")),
+                              "0.0000000000000001", 1));
+    ASSERT(fixedpoint_is_near(fixedpoint_pow(fixedpoint_create_from_hex("1.8"), fixedpoint_create_from_hex("-3.4")),
+                              "0.448a35ec79b1886", 1));
+    ASSERT(fixedpoint_is_near(fixedpoint_pow(fixedpoint_create(12), fixedpoint_negate(objs->one)),
+                              "0.1555555555555555", 1));
+
+    // Integer powers of two and their logarithms are exact
+    for (int k = -64; k < 64; ++k)
+    {
+        Fixedpoint n = k < 0 ? fixedpoint_negate(fixedpoint_create((uint64_t)-k)) : fixedpoint_create((uint64_t)k);
+        Fixedpoint power = fixedpoint_exp2(n);
+        ASSERT(k >= 0 ? power.whole == 1UL << k && power.frac == 0 : power.whole == 0 && power.frac == 1UL << (64 + k));
+        ASSERT(fixedpoint_compare(fixedpoint_log2(power), n) == 0);
+    }
+
+    // Round trips stay within the error bounds
+    Fixedpoint vals[32], logs[32], back[32];
+    uint64_t state = 0x9e3779b97f4a7c15UL;
+    for (int i = 0; i < 32; ++i)
+    {
+        vals[i] = fixedpoint_create2(test_rand(&state) >> 48, test_rand(&state));
+    }
+    fixedpoint_log_batch(vals, logs, 32);
+    fixedpoint_exp_batch(logs, back, 32);
+    for (int i = 0; i < 32; ++i)
+    {
+        // The error of the logarithm is scaled by the value, below 2^16
+        Fixedpoint diff = fixedpoint_sub(back[i], vals[i]);
+        ASSERT(diff.whole == 0 && diff.frac <= (1UL << 17));
+        ASSERT(fixedpoint_compare(fixedpoint_exp(logs[i]), back[i]) == 0);
+    }
+    fixedpoint_log2_batch(vals, logs, 32);
+    fixedpoint_exp2_batch(logs, back, 32);
+    Fixedpoint halves[32];
+    for (int i = 0; i < 32; ++i)
+    {
+        halves[i] = objs->one_half;
+    }
+    fixedpoint_pow_batch(vals, halves, logs, 32);
+    for (int i = 0; i < 32; ++i)
+    {
+        Fixedpoint diff = fixedpoint_sub(back[i], vals[i]);
+        ASSERT(diff.whole == 0 && diff.frac <= (1UL << 17));
+        // x^0.5 is the square root, to within the bound for pow
+        diff = fixedpoint_sub(logs[i], fixedpoint_sqrt(vals[i], FIXEDPOINT_ROUND_NEAREST_EVEN));
+        ASSERT(diff.whole == 0 && diff.frac <= 1);
+    }
+
+    // Special values
+    ASSERT(fixedpoint_is_overflow_pos(fixedpoint_exp2(fixedpoint_create(64))));
+    ASSERT(fixedpoint_is_overflow_pos(fixedpoint_exp(fixedpoint_create(45))));
+    ASSERT(fixedpoint_is_zero(fixedpoint_exp(fixedpoint_negate(objs->max))));
+    ASSERT(fixedpoint_is_overflow_neg(fixedpoint_log(objs->zero)));
+    ASSERT(fixedpoint_is_err(fixedpoint_log2(fixedpoint_negate(objs->one))));
+    ASSERT(fixedpoint_is_err(fixedpoint_exp(objs->format_error)));
+    ASSERT(fixedpoint_compare(fixedpoint_pow(objs->zero, objs->zero), objs->one) == 0);
+    ASSERT(fixedpoint_is_zero(fixedpoint_pow(objs->zero, objs->one_half)));
+    ASSERT(fixedpoint_is_overflow_pos(fixedpoint_pow(objs->zero, fixedpoint_negate(objs->one))));
+    ASSERT(fixedpoint_is_overflow_pos(fixedpoint_pow(fixedpoint_create(2), fixedpoint_create(64))));
+    ASSERT(fixedpoint_is_err(fixedpoint_pow(fixedpoint_negate(objs->one), objs->one)));
+}
+
+void test_fixedpoint_trig(TestObjs *objs)
+{
+    // Exact results on every host: these are the exact values rounded to
+    // the nearest multiple of 2^-64
+    Fixedpoint s, c;
+    fixedpoint_sincos(objs->one, &s, &c);
+    ASSERT(fixedpoint_is_near(s, "0.d76aa47848677021", 0) && fixedpoint_is_near(c, "0.8a51407da8345c92", 0));
+    fixedpoint_sincos(fixedpoint_create_from_hex("-0.8"), &s, &c);
+    ASSERT(fixedpoint_is_near(s, "-0.7abba1d12c17bfa2", 0) && fixedpoint_is_near(c, "0.e0a94032dbea7cee", 0));
+    ASSERT(fixedpoint_is_near(fixedpoint_sin(fixedpoint_create(100)), "-0.81a12dbc626dc038", 0));
+    ASSERT(fixedpoint_is_near(fixedpoint_cos(fixedpoint_create(100)), "0.dcc0edfb32fefb2", 0));
+
+    // The reduction is exact for the largest angles and near multiples of pi
+    ASSERT(fixedpoint_is_near(fixedpoint_sin(objs->max), "0.060a8d4c461e4f4a", 0));
+    ASSERT(fixedpoint_is_near(fixedpoint_cos(objs->max), "-0.ffedbfd1ff1a6a7a", 0));
+    Fixedpoint pi = fixedpoint_create_from_hex("3.243f6a8885a308d3");
+    ASSERT(fixedpoint_is_zero(fixedpoint_sin(pi)));
+    ASSERT(fixedpoint_is_near(fixedpoint_cos(pi), "-1", 0));
+    ASSERT(fixedpoint_is_zero(fixedpoint_sin(objs->zero)));
+    ASSERT(fixedpoint_is_near(fixedpoint_cos(objs->zero), "1", 0));
+    Fixedpoint ulp = fixedpoint_create2(0, 1);
+    ASSERT(fixedpoint_compare(fixedpoint_sin(ulp), ulp) == 0);
+
+    ASSERT(fixedpoint_is_near(fixedpoint_atan2(objs->one, objs->one), "0.c90fdaa22168c235", 0));
+    ASSERT(fixedpoint_is_near(fixedpoint_atan2(objs->one, fixedpoint_negate(objs->one)), "2.5b2f8fe6643a469e", 0));
+    ASSERT(fixedpoint_is_near(fixedpoint_atan2(fixedpoint_create_from_hex("-2"), fixedpoint_create_from_hex("-1")),
+                              "-2.08d15159c9bec20c", 0));
+    ASSERT(fixedpoint_is_near(fixedpoint_atan2(fixedpoint_create_from_hex("0.5"), fixedpoint_create(3)),
+                              "0.1a922283d69a9bca", 0));
+    ASSERT(fixedpoint_is_near(fixedpoint_atan2(objs->one, objs->zero), "1.921fb54442d1846a", 0));
+    ASSERT(fixedpoint_is_near(fixedpoint_atan2(objs->zero, fixedpoint_negate(objs->one)), "3.243f6a8885a308d3", 0));
+    ASSERT(fixedpoint_is_zero(fixedpoint_atan2(objs->zero, objs->zero)));
+    ASSERT(fixedpoint_is_err(fixedpoint_sin(objs->format_error)));
+    ASSERT(fixedpoint_is_err(fixedpoint_atan2(objs->one, objs->overflow_positive)));
+
+    // sin is odd, sin^2 + cos^2 is 1, and atan2 inverts sincos for angles
+    // in [-pi, pi]
+    Fixedpoint angles[32], sines[32], cosines[32], back[32];
+    uint64_t state = 0x0123456789abcdefUL;
+    for (int i = 0; i < 32; ++i)
+    {
+        angles[i] = fixedpoint_create2(test_rand(&state) % 3, test_rand(&state));
+        if (i % 2)
+        {
+            angles[i] = fixedpoint_negate(angles[i]);
+        }
+    }
+    fixedpoint_sincos_batch(angles, sines, cosines, 32);
+    fixedpoint_atan2_batch(sines, cosines, back, 32);
+    for (int i = 0; i < 32; ++i)
+    {
+        ASSERT(fixedpoint_compare(fixedpoint_sin(fixedpoint_negate(angles[i])), fixedpoint_negate(sines[i])) == 0);
+        Fixedpoint sum = fixedpoint_add(fixedpoint_mul_round(sines[i], sines[i], FIXEDPOINT_ROUND_NEAREST_EVEN),
+                                        fixedpoint_mul_round(cosines[i], cosines[i], FIXEDPOINT_ROUND_NEAREST_EVEN));
+        Fixedpoint diff = fixedpoint_sub(sum, objs->one);
+        ASSERT(diff.whole == 0 && diff.frac <= 4);
+        diff = fixedpoint_sub(back[i], angles[i]);
+        ASSERT(diff.whole == 0 && diff.frac <= 4);
+    }
+    fixedpoint_sin_batch(angles, sines, 32);
+    fixedpoint_cos_batch(angles, back, 32);
+    for (int i = 0; i < 32; ++i)
+    {
+        ASSERT(fixedpoint_compare(sines[i], fixedpoint_sin(angles[i])) == 0);
+        ASSERT(fixedpoint_compare(back[i], cosines[i]) == 0);
+    }
+}
+
+void test_fixedpoint_curve(TestObjs *objs)
+{
+    FixedpointCurve curve, uniform;
+    Fixedpoint xs[5] = {fixedpoint_create(0), fixedpoint_create(2), fixedpoint_create(3), fixedpoint_create(5),
+                        fixedpoint_create(8)};
+    Fixedpoint ys[5] = {fixedpoint_create(1), fixedpoint_create(3), fixedpoint_create(0), fixedpoint_create(0),
+                        fixedpoint_negate(fixedpoint_create(3))};
+
+    // Linear interpolation, exact at knots and flat outside them
+    ASSERT(fixedpoint_curve_init(&curve, xs, ys, 5, FIXEDPOINT_CURVE_LINEAR));
+    ASSERT(fixedpoint_is_near(fixedpoint_curve_eval(&curve, objs->one), "2", 0));
+    ASSERT(fixedpoint_is_near(fixedpoint_curve_eval(&curve, fixedpoint_create_from_hex("2.8")), "1.8", 0));
+    ASSERT(fixedpoint_is_near(fixedpoint_curve_eval(&curve, fixedpoint_create_from_hex("6.8")), "-1.8", 0));
+    ASSERT(fixedpoint_is_near(fixedpoint_curve_eval(&curve, fixedpoint_create(6)), "-1", 1));
+    ASSERT(fixedpoint_is_near(fixedpoint_curve_eval(&curve, fixedpoint_negate(objs->max)), "1", 0));
+    ASSERT(fixedpoint_is_near(fixedpoint_curve_eval(&curve, objs->max), "-3", 0));
+    for (int i = 0; i < 5; ++i)
+    {
+        ASSERT(fixedpoint_compare(fixedpoint_curve_eval(&curve, xs[i]), ys[i]) == 0);
+    }
+    ASSERT(fixedpoint_is_err(fixedpoint_curve_eval(&curve, objs->format_error)));
+    fixedpoint_curve_destroy(&curve);
+
+    // Cubic interpolation goes through the knots, reproduces straight
+    // lines, and stays within the range of the knots of each segment
+    ASSERT(fixedpoint_curve_init(&curve, xs, ys, 5, FIXEDPOINT_CURVE_CUBIC));
+    for (int i = 0; i < 5; ++i)
+    {
+        ASSERT(fixedpoint_compare(fixedpoint_curve_eval(&curve, xs[i]), ys[i]) == 0);
+    }
+    Fixedpoint x = objs->zero, step = fixedpoint_create_from_hex("0.01");
+    for (int i = 0; i < 0x800; ++i, x = fixedpoint_add(x, step))
+    {
+        Fixedpoint y = fixedpoint_curve_eval(&curve, x);
+        int seg = i < 0x200 ? 0 : i < 0x300 ? 1 : i < 0x500 ? 2 : 3;
+        Fixedpoint low = fixedpoint_compare(ys[seg], ys[seg + 1]) < 0 ? ys[seg] : ys[seg + 1];
+        Fixedpoint high = fixedpoint_compare(ys[seg], ys[seg + 1]) < 0 ? ys[seg + 1] : ys[seg];
+        ASSERT(fixedpoint_compare(y, low) >= 0 && fixedpoint_compare(y, high) <= 0);
+    }
+    ASSERT(fixedpoint_is_zero(fixedpoint_curve_eval(&curve, fixedpoint_create(4))));
+    fixedpoint_curve_destroy(&curve);
+    Fixedpoint line[3] = {fixedpoint_create(1), fixedpoint_create(3), fixedpoint_create(5)};
+    ASSERT(fixedpoint_curve_init(&curve, xs, line, 2, FIXEDPOINT_CURVE_CUBIC));
+    ASSERT(fixedpoint_is_near(fixedpoint_curve_eval(&curve, fixedpoint_create_from_hex("0.3")), "1.3", 1));
+    fixedpoint_curve_destroy(&curve);
+
+    // A uniform curve gives the same results as the same knots searched
+    Fixedpoint squares[17], knots[17];
+    for (int i = 0; i < 17; ++i)
+    {
+        squares[i] = fixedpoint_create((uint64_t)(i * i));
+        knots[i] = fixedpoint_add(fixedpoint_create2(1, 0), fixedpoint_create2((uint64_t)i / 4, (uint64_t)(i % 4) << 62));
+    }
+    FixedpointCurveKind kinds[2] = {FIXEDPOINT_CURVE_LINEAR, FIXEDPOINT_CURVE_CUBIC};
+    for (int k = 0; k < 2; ++k)
+    {
+        ASSERT(fixedpoint_curve_init_uniform(&uniform, objs->one, -2, squares, 17, kinds[k]));
+        ASSERT(fixedpoint_curve_init(&curve, knots, squares, 17, kinds[k]));
+        Fixedpoint args[64], expected[64], actual[64];
+        uint64_t state = 0x5deece66dUL;
+        for (int i = 0; i < 64; ++i)
+        {
+            args[i] = fixedpoint_create2(test_rand(&state) % 7, test_rand(&state));
+        }
+        fixedpoint_curve_eval_batch(&curve, args, expected, 64);
+        fixedpoint_curve_eval_batch(&uniform, args, actual, 64);
+        for (int i = 0; i < 64; ++i)
+        {
+            ASSERT(fixedpoint_compare(actual[i], expected[i]) == 0);
+        }
+        fixedpoint_curve_destroy(&curve);
+        fixedpoint_curve_destroy(&uniform);
+    }
+    ASSERT(fixedpoint_curve_init_uniform(&uniform, objs->one, -2, squares, 17, FIXEDPOINT_CURVE_LINEAR));
+    ASSERT(fixedpoint_is_near(fixedpoint_curve_eval(&uniform, fixedpoint_create_from_hex("1.2")), "0.8", 0));
+    fixedpoint_curve_destroy(&uniform);
+
+    // Knots that are out of order or out of range are rejected
+    ASSERT(!fixedpoint_curve_init(&curve, xs, ys, 0, FIXEDPOINT_CURVE_LINEAR));
+    Fixedpoint bad[2] = {fixedpoint_create(2), fixedpoint_create(2)};
+    ASSERT(!fixedpoint_curve_init(&curve, bad, ys, 2, FIXEDPOINT_CURVE_LINEAR));
+    bad[1] = fixedpoint_create(FIXEDPOINT_CURVE_MAX_WHOLE);
+    ASSERT(!fixedpoint_curve_init(&curve, bad, ys, 2, FIXEDPOINT_CURVE_LINEAR));
+    ASSERT(!fixedpoint_curve_init_uniform(&curve, objs->zero, 55, ys, 3, FIXEDPOINT_CURVE_LINEAR));
+    ASSERT(!fixedpoint_curve_init_uniform(&curve, objs->zero, 60, ys, 1, FIXEDPOINT_CURVE_LINEAR));
+}
+
+void test_fixedpoint_poly(TestObjs *objs)
+{
+    Fixedpoint coeffs[3] = {objs->one, fixedpoint_create(2), fixedpoint_create(3)};
+    Fixedpoint half_neg = fixedpoint_negate(objs->one_half);
+
+    // Exact results are tagged valid even with FIXEDPOINT_ROUND_EXACT
+    Fixedpoint result = fixedpoint_poly_eval(coeffs, 3, objs->one_half, FIXEDPOINT_ROUND_EXACT);
+    ASSERT(fixedpoint_is_near(result, "2.c", 0));
+    ASSERT(fixedpoint_is_near(fixedpoint_poly_eval(coeffs, 3, half_neg, FIXEDPOINT_ROUND_EXACT), "0.c", 0));
+    ASSERT(fixedpoint_is_near(fixedpoint_poly_eval(coeffs, 1, objs->max, FIXEDPOINT_ROUND_EXACT), "1", 0));
+    ASSERT(fixedpoint_is_near(fixedpoint_poly_eval(coeffs, 2, half_neg, FIXEDPOINT_ROUND_EXACT), "0", 0));
+    ASSERT(fixedpoint_is_zero(fixedpoint_poly_eval(coeffs, 0, objs->one, FIXEDPOINT_ROUND_EXACT)));
+
+    // x^2 for the smallest x is below the resolution of the result
+    Fixedpoint square[3] = {objs->zero, objs->zero, objs->one};
+    Fixedpoint ulp = fixedpoint_create2(0, 1);
+    ASSERT(fixedpoint_is_underflow_pos(fixedpoint_poly_eval(square, 3, ulp, FIXEDPOINT_ROUND_EXACT)));
+    ASSERT(fixedpoint_is_zero(fixedpoint_poly_eval(square, 3, ulp, FIXEDPOINT_ROUND_NEAREST_EVEN)));
+    ASSERT(fixedpoint_is_near(fixedpoint_poly_eval(square, 3, ulp, FIXEDPOINT_ROUND_CEILING), "0.0000000000000001", 0));
+
+    // With many coefficients the terms no longer fit on the stack:
+    // 1 + 1/2 + ... + 1/2^69 = 2 - 2^-69
+    Fixedpoint ones[70];
+    for (int i = 0; i < 70; ++i)
+    {
+        ones[i] = objs->one;
+    }
+    ASSERT(fixedpoint_is_underflow_pos(fixedpoint_poly_eval(ones, 70, objs->one_half, FIXEDPOINT_ROUND_EXACT)));
+    ASSERT(fixedpoint_is_near(fixedpoint_poly_eval(ones, 70, objs->one_half, FIXEDPOINT_ROUND_NEAREST_EVEN), "2", 0));
+    ASSERT(fixedpoint_is_near(fixedpoint_poly_eval(ones, 70, objs->one_half, FIXEDPOINT_ROUND_TRUNCATE),
+                              "1.ffffffffffffffff", 0));
+
+    // Overflow of the result, and invalid coefficients or arguments
+    ASSERT(fixedpoint_is_overflow_pos(fixedpoint_poly_eval(square, 3, fixedpoint_create(1UL << 32),
+                                                           FIXEDPOINT_ROUND_NEAREST_EVEN)));
+    square[2] = fixedpoint_negate(objs->one);
+    ASSERT(fixedpoint_is_overflow_neg(fixedpoint_poly_eval(square, 3, fixedpoint_create(1UL << 32),
+                                                           FIXEDPOINT_ROUND_NEAREST_EVEN)));
+    ASSERT(fixedpoint_is_err(fixedpoint_poly_eval(coeffs, 3, objs->format_error, FIXEDPOINT_ROUND_NEAREST_EVEN)));
+    coeffs[1] = objs->overflow_positive;
+    ASSERT(fixedpoint_is_err(fixedpoint_poly_eval(coeffs, 3, objs->one, FIXEDPOINT_ROUND_NEAREST_EVEN)));
+
+    // Random polynomials agree with Horner's rule to within its rounding
+    // error, and the batch version with the single one
+    uint64_t state = 0x2545f4914f6cdd1dUL;
+    Fixedpoint poly[13], args[11], batch[11];
+    for (int trial = 0; trial < 8; ++trial)
+    {
+        for (int i = 0; i < 13; ++i)
+        {
+            poly[i] = fixedpoint_create2(0, test_rand(&state));
+            if (test_rand(&state) & 1)
+            {
+                poly[i] = fixedpoint_negate(poly[i]);
+            }
+        }
+        for (int i = 0; i < 11; ++i)
+        {
+            args[i] = fixedpoint_create2(0, test_rand(&state));
+            if (i % 2)
+            {
+                args[i] = fixedpoint_negate(args[i]);
+            }
+        }
+        args[5] = objs->format_error;
+        fixedpoint_poly_eval_batch(poly, 13, args, FIXEDPOINT_ROUND_NEAREST_EVEN, batch, 11);
+        for (int i = 0; i < 11; ++i)
+        {
+            Fixedpoint single = fixedpoint_poly_eval(poly, 13, args[i], FIXEDPOINT_ROUND_NEAREST_EVEN);
+            ASSERT(fixedpoint_compare(batch[i], single) == 0 && batch[i].tag == single.tag);
+            if (i == 5)
+            {
+                ASSERT(fixedpoint_is_err(single));
+                continue;
+            }
+            Fixedpoint horner = poly[12];
+            for (int j = 11; j >= 0; --j)
+            {
+                horner = fixedpoint_add(fixedpoint_mul_round(horner, args[i], FIXEDPOINT_ROUND_NEAREST_EVEN), poly[j]);
+            }
+            Fixedpoint diff = fixedpoint_sub(single, horner);
+            ASSERT(fixedpoint_is_valid(single) && diff.whole == 0 && diff.frac <= 13);
+        }
+    }
+}
+
+// The product of row i of a and column j of b with a naive loop over
+// Fixedpoint256 values
+static Fixedpoint naive_dot(const Fixedpoint *a, const Fixedpoint *b, size_t i, size_t j, size_t n, size_t k,
+                            FixedpointRound mode)
+{
+    Fixedpoint256 sum = fixedpoint256_create(0);
+    for (size_t l = 0; l < k; ++l)
+    {
+        Fixedpoint256 left = fixedpoint256_from_fixedpoint(a[i * k + l]);
+        Fixedpoint256 right = fixedpoint256_from_fixedpoint(b[l * n + j]);
+        sum = fixedpoint256_add(sum, fixedpoint256_mul(left, right, FIXEDPOINT_ROUND_EXACT));
+    }
+    return fixedpoint256_to_fixedpoint(sum, mode);
+}
+
+void test_fixedpoint_matrix(TestObjs *objs)
+{
+    // Sizes that leave partial panels and tiles and span several blocks of
+    // terms
+    enum { M = 37, N = 35, K = 133 };
+    Fixedpoint *a = malloc(M * K * sizeof(Fixedpoint));
+    Fixedpoint *b = malloc(K * N * sizeof(Fixedpoint));
+    Fixedpoint *c = malloc(M * N * sizeof(Fixedpoint));
+    Fixedpoint *y = malloc(M * sizeof(Fixedpoint));
+    uint64_t state = 0x9e3779b97f4a7c15UL;
+    for (size_t i = 0; i < M * K; ++i)
+    {
+        a[i] = fixedpoint_create2(test_rand(&state) % 1000, test_rand(&state));
+        if (test_rand(&state) & 1)
+        {
+            a[i] = fixedpoint_negate(a[i]);
+        }
+    }
+    for (size_t i = 0; i < K * N; ++i)
+    {
+        b[i] = fixedpoint_create2(test_rand(&state) >> 40, test_rand(&state));
+        if (test_rand(&state) & 1)
+        {
+            b[i] = fixedpoint_negate(b[i]);
+        }
+    }
+
+    FixedpointRound modes[3] = {FIXEDPOINT_ROUND_NEAREST_EVEN, FIXEDPOINT_ROUND_FLOOR, FIXEDPOINT_ROUND_EXACT};
+    unsigned threads[3] = {1, 3, 64};
+    for (int t = 0; t < 3; ++t)
+    {
+        ASSERT(fixedpoint_gemm(a, b, c, M, N, K, modes[t], threads[t]));
+        for (size_t i = 0; i < M; ++i)
+        {
+            for (size_t j = 0; j < N; ++j)
+            {
+                Fixedpoint expected = naive_dot(a, b, i, j, N, K, modes[t]);
+                ASSERT(fixedpoint_compare(c[i * N + j], expected) == 0 && c[i * N + j].tag == expected.tag);
+            }
+        }
+
+        // The vector is column 0 of b
+        Fixedpoint x[K];
+        for (size_t l = 0; l < K; ++l)
+        {
+            x[l] = b[l * N];
+        }
+        ASSERT(fixedpoint_gemv(a, x, y, M, K, modes[t], threads[t]));
+        for (size_t i = 0; i < M; ++i)
+        {
+            Fixedpoint expected = naive_dot(a, x, i, 0, 1, K, modes[t]);
+            ASSERT(fixedpoint_compare(y[i], expected) == 0 && y[i].tag == expected.tag);
+        }
+    }
+
+    // Sums of large products that cancel are exact; an element out of range
+    // overflows, and invalid values make their row and column errors
+    Fixedpoint big[4] = {objs->max, objs->max, objs->max, fixedpoint_negate(objs->max)};
+    Fixedpoint out[4];
+    ASSERT(fixedpoint_gemm(big, big, out, 2, 2, 2, FIXEDPOINT_ROUND_EXACT, 1));
+    ASSERT(fixedpoint_is_overflow_pos(out[0]));
+    ASSERT(fixedpoint_is_zero(out[1]) && fixedpoint_is_valid(out[1]));
+    ASSERT(fixedpoint_is_overflow_pos(out[3]));
+    big[1] = objs->format_error;
+    ASSERT(fixedpoint_gemm(big, big, out, 2, 2, 2, FIXEDPOINT_ROUND_EXACT, 1));
+    ASSERT(fixedpoint_is_err(out[0]) && fixedpoint_is_err(out[1]) && fixedpoint_is_err(out[3]));
+    ASSERT(fixedpoint_is_zero(out[2]) && fixedpoint_is_valid(out[2]));
+    ASSERT(fixedpoint_gemv(big, big, out, 2, 2, FIXEDPOINT_ROUND_EXACT, 2));
+    ASSERT(fixedpoint_is_err(out[0]) && fixedpoint_is_err(out[1]));
+
+    // With no terms the product is 0
+    ASSERT(fixedpoint_gemm(a, b, c, 2, 2, 0, FIXEDPOINT_ROUND_EXACT, 1));
+    ASSERT(fixedpoint_is_zero(c[0]) && fixedpoint_is_zero(c[3]));
+
+    free(a);
+    free(b);
+    free(c);
+    free(y);
+}
+
+// Scale a transform result by 2^exponent
+static Fixedpoint fft_rescale(Fixedpoint val, int exponent)
+{
+    return exponent >= 0 ? fixedpoint_shl(val, (unsigned)exponent)
+                         : fixedpoint_shr(val, (unsigned)-exponent, FIXEDPOINT_ROUND_NEAREST_EVEN, NULL);
+}
+
+void test_fixedpoint_fft(TestObjs *objs)
+{
+    FixedpointFft fft;
+    ASSERT(!fixedpoint_fft_init(&fft, 0));
+    ASSERT(!fixedpoint_fft_init(&fft, 12));
+
+    // Small values are shifted left to use the full precision
+    ASSERT(fixedpoint_fft_init(&fft, 8));
+    FixedpointComplex data[16];
+    int exponent;
+    for (int i = 0; i < 8; ++i)
+    {
+        data[i].re = fixedpoint_create((uint64_t)i + 1);
+        data[i].im = objs->zero;
+    }
+    ASSERT(fixedpoint_fft_forward(&fft, data, &exponent));
+    ASSERT(exponent == -56);
+    ASSERT(fixedpoint_is_near(data[0].re, "2400000000000000", 0) && fixedpoint_is_zero(data[0].im));
+    ASSERT(fixedpoint_is_near(fft_rescale(data[1].re, exponent), "-4", 0));
+    ASSERT(fixedpoint_is_near(fft_rescale(data[1].im, exponent), "9.a827999fcef32423", 0));
+    ASSERT(fixedpoint_is_near(fft_rescale(data[2].re, exponent), "-4", 0));
+    ASSERT(fixedpoint_is_near(fft_rescale(data[2].im, exponent), "4", 0));
+    ASSERT(fixedpoint_is_near(fft_rescale(data[4].re, exponent), "-4", 0) && fixedpoint_is_zero(data[4].im));
+    ASSERT(fixedpoint_is_near(fft_rescale(data[7].im, exponent), "-9.a827999fcef32423", 0));
+
+    // The inverse transform includes the factor 1/8 in its exponent, and
+    // the exponents of the two transforms add
+    int forward_exponent = exponent;
+    ASSERT(fixedpoint_fft_inverse(&fft, data, &exponent));
+    ASSERT(exponent == -1);
+    for (int i = 0; i < 8; ++i)
+    {
+        Fixedpoint val = fft_rescale(data[i].re, forward_exponent + exponent);
+        ASSERT(fixedpoint_compare(val, fixedpoint_create((uint64_t)i + 1)) == 0);
+        ASSERT(fixedpoint_is_zero(fft_rescale(data[i].im, forward_exponent + exponent)));
+    }
+
+    // A value that is not valid leaves the data unchanged
+    Fixedpoint saved = data[3].re;
+    data[5].im = objs->overflow_positive;
+    ASSERT(!fixedpoint_fft_forward(&fft, data, &exponent));
+    ASSERT(fixedpoint_compare(data[3].re, saved) == 0);
+    fixedpoint_fft_destroy(&fft);
+
+    // The largest values are halved as often as needed, and the results are
+    // the same on every platform
+    ASSERT(fixedpoint_fft_init(&fft, 16));
+    for (int i = 0; i < 16; ++i)
+    {
+        data[i].re = objs->max;
+        data[i].im = objs->zero;
+    }
+    data[3].im = fixedpoint_negate(objs->max);
+    ASSERT(fixedpoint_fft_forward(&fft, data, &exponent));
+    ASSERT(exponent == 6);
+    ASSERT(fixedpoint_is_near(data[0].re, "3fffffffffffffff.fffffffffffffffc", 0));
+    ASSERT(fixedpoint_is_near(data[0].im, "-3ffffffffffffff.ffffffffffffffff", 0));
+    ASSERT(fixedpoint_is_near(data[1].re, "-3b20d79e651a8c5.15f98408c6b07585", 0));
+    ASSERT(fixedpoint_is_near(data[2].re, "-2d413cccfe77992.1165f626cdd52afa", 0));
+    ASSERT(fixedpoint_is_near(data[2].im, "2d413cccfe77992.1165f626cdd52afa", 0));
+    ASSERT(fixedpoint_is_near(data[3].im, "3b20d79e651a8c5.15f98408c6b07585", 0));
+    fixedpoint_fft_destroy(&fft);
+}
+
+void test_fixedpoint_convolve(TestObjs *objs)
+{
+    // (1 + 2z)(1 + iz) = 1 + (2 + i)z + 2iz^2, exactly
+    FixedpointComplex x[3] = {{objs->one, objs->zero}, {fixedpoint_create(2), objs->zero}, {objs->one, objs->zero}};
+    FixedpointComplex h[2] = {{objs->one, objs->zero}, {objs->zero, objs->one}};
+    FixedpointComplex out[40];
+    ASSERT(fixedpoint_convolve_direct(x, 2, h, 2, out, FIXEDPOINT_ROUND_EXACT));
+    ASSERT(fixedpoint_is_near(out[0].re, "1", 0) && fixedpoint_is_zero(out[0].im));
+    ASSERT(fixedpoint_is_near(out[1].re, "2", 0) && fixedpoint_is_near(out[1].im, "1", 0));
+    ASSERT(fixedpoint_is_zero(out[2].re) && fixedpoint_is_near(out[2].im, "2", 0));
+    ASSERT(fixedpoint_is_valid(out[2].re));
+
+    // Only the elements that depend on a value that is not valid are errors
+    x[1].im = objs->format_error;
+    ASSERT(fixedpoint_convolve_direct(x, 3, h, 2, out, FIXEDPOINT_ROUND_EXACT));
+    ASSERT(fixedpoint_is_valid(out[0].re) && fixedpoint_is_err(out[1].re) && fixedpoint_is_err(out[2].im));
+    ASSERT(fixedpoint_is_near(out[3].im, "1", 0));
+
+    // Convolution with transforms agrees with the direct one
+    FixedpointComplex a[21], b[13];
+    uint64_t state = 0x853c49e6748fea9bUL;
+    for (int i = 0; i < 21; ++i)
+    {
+        a[i].re = fixedpoint_create2(0, test_rand(&state));
+        a[i].im = fixedpoint_negate(fixedpoint_create2(test_rand(&state) % 4, test_rand(&state)));
+    }
+    for (int i = 0; i < 13; ++i)
+    {
+        b[i].re = fixedpoint_negate(fixedpoint_create2(0, test_rand(&state)));
+        b[i].im = fixedpoint_create2(test_rand(&state) % 1000, test_rand(&state));
+    }
+    FixedpointComplex direct[33];
+    FixedpointFft fft;
+    int exponent;
+    ASSERT(fixedpoint_fft_init(&fft, 32));
+    ASSERT(!fixedpoint_convolve_fft(&fft, a, 21, b, 14, out, &exponent));
+    ASSERT(fixedpoint_convolve_fft(&fft, a, 21, b, 12, out, &exponent));
+    ASSERT(fixedpoint_convolve_direct(a, 21, b, 12, direct, FIXEDPOINT_ROUND_NEAREST_EVEN));
+    for (int k = 0; k < 32; ++k)
+    {
+        Fixedpoint diff_re = fixedpoint_sub(fft_rescale(out[k].re, exponent), direct[k].re);
+        Fixedpoint diff_im = fixedpoint_sub(fft_rescale(out[k].im, exponent), direct[k].im);
+        ASSERT(diff_re.whole == 0 && diff_re.frac <= 1);
+        ASSERT(diff_im.whole == 0 && diff_im.frac <= 1);
+    }
+    fixedpoint_fft_destroy(&fft);
+}
+
+// The exact sum of the products of coefficients and values, rounded once
+static Fixedpoint naive_filter_sum(const Fixedpoint *coeffs, const Fixedpoint *vals, size_t count,
+                                   FixedpointRound mode)
+{
+    Fixedpoint256 sum = fixedpoint256_create(0);
+    for (size_t i = 0; i < count; ++i)
+    {
+        sum = fixedpoint256_add(sum, fixedpoint256_mul(fixedpoint256_from_fixedpoint(coeffs[i]),
+                                                       fixedpoint256_from_fixedpoint(vals[i]),
+                                                       FIXEDPOINT_ROUND_EXACT));
+    }
+    return fixedpoint256_to_fixedpoint(sum, mode);
+}
+
+void test_fixedpoint_fir(TestObjs *objs)
+{
+    enum { TAPS = 23, CHANNELS = 5, FRAMES = 100 };
+    Fixedpoint coeffs[TAPS];
+    Fixedpoint in[FRAMES * CHANNELS];
+    Fixedpoint out[FRAMES * CHANNELS];
+    uint64_t state = 0x2545f4914f6cdd1dUL;
+    for (size_t i = 0; i < TAPS; ++i)
+    {
+        coeffs[i] = fixedpoint_create2(0, test_rand(&state));
+        if (test_rand(&state) & 1)
+        {
+            coeffs[i] = fixedpoint_negate(coeffs[i]);
+        }
+    }
+    for (size_t i = 0; i < FRAMES * CHANNELS; ++i)
+    {
+        in[i] = fixedpoint_create2(test_rand(&state) % 100, test_rand(&state));
+        if (test_rand(&state) & 1)
+        {
+            in[i] = fixedpoint_negate(in[i]);
+        }
+    }
+
+    FixedpointFir fir;
+    ASSERT(!fixedpoint_fir_init(&fir, coeffs, 0, 1, FIXEDPOINT_ROUND_EXACT, FIXEDPOINT_FILTER_TAG));
+    ASSERT(!fixedpoint_fir_init(&fir, coeffs, TAPS, 0, FIXEDPOINT_ROUND_EXACT, FIXEDPOINT_FILTER_TAG));
+    // the delay lines would not fit in memory
+    ASSERT(!fixedpoint_fir_init(&fir, coeffs, SIZE_MAX / 64, 4, FIXEDPOINT_ROUND_EXACT, FIXEDPOINT_FILTER_TAG));
+
+    FixedpointRound modes[2] = {FIXEDPOINT_ROUND_NEAREST_EVEN, FIXEDPOINT_ROUND_EXACT};
+    for (int t = 0; t < 2; ++t)
+    {
+        // Blocks of different lengths, some shorter than the filter, continue
+        // the same stream; the output overwrites the input
+        ASSERT(fixedpoint_fir_init(&fir, coeffs, TAPS, CHANNELS, modes[t], FIXEDPOINT_FILTER_TAG));
+        Fixedpoint block[FRAMES * CHANNELS];
+        memcpy(block, in, sizeof(in));
+        size_t lengths[4] = {7, 1, 40, 52};
+        size_t start = 0;
+        for (int b = 0; b < 4; ++b)
+        {
+            fixedpoint_fir_process(&fir, block + start * CHANNELS, block + start * CHANNELS, lengths[b]);
+            start += lengths[b];
+        }
+        for (size_t f = 0; f < FRAMES; ++f)
+        {
+            for (size_t c = 0; c < CHANNELS; ++c)
+            {
+                Fixedpoint window[TAPS];
+                for (size_t i = 0; i < TAPS; ++i)
+                {
+                    window[i] = i <= f ? in[(f - i) * CHANNELS + c] : objs->zero;
+                }
+                Fixedpoint expected = naive_filter_sum(coeffs, window, TAPS, modes[t]);
+                ASSERT(fixedpoint_compare(block[f * CHANNELS + c], expected) == 0);
+                ASSERT(block[f * CHANNELS + c].tag == expected.tag);
+            }
+        }
+        fixedpoint_fir_destroy(&fir);
+    }
+
+    // An invalid sample makes the outputs that depend on it errors, in its
+    // channel only; a reset clears the delay line
+    Fixedpoint taps2[2] = {objs->one, objs->one_half};
+    ASSERT(fixedpoint_fir_init(&fir, taps2, 2, 2, FIXEDPOINT_ROUND_EXACT, FIXEDPOINT_FILTER_TAG));
+    Fixedpoint samples[8] = {objs->one, objs->one, objs->format_error, objs->one,
+                             objs->one, objs->one, objs->one, objs->one};
+    fixedpoint_fir_process(&fir, samples, out, 4);
+    ASSERT(fixedpoint_compare(out[0], objs->one) == 0);
+    ASSERT(fixedpoint_is_err(out[2]) && fixedpoint_is_err(out[4]) && fixedpoint_is_valid(out[6]));
+    ASSERT(fixedpoint_compare(out[6], fixedpoint_create_from_hex("1.8")) == 0);
+    ASSERT(fixedpoint_compare(out[3], fixedpoint_create_from_hex("1.8")) == 0);
+    fixedpoint_fir_reset(&fir);
+    fixedpoint_fir_process(&fir, samples, out, 1);
+    ASSERT(fixedpoint_compare(out[0], objs->one) == 0);
+    fixedpoint_fir_destroy(&fir);
+
+    // Outputs out of range wrap and are tagged, or saturate
+    Fixedpoint big[2] = {objs->max, fixedpoint_negate(objs->max)};
+    Fixedpoint two = fixedpoint_create(2);
+    FixedpointFilterOverflow policies[2] = {FIXEDPOINT_FILTER_TAG, FIXEDPOINT_FILTER_SATURATE};
+    for (int p = 0; p < 2; ++p)
+    {
+        ASSERT(fixedpoint_fir_init(&fir, &two, 1, 2, FIXEDPOINT_ROUND_EXACT, policies[p]));
+        fixedpoint_fir_process(&fir, big, out, 1);
+        if (p == 0)
+        {
+            ASSERT(fixedpoint_is_overflow_pos(out[0]) && fixedpoint_is_overflow_neg(out[1]));
+        }
+        else
+        {
+            ASSERT(fixedpoint_compare(out[0], objs->max) == 0);
+            ASSERT(fixedpoint_compare(out[1], fixedpoint_negate(objs->max)) == 0);
+        }
+        fixedpoint_fir_destroy(&fir);
+    }
+}
+
+void test_fixedpoint_biquad(TestObjs *objs)
+{
+    enum { SECTIONS = 2, CHANNELS = 3, FRAMES = 60 };
+    Fixedpoint coeffs[5 * SECTIONS] = {
+        fixedpoint_create_from_hex("0.3"), fixedpoint_create_from_hex("0.6"), fixedpoint_create_from_hex("0.3"),
+        fixedpoint_create_from_hex("-0.c"), fixedpoint_create_from_hex("0.4"),
+        fixedpoint_create_from_hex("1.1"), fixedpoint_create_from_hex("-0.8"), fixedpoint_create_from_hex("0.1"),
+        fixedpoint_create_from_hex("0.4"), fixedpoint_create_from_hex("0.1"),
+    };
+    Fixedpoint in[FRAMES * CHANNELS];
+    Fixedpoint out[FRAMES * CHANNELS];
+    uint64_t state = 0x853c49e6748fea9bUL;
+    for (size_t i = 0; i < FRAMES * CHANNELS; ++i)
+    {
+        in[i] = fixedpoint_create2(test_rand(&state) % 16, test_rand(&state));
+        if (test_rand(&state) & 1)
+        {
+            in[i] = fixedpoint_negate(in[i]);
+        }
+    }
+
+    FixedpointBiquad bq;
+    ASSERT(!fixedpoint_biquad_init(&bq, coeffs, 0, 1, FIXEDPOINT_ROUND_EXACT, FIXEDPOINT_FILTER_TAG));
+    ASSERT(!fixedpoint_biquad_init(&bq, coeffs, SIZE_MAX / 64, 4, FIXEDPOINT_ROUND_EXACT, FIXEDPOINT_FILTER_TAG));
+
+    FixedpointRound modes[2] = {FIXEDPOINT_ROUND_NEAREST_EVEN, FIXEDPOINT_ROUND_FLOOR};
+    for (int t = 0; t < 2; ++t)
+    {
+        ASSERT(fixedpoint_biquad_init(&bq, coeffs, SECTIONS, CHANNELS, modes[t], FIXEDPOINT_FILTER_TAG));
+        fixedpoint_biquad_process(&bq, in, out, 25);
+        fixedpoint_biquad_process(&bq, in + 25 * CHANNELS, out + 25 * CHANNELS, FRAMES - 25);
+
+        // Each section rounds its output, which is fed back and passed on
+        for (size_t c = 0; c < CHANNELS; ++c)
+        {
+            Fixedpoint hist[SECTIONS + 1][2];
+            for (size_t k = 0; k <= SECTIONS; ++k)
+            {
+                hist[k][0] = hist[k][1] = objs->zero;
+            }
+            for (size_t f = 0; f < FRAMES; ++f)
+            {
+                Fixedpoint x = in[f * CHANNELS + c];
+                for (size_t k = 0; k < SECTIONS; ++k)
+                {
+                    Fixedpoint terms[5] = {x, hist[k][0], hist[k][1], fixedpoint_negate(hist[k + 1][0]),
+                                           fixedpoint_negate(hist[k + 1][1])};
+                    Fixedpoint y = naive_filter_sum(coeffs + 5 * k, terms, 5, modes[t]);
+                    hist[k][1] = hist[k][0];
+                    hist[k][0] = x;
+                    x = y;
+                }
+                hist[SECTIONS][1] = hist[SECTIONS][0];
+                hist[SECTIONS][0] = x;
+                ASSERT(fixedpoint_compare(out[f * CHANNELS + c], x) == 0);
+                ASSERT(out[f * CHANNELS + c].tag == x.tag);
+            }
+        }
+        fixedpoint_biquad_destroy(&bq);
+    }
+
+    // Inexact outputs are tagged with FIXEDPOINT_ROUND_EXACT, but keep their
+    // value
+    ASSERT(fixedpoint_biquad_init(&bq, coeffs, SECTIONS, CHANNELS, FIXEDPOINT_ROUND_EXACT, FIXEDPOINT_FILTER_TAG));
+    fixedpoint_biquad_process(&bq, in, out, FRAMES);
+    ASSERT(fixedpoint_is_underflow_pos(out[FRAMES * CHANNELS - 1]) ||
+           fixedpoint_is_underflow_neg(out[FRAMES * CHANNELS - 1]));
+    fixedpoint_biquad_destroy(&bq);
+
+    // An invalid sample fails its channel until a reset
+    ASSERT(fixedpoint_biquad_init(&bq, coeffs, 1, 2, FIXEDPOINT_ROUND_NEAREST_EVEN, FIXEDPOINT_FILTER_TAG));
+    Fixedpoint samples[4] = {objs->format_error, objs->one, objs->one, objs->one};
+    fixedpoint_biquad_process(&bq, samples, out, 2);
+    ASSERT(fixedpoint_is_err(out[0]) && fixedpoint_is_err(out[2]));
+    ASSERT(fixedpoint_compare(out[1], fixedpoint_create_from_hex("0.3")) == 0);
+    fixedpoint_biquad_reset(&bq);
+    fixedpoint_biquad_process(&bq, samples + 1, out, 1);
+    ASSERT(fixedpoint_compare(out[0], fixedpoint_create_from_hex("0.3")) == 0);
+    fixedpoint_biquad_destroy(&bq);
+
+    // An unstable filter overflows: with FIXEDPOINT_FILTER_TAG the channel
+    // fails, and with FIXEDPOINT_FILTER_SATURATE it stays at the limit
+    Fixedpoint unstable[5] = {objs->one, objs->zero, objs->zero, fixedpoint_negate(fixedpoint_create(2)),
+                              objs->zero};
+    Fixedpoint ones[70];
+    for (int i = 0; i < 70; ++i)
+    {
+        ones[i] = objs->one;
+    }
+    ASSERT(fixedpoint_biquad_init(&bq, unstable, 1, 1, FIXEDPOINT_ROUND_EXACT, FIXEDPOINT_FILTER_TAG));
+    fixedpoint_biquad_process(&bq, ones, out, 70);
+    ASSERT(fixedpoint_is_valid(out[62]) && fixedpoint_is_overflow_pos(out[64]) && fixedpoint_is_err(out[65]));
+    fixedpoint_biquad_destroy(&bq);
+    ASSERT(fixedpoint_biquad_init(&bq, unstable, 1, 1, FIXEDPOINT_ROUND_EXACT, FIXEDPOINT_FILTER_SATURATE));
+    fixedpoint_biquad_process(&bq, ones, out, 70);
+    ASSERT(fixedpoint_compare(out[64], objs->max) == 0 && fixedpoint_compare(out[69], objs->max) == 0);
+    fixedpoint_biquad_destroy(&bq);
+}
+
+void test_fixedpoint_rolling(TestObjs *objs)
+{
+    enum { WINDOW = 17, COUNT = 300 };
+    Fixedpoint samples[COUNT];
+    uint64_t state = 0x6a09e667f3bcc909UL;
+    for (size_t i = 0; i < COUNT; ++i)
+    {
+        samples[i] = fixedpoint_create2(test_rand(&state) % 8, test_rand(&state));
+        if (test_rand(&state) & 1)
+        {
+            samples[i] = fixedpoint_negate(samples[i]);
+        }
+    }
+
+    FixedpointRolling r;
+    ASSERT(!fixedpoint_rolling_init(&r, 0));
+    ASSERT(fixedpoint_rolling_init(&r, WINDOW));
+    ASSERT(fixedpoint_is_zero(fixedpoint_rolling_sum(&r)));
+    ASSERT(fixedpoint_is_err(fixedpoint_rolling_mean(&r, FIXEDPOINT_ROUND_EXACT)));
+    ASSERT(fixedpoint_is_err(fixedpoint_rolling_min(&r)));
+
+    // Compare against each window recomputed from scratch
+    for (size_t i = 0; i < COUNT; ++i)
+    {
+        fixedpoint_rolling_push(&r, samples[i]);
+        size_t first = i + 1 >= WINDOW ? i + 1 - WINDOW : 0;
+        Fixedpoint256 sum = fixedpoint256_create(0);
+        Fixedpoint min = samples[first];
+        Fixedpoint max = samples[first];
+        for (size_t j = first; j <= i; ++j)
+        {
+            sum = fixedpoint256_add(sum, fixedpoint256_from_fixedpoint(samples[j]));
+            min = fixedpoint_compare(samples[j], min) < 0 ? samples[j] : min;
+            max = fixedpoint_compare(samples[j], max) > 0 ? samples[j] : max;
+        }
+        ASSERT(fixedpoint_rolling_count(&r) == i + 1 - first);
+        ASSERT(fixedpoint_compare(fixedpoint_rolling_sum(&r), fixedpoint256_to_fixedpoint(sum, FIXEDPOINT_ROUND_EXACT)) == 0);
+        ASSERT(fixedpoint_compare(fixedpoint_rolling_min(&r), min) == 0);
+        ASSERT(fixedpoint_compare(fixedpoint_rolling_max(&r), max) == 0);
+
+        // The mean times the count is the sum, to within the rounding
+        Fixedpoint count = fixedpoint_create(i + 1 - first);
+        Fixedpoint floor = fixedpoint_rolling_mean(&r, FIXEDPOINT_ROUND_FLOOR);
+        Fixedpoint ceiling = fixedpoint_rolling_mean(&r, FIXEDPOINT_ROUND_CEILING);
+        Fixedpoint256 low = fixedpoint256_mul(fixedpoint256_from_fixedpoint(floor),
+                                              fixedpoint256_from_fixedpoint(count), FIXEDPOINT_ROUND_EXACT);
+        Fixedpoint256 high = fixedpoint256_mul(fixedpoint256_from_fixedpoint(ceiling),
+                                               fixedpoint256_from_fixedpoint(count), FIXEDPOINT_ROUND_EXACT);
+        ASSERT(fixedpoint256_compare(low, sum) <= 0 && fixedpoint256_compare(sum, high) <= 0);
+        Fixedpoint exact = fixedpoint_rolling_mean(&r, FIXEDPOINT_ROUND_EXACT);
+        ASSERT(fixedpoint_compare(floor, ceiling) == 0 ? fixedpoint_is_valid(exact)
+                                                       : !fixedpoint_is_valid(exact));
+    }
+
+    // Means round like other operations
+    fixedpoint_rolling_reset(&r);
+    fixedpoint_rolling_push(&r, fixedpoint_create2(0, 1));
+    fixedpoint_rolling_push(&r, objs->zero);
+    ASSERT(fixedpoint_is_zero(fixedpoint_rolling_mean(&r, FIXEDPOINT_ROUND_NEAREST_EVEN)));
+    ASSERT(fixedpoint_is_underflow_pos(fixedpoint_rolling_mean(&r, FIXEDPOINT_ROUND_EXACT)));
+    fixedpoint_rolling_push(&r, fixedpoint_create2(0, 2));
+    ASSERT(fixedpoint_rolling_mean(&r, FIXEDPOINT_ROUND_NEAREST_EVEN).frac == 1);
+
+    // Sums out of range overflow, but the mean is exact
+    fixedpoint_rolling_reset(&r);
+    fixedpoint_rolling_push(&r, objs->max);
+    fixedpoint_rolling_push(&r, objs->max);
+    ASSERT(fixedpoint_is_overflow_pos(fixedpoint_rolling_sum(&r)));
+    ASSERT(fixedpoint_compare(fixedpoint_rolling_mean(&r, FIXEDPOINT_ROUND_EXACT), objs->max) == 0);
+    ASSERT(fixedpoint_is_valid(fixedpoint_rolling_mean(&r, FIXEDPOINT_ROUND_EXACT)));
+    fixedpoint_rolling_destroy(&r);
+
+    // An invalid sample makes the results errors until it leaves the window
+    ASSERT(fixedpoint_rolling_init(&r, 2));
+    fixedpoint_rolling_push(&r, objs->one);
+    fixedpoint_rolling_push(&r, objs->format_error);
+    ASSERT(fixedpoint_is_err(fixedpoint_rolling_sum(&r)) && fixedpoint_is_err(fixedpoint_rolling_max(&r)));
+    fixedpoint_rolling_push(&r, objs->one_half);
+    ASSERT(fixedpoint_is_err(fixedpoint_rolling_min(&r)));
+    fixedpoint_rolling_push(&r, objs->one);
+    ASSERT(fixedpoint_compare(fixedpoint_rolling_sum(&r), fixedpoint_create_from_hex("1.8")) == 0);
+    ASSERT(fixedpoint_compare(fixedpoint_rolling_min(&r), objs->one_half) == 0);
+    fixedpoint_rolling_destroy(&r);
+}
+
+void test_fixedpoint_ema(TestObjs *objs)
+{
+    FixedpointEma ema;
+    ASSERT(!fixedpoint_ema_init(&ema, 65, FIXEDPOINT_ROUND_EXACT));
+
+    // With alpha = 1/4, the first sample is taken as is
+    ASSERT(fixedpoint_ema_init(&ema, 2, FIXEDPOINT_ROUND_EXACT));
+    ASSERT(fixedpoint_compare(fixedpoint_ema_update(&ema, fixedpoint_create(8)), fixedpoint_create(8)) == 0);
+    ASSERT(fixedpoint_compare(fixedpoint_ema_update(&ema, objs->zero), fixedpoint_create(6)) == 0);
+    ASSERT(fixedpoint_compare(fixedpoint_ema_update(&ema, fixedpoint_negate(fixedpoint_create(10))),
+                              fixedpoint_create_from_hex("2")) == 0);
+
+    // Inexact updates are tagged with FIXEDPOINT_ROUND_EXACT, and rounded
+    // with other modes
+    ASSERT(fixedpoint_ema_init(&ema, 1, FIXEDPOINT_ROUND_EXACT));
+    fixedpoint_ema_update(&ema, fixedpoint_create2(0, 1));
+    Fixedpoint avg = fixedpoint_ema_update(&ema, objs->zero);
+    ASSERT(fixedpoint_is_underflow_pos(avg) && avg.whole == 0 && avg.frac == 0);
+    ASSERT(fixedpoint_is_valid(ema.value));
+    ASSERT(fixedpoint_ema_init(&ema, 1, FIXEDPOINT_ROUND_CEILING));
+    fixedpoint_ema_update(&ema, fixedpoint_create2(0, 1));
+    ASSERT(fixedpoint_ema_update(&ema, objs->zero).frac == 1);
+
+    // Averages of samples far apart do not overflow
+    ASSERT(fixedpoint_ema_init(&ema, 1, FIXEDPOINT_ROUND_TRUNCATE));
+    fixedpoint_ema_update(&ema, objs->max);
+    avg = fixedpoint_ema_update(&ema, fixedpoint_negate(objs->max));
+    ASSERT(fixedpoint_is_zero(avg) && fixedpoint_is_valid(avg));
+
+    // An invalid sample fails the average
+    ASSERT(fixedpoint_is_err(fixedpoint_ema_update(&ema, objs->format_error)));
+    ASSERT(fixedpoint_is_err(fixedpoint_ema_update(&ema, objs->one)));
+}
+
+void test_fixedpoint_bars(TestObjs *objs)
+{
+    FixedpointBars bars;
+    FixedpointBar bar;
+    ASSERT(!fixedpoint_bars_init(&bars, 0));
+    ASSERT(fixedpoint_bars_init(&bars, 60));
+    ASSERT(!fixedpoint_bars_flush(&bars, &bar));
+
+    ASSERT(!fixedpoint_bars_push(&bars, 125, fixedpoint_create(5), &bar));
+    ASSERT(!fixedpoint_bars_push(&bars, 130, fixedpoint_create(7), &bar));
+    ASSERT(!fixedpoint_bars_push(&bars, 150, fixedpoint_create(3), &bar));
+    ASSERT(!fixedpoint_bars_push(&bars, 179, fixedpoint_create(4), &bar));
+    ASSERT(fixedpoint_bars_push(&bars, 180, objs->one, &bar));
+    ASSERT(bar.start == 120 && bar.count == 4);
+    ASSERT(fixedpoint_compare(bar.open, fixedpoint_create(5)) == 0);
+    ASSERT(fixedpoint_compare(bar.high, fixedpoint_create(7)) == 0);
+    ASSERT(fixedpoint_compare(bar.low, fixedpoint_create(3)) == 0);
+    ASSERT(fixedpoint_compare(bar.close, fixedpoint_create(4)) == 0);
+
+    // A gap of several buckets starts the next bar at its own bucket
+    ASSERT(fixedpoint_bars_push(&bars, 400, objs->format_error, &bar));
+    ASSERT(bar.start == 180 && bar.count == 1 && fixedpoint_compare(bar.high, objs->one) == 0);
+    ASSERT(!fixedpoint_bars_push(&bars, 410, objs->one, &bar));
+    ASSERT(fixedpoint_bars_flush(&bars, &bar));
+    ASSERT(bar.start == 360 && bar.count == 2 && fixedpoint_is_err(bar.open) && fixedpoint_is_err(bar.close));
+    ASSERT(!fixedpoint_bars_flush(&bars, &bar));
+}
+
+void test_fixedpoint_moments(TestObjs *objs)
+{
+    enum { COUNT = 1000, PARTS = 4 };
+    Fixedpoint vals[COUNT];
+    uint64_t state = 0xbb67ae8584caa73bUL;
+    for (size_t i = 0; i < COUNT; ++i)
+    {
+        vals[i] = fixedpoint_create2(100 + test_rand(&state) % 16, test_rand(&state));
+        if (i % 7 == 0)
+        {
+            vals[i] = fixedpoint_negate(vals[i]);
+        }
+    }
+
+    FixedpointMoments m;
+    fixedpoint_moments_init(&m);
+    ASSERT(fixedpoint_is_err(fixedpoint_moments_mean(&m, FIXEDPOINT_ROUND_EXACT)));
+    ASSERT(fixedpoint_is_err(fixedpoint_moments_variance(&m, FIXEDPOINT_ROUND_EXACT)));
+    fixedpoint_moments_update(&m, vals, COUNT);
+
+    // Partials merged in any order give the same results
+    FixedpointMoments parts[PARTS];
+    for (int p = 0; p < PARTS; ++p)
+    {
+        fixedpoint_moments_init(&parts[p]);
+        fixedpoint_moments_update(&parts[p], vals + p * (COUNT / PARTS), COUNT / PARTS);
+    }
+    FixedpointMoments merged;
+    fixedpoint_moments_init(&merged);
+    for (int p = PARTS; p-- > 0;)
+    {
+        fixedpoint_moments_merge(&merged, &parts[p]);
+    }
+    ASSERT(merged.count == COUNT);
+
+    // Compare against the definition, computed exactly from the mean
+    FixedpointRound modes[3] = {FIXEDPOINT_ROUND_NEAREST_EVEN, FIXEDPOINT_ROUND_FLOOR, FIXEDPOINT_ROUND_CEILING};
+    for (int t = 0; t < 3; ++t)
+    {
+        Fixedpoint mean = fixedpoint_moments_mean(&m, modes[t]);
+        ASSERT(fixedpoint_compare(mean, fixedpoint_moments_mean(&merged, modes[t])) == 0);
+        Fixedpoint var = fixedpoint_moments_variance(&m, modes[t]);
+        Fixedpoint svar = fixedpoint_moments_sample_variance(&merged, modes[t]);
+        ASSERT(fixedpoint_compare(var, fixedpoint_moments_variance(&merged, modes[t])) == 0);
+        ASSERT(fixedpoint_compare(var, svar) < 0);
+
+        // var * n lies within n ulps of the sum of squared deviations from
+        // the rounded mean, which differs from the exact one by less than
+        // an ulp
+        Fixedpoint256 deviations = fixedpoint256_create(0);
+        for (size_t i = 0; i < COUNT; ++i)
+        {
+            Fixedpoint256 d = fixedpoint256_sub(fixedpoint256_from_fixedpoint(vals[i]),
+                                                fixedpoint256_from_fixedpoint(mean));
+            deviations = fixedpoint256_add(deviations, fixedpoint256_mul(d, d, FIXEDPOINT_ROUND_EXACT));
+        }
+        Fixedpoint256 scaled = fixedpoint256_mul(fixedpoint256_from_fixedpoint(var),
+                                                 fixedpoint256_from_fixedpoint(fixedpoint_create(COUNT)),
+                                                 FIXEDPOINT_ROUND_EXACT);
+        Fixedpoint256 diff = fixedpoint256_sub(scaled, deviations);
+        Fixedpoint256 tolerance = fixedpoint256_from_fixedpoint(fixedpoint_create2(0, 2 * COUNT));
+        ASSERT(fixedpoint256_compare(fixedpoint256_is_neg(diff) ? fixedpoint256_negate(diff) : diff, tolerance) <= 0);
+    }
+    ASSERT(fixedpoint_compare(fixedpoint_moments_mean(&m, FIXEDPOINT_ROUND_FLOOR),
+                              fixedpoint_moments_mean(&m, FIXEDPOINT_ROUND_CEILING)) < 0);
+
+    // Small exact cases
+    Fixedpoint small[4] = {fixedpoint_create(2), fixedpoint_create(4), fixedpoint_create(4), fixedpoint_create(6)};
+    fixedpoint_moments_init(&m);
+    fixedpoint_moments_update(&m, small, 4);
+    ASSERT(fixedpoint_compare(fixedpoint_moments_mean(&m, FIXEDPOINT_ROUND_EXACT), fixedpoint_create(4)) == 0);
+    ASSERT(fixedpoint_compare(fixedpoint_moments_variance(&m, FIXEDPOINT_ROUND_EXACT), fixedpoint_create(2)) == 0);
+    Fixedpoint svar = fixedpoint_moments_sample_variance(&m, FIXEDPOINT_ROUND_EXACT);
+    ASSERT(fixedpoint_is_underflow_pos(svar) && svar.whole == 2 && svar.frac == 0xaaaaaaaaaaaaaaaaUL);
+    svar = fixedpoint_moments_sample_variance(&m, FIXEDPOINT_ROUND_NEAREST_EVEN);
+    ASSERT(fixedpoint_compare(svar, fixedpoint_create_from_hex("2.aaaaaaaaaaaaaaab")) == 0);
+    Fixedpoint three[3] = {objs->zero, objs->zero, objs->one};
+    fixedpoint_moments_init(&m);
+    fixedpoint_moments_update(&m, three, 3);
+    ASSERT(fixedpoint_is_underflow_pos(fixedpoint_moments_variance(&m, FIXEDPOINT_ROUND_EXACT)));
+    ASSERT(fixedpoint_moments_variance(&m, FIXEDPOINT_ROUND_NEAREST_EVEN).frac == 0x38e38e38e38e38e4UL);
+
+    // Extreme values do not overflow the sums; a variance out of range does
+    Fixedpoint extremes[2] = {objs->max, fixedpoint_negate(objs->max)};
+    fixedpoint_moments_init(&m);
+    fixedpoint_moments_update(&m, extremes, 2);
+    ASSERT(fixedpoint_is_zero(fixedpoint_moments_mean(&m, FIXEDPOINT_ROUND_EXACT)));
+    ASSERT(fixedpoint_is_overflow_pos(fixedpoint_moments_variance(&m, FIXEDPOINT_ROUND_EXACT)));
+    fixedpoint_moments_update(&m, extremes, 1);
+
+    // Invalid values are remembered
+    fixedpoint_moments_update(&m, &objs->overflow_positive, 1);
+    ASSERT(m.count == 3 && fixedpoint_is_overflow_pos(fixedpoint_moments_mean(&m, FIXEDPOINT_ROUND_EXACT)));
+    ASSERT(fixedpoint_is_overflow_pos(fixedpoint_moments_variance(&m, FIXEDPOINT_ROUND_EXACT)));
+}
+
+// The number of values below val and not above it, in a sorted array
+static void test_rank(const Fixedpoint *sorted, size_t count, Fixedpoint val, size_t *below, size_t *upto)
+{
+    *below = 0;
+    while (*below < count && fixedpoint_compare(sorted[*below], val) < 0)
+    {
+        ++*below;
+    }
+    *upto = *below;
+    while (*upto < count && fixedpoint_compare(sorted[*upto], val) == 0)
+    {
+        ++*upto;
+    }
+}
+
+static int compare_fixedpoint(const void *left, const void *right)
+{
+    return fixedpoint_compare(*(const Fixedpoint *)left, *(const Fixedpoint *)right);
+}
+
+void test_fixedpoint_kll(TestObjs *objs)
+{
+    enum { COUNT = 20000, PARTS = 4, K = 200 };
+    Fixedpoint *vals = malloc(COUNT * sizeof(Fixedpoint));
+    uint64_t state = 0x3c6ef372fe94f82bUL;
+    for (size_t i = 0; i < COUNT; ++i)
+    {
+        vals[i] = fixedpoint_create2(test_rand(&state) % 1000, test_rand(&state));
+        if (test_rand(&state) & 1)
+        {
+            vals[i] = fixedpoint_negate(vals[i]);
+        }
+    }
+
+    FixedpointKll whole, parts[PARTS], other;
+    ASSERT(!fixedpoint_kll_init(&whole, 7));
+    ASSERT(fixedpoint_kll_init(&whole, K));
+    ASSERT(fixedpoint_is_err(fixedpoint_kll_quantile(&whole, objs->one_half)));
+    ASSERT(fixedpoint_kll_update(&whole, vals, COUNT));
+    for (int p = 0; p < PARTS; ++p)
+    {
+        ASSERT(fixedpoint_kll_init(&parts[p], K));
+        ASSERT(fixedpoint_kll_update(&parts[p], vals + p * (COUNT / PARTS), COUNT / PARTS));
+        if (p > 0)
+        {
+            ASSERT(fixedpoint_kll_merge(&parts[0], &parts[p]));
+        }
+    }
+    ASSERT(fixedpoint_kll_count(&whole) == COUNT && fixedpoint_kll_count(&parts[0]) == COUNT);
+
+    // The sketch is much smaller than the data
+    size_t retained = 0;
+    for (unsigned h = 0; h < whole.num_levels; ++h)
+    {
+        retained += whole.sizes[h];
+    }
+    ASSERT(retained < 4 * K);
+
+    // Estimated quantiles are close in rank to the exact ones, for the
+    // whole data and for merged partials
+    qsort(vals, COUNT, sizeof(Fixedpoint), compare_fixedpoint);
+    const char *fractions[7] = {"0", "0.01", "0.25", "0.5", "0.8", "0.99", "1"};
+    for (int f = 0; f < 7; ++f)
+    {
+        Fixedpoint fraction = fixedpoint_create_from_hex(fractions[f]);
+        uint64_t target = fixedpoint_mul(fraction, fixedpoint_create(COUNT)).whole;
+        for (int s = 0; s < 2; ++s)
+        {
+            Fixedpoint q = fixedpoint_kll_quantile(s ? &parts[0] : &whole, fraction);
+            ASSERT(fixedpoint_is_valid(q));
+            size_t below, upto;
+            test_rank(vals, COUNT, q, &below, &upto);
+            ASSERT(upto > below);
+            ASSERT(below <= target + COUNT / 50 && upto + COUNT / 50 >= target);
+        }
+    }
+
+    // The same updates give the same sketch
+    ASSERT(fixedpoint_kll_init(&other, K));
+    ASSERT(fixedpoint_kll_update(&other, vals, COUNT));
+    fixedpoint_kll_destroy(&parts[1]);
+    ASSERT(fixedpoint_kll_init(&parts[1], K));
+    ASSERT(fixedpoint_kll_update(&parts[1], vals, COUNT));
+    for (int f = 0; f < 7; ++f)
+    {
+        Fixedpoint fraction = fixedpoint_create_from_hex(fractions[f]);
+        ASSERT(fixedpoint_compare(fixedpoint_kll_quantile(&other, fraction),
+                                  fixedpoint_kll_quantile(&parts[1], fraction)) == 0);
+    }
+
+    // Small sketches are exact; invalid fractions and values are errors
+    fixedpoint_kll_destroy(&other);
+    ASSERT(fixedpoint_kll_init(&other, K));
+    Fixedpoint few[3] = {fixedpoint_create(3), fixedpoint_create(1), fixedpoint_create(2)};
+    ASSERT(fixedpoint_kll_update(&other, few, 3));
+    ASSERT(fixedpoint_compare(fixedpoint_kll_quantile(&other, objs->zero), fixedpoint_create(1)) == 0);
+    ASSERT(fixedpoint_compare(fixedpoint_kll_quantile(&other, objs->one_half), fixedpoint_create(2)) == 0);
+    ASSERT(fixedpoint_compare(fixedpoint_kll_quantile(&other, objs->one), fixedpoint_create(3)) == 0);
+    ASSERT(fixedpoint_is_err(fixedpoint_kll_quantile(&other, fixedpoint_create_from_hex("1.01"))));
+    ASSERT(fixedpoint_is_err(fixedpoint_kll_quantile(&other, fixedpoint_create_from_hex("-0.5"))));
+    FixedpointKll small_k;
+    ASSERT(fixedpoint_kll_init(&small_k, 100));
+    ASSERT(!fixedpoint_kll_merge(&other, &small_k));
+    ASSERT(fixedpoint_kll_update(&other, &objs->format_error, 1));
+    ASSERT(fixedpoint_kll_count(&other) == 3 && fixedpoint_is_err(fixedpoint_kll_quantile(&other, objs->one)));
+
+    fixedpoint_kll_destroy(&small_k);
+    fixedpoint_kll_destroy(&other);
+    fixedpoint_kll_destroy(&whole);
+    for (int p = 0; p < PARTS; ++p)
+    {
+        fixedpoint_kll_destroy(&parts[p]);
+    }
+    free(vals);
+}
+
+// The prefix sums of the sequential loop of fixedpoint_add
+static void naive_scan(const Fixedpoint *in, Fixedpoint *out, size_t count, int exclusive)
+{
+    Fixedpoint total = fixedpoint_create(0);
+    for (size_t i = 0; i < count; ++i)
+    {
+        Fixedpoint val = in[i];
+        if (exclusive)
+        {
+            out[i] = total;
+        }
+        total = fixedpoint_add(total, val);
+        if (!exclusive)
+        {
+            out[i] = total;
+        }
+    }
+}
+
+// Whether both scans, with several numbers of threads and in place, match
+// the sequential loop and return stop
+static int scans_match(const Fixedpoint *in, size_t count, size_t stop)
+{
+    static const unsigned threads[] = {1, 3, 8};
+    Fixedpoint *expected = malloc(count * sizeof(Fixedpoint));
+    Fixedpoint *out = malloc(count * sizeof(Fixedpoint));
+    int ok = expected != NULL && out != NULL;
+    for (int exclusive = 0; ok && exclusive < 2; ++exclusive)
+    {
+        naive_scan(in, expected, count, exclusive);
+        for (size_t t = 0; ok && t < sizeof(threads) / sizeof(threads[0]); ++t)
+        {
+            for (int in_place = 0; ok && in_place < 2; ++in_place)
+            {
+                const Fixedpoint *src = in;
+                if (in_place)
+                {
+                    memcpy(out, in, count * sizeof(Fixedpoint));
+                    src = out;
+                }
+                size_t result = exclusive ? fixedpoint_scan_exclusive(src, out, count, threads[t])
+                                          : fixedpoint_scan_inclusive(src, out, count, threads[t]);
+                ok = result == stop;
+                for (size_t i = 0; ok && i < count; ++i)
+                {
+                    ok = out[i].whole == expected[i].whole && out[i].frac == expected[i].frac &&
+                         out[i].tag == expected[i].tag;
+                }
+            }
+        }
+    }
+    free(expected);
+    free(out);
+    return ok;
+}
+
+void test_fixedpoint_scan(TestObjs *objs)
+{
+    enum { COUNT = 1001 };
+    Fixedpoint vals[COUNT];
+    uint64_t state = 0x3c6ef372fe94f82bUL;
+    for (size_t i = 0; i < COUNT; ++i)
+    {
+        vals[i] = fixedpoint_create2(test_rand(&state) % 1000, test_rand(&state));
+        if (test_rand(&state) % 3 == 0)
+        {
+            vals[i] = fixedpoint_negate(vals[i]);
+        }
+    }
+    ASSERT(scans_match(vals, COUNT, COUNT));
+    ASSERT(scans_match(vals, 5, 5));
+    ASSERT(scans_match(vals, 0, 0));
+
+    Fixedpoint out[4];
+    Fixedpoint small[4] = {objs->one, objs->one_half, fixedpoint_negate(objs->one), objs->one_half};
+    ASSERT(fixedpoint_scan_inclusive(small, out, 4, 2) == 4);
+    ASSERT(fixedpoint_compare(out[1], fixedpoint_create2(1, 0x8000000000000000UL)) == 0);
+    ASSERT(fixedpoint_is_zero(out[2]) == 0 && fixedpoint_compare(out[2], objs->one_half) == 0);
+    ASSERT(fixedpoint_compare(out[3], objs->one) == 0);
+    ASSERT(fixedpoint_scan_exclusive(small, out, 4, 2) == 4);
+    ASSERT(fixedpoint_is_zero(out[0]) && fixedpoint_compare(out[3], objs->one_half) == 0);
+
+    // Totals that return to 0 are non-negative, as fixedpoint_add leaves them
+    Fixedpoint cancel[4] = {objs->one, fixedpoint_negate(objs->one), fixedpoint_negate(objs->one), objs->one};
+    ASSERT(scans_match(cancel, 4, 4));
+    ASSERT(fixedpoint_scan_inclusive(cancel, out, 4, 2) == 4 && out[3].tag == VALID_NONNEGATIVE);
+
+    // The running total reaches the largest value, then overflows in a
+    // middle block
+    Fixedpoint total = fixedpoint_create(0);
+    for (size_t i = 0; i < 599; ++i)
+    {
+        total = fixedpoint_add(total, vals[i]);
+    }
+    vals[599] = fixedpoint_negate(total);
+    vals[600] = objs->max;
+    vals[601] = objs->one;
+    vals[602] = fixedpoint_negate(objs->max);
+    ASSERT(scans_match(vals, COUNT, 601));
+
+    // Totals at the limits of the range do not overflow
+    Fixedpoint limits[6] = {objs->max, objs->zero, fixedpoint_negate(objs->max), fixedpoint_negate(objs->max),
+                            objs->max, objs->max};
+    ASSERT(scans_match(limits, 6, 6));
+
+    // A value that is not valid stops the exact sums
+    vals[600] = vals[601] = vals[602] = objs->one;
+    vals[400] = objs->format_error;
+    ASSERT(scans_match(vals, COUNT, 400));
+    vals[400] = objs->overflow_positive;
+    vals[0] = objs->format_error;
+    ASSERT(scans_match(vals, COUNT, 0));
+}
+
+// Count the visits of each element of a range
+static void count_visits(void *arg, size_t begin, size_t end)
+{
+    unsigned *visits = arg;
+    // The cost of the elements grows along the array, so threads steal
+    for (size_t i = begin; i < end; ++i)
+    {
+        for (size_t spin = 0; spin < i / 64; ++spin)
+        {
+            __asm__ volatile("" ::: "memory");
+        }
+        ++visits[i];
+    }
+}
+
+static Fixedpoint square(Fixedpoint val)
+{
+    return fixedpoint_mul(val, val);
+}
+
+// Whether two arrays hold the same values with the same tags
+static int same_values(const Fixedpoint *left, const Fixedpoint *right, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (left[i].whole != right[i].whole || left[i].frac != right[i].frac || left[i].tag != right[i].tag)
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+void test_fixedpoint_pool_for(TestObjs *objs)
+{
+    (void)objs;
+    enum { COUNT = 10007 };
+    static unsigned visits[COUNT];
+    FixedpointPoolConfig config = {4, 37, NULL, 0};
+    FixedpointPool pool;
+    ASSERT(fixedpoint_pool_init(&pool, &config));
+    ASSERT(fixedpoint_pool_num_threads(&pool) == 4);
+    for (int round = 0; round < 3; ++round)
+    {
+        fixedpoint_pool_for(&pool, COUNT, count_visits, visits);
+    }
+    fixedpoint_pool_for(&pool, 0, count_visits, visits);
+    fixedpoint_pool_for(&pool, 5, count_visits, visits);
+    fixedpoint_pool_for(NULL, COUNT, count_visits, visits);
+    for (size_t i = 0; i < COUNT; ++i)
+    {
+        ASSERT(visits[i] == (i < 5 ? 5u : 4u));
+    }
+    fixedpoint_pool_destroy(&pool);
+    ASSERT(fixedpoint_pool_num_threads(NULL) == 1);
+
+    // Worker threads pinned to a CPU the process may run on, and the default
+    // configuration
+    cpu_set_t allowed;
+    int cpus[] = {0};
+    ASSERT(sched_getaffinity(0, sizeof(allowed), &allowed) == 0);
+    while (!CPU_ISSET(cpus[0], &allowed))
+    {
+        ++cpus[0];
+        ASSERT(cpus[0] < CPU_SETSIZE);
+    }
+    FixedpointPoolConfig pinned = {3, 100, cpus, 1};
+    ASSERT(fixedpoint_pool_init(&pool, &pinned));
+    fixedpoint_pool_for(&pool, COUNT, count_visits, visits);
+    fixedpoint_pool_destroy(&pool);
+    static const int bad_cpus[] = {-1};
+    FixedpointPoolConfig bad = {3, 100, bad_cpus, 1};
+    ASSERT(!fixedpoint_pool_init(&pool, &bad));
+    ASSERT(fixedpoint_pool_init(&pool, NULL));
+    ASSERT(fixedpoint_pool_num_threads(&pool) >= 1 && pool.chunk == FIXEDPOINT_POOL_DEFAULT_CHUNK);
+    fixedpoint_pool_for(&pool, COUNT, count_visits, visits);
+    fixedpoint_pool_destroy(&pool);
+    for (size_t i = 0; i < COUNT; ++i)
+    {
+        ASSERT(visits[i] == (i < 5 ? 7u : 6u));
+    }
+}
+
+void test_fixedpoint_pool_ops(TestObjs *objs)
+{
+    enum { COUNT = 1000 };
+    Fixedpoint left[COUNT], right[COUNT], out[COUNT], expected[COUNT];
+    uint64_t state = 0xa54ff53a5f1d36f1UL;
+    for (size_t i = 0; i < COUNT; ++i)
+    {
+        left[i] = fixedpoint_create2(test_rand(&state) >> (test_rand(&state) % 64), test_rand(&state));
+        right[i] = fixedpoint_create2(test_rand(&state) >> (test_rand(&state) % 64), test_rand(&state));
+        if (i % 3 == 0)
+        {
+            right[i] = fixedpoint_negate(right[i]);
+        }
+    }
+    left[10] = objs->max;
+    right[10] = objs->max;
+    left[11] = objs->format_error;
+    right[12] = objs->overflow_positive;
+
+    FixedpointPoolConfig config = {3, 16, NULL, 0};
+    FixedpointPool pool;
+    ASSERT(fixedpoint_pool_init(&pool, &config));
+
+    for (size_t i = 0; i < COUNT; ++i)
+    {
+        expected[i] = fixedpoint_add(left[i], right[i]);
+    }
+    fixedpoint_pool_add(&pool, left, right, out, COUNT);
+    ASSERT(same_values(out, expected, COUNT));
+    for (size_t i = 0; i < COUNT; ++i)
+    {
+        expected[i] = fixedpoint_sub(left[i], right[i]);
+    }
+    fixedpoint_pool_sub(&pool, left, right, out, COUNT);
+    ASSERT(same_values(out, expected, COUNT));
+    for (size_t i = 0; i < COUNT; ++i)
+    {
+        expected[i] = fixedpoint_negate(right[i]);
+    }
+    fixedpoint_pool_negate(&pool, right, out, COUNT);
+    ASSERT(same_values(out, expected, COUNT));
+    for (size_t i = 0; i < COUNT; ++i)
+    {
+        expected[i] = fixedpoint_halve(right[i]);
+    }
+    fixedpoint_pool_halve(&pool, right, out, COUNT);
+    ASSERT(same_values(out, expected, COUNT));
+    for (size_t i = 0; i < COUNT; ++i)
+    {
+        expected[i] = fixedpoint_double(right[i]);
+    }
+    fixedpoint_pool_double(&pool, right, out, COUNT);
+    ASSERT(same_values(out, expected, COUNT));
+
+    // A caller's kernel, in place
+    for (size_t i = 0; i < COUNT; ++i)
+    {
+        expected[i] = square(left[i]);
+    }
+    memcpy(out, left, sizeof(out));
+    fixedpoint_pool_map(&pool, out, out, COUNT, square);
+    ASSERT(same_values(out, expected, COUNT));
+    for (size_t i = 0; i < COUNT; ++i)
+    {
+        expected[i] = fixedpoint_mul(left[i], right[i]);
+    }
+    fixedpoint_pool_map2(NULL, left, right, out, COUNT, fixedpoint_mul);
+    ASSERT(same_values(out, expected, COUNT));
+    fixedpoint_pool_map2(&pool, left, right, out, COUNT, fixedpoint_mul);
+    ASSERT(same_values(out, expected, COUNT));
+    fixedpoint_pool_destroy(&pool);
+}
+
+// Set each value of a range from its index
+static void fill_index(void *arg, size_t begin, size_t end)
+{
+    Fixedpoint *vals = arg;
+    for (size_t i = begin; i < end; ++i)
+    {
+        vals[i] = fixedpoint_create2(i % 1000, (uint64_t)i << 40);
+        if (i % 3 == 0)
+        {
+            vals[i] = fixedpoint_negate(vals[i]);
+        }
+    }
+}
+
+void test_fixedpoint_numa(TestObjs *objs)
+{
+    enum { COUNT = 600000 };
+    FixedpointNuma numa;
+    ASSERT(fixedpoint_numa_init(&numa, 2));
+    ASSERT(numa.num_nodes >= 1);
+
+    FixedpointNumaArray vals, out, other;
+    ASSERT(fixedpoint_numa_alloc(&numa, &vals, COUNT, FIXEDPOINT_NUMA_BIND));
+    ASSERT(fixedpoint_numa_alloc(&numa, &out, COUNT, FIXEDPOINT_NUMA_FIRST_TOUCH));
+    ASSERT(out.placement == FIXEDPOINT_NUMA_FIRST_TOUCH);
+    ASSERT((uintptr_t)vals.vals % (2UL << 20) == 0);
+    ASSERT(vals.num_parts >= 1 && vals.num_parts <= numa.num_nodes);
+    ASSERT(vals.part_count * vals.num_parts >= COUNT);
+    ASSERT(vals.part_count * sizeof(Fixedpoint) % (2UL << 20) == 0);
+    for (size_t i = 0; i < COUNT; i += 1009)
+    {
+        ASSERT(fixedpoint_is_zero(vals.vals[i]) && vals.vals[i].tag == VALID_NONNEGATIVE);
+    }
+
+    fixedpoint_numa_for(&numa, &vals, fill_index, vals.vals);
+    FixedpointAccum expected;
+    fixedpoint_accum_init(&expected);
+    for (size_t i = 0; i < COUNT; ++i)
+    {
+        Fixedpoint val = fixedpoint_create2(i % 1000, (uint64_t)i << 40);
+        val = i % 3 == 0 ? fixedpoint_negate(val) : val;
+        ASSERT(fixedpoint_compare(vals.vals[i], val) == 0);
+        fixedpoint_accum_add(&expected, val);
+    }
+    ASSERT(fixedpoint_compare(fixedpoint_numa_sum(&numa, &vals), fixedpoint_accum_result(&expected)) == 0);
+
+    ASSERT(fixedpoint_numa_map(&numa, &vals, &out, fixedpoint_negate));
+    ASSERT(fixedpoint_compare(fixedpoint_numa_sum(&numa, &out),
+                              fixedpoint_negate(fixedpoint_accum_result(&expected))) == 0);
+    ASSERT(fixedpoint_numa_map2(&numa, &vals, &out, &out, fixedpoint_add));
+    for (size_t i = 0; i < COUNT; i += 997)
+    {
+        ASSERT(fixedpoint_is_zero(out.vals[i]));
+    }
+    ASSERT(fixedpoint_is_zero(fixedpoint_numa_sum(&numa, &out)));
+
+    // Arrays of different sizes are partitioned differently
+    ASSERT(fixedpoint_numa_alloc(&numa, &other, 10, FIXEDPOINT_NUMA_FIRST_TOUCH));
+    ASSERT(other.num_parts == 1);
+    ASSERT(!fixedpoint_numa_map(&numa, &vals, &other, fixedpoint_negate));
+    ASSERT(!fixedpoint_numa_map2(&numa, &vals, &out, &other, fixedpoint_add));
+    other.vals[9] = objs->format_error;
+    ASSERT(fixedpoint_is_err(fixedpoint_numa_sum(&numa, &other)));
+    fixedpoint_numa_free(&other);
+    ASSERT(fixedpoint_numa_alloc(&numa, &other, 0, FIXEDPOINT_NUMA_BIND));
+    ASSERT(fixedpoint_is_zero(fixedpoint_numa_sum(&numa, &other)));
+    fixedpoint_numa_free(&other);
+
+    // A size in bytes that would overflow fails instead of mapping too little
+    ASSERT(!fixedpoint_numa_alloc(&numa, &other, SIZE_MAX / sizeof(Fixedpoint), FIXEDPOINT_NUMA_FIRST_TOUCH));
+
+    fixedpoint_numa_free(&vals);
+    fixedpoint_numa_free(&out);
+    fixedpoint_numa_destroy(&numa);
+}
+
+// The tag an operator gives for operands that are not valid, as
+// fixedpoint_expr_eval does
+static Fixedpoint expr_propagate(Fixedpoint left, Fixedpoint right, Fixedpoint result)
+{
+    Fixedpoint tagged = {0, 0, ERROR};
+    if (!fixedpoint_is_valid(left) || !fixedpoint_is_valid(right))
+    {
+        tagged.tag = fixedpoint_is_valid(left) ? right.tag : left.tag;
+        return tagged;
+    }
+    return result;
+}
+
+static int same_fixedpoint(Fixedpoint left, Fixedpoint right)
+{
+    return left.whole == right.whole && left.frac == right.frac && left.tag == right.tag;
+}
+
+void test_fixedpoint_expr_eval(TestObjs *objs)
+{
+    enum { ROWS = 1000 };
+    static const char *const names[] = {"price", "qty", "fee"};
+    static Fixedpoint price[ROWS], qty[ROWS], fee[ROWS], out[ROWS];
+    const Fixedpoint *columns[] = {price, qty, fee};
+    uint64_t state = 0x510e527fade682d1UL;
+    for (size_t i = 0; i < ROWS; ++i)
+    {
+        price[i] = fixedpoint_create2(test_rand(&state) % 1000, test_rand(&state) & 0xffff000000000000UL);
+        qty[i] = fixedpoint_create(test_rand(&state) % 100);
+        fee[i] = fixedpoint_create2(test_rand(&state) % 4, test_rand(&state));
+        if (i % 5 == 0)
+        {
+            fee[i] = fixedpoint_negate(fee[i]);
+        }
+    }
+    price[7] = objs->max;
+    qty[7] = fixedpoint_create(2);
+    price[8] = objs->format_error;
+    fee[9] = objs->overflow_positive;
+    qty[10] = objs->overflow_positive;
+    fee[10] = objs->format_error;
+    price[11] = fixedpoint_create2(0, 1);
+
+    FixedpointExpr expr;
+    FixedpointExprScratch scratch;
+    fixedpoint_expr_scratch_init(&scratch);
+
+    ASSERT(fixedpoint_expr_compile(&expr, "price * qty - fee", names, 3, NULL));
+    ASSERT(expr.code_len == 2 && expr.num_registers == 1);
+    ASSERT(fixedpoint_expr_eval(&expr, columns, ROWS, out, &scratch));
+    for (size_t i = 0; i < ROWS; ++i)
+    {
+        Fixedpoint product = expr_propagate(price[i], qty[i], fixedpoint_mul(price[i], qty[i]));
+        ASSERT(same_fixedpoint(out[i], expr_propagate(product, fee[i], fixedpoint_sub(product, fee[i]))));
+    }
+    ASSERT(fixedpoint_is_overflow_pos(out[7]) && out[7].whole == 0);
+    ASSERT(fixedpoint_is_err(out[8]) && fixedpoint_is_overflow_pos(out[9]) && fixedpoint_is_overflow_pos(out[10]));
+    fixedpoint_expr_destroy(&expr);
+
+    // The absolute difference, with constants folded, in place
+    static Fixedpoint copy[ROWS];
+    memcpy(copy, fee, sizeof(copy));
+    const Fixedpoint *in_place[] = {price, qty, copy};
+    ASSERT(fixedpoint_expr_compile(&expr, "select(fee >= (1 - 1) * halve(2), fee, neg(fee)) * (0.8 + 0.8)", names,
+                                   3, NULL));
+    ASSERT(expr.num_constants == 2);
+    ASSERT(fixedpoint_expr_eval(&expr, in_place, ROWS, copy, &scratch));
+    for (size_t i = 0; i < ROWS; ++i)
+    {
+        if (i == 9 || i == 10)
+        {
+            ASSERT(same_fixedpoint(copy[i], expr_propagate(fee[i], fee[i], fee[i])));
+            continue;
+        }
+        Fixedpoint abs = fixedpoint_is_neg(fee[i]) ? fixedpoint_negate(fee[i]) : fee[i];
+        ASSERT(same_fixedpoint(copy[i], abs));
+    }
+
+    // Underflow of halve is kept in the tag through later operators, and
+    // comparisons give 1 or 0
+    fixedpoint_expr_destroy(&expr);
+    ASSERT(fixedpoint_expr_compile(&expr, "(halve(price) + 1) + (qty == 0) + (qty != 0) * 0", names, 3, NULL));
+    ASSERT(fixedpoint_expr_eval(&expr, columns, ROWS, out, &scratch));
+    ASSERT(fixedpoint_is_underflow_pos(out[11]) && out[11].whole == 0 && out[11].frac == 0);
+    for (size_t i = 12; i < ROWS; ++i)
+    {
+        Fixedpoint expected = fixedpoint_add(fixedpoint_halve(price[i]), fixedpoint_create(1));
+        expected = fixedpoint_add(expected, fixedpoint_create(fixedpoint_is_zero(qty[i])));
+        ASSERT(fixedpoint_is_underflow_pos(fixedpoint_halve(price[i])) ? fixedpoint_is_underflow_pos(out[i])
+                                                                        : same_fixedpoint(out[i], expected));
+    }
+    fixedpoint_expr_destroy(&expr);
+    fixedpoint_expr_scratch_destroy(&scratch);
+}
+
+void test_fixedpoint_expr_compile(TestObjs *objs)
+{
+    static const char *const names[] = {"a", "b", "c_2"};
+    Fixedpoint a[3] = {objs->one, objs->one_half, objs->max};
+    Fixedpoint b[3] = {objs->one_half, objs->one, objs->one};
+    Fixedpoint c[3] = {objs->zero, objs->one, fixedpoint_negate(objs->one)};
+    const Fixedpoint *columns[] = {a, b, c};
+    Fixedpoint out[3];
+    FixedpointExpr expr;
+    FixedpointExprScratch scratch;
+    fixedpoint_expr_scratch_init(&scratch);
+
+    // Registers are reused along a chain
+    ASSERT(fixedpoint_expr_compile(&expr, "double(a) + a - b + c_2 - a + b - c_2", names, 3, NULL));
+    ASSERT(expr.code_len == 7 && expr.num_registers == 1);
+    ASSERT(fixedpoint_expr_eval(&expr, columns, 3, out, &scratch));
+    ASSERT(same_fixedpoint(out[0], fixedpoint_create(2)) && same_fixedpoint(out[1], objs->one));
+    ASSERT(fixedpoint_is_overflow_pos(out[2]));
+    fixedpoint_expr_destroy(&expr);
+    ASSERT(fixedpoint_expr_compile(&expr, "(a + b) * (b + c_2) - (a * c_2 + b)", names, 3, NULL));
+    ASSERT(expr.num_registers == 2);
+    fixedpoint_expr_destroy(&expr);
+
+    // A formula that is only a column or a number
+    ASSERT(fixedpoint_expr_compile(&expr, " b ", names, 3, NULL));
+    ASSERT(expr.code_len == 0 && fixedpoint_expr_eval(&expr, columns, 3, out, &scratch));
+    ASSERT(same_fixedpoint(out[2], objs->one));
+    fixedpoint_expr_destroy(&expr);
+    ASSERT(fixedpoint_expr_compile(&expr, "-0a.8 * 2", names, 3, NULL));
+    ASSERT(expr.code_len == 0 && expr.num_constants == 1 && fixedpoint_expr_eval(&expr, columns, 3, out, &scratch));
+    ASSERT(same_fixedpoint(out[1], fixedpoint_negate(fixedpoint_create(0x15))));
+    fixedpoint_expr_destroy(&expr);
+    ASSERT(fixedpoint_expr_compile(&expr, "select(c_2, a, b) < (select(1, b, a))", names, 3, NULL));
+    ASSERT(fixedpoint_expr_eval(&expr, columns, 3, out, &scratch));
+    ASSERT(fixedpoint_is_zero(out[0]) && same_fixedpoint(out[1], objs->one) && fixedpoint_is_zero(out[2]));
+    fixedpoint_expr_destroy(&expr);
+
+    static const struct
+    {
+        const char *source;
+        size_t error_pos;
+    } errors[] = {
+        {"a +", 3}, {"a / b", 2}, {"a + d", 4}, {"sqrt(a)", 0}, {"a < b < c_2", 6}, {"1.2.3 + a", 0},
+        {"select(a, b)", 11}, {"(a + b", 6}, {"halve(a))", 8}, {"", 0}, {"a b", 2}, {"ff + a", 0},
+    };
+    for (size_t i = 0; i < sizeof(errors) / sizeof(errors[0]); ++i)
+    {
+        size_t pos = 999;
+        ASSERT(!fixedpoint_expr_compile(&expr, errors[i].source, names, 3, &pos));
+        ASSERT(pos == errors[i].error_pos);
+    }
+    fixedpoint_expr_scratch_destroy(&scratch);
+}
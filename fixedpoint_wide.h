@@ -0,0 +1,67 @@
+#ifndef FIXEDPOINT_WIDE_H
+#define FIXEDPOINT_WIDE_H
+
+#include <stdint.h>
+#include "fixedpoint.h"
+
+// Helpers for the 128 and 256 bit integer arithmetic shared by the modules
+// that compute with wider intermediates than a Fixedpoint value. This header
+// is internal to the library: it is not included by any public header.
+
+__extension__ typedef unsigned __int128 u128;
+__extension__ typedef __int128 i128;
+
+// A 256 bit two's complement number
+//
+// Fields:
+//  lo - the low 128 bits
+//  hi - the high 128 bits (with the sign)
+typedef struct
+{
+    u128 lo;
+    u128 hi;
+} Wide;
+
+// The magnitude of a Fixedpoint value in units of 2^-64
+static inline u128 magnitude(Fixedpoint val)
+{
+    return (u128)val.whole << 64 | val.frac;
+}
+
+// The magnitude of a signed 128 bit number
+static inline u128 abs_wide(i128 v)
+{
+    return v < 0 ? -(u128)v : (u128)v;
+}
+
+// The number of bits of x, not counting leading zeros (0 if x is 0)
+static inline unsigned bit_length(u128 x)
+{
+    uint64_t upper = (uint64_t)(x >> 64);
+    if (upper != 0)
+    {
+        return 128 - (unsigned)__builtin_clzl(upper);
+    }
+    return (uint64_t)x == 0 ? 0 : 64 - (unsigned)__builtin_clzl((uint64_t)x);
+}
+
+// Multiply two 128 bit numbers into a 256 bit product upper:lower
+static inline void mul_128(u128 a, u128 b, u128 *upper, u128 *lower)
+{
+    uint64_t a0 = (uint64_t)a, a1 = (uint64_t)(a >> 64);
+    uint64_t b0 = (uint64_t)b, b1 = (uint64_t)(b >> 64);
+    u128 lo = (u128)a0 * b0;
+    u128 mid1 = (u128)a1 * b0;
+    u128 mid2 = (u128)a0 * b1;
+    u128 mid = (lo >> 64) + (uint64_t)mid1 + (uint64_t)mid2;
+    *upper = (u128)a1 * b1 + (mid1 >> 64) + (mid2 >> 64) + (mid >> 64);
+    *lower = mid << 64 | (uint64_t)lo;
+}
+
+static inline Wide wide_negate(Wide a)
+{
+    Wide r = {-a.lo, ~a.hi + (a.lo == 0)};
+    return r;
+}
+
+#endif // FIXEDPOINT_WIDE_H
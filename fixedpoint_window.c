@@ -0,0 +1,270 @@
+#include <stdlib.h>
+#include "fixedpoint_window.h"
+#include "fixedpoint256.h"
+
+static Fixedpoint error_value(void)
+{
+    Fixedpoint error = {0, 0, ERROR};
+    return error;
+}
+
+int fixedpoint_rolling_init(FixedpointRolling *r, size_t window)
+{
+    if (window == 0)
+    {
+        return 0;
+    }
+    r->samples = malloc(window * sizeof(Fixedpoint));
+    r->min_deque = malloc(window * sizeof(uint64_t));
+    r->max_deque = malloc(window * sizeof(uint64_t));
+    r->window = window;
+    if (!r->samples || !r->min_deque || !r->max_deque)
+    {
+        fixedpoint_rolling_destroy(r);
+        return 0;
+    }
+    fixedpoint_rolling_reset(r);
+    return 1;
+}
+
+void fixedpoint_rolling_reset(FixedpointRolling *r)
+{
+    fixedpoint_accum_init(&r->sum);
+    r->pushed = 0;
+    r->invalid = 0;
+    r->min_head = r->min_len = 0;
+    r->max_head = r->max_len = 0;
+}
+
+void fixedpoint_rolling_destroy(FixedpointRolling *r)
+{
+    free(r->samples);
+    free(r->min_deque);
+    free(r->max_deque);
+    r->samples = NULL;
+    r->min_deque = NULL;
+    r->max_deque = NULL;
+}
+
+// Push sequence number seq, holding sample, onto the back of a monotonic
+// deque, first removing the entries it makes useless: those that are not
+// below it for the minimum (sign 1), or not above it for the maximum
+// (sign -1)
+static void deque_push(const FixedpointRolling *r, uint64_t *deque, size_t head, size_t *len, uint64_t seq,
+                       Fixedpoint sample, int sign)
+{
+    while (*len > 0)
+    {
+        uint64_t back = deque[(head + *len - 1) % r->window];
+        if (fixedpoint_compare(r->samples[back % r->window], sample) * sign < 0)
+        {
+            break;
+        }
+        --*len;
+    }
+    deque[(head + *len) % r->window] = seq;
+    ++*len;
+}
+
+// Remove the front of a monotonic deque if it is sequence number seq
+static void deque_expire(const FixedpointRolling *r, const uint64_t *deque, size_t *head, size_t *len, uint64_t seq)
+{
+    if (*len > 0 && deque[*head] == seq)
+    {
+        *head = *head + 1 == r->window ? 0 : *head + 1;
+        --*len;
+    }
+}
+
+void fixedpoint_rolling_push(FixedpointRolling *r, Fixedpoint sample)
+{
+    uint64_t seq = r->pushed;
+    size_t slot = seq % r->window;
+    if (seq >= r->window)
+    {
+        Fixedpoint old = r->samples[slot];
+        if (fixedpoint_is_valid(old))
+        {
+            fixedpoint_accum_sub(&r->sum, old);
+        }
+        else
+        {
+            --r->invalid;
+        }
+        deque_expire(r, r->min_deque, &r->min_head, &r->min_len, seq - r->window);
+        deque_expire(r, r->max_deque, &r->max_head, &r->max_len, seq - r->window);
+    }
+
+    // Samples that are not valid are counted, but not summed or ordered
+    r->samples[slot] = sample;
+    if (fixedpoint_is_valid(sample))
+    {
+        fixedpoint_accum_add(&r->sum, sample);
+        deque_push(r, r->min_deque, r->min_head, &r->min_len, seq, sample, 1);
+        deque_push(r, r->max_deque, r->max_head, &r->max_len, seq, sample, -1);
+    }
+    else
+    {
+        ++r->invalid;
+    }
+    r->pushed = seq + 1;
+}
+
+size_t fixedpoint_rolling_count(const FixedpointRolling *r)
+{
+    return r->pushed < r->window ? (size_t)r->pushed : r->window;
+}
+
+Fixedpoint fixedpoint_rolling_sum(const FixedpointRolling *r)
+{
+    return r->invalid ? error_value() : fixedpoint_accum_result(&r->sum);
+}
+
+Fixedpoint fixedpoint_rolling_mean(const FixedpointRolling *r, FixedpointRound mode)
+{
+    size_t count = fixedpoint_rolling_count(r);
+    if (r->invalid || count == 0)
+    {
+        return error_value();
+    }
+    return fixedpoint_accum_div(&r->sum, count, mode);
+}
+
+Fixedpoint fixedpoint_rolling_min(const FixedpointRolling *r)
+{
+    if (r->invalid || r->min_len == 0)
+    {
+        return error_value();
+    }
+    return r->samples[r->min_deque[r->min_head] % r->window];
+}
+
+Fixedpoint fixedpoint_rolling_max(const FixedpointRolling *r)
+{
+    if (r->invalid || r->max_len == 0)
+    {
+        return error_value();
+    }
+    return r->samples[r->max_deque[r->max_head] % r->window];
+}
+
+int fixedpoint_ema_init(FixedpointEma *ema, unsigned shift, FixedpointRound mode)
+{
+    if (shift > 64)
+    {
+        return 0;
+    }
+    ema->value = fixedpoint_create(0);
+    ema->shift = shift;
+    ema->mode = mode;
+    ema->primed = 0;
+    return 1;
+}
+
+// Divide a Fixedpoint256 value whose lowest limb is 0 by 2^shift, for shift
+// at most 64; the result is exact
+static Fixedpoint256 shr256(Fixedpoint256 val, unsigned shift)
+{
+    if (shift == 0)
+    {
+        return val;
+    }
+    for (int i = 0; i < FIXEDPOINT256_LIMBS; ++i)
+    {
+        uint64_t next = i + 1 < FIXEDPOINT256_LIMBS ? val.limb[i + 1] : 0;
+        val.limb[i] = shift == 64 ? next : val.limb[i] >> shift | next << (64 - shift);
+    }
+    return val;
+}
+
+Fixedpoint fixedpoint_ema_update(FixedpointEma *ema, Fixedpoint sample)
+{
+    if (!fixedpoint_is_valid(ema->value) || !fixedpoint_is_valid(sample))
+    {
+        ema->value = error_value();
+        return ema->value;
+    }
+    if (!ema->primed)
+    {
+        ema->primed = 1;
+        ema->value = sample;
+        return sample;
+    }
+
+    // avg + (x - avg) / 2^shift lies between avg and x, so it can always be
+    // represented
+    Fixedpoint256 avg = fixedpoint256_from_fixedpoint(ema->value);
+    Fixedpoint256 step = shr256(fixedpoint256_sub(fixedpoint256_from_fixedpoint(sample), avg), ema->shift);
+    Fixedpoint result = fixedpoint256_to_fixedpoint(fixedpoint256_add(avg, step), ema->mode);
+    ema->value = result;
+    if (result.tag == UNDERFLOW_POSITIVE || result.tag == UNDERFLOW_NEGATIVE)
+    {
+        int negative = result.tag == UNDERFLOW_NEGATIVE && (result.whole != 0 || result.frac != 0);
+        ema->value.tag = negative ? VALID_NEGATIVE : VALID_NONNEGATIVE;
+    }
+    return result;
+}
+
+int fixedpoint_bars_init(FixedpointBars *bars, uint64_t interval)
+{
+    if (interval == 0)
+    {
+        return 0;
+    }
+    bars->interval = interval;
+    bars->active = 0;
+    return 1;
+}
+
+int fixedpoint_bars_push(FixedpointBars *bars, uint64_t time, Fixedpoint price, FixedpointBar *completed)
+{
+    uint64_t start = time - time % bars->interval;
+    int done = 0;
+    if (bars->active && start != bars->current.start)
+    {
+        *completed = bars->current;
+        bars->active = 0;
+        done = 1;
+    }
+
+    FixedpointBar *bar = &bars->current;
+    if (!fixedpoint_is_valid(price))
+    {
+        price = error_value();
+    }
+    if (!bars->active)
+    {
+        bar->start = start;
+        bar->open = bar->high = bar->low = bar->close = price;
+        bar->count = 1;
+        bars->active = 1;
+        return done;
+    }
+    ++bar->count;
+    if (fixedpoint_is_err(bar->close) || fixedpoint_is_err(price))
+    {
+        bar->open = bar->high = bar->low = bar->close = error_value();
+        return done;
+    }
+    if (fixedpoint_compare(price, bar->high) > 0)
+    {
+        bar->high = price;
+    }
+    if (fixedpoint_compare(price, bar->low) < 0)
+    {
+        bar->low = price;
+    }
+    bar->close = price;
+    return done;
+}
+
+int fixedpoint_bars_flush(FixedpointBars *bars, FixedpointBar *completed)
+{
+    if (!bars->active)
+    {
+        return 0;
+    }
+    *completed = bars->current;
+    bars->active = 0;
+    return 1;
+}
@@ -0,0 +1,250 @@
+#ifndef FIXEDPOINT_WINDOW_H
+#define FIXEDPOINT_WINDOW_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "fixedpoint.h"
+#include "fixedpoint_accum.h"
+
+// Streaming aggregations over Fixedpoint samples: rolling sums, means,
+// minimums and maximums over the last few samples, exponential moving
+// averages, and open/high/low/close bars over buckets of time.
+//
+// Each sample is processed in constant (amortized) time. The rolling sum is
+// kept in an exact accumulator, adding each sample as it enters the window
+// and subtracting it as it leaves, so it never drifts. The minimum and
+// maximum are kept in monotonic deques: the samples of the window that
+// could still become the minimum (or maximum), in order, so the oldest is
+// the answer.
+
+// A struct that holds aggregations over a sliding window of samples
+//
+// Fields:
+//  samples - the last window samples, in a ring indexed by sequence number
+//  min_deque - the sequence numbers of the samples that may become the
+//              minimum, oldest first (a ring of window entries)
+//  max_deque - the same for the maximum
+//  sum - the exact sum of the valid samples in the window
+//  window - the number of samples in the window
+//  pushed - the number of samples pushed since the last reset
+//  invalid - the number of samples in the window that are not valid
+//  min_head, min_len - the first entry of min_deque and its length
+//  max_head, max_len - the same for max_deque
+typedef struct
+{
+    Fixedpoint *samples;
+    uint64_t *min_deque;
+    uint64_t *max_deque;
+    FixedpointAccum sum;
+    size_t window;
+    uint64_t pushed;
+    size_t invalid;
+    size_t min_head, min_len;
+    size_t max_head, max_len;
+} FixedpointRolling;
+
+// A struct that holds an exponential moving average with smoothing factor
+// 2^-shift: each sample x updates the average to avg + (x - avg) / 2^shift,
+// computed exactly and rounded once.
+//
+// Fields:
+//  value - the current average
+//  shift - the smoothing factor is 2^-shift
+//  mode - how each update is rounded
+//  primed - whether a sample has been seen (the first sample becomes the
+//           average)
+typedef struct
+{
+    Fixedpoint value;
+    unsigned shift;
+    FixedpointRound mode;
+    int primed;
+} FixedpointEma;
+
+// A struct that holds an open/high/low/close bar
+//
+// Fields:
+//  start - the start of the bar's bucket of time
+//  open - the first price in the bucket
+//  high - the highest price
+//  low - the lowest price
+//  close - the last price
+//  count - the number of prices
+typedef struct
+{
+    uint64_t start;
+    Fixedpoint open;
+    Fixedpoint high;
+    Fixedpoint low;
+    Fixedpoint close;
+    size_t count;
+} FixedpointBar;
+
+// A struct that builds bars from a stream of timestamped prices
+//
+// Fields:
+//  interval - the length of each bucket of time; the bucket of time t
+//             starts at t - t % interval
+//  current - the bar being built
+//  active - whether current holds at least one price
+typedef struct
+{
+    uint64_t interval;
+    FixedpointBar current;
+    int active;
+} FixedpointBars;
+
+// Initialize a sliding window, with no samples.
+//
+// Parameters:
+//   r - pointer to the window to initialize
+//   window - the number of samples in the window, at least 1
+//
+// Returns:
+//   1 if successful;
+//   0 if window is 0 or memory could not be allocated
+int fixedpoint_rolling_init(FixedpointRolling *r, size_t window);
+
+// Remove every sample from a sliding window.
+//
+// Parameters:
+//   r - pointer to the window
+void fixedpoint_rolling_reset(FixedpointRolling *r);
+
+// Free the memory owned by a sliding window.
+//
+// Parameters:
+//   r - pointer to the window
+void fixedpoint_rolling_destroy(FixedpointRolling *r);
+
+// Add a sample to a sliding window, removing the oldest one if the window
+// is full.
+//
+// Parameters:
+//   r - pointer to the window
+//   sample - the sample
+void fixedpoint_rolling_push(FixedpointRolling *r, Fixedpoint sample);
+
+// Get the number of samples in a sliding window.
+//
+// Parameters:
+//   r - pointer to the window
+//
+// Returns:
+//   the number of samples pushed, up to the size of the window
+size_t fixedpoint_rolling_count(const FixedpointRolling *r);
+
+// Get the sum of the samples in a sliding window.
+//
+// Parameters:
+//   r - pointer to the window
+//
+// Returns:
+//   the exact sum (0 if there are no samples);
+//   if it cannot be represented, a value for which either
+//   fixedpoint_is_overflow_pos or fixedpoint_is_overflow_neg returns true,
+//   as fixedpoint_accum_result returns;
+//   an error value if a sample in the window is not valid
+Fixedpoint fixedpoint_rolling_sum(const FixedpointRolling *r);
+
+// Get the mean of the samples in a sliding window.
+//
+// Parameters:
+//   r - pointer to the window
+//   mode - how to round the mean to a multiple of 2^-64
+//
+// Returns:
+//   the mean rounded according to mode (with FIXEDPOINT_ROUND_EXACT, a value
+//   for which fixedpoint_is_underflow_pos or fixedpoint_is_underflow_neg
+//   returns true if it is inexact);
+//   an error value if there are no samples or a sample in the window is not
+//   valid
+Fixedpoint fixedpoint_rolling_mean(const FixedpointRolling *r, FixedpointRound mode);
+
+// Get the smallest sample in a sliding window.
+//
+// Parameters:
+//   r - pointer to the window
+//
+// Returns:
+//   the smallest sample;
+//   an error value if there are no samples or a sample in the window is not
+//   valid
+Fixedpoint fixedpoint_rolling_min(const FixedpointRolling *r);
+
+// Get the largest sample in a sliding window.
+//
+// Parameters:
+//   r - pointer to the window
+//
+// Returns:
+//   the largest sample;
+//   an error value if there are no samples or a sample in the window is not
+//   valid
+Fixedpoint fixedpoint_rolling_max(const FixedpointRolling *r);
+
+// Initialize an exponential moving average, with no samples.
+//
+// Parameters:
+//   ema - pointer to the average to initialize
+//   shift - the smoothing factor is 2^-shift, with shift at most 64
+//   mode - how to round each update to a multiple of 2^-64
+//
+// Returns:
+//   1 if successful;
+//   0 if shift is more than 64
+int fixedpoint_ema_init(FixedpointEma *ema, unsigned shift, FixedpointRound mode);
+
+// Update an exponential moving average with a sample.
+//
+// Parameters:
+//   ema - pointer to the average
+//   sample - the sample
+//
+// Returns:
+//   the new average (with FIXEDPOINT_ROUND_EXACT, a value for which
+//   fixedpoint_is_underflow_pos or fixedpoint_is_underflow_neg returns true
+//   if the update was inexact; the average keeps the rounded value);
+//   an error value if this or an earlier sample was not valid (until the
+//   average is initialized again)
+Fixedpoint fixedpoint_ema_update(FixedpointEma *ema, Fixedpoint sample);
+
+// Initialize a bar builder, with no prices.
+//
+// Parameters:
+//   bars - pointer to the builder to initialize
+//   interval - the length of each bucket of time, at least 1
+//
+// Returns:
+//   1 if successful;
+//   0 if interval is 0
+int fixedpoint_bars_init(FixedpointBars *bars, uint64_t interval);
+
+// Add a price to a bar builder. Times should not decrease: a price in a
+// different bucket from the current bar completes it and starts a new one.
+// A price that is not valid makes open, high, low and close of its bar
+// error values.
+//
+// Parameters:
+//   bars - pointer to the builder
+//   time - the time of the price
+//   price - the price
+//   completed - receives the completed bar, if there is one
+//
+// Returns:
+//   1 if a bar was completed;
+//   0 otherwise
+int fixedpoint_bars_push(FixedpointBars *bars, uint64_t time, Fixedpoint price, FixedpointBar *completed);
+
+// Complete the current bar of a bar builder, if it has any prices.
+//
+// Parameters:
+//   bars - pointer to the builder
+//   completed - receives the completed bar, if there is one
+//
+// Returns:
+//   1 if a bar was completed;
+//   0 otherwise
+int fixedpoint_bars_flush(FixedpointBars *bars, FixedpointBar *completed);
+
+#endif // FIXEDPOINT_WINDOW_H